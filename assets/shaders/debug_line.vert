@@ -0,0 +1,55 @@
+#version 450
+
+// one instance per line, expanded into a quad of constant screen width,
+// see core/debug/debug_renderer.hpp
+layout(location=0) in vec3 a_start;
+layout(location=1) in vec4 a_color;     // unorm8
+layout(location=2) in vec3 a_end;
+
+layout(location=0) out vec4 v_color;
+
+layout(push_constant) uniform line_constants {
+    mat4 view_projection;
+    vec2 half_viewport;     // pixels
+    float width;            // pixels
+} lines;
+
+// x picks the end, y the side. clockwise like the rest of the pipelines
+const vec2 corners[6] = vec2[](
+    vec2(0.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(0.0, -1.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+// lines that cross the camera plane are cut just in front of it
+const float min_w = 0.001;
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex];
+
+    vec4 start = lines.view_projection * vec4(a_start, 1.0);
+    vec4 end = lines.view_projection * vec4(a_end, 1.0);
+
+    v_color = a_color;
+
+    // all of it behind the camera, outside the clip volume
+    if(start.w < min_w && end.w < min_w) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    if(start.w < min_w) start = mix(start, end, (min_w - start.w) / (end.w - start.w));
+    if(end.w < min_w) end = mix(end, start, (min_w - end.w) / (start.w - end.w));
+
+    vec2 screen_start = start.xy / start.w * lines.half_viewport;
+    vec2 screen_end = end.xy / end.w * lines.half_viewport;
+
+    vec2 direction = screen_end - screen_start;
+    direction = dot(direction, direction) > 0.0 ? normalize(direction) : vec2(1.0, 0.0);
+    vec2 normal = vec2(-direction.y, direction.x);
+
+    vec4 position = corner.x == 0.0 ? start : end;
+    vec2 offset = normal * (corner.y * lines.width * 0.5) / lines.half_viewport;
+    position.xy += offset * position.w;
+
+    gl_Position = position;
+}
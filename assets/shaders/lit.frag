@@ -0,0 +1,75 @@
+#version 450
+
+// shades with the lights of the fragment's cluster only, the lists come
+// from light_cull.comp
+
+const uint size_x = 16;
+const uint size_y = 9;
+const uint size_z = 24;
+const uint max_lights_per_cluster = 128;
+
+layout(location=0) in vec3 v_position;
+layout(location=1) in vec3 v_normal;
+
+layout(location=0) out vec4 out_color;
+
+struct light {
+    vec4 position_radius;
+    vec4 color_intensity;
+};
+
+layout(set=0, binding=0) uniform cluster_params {
+    mat4 projection;
+    float near_plane;
+    float far_plane;
+    float inv_scale_x;
+    float inv_scale_y;
+    vec4 screen;            // width, height, slice scale, slice bias
+    uvec4 counts;
+} params;
+
+layout(set=0, binding=1) readonly buffer light_buffer {
+    light lights[];
+};
+
+layout(set=0, binding=2) readonly buffer cluster_counts {
+    uint counts[];
+};
+
+layout(set=0, binding=3) readonly buffer cluster_indices {
+    uint indices[];
+};
+
+const vec3 albedo = vec3(0.8);
+const vec3 ambient = vec3(0.03);
+
+void main() {
+    float depth = max(-v_position.z, params.near_plane);
+
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / params.screen.xy * vec2(size_x, size_y)), uvec2(size_x - 1, size_y - 1));
+    uint slice = uint(clamp(floor(log(depth) * params.screen.z - params.screen.w), 0.0, float(size_z - 1)));
+    uint cluster = tile.x + size_x * (tile.y + size_y * slice);
+
+    vec3 normal = normalize(v_normal);
+    vec3 color = ambient * albedo;
+
+    uint count = counts[cluster];
+    uint base = cluster * max_lights_per_cluster;
+
+    for(uint i = 0; i < count; i++) {
+        light l = lights[indices[base + i]];
+
+        vec3 to_light = l.position_radius.xyz - v_position;
+        float distance = length(to_light);
+        if(distance >= l.position_radius.w) continue;
+
+        // smooth falloff that reaches 0 at the radius
+        float falloff = 1.0 - distance / l.position_radius.w;
+        falloff *= falloff;
+
+        float diffuse = max(dot(normal, to_light / distance), 0.0);
+        color += albedo * l.color_intensity.rgb * l.color_intensity.a * diffuse * falloff;
+    }
+
+    out_color = vec4(color, 1.0);
+}
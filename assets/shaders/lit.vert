@@ -0,0 +1,44 @@
+#version 450
+
+// quantized vertices from .mesh files (see core/graphics/mesh_format.hpp)
+// with view space outputs, for clustered lighting (lit.frag)
+layout(location=0) in vec4 a_position;  // unorm16 inside the mesh bounds
+layout(location=1) in vec2 a_normal;    // octahedral, snorm16
+layout(location=2) in vec2 a_uv;        // half floats
+
+layout(location=0) out vec3 v_position; // view space
+layout(location=1) out vec3 v_normal;
+
+layout(push_constant) uniform mesh_constants {
+    mat4 model_view;
+    vec4 bounds_min;
+    vec4 bounds_extent;
+} mesh;
+
+layout(set=0, binding=0) uniform cluster_params {
+    mat4 projection;
+    float near_plane;
+    float far_plane;
+    float inv_scale_x;
+    float inv_scale_y;
+    vec4 screen;
+    uvec4 counts;
+} params;
+
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = mesh.bounds_min.xyz + a_position.xyz * mesh.bounds_extent.xyz;
+    vec4 view_position = mesh.model_view * vec4(position, 1.0);
+
+    v_position = view_position.xyz;
+    // uniform scale only
+    v_normal = mat3(mesh.model_view) * decode_octahedral(a_normal);
+    gl_Position = params.projection * view_position;
+}
@@ -0,0 +1,15 @@
+#version 450
+
+layout(location=0) in vec2 v_uv;
+layout(location=1) in vec4 v_color;
+
+layout(location=0) out vec4 out_color;
+
+void main() {
+    // a soft disc
+    float d = length(v_uv - 0.5) * 2.0;
+    float alpha = 1.0 - smoothstep(0.5, 1.0, d);
+    if(alpha <= 0.0) discard;
+
+    out_color = vec4(v_color.rgb, v_color.a * alpha);
+}
@@ -0,0 +1,49 @@
+#version 450
+
+// a camera facing quad per instance, the particles come from the
+// compute passes in particles.comp, sorted if the system sorts them
+struct particle {
+    vec4 position_age;
+    vec4 velocity_lifetime;
+    uvec4 color_size;
+};
+
+layout(set=0, binding=0) readonly buffer particle_buffer {
+    particle particles[];
+};
+
+layout(set=0, binding=5) readonly buffer draw_entries {
+    uvec2 entries[];
+};
+
+layout(push_constant) uniform particle_camera {
+    mat4 view;
+    mat4 projection;
+} camera;
+
+layout(location=0) out vec2 v_uv;
+layout(location=1) out vec4 v_color;
+
+// clockwise on screen, like the rest of the pipelines
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    particle p = particles[entries[gl_InstanceIndex].y];
+    vec2 corner = corners[gl_VertexIndex];
+
+    float size = uintBitsToFloat(p.color_size.y);
+    // fade out over the last quarter of its life
+    float life = p.position_age.w / p.velocity_lifetime.w;
+
+    vec4 center = camera.view * vec4(p.position_age.xyz, 1.0);
+    // corner y grows down the screen, view space y up
+    vec2 offset = vec2(corner.x - 0.5, 0.5 - corner.y) * size;
+
+    v_uv = corner;
+    v_color = unpackUnorm4x8(p.color_size.x);
+    v_color.a *= clamp((1.0 - life) * 4.0, 0.0, 1.0);
+    gl_Position = camera.projection * vec4(center.xy + offset, center.zw);
+}
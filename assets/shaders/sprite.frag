@@ -0,0 +1,12 @@
+#version 450
+
+layout(location=0) in vec2 v_uv;
+layout(location=1) in vec4 v_color;
+
+layout(location=0) out vec4 out_color;
+
+layout(set=0, binding=0) uniform sampler2D atlas;
+
+void main() {
+    out_color = texture(atlas, v_uv) * v_color;
+}
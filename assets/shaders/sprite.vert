@@ -0,0 +1,34 @@
+#version 450
+
+// one instance per sprite, see core/graphics/sprite_batch.hpp
+layout(location=0) in vec2 a_position;  // center, pixels
+layout(location=1) in vec2 a_size;
+layout(location=2) in vec4 a_uv_rect;   // min.xy, max.xy, unorm16
+layout(location=3) in vec4 a_color;     // unorm8
+layout(location=4) in float a_rotation;
+
+layout(location=0) out vec2 v_uv;
+layout(location=1) out vec4 v_color;
+
+layout(push_constant) uniform sprite_constants {
+    vec2 scale;     // pixels to clip space
+} sprite;
+
+// clockwise on screen, like the rest of the pipelines
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex];
+    vec2 local = (corner - 0.5) * a_size;
+
+    float s = sin(a_rotation);
+    float c = cos(a_rotation);
+    vec2 rotated = vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    v_uv = mix(a_uv_rect.xy, a_uv_rect.zw, corner);
+    v_color = a_color;
+    gl_Position = vec4((a_position + rotated) * sprite.scale - 1.0, 0.0, 1.0);
+}
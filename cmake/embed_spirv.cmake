@@ -0,0 +1,34 @@
+# turns a .spv file into a header with its words as a constexpr array
+#
+# usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.hpp> -DNAME=<identifier> -P embed_spirv.cmake
+
+file(READ "${INPUT}" hex HEX)
+
+# SPIR-V is little-endian 32-bit words, so flip every 4 bytes
+string(REGEX REPLACE
+	"([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+	"0x\\4\\3\\2\\1u,"
+	words "${hex}")
+
+# a line break every 8 words so the header stays readable
+string(REPEAT "0x[0-9a-f]+u," 8 row)
+string(REGEX REPLACE "(${row})" "\\1\n\t\t" words "${words}")
+
+file(WRITE "${OUTPUT}.tmp"
+"// generated from ${INPUT}, do not edit\n\
+#pragma once\n\
+\n\
+#include <cstdint>\n\
+#include <cstddef>\n\
+\n\
+namespace shaders::embedded {\n\
+	constexpr uint32_t ${NAME}[] = {\n\
+		${words}\n\
+	};\n\
+	constexpr size_t ${NAME}_size = sizeof(${NAME});\n\
+}\n")
+
+# only touch the header when it actually changed, so sources including it
+# don't rebuild for nothing
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,103 @@
+# shader build graph: every GLSL source gets its own custom command, so the
+# build tool compiles them in parallel and only redoes the ones whose source
+# (or anything they #include, through glslc's depfile) changed.
+#
+#   add_shaders(<target> <sources...>)
+#
+# SPIR-V ends up in ${CMAKE_BINARY_DIR}/shaders/<name>.spv. with
+# GAME_EMBED_SHADERS each one also becomes shaders/<name>.hpp (under the
+# generated include dir), with the words as a constexpr array.
+
+find_program(GLSLC_EXECUTABLE glslc HINTS "$ENV{VULKAN_SDK}/bin")
+find_program(SPIRV_OPT_EXECUTABLE spirv-opt HINTS "$ENV{VULKAN_SDK}/bin")
+
+option(GAME_OPTIMIZE_SHADERS "Run spirv-opt -O over compiled shaders" OFF)
+option(GAME_EMBED_SHADERS "Embed SPIR-V in the executable instead of reading .spv files" OFF)
+
+set(SHADER_OUTPUT_DIR "${CMAKE_BINARY_DIR}/shaders")
+set(SHADER_GENERATED_INCLUDE_DIR "${CMAKE_BINARY_DIR}/generated")
+
+# make paths in depfiles relative to the build dir like ninja expects
+if(POLICY CMP0116)
+	cmake_policy(SET CMP0116 NEW)
+endif()
+
+function(add_shaders target)
+	if(NOT GLSLC_EXECUTABLE)
+		message(WARNING "glslc not found, using the prebuilt SPIR-V in assets/shaders")
+		target_compile_definitions(${target} PRIVATE SHADERS="${CMAKE_SOURCE_DIR}/assets/shaders/")
+		return()
+	endif()
+
+	file(MAKE_DIRECTORY "${SHADER_OUTPUT_DIR}" "${SHADER_GENERATED_INCLUDE_DIR}/shaders")
+
+	# depfiles on makefile generators need cmake 3.20
+	set(use_depfile OFF)
+	if(CMAKE_GENERATOR MATCHES "Ninja" OR NOT CMAKE_VERSION VERSION_LESS 3.20)
+		set(use_depfile ON)
+	endif()
+
+	set(outputs "")
+
+	foreach(source ${ARGN})
+		get_filename_component(source "${source}" ABSOLUTE)
+		get_filename_component(name "${source}" NAME)
+
+		set(spv "${SHADER_OUTPUT_DIR}/${name}.spv")
+		set(depfile "${SHADER_OUTPUT_DIR}/${name}.d")
+
+		set(commands
+			COMMAND ${GLSLC_EXECUTABLE} -MD -MF "${depfile}" -MT "${spv}" -o "${spv}" "${source}")
+
+		if(GAME_OPTIMIZE_SHADERS AND SPIRV_OPT_EXECUTABLE)
+			list(APPEND commands
+				COMMAND ${SPIRV_OPT_EXECUTABLE} -O "${spv}" -o "${spv}")
+		endif()
+
+		if(use_depfile)
+			add_custom_command(
+				OUTPUT "${spv}"
+				${commands}
+				DEPENDS "${source}"
+				DEPFILE "${depfile}"
+				COMMENT "Compiling shader ${name}"
+				VERBATIM)
+		else()
+			add_custom_command(
+				OUTPUT "${spv}"
+				${commands}
+				DEPENDS "${source}"
+				COMMENT "Compiling shader ${name}"
+				VERBATIM)
+		endif()
+
+		list(APPEND outputs "${spv}")
+
+		if(GAME_EMBED_SHADERS)
+			# basic.vert -> basic_vert
+			string(MAKE_C_IDENTIFIER "${name}" identifier)
+			set(header "${SHADER_GENERATED_INCLUDE_DIR}/shaders/${name}.hpp")
+
+			add_custom_command(
+				OUTPUT "${header}"
+				COMMAND ${CMAKE_COMMAND}
+					-DINPUT=${spv} -DOUTPUT=${header} -DNAME=${identifier}
+					-P "${CMAKE_SOURCE_DIR}/cmake/embed_spirv.cmake"
+				DEPENDS "${spv}" "${CMAKE_SOURCE_DIR}/cmake/embed_spirv.cmake"
+				COMMENT "Embedding shader ${name}"
+				VERBATIM)
+
+			list(APPEND outputs "${header}")
+		endif()
+	endforeach()
+
+	add_custom_target(${target}_shaders DEPENDS ${outputs})
+	add_dependencies(${target} ${target}_shaders)
+
+	target_compile_definitions(${target} PRIVATE SHADERS="${SHADER_OUTPUT_DIR}/")
+
+	if(GAME_EMBED_SHADERS)
+		target_compile_definitions(${target} PRIVATE GAME_EMBED_SHADERS)
+		target_include_directories(${target} PRIVATE "${SHADER_GENERATED_INCLUDE_DIR}")
+	endif()
+endfunction()
@@ -1,5 +1,9 @@
 #!/bin/sh
 
+# the build compiles shaders on its own (see cmake/shaders.cmake), this
+# only refreshes the prebuilt .spv kept in assets/shaders for machines
+# without glslc. sources newer than their .spv get recompiled, in parallel
+
 [ -n "$GLSLC" ] || {
   GLSLC=$(which glslc) || {
     echo "[ERROR] glslc executable not found. "
@@ -9,10 +13,15 @@
 
 (
   cd assets/shaders ;
-  touch *.spv && rm *.spv ;
-  [ "$1" = "clean" ] || {
-    for s in $(ls) 
-      do (exec $GLSLC $s -o "$s.spv")
-    done
+  [ "$1" = "clean" ] && {
+    rm -f *.spv
+    exit
   }
-)
\ No newline at end of file
+  for s in *.vert *.frag *.comp
+    do
+      [ -f "$s" ] || continue
+      [ "$s.spv" -nt "$s" ] && continue
+      $GLSLC "$s" -o "$s.spv" &
+    done
+  wait
+)
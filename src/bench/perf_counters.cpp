@@ -0,0 +1,115 @@
+#include "./perf_counters.hpp"
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+#include <cstring>
+
+using namespace bench;
+
+#ifdef __linux__
+
+namespace {
+    // same order as the fields of perf_counters::sample
+    const uint64_t events[] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+
+    int open_counter(uint64_t event) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = event;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        // user space only, that's what paranoid level 2 still lets us see
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+}
+
+perf_counters::perf_counters() {
+    for(int i = 0; i < counter_count; i++) _fds[i] = -1;
+
+    for(int i = 0; i < counter_count; i++) {
+        _fds[i] = open_counter(events[i]);
+
+        // all or nothing, a table with half the columns is just confusing
+        if(_fds[i] < 0) {
+            for(int j = 0; j < i; j++) close(_fds[j]);
+            for(int j = 0; j < counter_count; j++) _fds[j] = -1;
+            return;
+        }
+    }
+}
+
+perf_counters::~perf_counters() {
+    if(!is_available()) return;
+    for(int i = 0; i < counter_count; i++) close(_fds[i]);
+}
+
+bool perf_counters::is_available() const {
+    return _fds[0] >= 0;
+}
+
+void perf_counters::start() {
+    if(!is_available()) return;
+
+    for(int i = 0; i < counter_count; i++) {
+        ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+perf_counters::sample perf_counters::stop() {
+    uint64_t values[counter_count] = {};
+    if(!is_available()) return { 0, 0, 0, 0 };
+
+    for(int i = 0; i < counter_count; i++) ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for(int i = 0; i < counter_count; i++) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if(read(_fds[i], data, sizeof(data)) != sizeof(data)) continue;
+
+        // only ran part of the time, extrapolate
+        if(data[2] > 0 && data[2] < data[1]) {
+            values[i] = uint64_t(double(data[0]) * double(data[1]) / double(data[2]));
+        } else {
+            values[i] = data[0];
+        }
+    }
+
+    return { values[0], values[1], values[2], values[3] };
+}
+
+#else
+
+perf_counters::perf_counters() {
+    for(int i = 0; i < counter_count; i++) _fds[i] = -1;
+}
+
+perf_counters::~perf_counters() {}
+
+bool perf_counters::is_available() const {
+    return false;
+}
+
+void perf_counters::start() {}
+
+perf_counters::sample perf_counters::stop() {
+    return { 0, 0, 0, 0 };
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bench {
+    // hardware counters for the whole process through perf_event_open.
+    //
+    // open them before starting any threads: workers created afterwards
+    // inherit the counters and get added into the totals. is_available()
+    // is false off linux, in VMs without a PMU, or when
+    // /proc/sys/kernel/perf_event_paranoid doesn't allow it
+    class perf_counters {
+    public:
+        struct sample {
+            uint64_t cycles;
+            uint64_t instructions;
+            uint64_t cache_references;
+            uint64_t cache_misses;
+        };
+
+    private:
+        static const int counter_count = 4;
+        int _fds[counter_count];
+
+    public:
+        perf_counters();
+        ~perf_counters();
+
+        perf_counters(const perf_counters&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+
+        bool is_available() const;
+
+        // zeroes and starts counting
+        void start();
+        // stops counting and reads the totals since start(), scaled up if
+        // the kernel had to multiplex the counters
+        sample stop();
+    };
+}
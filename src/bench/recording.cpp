@@ -0,0 +1,90 @@
+#include "./recording.hpp"
+
+#include "core/vulkan/vkutils.hpp"
+#include "core/graphics/render_graph.hpp"
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+using namespace core;
+
+void bench::recording(vkapp& app) {
+    const VkExtent2D extent{ 1920, 1080 };
+    const uint32_t draw_counts[] = { 1000, 10000, 100000 };
+    const int warmup = 5, iterations = 30;
+
+    uint32_t draw_count = 0;
+    uint32_t threads = 1;
+
+    // same format as the swapchain, so the app's shaders fit
+    render_graph graph(app.device, app.physical_device, app.dynamic_rendering);
+    auto target = graph.create_image("target", app.swapchain.format.format, extent);
+
+    vkpipeline pipeline;
+
+    auto pass = graph.add_pass("draws", [&](VkCommandBuffer primary) {
+        app.recorder.record(primary, pipeline.target, draw_count, [&](VkCommandBuffer command_buffer, uint32_t first, uint32_t count) {
+            VkViewport viewport{ 0.0f, 0.0f, float(extent.width), float(extent.height), 0.0f, 1.0f };
+            VkRect2D scissor{ { 0, 0 }, extent };
+
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+            for(uint32_t i = first; i < first + count; i++) {
+                vkCmdDraw(command_buffer, 3, 1, 0, i);
+            }
+        }, 256, threads);
+    });
+
+    graph.write_color(pass, target, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    graph.keep(pass);
+    graph.secondary_contents(pass);
+    graph.compile();
+
+    std::vector<vkshader> shaders{ app.vertex_shader, app.fragment_shader };
+    pipeline = vkpipeline(app.device, graph.target_info(pass), shaders, app.layouts);
+
+    std::vector<uint32_t> thread_counts;
+    for(uint32_t t = 1; t < app.recorder.thread_count(); t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(app.recorder.thread_count());
+
+    printf("%8s %8s %12s %12s %8s\n", "draws", "threads", "median ms", "draws/ms", "speedup");
+
+    std::vector<double> times;
+    for(auto count : draw_counts) {
+        double single_thread = 0.0;
+
+        for(auto t : thread_counts) {
+            draw_count = count;
+            threads = t;
+            times.clear();
+
+            for(int i = 0; i < warmup + iterations; i++) {
+                // the one-time submit waits for the GPU, so the frame's
+                // pools are free to reset every iteration
+                app.recorder.begin_frame(0);
+                VkCommandBuffer command_buffer = vkutils::begin_one_time_commands(app.device, app.command_pool);
+
+                auto start = std::chrono::steady_clock::now();
+                graph.execute(command_buffer);
+                auto end = std::chrono::steady_clock::now();
+
+                vkutils::submit_one_time_commands(app.device, app.command_pool, app.graphics_queue, command_buffer);
+
+                if(i >= warmup) times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+
+            std::sort(times.begin(), times.end());
+            double median = times[times.size() / 2];
+            if(t == 1) single_thread = median;
+
+            printf("%8u %8u %12.3f %12.0f %7.2fx\n", count, t, median, count / median, single_thread / median);
+        }
+    }
+
+    pipeline.destroy(app.device);
+    graph.destroy();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "core/vulkan/vkapp.hpp"
+
+namespace bench {
+    // times recording a draw list of different sizes with 1..N threads,
+    // into an offscreen target, and prints the table
+    void recording(core::vkapp&);
+}
@@ -0,0 +1,648 @@
+#include "./scenario.hpp"
+
+#include "core/ecs/world.hpp"
+#include "core/ecs/snapshot.hpp"
+#include "core/jobs/thread_pool.hpp"
+#include "core/memory/alloc_stats.hpp"
+#include "core/physics/simulation.hpp"
+#include "core/physics/system.hpp"
+#include "core/graphics/occlusion.hpp"
+#include "core/graphics/light_clusters.hpp"
+#include "components/components.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <algorithm>
+
+#include <time.h>
+#include <unistd.h>
+
+using namespace core;
+
+namespace {
+    // only the movement system uses it, so it lives here
+    struct velocity {
+        float x, y, z;
+    };
+
+    // everything the systems need, alive for as long as the world updates
+    struct context {
+        world& w;
+        const std::vector<entt::entity>& entities;
+        jobs::thread_pool* pool;
+
+        std::unique_ptr<physics::simulation> simulation;
+
+        snapshot_schema schema;
+        snapshot base, latest;
+        uint64_t frame;
+        double capture_ms;
+
+        std::unique_ptr<occlusion_culler> culler;
+        std::vector<occlusion_culler::box> boxes;
+        std::vector<uint8_t> visible;
+
+        std::unique_ptr<light_clusters> clusters;
+        std::vector<light_clusters::light> lights;
+    };
+
+    // unit cube, the occluder mesh
+    const float cube_positions[] = {
+        -1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+        -1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1,
+    };
+    const uint32_t cube_indices[] = {
+        0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,
+        0, 1, 5, 0, 5, 4,   3, 6, 2, 3, 7, 6,
+        0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+    };
+
+    uint32_t next_random(uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u;
+        return seed;
+    }
+
+    float random_float(uint32_t& seed) {
+        return float(next_random(seed) >> 8) / float(1 << 24);
+    }
+
+    double since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void setup_movement(context& c) {
+        auto& registry = c.w.get_registry();
+
+        uint32_t seed = 7;
+        for(auto e : c.entities) {
+            registry.emplace<velocity>(e,
+                random_float(seed) - 0.5f, random_float(seed) - 0.5f, random_float(seed) - 0.5f);
+        }
+
+        c.w.add_update_system([](world& w) {
+            float delta = w.get_resource<world::delta_time>();
+            auto view = w.get_registry().view<components::transform, const velocity>();
+
+            for(auto [entity, transform, v] : view.each()) {
+                transform.position.x += v.x * delta;
+                transform.position.y += v.y * delta;
+                transform.position.z += v.z * delta;
+            }
+        });
+    }
+
+    // a floor, two walls and a body per entity, planar so it stays a
+    // pile. same entity count, same scene, whatever the thread count
+    void setup_physics(context& c) {
+        physics::settings settings;
+        settings.planar = true;
+        c.simulation = std::make_unique<physics::simulation>(settings, c.pool);
+
+        float width = 100 * 1.2f;
+
+        physics::body_desc floor;
+        floor.type = physics::shape::box;
+        floor.mass = 0.0f;
+        floor.position[0] = width * 0.5f;
+        floor.position[1] = -1.0f;
+        floor.extents[0] = width;
+        floor.extents[1] = 1.0f;
+        floor.extents[2] = width;
+        c.simulation->add_body(floor);
+
+        physics::body_desc wall = floor;
+        wall.extents[0] = 1.0f;
+        wall.extents[1] = 1000.0f;
+        wall.position[1] = 1000.0f;
+        wall.position[0] = -1.0f;
+        c.simulation->add_body(wall);
+        wall.position[0] = width + 1.0f;
+        c.simulation->add_body(wall);
+
+        uint32_t seed = 1;
+        for(size_t i = 0; i < c.entities.size(); i++) {
+            physics::body_desc body;
+            body.type = i % 3 == 0 ? physics::shape::box : physics::shape::sphere;
+            body.extents[0] = body.extents[1] = body.extents[2] = 0.4f + random_float(seed) * 0.1f;
+            body.restitution = 0.2f;
+            physics::attach_body(c.w, *c.simulation, c.entities[i], body);
+        }
+
+        physics::register_physics(c.w, *c.simulation);
+    }
+
+    // window_details holds a string, so it goes through a writer
+    void write_window(const components::window_details& w, std::vector<char>& out) {
+        uint32_t length = w.title.size();
+        auto append = [&out](const void* p, size_t size) {
+            out.insert(out.end(), static_cast<const char*>(p), static_cast<const char*>(p) + size);
+        };
+
+        append(&w.width, sizeof(w.width));
+        append(&w.height, sizeof(w.height));
+        append(&length, sizeof(length));
+        append(w.title.data(), length);
+    }
+
+    bool read_window(components::window_details& w, const char* data, size_t size, uint32_t version) {
+        const size_t fixed = sizeof(w.width) + sizeof(w.height) + sizeof(uint32_t);
+        if(version != 1 || size < fixed) return false;
+
+        uint32_t length;
+        memcpy(&w.width, data, sizeof(w.width));
+        memcpy(&w.height, data + sizeof(w.width), sizeof(w.height));
+        memcpy(&length, data + sizeof(w.width) + sizeof(w.height), sizeof(length));
+        if(size != fixed + length) return false;
+
+        w.title.assign(data + fixed, length);
+        return true;
+    }
+
+    // a delta against the first frame every frame. the one-off steps,
+    // save, map, restore, apply and rollback, are timed once the frames
+    // are done, see finish_snapshot
+    void setup_snapshot(context& c) {
+        c.schema.add<components::transform>("transform");
+        c.schema.add<components::rigid_body>("rigid_body");
+        c.schema.add<components::window_details>("window_details", 1, write_window, read_window);
+
+        auto& registry = c.w.get_registry();
+        for(size_t i = 0; i < c.entities.size(); i += 1000) {
+            registry.emplace<components::window_details>(c.entities[i], 640, 480, "window " + std::to_string(i));
+        }
+
+        // taken once every other system has set its entities up
+        c.w.add_startup_system([&c](world& w) {
+            auto start = std::chrono::steady_clock::now();
+            c.base = c.schema.capture(w.get_registry(), 0);
+            c.capture_ms = since(start);
+        });
+        c.w.add_update_system([&c](world& w) {
+            c.latest = c.schema.capture_delta(w.get_registry(), c.base, ++c.frame);
+        });
+    }
+
+    // a wall in front of the left half of the grid, seen from far enough
+    // back that 10k entities fit on screen. the cube scaled and moved to
+    // x 0..60, y 0..120, z 49..51
+    const float occlusion_camera[3] = { 60.0f, 60.0f, 200.0f };
+    const float occlusion_wall[16] = {
+        30, 0, 0, 0,
+        0, 60, 0, 0,
+        0, 0, 1, 0,
+        30, 60, 50, 1,
+    };
+
+    // vulkan style perspective, 60 degrees, times a view that only moves
+    // the camera to occlusion_camera
+    void occlusion_view_proj(float view_proj[16]) {
+        const float near = 0.5f, far = 1000.0f, aspect = 2.0f;
+        float t = std::tan(0.5f * 3.14159265f / 3.0f);
+        const float* camera = occlusion_camera;
+
+        std::fill(view_proj, view_proj + 16, 0.0f);
+        view_proj[0] = 1.0f / (aspect * t);
+        view_proj[5] = 1.0f / t;
+        view_proj[10] = far / (near - far);
+        view_proj[11] = -1.0f;
+        view_proj[12] = -camera[0] * view_proj[0];
+        view_proj[13] = -camera[1] * view_proj[5];
+        view_proj[14] = -camera[2] * view_proj[10] + near * far / (near - far);
+        view_proj[15] = camera[2];
+    }
+
+    void setup_occlusion(context& c) {
+        c.culler = std::make_unique<occlusion_culler>(256, 128, c.pool);
+
+        float view_proj[16];
+        occlusion_view_proj(view_proj);
+
+        c.w.add_update_system([&c, view_proj](world& w) {
+            c.culler->begin(view_proj);
+            c.culler->add_occluder(cube_positions, 3, cube_indices, 36, occlusion_wall);
+            c.culler->rasterize();
+
+            auto view = w.get_registry().view<const components::transform>();
+
+            c.boxes.clear();
+            for(auto [entity, transform] : view.each()) {
+                auto& p = transform.position;
+                c.boxes.push_back({ { p.x - 0.5f, p.y - 0.5f, p.z - 0.5f }, { p.x + 0.5f, p.y + 0.5f, p.z + 0.5f } });
+            }
+
+            c.visible.resize(c.boxes.size());
+            c.culler->test(c.boxes.data(), c.boxes.size(), c.visible.data());
+        });
+    }
+
+    // a point light on every entity, binned the way light_cull.comp does
+    // it. the grid is pushed apart in depth, or every light would sit in
+    // the same slice, and seen from (60, 60, 150) on a 1080p screen
+    void setup_lighting(context& c) {
+        c.clusters = std::make_unique<light_clusters>();
+        c.lights.reserve(c.entities.size());
+
+        auto& registry = c.w.get_registry();
+
+        uint32_t seed = 3;
+        for(auto e : c.entities) {
+            registry.get<components::transform>(e).position.z = (random_float(seed) - 0.5f) * 200.0f;
+
+            components::point_light light;
+            light.color = {
+                uint8_t(next_random(seed) >> 24), uint8_t(next_random(seed) >> 24), uint8_t(next_random(seed) >> 24), 255 };
+            light.intensity = 1.0f;
+            light.radius = 2.0f + random_float(seed) * 4.0f;
+            registry.emplace<components::point_light>(e, light);
+        }
+
+        const float near = 0.1f, far = 300.0f;
+        const float camera[3] = { 60.0f, 60.0f, 150.0f };
+
+        float projection[16];
+        light_clusters::perspective(3.14159265f / 3.0f, 16.0f / 9.0f, near, far, projection);
+        auto params = light_clusters::make_params(projection, near, far, 1920.0f, 1080.0f);
+
+        c.w.add_update_system([&c, params, camera](world& w) {
+            auto view = w.get_registry().view<const components::transform, const components::point_light>();
+
+            // the view only moves the camera
+            c.lights.clear();
+            for(auto [entity, transform, light] : view.each()) {
+                auto& p = transform.position;
+
+                light_clusters::light l;
+                l.position[0] = p.x - camera[0];
+                l.position[1] = p.y - camera[1];
+                l.position[2] = p.z - camera[2];
+                l.radius = light.radius;
+                l.color[0] = light.color.r / 255.0f;
+                l.color[1] = light.color.g / 255.0f;
+                l.color[2] = light.color.b / 255.0f;
+                l.intensity = light.intensity;
+                c.lights.push_back(l);
+            }
+
+            c.clusters->build(params, c.lights.data(), uint32_t(c.lights.size()));
+        });
+    }
+
+    void finish_snapshot(context& c, bench::scenario_result& result) {
+        std::string path = "/tmp/bench-" + std::to_string(getpid()) + ".snap";
+        uint32_t failures = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        if(!c.base.save(path)) failures++;
+        double save_ms = since(start);
+
+        start = std::chrono::steady_clock::now();
+        snapshot mapped(path);
+        double map_ms = since(start);
+
+        world target;
+        start = std::chrono::steady_clock::now();
+        if(!c.schema.restore(target.get_registry(), mapped)) failures++;
+        double restore_ms = since(start);
+
+        // the last frame's delta on top of the restored base
+        start = std::chrono::steady_clock::now();
+        if(c.latest.is_valid() && !c.schema.restore(target.get_registry(), c.latest)) failures++;
+        double apply_ms = since(start);
+
+        // and the live world back to the first frame
+        start = std::chrono::steady_clock::now();
+        if(!c.schema.restore(c.w.get_registry(), c.base)) failures++;
+        double rollback_ms = since(start);
+
+        remove(path.c_str());
+
+        result.metrics.push_back({ "full_mib", c.base.size() / (1024.0 * 1024.0) });
+        result.metrics.push_back({ "delta_kib", c.latest.size() / 1024.0 });
+        result.metrics.push_back({ "capture_ms", c.capture_ms });
+        result.metrics.push_back({ "save_ms", save_ms });
+        result.metrics.push_back({ "map_ms", map_ms });
+        result.metrics.push_back({ "restore_ms", restore_ms });
+        result.metrics.push_back({ "apply_delta_ms", apply_ms });
+        result.metrics.push_back({ "rollback_ms", rollback_ms });
+        result.metrics.push_back({ "restore_failures", double(failures) });
+    }
+
+    // every box the last frame culled has to be outside the view or really
+    // behind the wall: the line from the camera to each of its corners goes
+    // through it. box and wall are both convex, so the corners are enough
+    void finish_occlusion(context& c, bench::scenario_result& result) {
+        float view_proj[16];
+        occlusion_view_proj(view_proj);
+
+        float wall_min[3], wall_max[3];
+        for(int a = 0; a < 3; a++) {
+            wall_min[a] = occlusion_wall[12 + a] - occlusion_wall[a * 5];
+            wall_max[a] = occlusion_wall[12 + a] + occlusion_wall[a * 5];
+        }
+
+        // texels count as covered when their center is, so the wall can hide
+        // up to half a texel past its outline. it faces the camera, texels
+        // are the largest at its back
+        float distance = occlusion_camera[2] - wall_min[2];
+        float texel[2] = {
+            2.0f * distance / (view_proj[0] * c.culler->width()),
+            2.0f * distance / (view_proj[5] * c.culler->height()),
+        };
+        for(int a = 0; a < 2; a++) {
+            wall_min[a] -= texel[a] * 0.5f;
+            wall_max[a] += texel[a] * 0.5f;
+        }
+
+        auto blocked = [&](const float to[3]) {
+            float enter = 0.0f, leave = 1.0f;
+            for(int a = 0; a < 3; a++) {
+                float from = occlusion_camera[a], d = to[a] - from;
+                if(d == 0.0f) {
+                    if(from < wall_min[a] || from > wall_max[a]) return false;
+                    continue;
+                }
+
+                float t0 = (wall_min[a] - from) / d, t1 = (wall_max[a] - from) / d;
+                enter = std::max(enter, std::min(t0, t1));
+                leave = std::min(leave, std::max(t0, t1));
+            }
+            return enter <= leave;
+        };
+
+        uint32_t culled = 0, wrongly_culled = 0;
+        for(size_t i = 0; i < c.boxes.size(); i++) {
+            if(c.visible[i]) continue;
+            culled++;
+
+            auto& b = c.boxes[i];
+            bool hidden = true;
+            // bit per side of the view all corners are past, x+ x- y+ y-
+            uint32_t outside = 0xf;
+
+            for(int corner = 0; corner < 8; corner++) {
+                float p[3] = {
+                    corner & 1 ? b.max[0] : b.min[0],
+                    corner & 2 ? b.max[1] : b.min[1],
+                    corner & 4 ? b.max[2] : b.min[2],
+                };
+                hidden = hidden && blocked(p);
+
+                float clip[4];
+                for(int r = 0; r < 4; r++) {
+                    clip[r] = view_proj[r] * p[0] + view_proj[4 + r] * p[1] + view_proj[8 + r] * p[2] + view_proj[12 + r];
+                }
+                outside &=
+                    (clip[0] > clip[3] ? 1 : 0) | (clip[0] < -clip[3] ? 2 : 0) |
+                    (clip[1] > clip[3] ? 4 : 0) | (clip[1] < -clip[3] ? 8 : 0);
+            }
+            if(!hidden && outside == 0) wrongly_culled++;
+        }
+
+        result.metrics.push_back({ "culled", double(culled) });
+        result.metrics.push_back({ "wrongly_culled", double(wrongly_culled) });
+    }
+
+    struct system_entry {
+        const char* name;
+        void (*setup)(context&);
+    };
+
+    const system_entry known_systems[] = {
+        { "movement", setup_movement },
+        { "physics", setup_physics },
+        { "snapshot", setup_snapshot },
+        { "occlusion", setup_occlusion },
+        { "lighting", setup_lighting },
+    };
+
+    const system_entry* find_system(const std::string& name) {
+        for(auto& s : known_systems) {
+            if(name == s.name) return &s;
+        }
+        return nullptr;
+    }
+
+    // nearest rank, times has to be sorted
+    double percentile(const std::vector<double>& times, double p) {
+        size_t rank = size_t(p * times.size() + 0.999999);
+        if(rank == 0) rank = 1;
+        return times[std::min(rank, times.size()) - 1];
+    }
+
+    void write_string(FILE* file, const std::string& s) {
+        fputc('"', file);
+        for(char c : s) {
+            if(c == '"' || c == '\\') fputc('\\', file);
+            if(uint8_t(c) < 0x20) {
+                fprintf(file, "\\u%04x", c);
+                continue;
+            }
+            fputc(c, file);
+        }
+        fputc('"', file);
+    }
+}
+
+bench::scenario_result bench::run(const scenario& config) {
+    scenario_result result{};
+    result.config = config;
+
+    for(auto& name : config.systems) {
+        if(find_system(name) == nullptr) {
+            printf("unknown system '%s'\n", name.c_str());
+            return result;
+        }
+    }
+    result.valid = true;
+
+    // before the pool, so its workers inherit the counters
+    perf_counters counters;
+
+    std::unique_ptr<jobs::thread_pool> pool;
+    if(config.threads != 1) {
+        pool = std::make_unique<jobs::thread_pool>(config.threads == 0 ? 0 : config.threads - 1);
+    }
+
+    world w;
+    auto& registry = w.get_registry();
+
+    // a 100 wide grid, jittered
+    std::vector<entt::entity> entities;
+    entities.reserve(config.entities);
+
+    uint32_t seed = 1;
+    for(uint32_t i = 0; i < config.entities; i++) {
+        auto e = registry.create();
+        entities.push_back(e);
+
+        registry.emplace<components::transform>(e,
+            structs::vector3{ (i % 100) * 1.2f + 0.5f + random_float(seed) * 0.1f, (i / 100) * 1.2f + 0.5f, 0.0f },
+            structs::vector3{ 1.0f, 1.0f, 1.0f },
+            structs::vector3{ 0.0f, 0.0f, 0.0f });
+    }
+
+    context c{ w, entities, pool.get(), nullptr, {}, {}, {}, 0, 0.0, nullptr, {}, {}, nullptr, {} };
+    for(auto& name : config.systems) find_system(name)->setup(c);
+
+    w.tick_startup();
+
+    const float delta = 1.0f / 60.0f;
+    for(uint32_t i = 0; i < config.warmup; i++) w.tick_update(delta);
+
+    std::vector<double> times(config.frames);
+
+    auto allocations_before = memory::total_allocations();
+    counters.start();
+
+    for(uint32_t i = 0; i < config.frames; i++) {
+        auto frame_start = memory::total_allocations();
+
+        auto start = std::chrono::steady_clock::now();
+        w.tick_update(delta);
+        auto end = std::chrono::steady_clock::now();
+
+        auto frame_end = memory::total_allocations();
+
+        times[i] = std::chrono::duration<double, std::milli>(end - start).count();
+
+        uint64_t count = frame_end.count - frame_start.count;
+        result.max_frame_allocations = std::max(result.max_frame_allocations, count);
+        if(count > 0) result.allocating_frames++;
+    }
+
+    result.counters = counters.stop();
+    result.has_counters = counters.is_available();
+
+    auto allocations_after = memory::total_allocations();
+    result.allocations = allocations_after.count - allocations_before.count;
+    result.allocated_bytes = allocations_after.bytes - allocations_before.bytes;
+
+    if(config.frames > 0) {
+        double total = 0.0;
+        for(double t : times) total += t;
+        result.mean_ms = total / config.frames;
+
+        std::sort(times.begin(), times.end());
+        result.p50_ms = percentile(times, 0.50);
+        result.p90_ms = percentile(times, 0.90);
+        result.p99_ms = percentile(times, 0.99);
+        result.max_ms = times.back();
+    }
+
+    if(c.simulation) result.state_hash = c.simulation->state_hash();
+
+    // the last frame's clusters, what a shading pass over them would cost
+    if(c.clusters) {
+        auto& stats = c.clusters->get_stats();
+        result.metrics.push_back({ "visible_lights", double(stats.visible_lights) });
+        result.metrics.push_back({ "occupied_clusters", double(stats.occupied_clusters) });
+        result.metrics.push_back({ "lights_per_cluster", double(stats.references) / light_clusters::cluster_count });
+        result.metrics.push_back({ "max_lights_per_cluster", double(stats.max_per_cluster) });
+        result.metrics.push_back({ "dropped", double(stats.dropped) });
+    }
+
+    if(c.base.is_valid()) finish_snapshot(c, result);
+    if(c.culler) finish_occlusion(c, result);
+
+    return result;
+}
+
+void bench::print_header() {
+    printf("%-20s %9s %7s %9s %9s %9s %12s %14s\n",
+        "scenario", "entities", "frames", "p50 ms", "p99 ms", "max ms", "allocs/frame", "misses/frame");
+}
+
+void bench::print(const scenario_result& r) {
+    if(!r.valid) {
+        printf("%-20s invalid\n", r.config.name.c_str());
+        return;
+    }
+
+    double frames = r.config.frames > 0 ? r.config.frames : 1;
+
+    char misses[32] = "n/a";
+    if(r.has_counters) snprintf(misses, sizeof(misses), "%.0f", r.counters.cache_misses / frames);
+
+    char allocations[32] = "n/a";
+    if(memory::allocation_tracking_enabled()) snprintf(allocations, sizeof(allocations), "%.1f", r.allocations / frames);
+
+    printf("%-20s %9u %7u %9.3f %9.3f %9.3f %12s %14s\n",
+        r.config.name.c_str(), r.config.entities, r.config.frames,
+        r.p50_ms, r.p99_ms, r.max_ms, allocations, misses);
+
+    if(r.metrics.empty()) return;
+    printf("%-20s", "");
+    for(auto& m : r.metrics) printf(" %s %.3g", m.name.c_str(), m.value);
+    printf("\n");
+}
+
+bool bench::write_json(const std::string& path, const std::vector<scenario_result>& results) {
+    FILE* file = fopen(path.c_str(), "w");
+    if(file == nullptr) {
+        printf("could not write %s\n", path.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"timestamp\": %lld,\n", (long long)time(nullptr));
+    fprintf(file, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(file, "  \"allocation_tracking\": %s,\n", memory::allocation_tracking_enabled() ? "true" : "false");
+    fprintf(file, "  \"results\": [");
+
+    bool first = true;
+    for(auto& r : results) {
+        if(!r.valid) continue;
+
+        fprintf(file, first ? "\n" : ",\n");
+        first = false;
+
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": ");
+        write_string(file, r.config.name);
+        fprintf(file, ",\n      \"systems\": [");
+        for(size_t i = 0; i < r.config.systems.size(); i++) {
+            if(i > 0) fprintf(file, ", ");
+            write_string(file, r.config.systems[i]);
+        }
+        fprintf(file, "],\n");
+
+        fprintf(file, "      \"entities\": %u,\n", r.config.entities);
+        fprintf(file, "      \"frames\": %u,\n", r.config.frames);
+        fprintf(file, "      \"warmup\": %u,\n", r.config.warmup);
+        fprintf(file, "      \"threads\": %u,\n", r.config.threads);
+        fprintf(file, "      \"frame_ms\": { \"mean\": %.6f, \"p50\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f },\n",
+            r.mean_ms, r.p50_ms, r.p90_ms, r.p99_ms, r.max_ms);
+        fprintf(file, "      \"allocations\": { \"count\": %llu, \"bytes\": %llu, \"max_per_frame\": %llu, \"frames_allocating\": %u },\n",
+            (unsigned long long)r.allocations, (unsigned long long)r.allocated_bytes,
+            (unsigned long long)r.max_frame_allocations, r.allocating_frames);
+
+        if(r.has_counters) {
+            fprintf(file, "      \"counters\": { \"cycles\": %llu, \"instructions\": %llu, \"cache_references\": %llu, \"cache_misses\": %llu },\n",
+                (unsigned long long)r.counters.cycles, (unsigned long long)r.counters.instructions,
+                (unsigned long long)r.counters.cache_references, (unsigned long long)r.counters.cache_misses);
+        } else {
+            fprintf(file, "      \"counters\": null,\n");
+        }
+
+        fprintf(file, "      \"metrics\": {");
+        for(size_t i = 0; i < r.metrics.size(); i++) {
+            fprintf(file, i > 0 ? ", " : " ");
+            write_string(file, r.metrics[i].name);
+            fprintf(file, ": %.6f", r.metrics[i].value);
+        }
+        fprintf(file, r.metrics.empty() ? "},\n" : " },\n");
+
+        fprintf(file, "      \"state_hash\": \"%016llx\"\n", (unsigned long long)r.state_hash);
+        fprintf(file, "    }");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
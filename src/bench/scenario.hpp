@@ -0,0 +1,72 @@
+#pragma once
+
+#include "./perf_counters.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace bench {
+    // a world to build and how long to run it, without a window or GPU
+    struct scenario {
+        std::string name = "custom";
+        uint32_t entities = 10000;
+        uint32_t frames = 600;
+        // run first and left out of the numbers
+        uint32_t warmup = 60;
+        // for the systems that use a thread pool, 0 for one per hardware thread
+        uint32_t threads = 1;
+        // update systems, run in this order. known ones:
+        //   movement   transforms moved by a velocity
+        //   physics    every entity gets a rigid body, see core::physics
+        //   snapshot   a delta against the first frame, every frame. save,
+        //              map, restore and rollback are timed once at the end
+        //   occlusion  one wall rasterized, every entity's box tested. the
+        //              boxes culled on the last frame are checked against
+        //              the wall itself
+        //   lighting   a point light per entity, binned into clusters
+        std::vector<std::string> systems = { "movement" };
+    };
+
+    // a number a system reports about its own work, eg. lights per cluster
+    struct metric {
+        std::string name;
+        double value;
+    };
+
+    struct scenario_result {
+        scenario config;
+        // false if a system name wasn't known, nothing else is filled in
+        bool valid;
+
+        // frame times, milliseconds
+        double mean_ms, p50_ms, p90_ms, p99_ms, max_ms;
+
+        // over the measured frames, every thread. zero unless the build
+        // tracks allocations
+        uint64_t allocations;
+        uint64_t allocated_bytes;
+        uint64_t max_frame_allocations;
+        uint32_t allocating_frames;
+
+        // totals over the measured frames, if has_counters
+        bool has_counters;
+        perf_counters::sample counters;
+
+        // physics::simulation::state_hash(), 0 without physics
+        uint64_t state_hash;
+
+        std::vector<metric> metrics;
+    };
+
+    // builds the world, runs tick_startup, the warmup and then the
+    // measured frames with a fixed 1/60 delta
+    scenario_result run(const scenario&);
+
+    void print_header();
+    void print(const scenario_result&);
+
+    // every result plus a bit about the machine, as json. false if the
+    // file can't be written
+    bool write_json(const std::string& path, const std::vector<scenario_result>&);
+}
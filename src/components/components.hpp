@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include "./structs.hpp"
 
 namespace components {
@@ -10,6 +11,34 @@ namespace components {
         structs::vector3 rotation;
     };
 
+    // links an entity to a body in core::physics::simulation
+    struct rigid_body {
+        uint32_t id;
+    };
+
+    // lights everything within radius of the entity's transform, see
+    // core::clustered_lighting
+    struct point_light {
+        structs::color color;
+        float intensity;
+        float radius;
+    };
+
+    // spawns particles at the entity's transform, see core::particle_system
+    struct particle_emitter {
+        // particles per second
+        float rate;
+        // seconds a particle lives
+        float lifetime;
+        float speed;
+        // 0 shoots straight up, 1 in every direction
+        float spread;
+        float size;
+        structs::color color;
+        // the fraction of a particle owed from earlier frames
+        float pending;
+    };
+
     struct label {
         const char* label;
     };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <math.h>
+#include <cstdint>
 
 namespace structs {
 
@@ -60,8 +61,13 @@ namespace structs {
         float w, h;
     };
 
+    // 0-255 per channel, the GPU reads it as one RGBA8 value
     struct color {
-        float r, g, b, a;
+        uint8_t r, g, b, a;
+
+        uint32_t packed() const {
+            return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 | uint32_t(a) << 24;
+        }
     };
 
     struct rect {
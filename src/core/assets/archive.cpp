@@ -0,0 +1,235 @@
+#include "./archive.hpp"
+
+#include "utils/log.hpp"
+#include "utils/file.hpp"
+#include "utils/assert.hpp"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef GAME_HAS_LZ4
+    #include <lz4.h>
+#endif
+
+#ifdef GAME_HAS_ZSTD
+    #include <zstd.h>
+#endif
+
+using namespace core;
+using archive_format::compression;
+
+archive::archive()
+    : _fd(-1), _base(nullptr), _size(0),
+      _header(nullptr), _entries(nullptr), _names(nullptr)
+{}
+
+archive::archive(const std::string& path)
+    : archive()
+{
+    _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(_fd < 0) {
+        LOG("[ASSETS] could not open %s", path.c_str());
+        return;
+    }
+
+    const char* error = map();
+    if(error != nullptr) {
+        // anything wrong leaves the archive closed, is_open() says so
+        LOG("[ASSETS] %s: %s", path.c_str(), error);
+        if(_base) munmap(const_cast<char*>(_base), _size);
+        close(_fd);
+
+        _fd = -1;
+        _base = nullptr;
+        _size = 0;
+        _header = nullptr;
+        return;
+    }
+
+    _entries = reinterpret_cast<const entry*>(_base + _header->index_offset);
+    _names = _base + _header->names_offset;
+
+    // the index gets hit right away, the data only when asked for
+    madvise(const_cast<char*>(_base), _header->data_offset, MADV_WILLNEED);
+}
+
+const char* archive::map() {
+    struct stat info;
+    if(fstat(_fd, &info) != 0) return "could not stat";
+    _size = info.st_size;
+
+    if(_size < sizeof(archive_format::header)) return "too small to be an archive";
+
+    void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if(mapping == MAP_FAILED) return "could not map";
+
+    _base = static_cast<const char*>(mapping);
+    _header = reinterpret_cast<const archive_format::header*>(_base);
+
+    if(_header->magic != archive_format::magic) return "not an asset archive";
+    if(_header->version != archive_format::version) return "unsupported archive version";
+    if(_header->file_size != _size) return "truncated";
+
+    // the index and names have to be inside the file before anything
+    // points into them
+    uint64_t index_end = _header->index_offset + uint64_t(_header->entry_count) * sizeof(entry);
+    if(_header->index_offset > _size || index_end > _size ||
+       _header->names_offset > _size || _header->data_offset > _size) {
+        return "index out of bounds";
+    }
+
+    return nullptr;
+}
+
+archive::~archive() {
+    if(_base) munmap(const_cast<char*>(_base), _size);
+    if(_fd >= 0) close(_fd);
+}
+
+archive::archive(archive&& o) noexcept
+    : archive()
+{
+    *this = std::move(o);
+}
+
+archive& archive::operator=(archive&& o) noexcept {
+    std::swap(_fd, o._fd);
+    std::swap(_base, o._base);
+    std::swap(_size, o._size);
+    std::swap(_header, o._header);
+    std::swap(_entries, o._entries);
+    std::swap(_names, o._names);
+    return *this;
+}
+
+bool archive::is_open() const {
+    return _base != nullptr;
+}
+
+size_t archive::entry_count() const {
+    return _header ? _header->entry_count : 0;
+}
+
+const archive::entry& archive::entry_at(size_t i) const {
+    return _entries[i];
+}
+
+std::string_view archive::name_of(const entry& e) const {
+    return std::string_view(_names + e.name_offset, e.name_length);
+}
+
+const archive::entry* archive::find(std::string_view name) const {
+    if(!is_open()) return nullptr;
+
+    uint64_t hash = archive_format::hash_name(name);
+
+    const entry* begin = _entries;
+    const entry* end = _entries + _header->entry_count;
+
+    auto it = std::lower_bound(begin, end, hash, [](const entry& e, uint64_t h) {
+        return e.hash < h;
+    });
+
+    // names only get compared on (very unlikely) hash collisions
+    for(; it != end && it->hash == hash; it++) {
+        if(name_of(*it) == name) return it;
+    }
+
+    return nullptr;
+}
+
+const char* archive::data(const entry& e) const {
+    ASSERT(e.method == compression::none, "Compressed entries must be read or streamed");
+    return _base + e.offset;
+}
+
+std::vector<char> archive::read(const entry& e) const {
+    std::vector<char> buffer(e.original_size);
+    size_t written = 0;
+
+    stream(e, e.chunk_size ? e.chunk_size : e.original_size, [&](const char* data, size_t size) {
+        std::copy(data, data + size, buffer.data() + written);
+        written += size;
+    });
+
+    return buffer;
+}
+
+std::vector<char> archive::read(std::string_view name) const {
+    auto e = find(name);
+    if(e == nullptr) return {};
+    return read(*e);
+}
+
+void archive::stream(const entry& e, size_t chunk_size, const chunk_callback& callback) const {
+    if(chunk_size == 0) {
+        LOG("[ASSETS] streaming needs a chunk size");
+        return;
+    }
+    const char* src = _base + e.offset;
+
+    if(e.method == compression::none) {
+        for(size_t offset = 0; offset < e.original_size; offset += chunk_size) {
+            size_t size = std::min(chunk_size, size_t(e.original_size - offset));
+
+            // start paging in the next chunk while this one gets consumed
+            size_t next = offset + size;
+            if(next < e.original_size) {
+                uintptr_t page = reinterpret_cast<uintptr_t>(src + next) & ~uintptr_t(archive_format::alignment - 1);
+                madvise(reinterpret_cast<void*>(page), std::min(chunk_size, size_t(e.original_size - next)), MADV_WILLNEED);
+            }
+
+            callback(src + offset, size);
+        }
+        return;
+    }
+
+    // compressed entries come in the chunks they were packed with,
+    // whatever chunk size the caller asked for
+    size_t chunk_count = (e.original_size + e.chunk_size - 1) / e.chunk_size;
+    auto sizes = reinterpret_cast<const uint32_t*>(src);
+    const char* chunk = src + chunk_count * sizeof(uint32_t);
+
+    std::vector<char> buffer(e.chunk_size);
+
+    for(size_t i = 0; i < chunk_count; i++) {
+        size_t original = std::min(size_t(e.chunk_size), size_t(e.original_size - i * e.chunk_size));
+
+        decompress_chunk(e.method, chunk, sizes[i], buffer.data(), original);
+        callback(buffer.data(), original);
+
+        chunk += sizes[i];
+    }
+}
+
+void archive::decompress_chunk(
+    compression method, [[maybe_unused]] const char* src, [[maybe_unused]] size_t src_size,
+    [[maybe_unused]] char* dst, [[maybe_unused]] size_t dst_size
+) const {
+    switch(method) {
+#ifdef GAME_HAS_LZ4
+        case compression::lz4: {
+            int result = LZ4_decompress_safe(src, dst, src_size, dst_size);
+            ASSERT(result == int(dst_size), "Corrupted LZ4 chunk");
+            return;
+        }
+#endif
+#ifdef GAME_HAS_ZSTD
+        case compression::zstd: {
+            size_t result = ZSTD_decompress(dst, dst_size, src, src_size);
+            ASSERT(!ZSTD_isError(result) && result == dst_size, "Corrupted zstd chunk");
+            return;
+        }
+#endif
+        default:
+            ASSERT(false, "Archive uses a compression this build doesn't support");
+    }
+}
+
+std::string archive::default_path() {
+    return utils::file::executable_dir() + "assets.pak";
+}
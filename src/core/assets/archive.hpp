@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/assets/archive_format.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace core {
+    // read-only view of a .pak file. the whole file is mmap'd, lookups are
+    // a binary search over the hash-sorted index, and uncompressed entries
+    // are handed out as pointers straight into the mapping
+    class archive {
+    public:
+        using entry = archive_format::entry;
+        using chunk_callback = std::function<void(const char* data, size_t size)>;
+
+    private:
+        int _fd;
+        const char* _base;
+        size_t _size;
+
+        const archive_format::header* _header;
+        const entry* _entries;
+        const char* _names;
+
+        // maps _fd and checks the header, the reason if it's no archive
+        const char* map();
+
+        void decompress_chunk(
+            archive_format::compression, const char* src, size_t src_size,
+            char* dst, size_t dst_size) const;
+
+    public:
+        archive();
+        archive(const std::string& path);
+        ~archive();
+
+        archive(const archive&) = delete;
+        archive& operator=(const archive&) = delete;
+        archive(archive&&) noexcept;
+        archive& operator=(archive&&) noexcept;
+
+        bool is_open() const;
+
+        size_t entry_count() const;
+        const entry& entry_at(size_t) const;
+        std::string_view name_of(const entry&) const;
+
+        // nullptr if there's no such asset
+        const entry* find(std::string_view name) const;
+
+        // pointer into the mapping, only for uncompressed entries
+        const char* data(const entry&) const;
+
+        // whole entry, decompressed if needed
+        std::vector<char> read(const entry&) const;
+        std::vector<char> read(std::string_view name) const;
+
+        // hands out the entry piece by piece, without ever holding more
+        // than one chunk of decompressed data
+        void stream(const entry&, size_t chunk_size, const chunk_callback&) const;
+
+        // where the archive sits next to the executable
+        static std::string default_path();
+    };
+}
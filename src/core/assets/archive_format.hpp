@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// on-disk layout of a packed asset archive (.pak)
+//
+//   header
+//   index     header.entry_count entries, sorted by name hash
+//   names     every name back to back, not null terminated
+//   data      each entry starts on an archive::alignment boundary
+//
+// everything is little-endian. compressed entries are split into
+// independently compressed chunks, so they can be streamed:
+//
+//   uint32_t compressed_size[chunk_count]   (chunk_count from original size)
+//   chunk data, back to back
+
+namespace core::archive_format {
+    const uint32_t magic = 0x4b415047; // "GPAK"
+    const uint32_t version = 1;
+
+    // entry data is page aligned, so a mmap'd entry can be handed to
+    // anything that wants aligned memory (eg. a mapped staging upload)
+    const uint64_t alignment = 4096;
+
+    enum class compression : uint32_t {
+        none = 0,
+        lz4 = 1,
+        zstd = 2,
+    };
+
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t reserved;
+        uint64_t index_offset;
+        uint64_t names_offset;
+        uint64_t data_offset;
+        uint64_t file_size;
+    };
+
+    struct entry {
+        uint64_t hash;
+        uint64_t offset;        // from the start of the file
+        uint64_t stored_size;
+        uint64_t original_size;
+        uint32_t name_offset;   // into the names block
+        uint32_t name_length;
+        compression method;
+        uint32_t chunk_size;    // uncompressed bytes per chunk
+    };
+
+    static_assert(sizeof(header) == 48, "archive header must be packed");
+    static_assert(sizeof(entry) == 48, "archive entry must be packed");
+
+    // FNV-1a over the asset name, eg. "shaders/basic.vert.spv"
+    inline uint64_t hash_name(std::string_view name) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for(char c : name) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+}
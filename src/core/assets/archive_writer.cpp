@@ -0,0 +1,166 @@
+#include "./archive_writer.hpp"
+
+#include "utils/log.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+#ifdef GAME_HAS_LZ4
+    #include <lz4.h>
+#endif
+
+#ifdef GAME_HAS_ZSTD
+    #include <zstd.h>
+#endif
+
+using namespace core;
+using archive_format::compression;
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+archive_writer::archive_writer(uint32_t chunk_size)
+    : _chunk_size(chunk_size)
+{}
+
+bool archive_writer::supports(compression method) {
+    switch(method) {
+        case compression::none: return true;
+#ifdef GAME_HAS_LZ4
+        case compression::lz4: return true;
+#endif
+#ifdef GAME_HAS_ZSTD
+        case compression::zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+void archive_writer::add(std::string name, std::vector<char> data, compression method) {
+    if(!supports(method)) method = compression::none;
+    _pending.push_back({ std::move(name), std::move(data), method });
+}
+
+std::vector<char> archive_writer::compress(const pending& p) const {
+    if(p.method == compression::none || p.data.empty()) return {};
+
+    size_t chunk_count = (p.data.size() + _chunk_size - 1) / _chunk_size;
+
+    // chunk size table up front, then the chunks
+    std::vector<char> out(chunk_count * sizeof(uint32_t));
+
+    for(size_t i = 0; i < chunk_count; i++) {
+        [[maybe_unused]] const char* src = p.data.data() + i * _chunk_size;
+        [[maybe_unused]] size_t src_size = std::min(size_t(_chunk_size), p.data.size() - i * _chunk_size);
+        size_t written = 0;
+        size_t start = out.size();
+
+        switch(p.method) {
+#ifdef GAME_HAS_LZ4
+            case compression::lz4: {
+                out.resize(start + LZ4_compressBound(src_size));
+                written = LZ4_compress_default(src, out.data() + start, src_size, out.size() - start);
+                break;
+            }
+#endif
+#ifdef GAME_HAS_ZSTD
+            case compression::zstd: {
+                out.resize(start + ZSTD_compressBound(src_size));
+                written = ZSTD_compress(out.data() + start, out.size() - start, src, src_size, 19);
+                if(ZSTD_isError(written)) written = 0;
+                break;
+            }
+#endif
+            default:
+                break;
+        }
+
+        if(written == 0) return {};
+
+        out.resize(start + written);
+        uint32_t size = written;
+        std::copy(
+            reinterpret_cast<char*>(&size), reinterpret_cast<char*>(&size) + sizeof(size),
+            out.data() + i * sizeof(uint32_t));
+    }
+
+    if(out.size() >= p.data.size()) return {};
+    return out;
+}
+
+bool archive_writer::write(const std::string& path) {
+    using archive_format::entry;
+
+    std::sort(_pending.begin(), _pending.end(), [](const pending& a, const pending& b) {
+        return archive_format::hash_name(a.name) < archive_format::hash_name(b.name);
+    });
+
+    archive_format::header header{};
+    header.magic = archive_format::magic;
+    header.version = archive_format::version;
+    header.entry_count = _pending.size();
+    header.index_offset = sizeof(header);
+    header.names_offset = header.index_offset + _pending.size() * sizeof(entry);
+
+    std::vector<entry> entries(_pending.size());
+    std::vector<std::vector<char>> stored(_pending.size());
+    std::string names;
+
+    for(size_t i = 0; i < _pending.size(); i++) {
+        auto& p = _pending[i];
+        auto& e = entries[i];
+
+        e.hash = archive_format::hash_name(p.name);
+        e.name_offset = names.size();
+        e.name_length = p.name.size();
+        e.original_size = p.data.size();
+
+        names += p.name;
+
+        stored[i] = compress(p);
+        if(stored[i].empty()) {
+            e.method = compression::none;
+            e.chunk_size = 0;
+            e.stored_size = p.data.size();
+        } else {
+            e.method = p.method;
+            e.chunk_size = _chunk_size;
+            e.stored_size = stored[i].size();
+        }
+    }
+
+    header.data_offset = align_up(header.names_offset + names.size(), archive_format::alignment);
+
+    uint64_t offset = header.data_offset;
+    for(auto& e : entries) {
+        e.offset = offset;
+        offset = align_up(offset + e.stored_size, archive_format::alignment);
+    }
+    header.file_size = offset;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out.is_open()) {
+        LOG("[ASSETS] could not write %s", path.c_str());
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entry));
+    out.write(names.data(), names.size());
+
+    for(size_t i = 0; i < entries.size(); i++) {
+        out.seekp(entries[i].offset);
+
+        auto& data = stored[i].empty() ? _pending[i].data : stored[i];
+        out.write(data.data(), data.size());
+    }
+
+    // pad the last entry, so the file size matches the header
+    if(static_cast<uint64_t>(out.tellp()) < header.file_size) {
+        out.seekp(header.file_size - 1);
+        out.put(0);
+    }
+
+    return out.good();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/assets/archive_format.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // builds a .pak file, used by the packer tool (tools/packer)
+    class archive_writer {
+    private:
+        struct pending {
+            std::string name;
+            std::vector<char> data;
+            archive_format::compression method;
+        };
+
+        std::vector<pending> _pending;
+        uint32_t _chunk_size;
+
+        // empty if compressing didn't pay off
+        std::vector<char> compress(const pending&) const;
+
+    public:
+        archive_writer(uint32_t chunk_size = 256 * 1024);
+
+        // unsupported methods quietly fall back to storing the data as is
+        void add(std::string name, std::vector<char> data, archive_format::compression);
+
+        bool write(const std::string& path);
+
+        static bool supports(archive_format::compression);
+    };
+}
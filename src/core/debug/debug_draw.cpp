@@ -0,0 +1,129 @@
+#include "./debug_draw.hpp"
+
+#if GAME_DEBUG_DRAW
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+#include <cstdarg>
+
+using namespace core;
+
+namespace {
+    // one per thread that ever drew. only its own thread and collect()
+    // touch it, so the lock is almost never contended
+    struct thread_buffer {
+        std::mutex mutex;
+        std::vector<debug::line> lines;
+        std::vector<debug::text> texts;
+        std::vector<char> chars;
+    };
+
+    std::atomic<bool> draw_enabled{ true };
+
+    // buffers outlive their threads, there are only ever a handful
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+
+    thread_buffer& local_buffer() {
+        thread_local thread_buffer* local = nullptr;
+        if(local != nullptr) return *local;
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<thread_buffer>());
+        local = buffers.back().get();
+        return *local;
+    }
+
+    debug::line make_line(float ax, float ay, float az, float bx, float by, float bz, uint32_t color) {
+        return { { ax, ay, az }, color, { bx, by, bz }, 0 };
+    }
+}
+
+void debug::set_enabled(bool enabled) {
+    draw_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool debug::enabled() {
+    return draw_enabled.load(std::memory_order_relaxed);
+}
+
+void debug::draw_line(const structs::vector3& a, const structs::vector3& b, structs::color color) {
+    if(!enabled()) return;
+
+    auto& buffer = local_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.lines.push_back(make_line(a.x, a.y, a.z, b.x, b.y, b.z, color.packed()));
+}
+
+void debug::draw_box(const structs::vector3& min, const structs::vector3& max, structs::color color) {
+    if(!enabled()) return;
+
+    uint32_t c = color.packed();
+    float x0 = min.x, y0 = min.y, z0 = min.z;
+    float x1 = max.x, y1 = max.y, z1 = max.z;
+
+    auto& buffer = local_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    auto& lines = buffer.lines;
+
+    // the 4 edges along each axis
+    lines.push_back(make_line(x0, y0, z0, x1, y0, z0, c));
+    lines.push_back(make_line(x0, y1, z0, x1, y1, z0, c));
+    lines.push_back(make_line(x0, y0, z1, x1, y0, z1, c));
+    lines.push_back(make_line(x0, y1, z1, x1, y1, z1, c));
+
+    lines.push_back(make_line(x0, y0, z0, x0, y1, z0, c));
+    lines.push_back(make_line(x1, y0, z0, x1, y1, z0, c));
+    lines.push_back(make_line(x0, y0, z1, x0, y1, z1, c));
+    lines.push_back(make_line(x1, y0, z1, x1, y1, z1, c));
+
+    lines.push_back(make_line(x0, y0, z0, x0, y0, z1, c));
+    lines.push_back(make_line(x1, y0, z0, x1, y0, z1, c));
+    lines.push_back(make_line(x0, y1, z0, x0, y1, z1, c));
+    lines.push_back(make_line(x1, y1, z0, x1, y1, z1, c));
+}
+
+void debug::draw_text(float x, float y, structs::color color, const char* format, ...) {
+    if(!enabled()) return;
+
+    char formatted[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(formatted, sizeof(formatted), format, args);
+    va_end(args);
+
+    if(length <= 0) return;
+    if(length >= int(sizeof(formatted))) length = sizeof(formatted) - 1;
+
+    auto& buffer = local_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+
+    buffer.texts.push_back({ x, y, color.packed(), uint32_t(buffer.chars.size()), uint32_t(length) });
+    buffer.chars.insert(buffer.chars.end(), formatted, formatted + length);
+}
+
+void debug::collect(std::vector<line>& lines, std::vector<text>& texts, std::vector<char>& chars) {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+
+    for(auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+
+        lines.insert(lines.end(), buffer->lines.begin(), buffer->lines.end());
+
+        uint32_t base = uint32_t(chars.size());
+        for(auto t : buffer->texts) {
+            t.first += base;
+            texts.push_back(t);
+        }
+        chars.insert(chars.end(), buffer->chars.begin(), buffer->chars.end());
+
+        // cleared, not freed, steady frames don't allocate
+        buffer->lines.clear();
+        buffer->texts.clear();
+        buffer->chars.clear();
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "components/structs.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// on in debug builds. release builds compile every DEBUG_* call away,
+// arguments and all. -DGAME_DEBUG_DRAW=0 turns it off in debug builds too
+#ifndef GAME_DEBUG_DRAW
+    #ifdef NDEBUG
+        #define GAME_DEBUG_DRAW 0
+    #else
+        #define GAME_DEBUG_DRAW 1
+    #endif
+#endif
+
+#if GAME_DEBUG_DRAW
+
+namespace core::debug {
+    // also the per-instance data of debug_line.vert
+    struct line {
+        float a[3];
+        uint32_t color;     // RGBA8
+        float b[3];
+        uint32_t padding;
+    };
+
+    // screen space, pixels from the top left
+    struct text {
+        float x, y;
+        uint32_t color;
+        // range of the collected characters
+        uint32_t first, length;
+    };
+
+    // off costs one relaxed load per call, nothing gets stored
+    void set_enabled(bool);
+    bool enabled();
+
+    // world space. callable from any thread, each one appends to its own
+    // buffer and collect() merges them
+    void draw_line(const structs::vector3& a, const structs::vector3& b, structs::color);
+    // axis aligned, 12 lines
+    void draw_box(const structs::vector3& min, const structs::vector3& max, structs::color);
+    // printf style, \n starts a new line. cut at 255 characters
+    void draw_text(float x, float y, structs::color, const char* format, ...)
+        __attribute__((format(printf, 4, 5)));
+
+    // moves every thread's primitives since the last call to the end of
+    // lines, texts and chars. once per frame, see core::debug_renderer
+    void collect(std::vector<line>& lines, std::vector<text>& texts, std::vector<char>& chars);
+}
+
+#define DEBUG_LINE(...) core::debug::draw_line(__VA_ARGS__)
+#define DEBUG_BOX(...)  core::debug::draw_box(__VA_ARGS__)
+#define DEBUG_TEXT(...) core::debug::draw_text(__VA_ARGS__)
+
+#else
+
+#define DEBUG_LINE(...) ((void)0)
+#define DEBUG_BOX(...)  ((void)0)
+#define DEBUG_TEXT(...) ((void)0)
+
+#endif
@@ -0,0 +1,276 @@
+#include "./debug_renderer.hpp"
+
+#if GAME_DEBUG_DRAW
+
+#include "utils/log.hpp"
+
+#include <cstring>
+#include <cstddef>
+
+using namespace core;
+
+namespace {
+    // font8x8_basic (public domain), ' ' to '~'. a byte per row from the
+    // top, bit 0 is the leftmost pixel
+    const uint8_t font[debug_renderer::glyph_count][8] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+        { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // !
+        { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+        { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // #
+        { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // $
+        { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // %
+        { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // &
+        { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+        { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // (
+        { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // )
+        { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // *
+        { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // +
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ,
+        { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // -
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+        { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // /
+        { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // 0
+        { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // 1
+        { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // 2
+        { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // 3
+        { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // 4
+        { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // 5
+        { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // 6
+        { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // 7
+        { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // 8
+        { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // 9
+        { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // :
+        { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ;
+        { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // <
+        { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // =
+        { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // >
+        { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // ?
+        { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // @
+        { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // A
+        { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // B
+        { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // C
+        { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // D
+        { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // E
+        { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // F
+        { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // G
+        { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // H
+        { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // I
+        { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // J
+        { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // K
+        { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // L
+        { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // M
+        { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // N
+        { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // O
+        { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // P
+        { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // Q
+        { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // R
+        { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // S
+        { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // T
+        { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // U
+        { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // V
+        { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // W
+        { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // X
+        { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // Y
+        { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // Z
+        { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // [
+        { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // backslash
+        { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ]
+        { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // ^
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // _
+        { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+        { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // a
+        { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // b
+        { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // c
+        { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // d
+        { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // e
+        { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // f
+        { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // g
+        { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // h
+        { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // i
+        { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // j
+        { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // k
+        { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // l
+        { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // m
+        { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // n
+        { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // o
+        { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // p
+        { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // q
+        { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // r
+        { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // s
+        { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // t
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // u
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // v
+        { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // w
+        { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // x
+        { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // y
+        { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // z
+        { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // {
+        { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // |
+        { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // }
+        { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+    };
+
+    // glyphs get a transparent border so linear filtering doesn't bleed
+    // the atlas neighbours in
+    const uint32_t glyph_size = 8;
+    const uint32_t glyph_padded = glyph_size + 2;
+}
+
+structs::vertex_layout debug_renderer::vertex_layout() {
+    structs::vertex_layout layout;
+
+    VkVertexInputBindingDescription binding{};
+    binding.binding = 0;
+    binding.stride = sizeof(debug::line);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    layout.bindings.push_back(binding);
+
+    VkVertexInputAttributeDescription start{};
+    start.location = 0;
+    start.binding = 0;
+    start.format = VK_FORMAT_R32G32B32_SFLOAT;
+    start.offset = offsetof(debug::line, a);
+    layout.attributes.push_back(start);
+
+    VkVertexInputAttributeDescription color{};
+    color.location = 1;
+    color.binding = 0;
+    color.format = VK_FORMAT_R8G8B8A8_UNORM;
+    color.offset = offsetof(debug::line, color);
+    layout.attributes.push_back(color);
+
+    VkVertexInputAttributeDescription end{};
+    end.location = 2;
+    end.binding = 0;
+    end.format = VK_FORMAT_R32G32B32_SFLOAT;
+    end.offset = offsetof(debug::line, b);
+    layout.attributes.push_back(end);
+
+    return layout;
+}
+
+debug_renderer::debug_renderer(sprite_batch* sprites)
+    : line_width(2.0f), text_scale(2.0f), _has_glyphs(false), _stats{}
+{
+    static const float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+    memcpy(_view_projection, identity, sizeof(identity));
+
+    if(sprites == nullptr) return;
+
+    uint8_t rgba[glyph_padded * glyph_padded * 4];
+    for(uint32_t g = 0; g < glyph_count; g++) {
+        memset(rgba, 0, sizeof(rgba));
+
+        for(uint32_t y = 0; y < glyph_size; y++) {
+            for(uint32_t x = 0; x < glyph_size; x++) {
+                if(!(font[g][y] & (1u << x))) continue;
+
+                uint8_t* p = rgba + ((y + 1) * glyph_padded + x + 1) * 4;
+                p[0] = p[1] = p[2] = p[3] = 255;
+            }
+        }
+
+        auto id = sprites->add_sprite(rgba, glyph_padded, glyph_padded);
+        if(!id.has_value()) {
+            LOG("Debug text disabled, the sprite atlas is full");
+            return;
+        }
+        _glyphs[g] = *id;
+    }
+    _has_glyphs = true;
+}
+
+void debug_renderer::set_camera(const float view[16], const float projection[16]) {
+    // projection * view, both column major
+    for(uint32_t c = 0; c < 4; c++) {
+        for(uint32_t r = 0; r < 4; r++) {
+            float sum = 0.0f;
+            for(uint32_t k = 0; k < 4; k++) {
+                sum += projection[k * 4 + r] * view[c * 4 + k];
+            }
+            _view_projection[c * 4 + r] = sum;
+        }
+    }
+}
+
+void debug_renderer::collect() {
+    _lines.clear();
+    _texts.clear();
+    _chars.clear();
+    debug::collect(_lines, _texts, _chars);
+
+    _stats = {};
+    _stats.lines = uint32_t(_lines.size());
+}
+
+void debug_renderer::draw_lines(
+    draw_queue& queue, vkframe_ring& ring,
+    VkPipeline pipeline, VkPipelineLayout layout, uint32_t pipeline_id, uint8_t layer,
+    VkExtent2D viewport)
+{
+    if(_lines.empty()) return;
+
+    auto instances = ring.push(_lines.data(), _lines.size() * sizeof(debug::line));
+    if(!instances.has_value()) {
+        _stats.dropped_lines += uint32_t(_lines.size());
+        return;
+    }
+
+    line_constants constants;
+    memcpy(constants.view_projection, _view_projection, sizeof(_view_projection));
+    constants.half_viewport[0] = viewport.width * 0.5f;
+    constants.half_viewport[1] = viewport.height * 0.5f;
+    constants.width = line_width;
+
+    // a quad of two triangles per line, debug_line.vert expands them
+    draw_packet packet{};
+    packet.key = draw_queue::make_key(layer, pipeline_id, 0, 0.0f, 1.0f);
+    packet.pipeline = pipeline;
+    packet.layout = layout;
+    packet.vertex_buffer = instances->buffer;
+    packet.vertex_buffer_offset = instances->offset;
+    packet.count = 6;
+    packet.instance_count = uint32_t(_lines.size());
+    packet.push_stages = VK_SHADER_STAGE_VERTEX_BIT;
+    packet.push_offset = queue.push_data(&constants, sizeof(constants));
+    packet.push_size = sizeof(constants);
+    queue.push(packet);
+}
+
+void debug_renderer::draw_text(sprite_batch& sprites, uint8_t layer) {
+    if(!_has_glyphs) return;
+
+    float advance = glyph_size * text_scale;
+    float quad = glyph_padded * text_scale;
+
+    for(auto& t : _texts) {
+        structs::color color{
+            uint8_t(t.color & 0xff), uint8_t((t.color >> 8) & 0xff),
+            uint8_t((t.color >> 16) & 0xff), uint8_t(t.color >> 24) };
+
+        uint32_t column = 0, row = 0;
+        for(uint32_t i = 0; i < t.length; i++) {
+            unsigned char c = _chars[t.first + i];
+            if(c == '\n') {
+                column = 0;
+                row++;
+                continue;
+            }
+
+            if(c != ' ' && c >= first_glyph && c < first_glyph + glyph_count) {
+                // sprites are centered on their position
+                float x = t.x + (column + 0.5f) * advance;
+                float y = t.y + (row + 0.5f) * advance;
+                sprites.draw(_glyphs[c - first_glyph], x, y, quad, quad, color, 0.0f, layer);
+                _stats.glyphs++;
+            }
+            column++;
+        }
+    }
+}
+
+const debug_renderer::stats& debug_renderer::get_stats() const {
+    return _stats;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "./debug_draw.hpp"
+
+#if GAME_DEBUG_DRAW
+
+#include "core/graphics/draw_queue.hpp"
+#include "core/graphics/sprite_batch.hpp"
+#include "core/vulkan/vkframe_ring.hpp"
+#include "core/vulkan/vkstructs.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // draws what core::debug collected: every line of the frame is an
+    // instance of one draw with the debug_line pipeline, text goes
+    // through the sprite batch with glyphs from a built-in 8x8 font
+    class debug_renderer {
+    public:
+        struct stats {
+            uint32_t lines;
+            uint32_t glyphs;
+            // didn't fit in the frame ring, not drawn
+            uint32_t dropped_lines;
+        };
+
+        // printable ASCII, ' ' to '~'
+        static const uint32_t first_glyph = 32;
+        static const uint32_t glyph_count = 95;
+
+        static structs::vertex_layout vertex_layout();
+
+        // in pixels
+        float line_width;
+        // a glyph is 8 * text_scale pixels square
+        float text_scale;
+
+    private:
+        // debug_line.vert's push constants
+        struct line_constants {
+            float view_projection[16];
+            float half_viewport[2];
+            float width;
+        };
+
+        bool _has_glyphs;
+        sprite_atlas::sprite_id _glyphs[glyph_count];
+
+        float _view_projection[16];
+
+        // the frame's primitives, cleared (not freed) by collect()
+        std::vector<debug::line> _lines;
+        std::vector<debug::text> _texts;
+        std::vector<char> _chars;
+
+        stats _stats;
+
+    public:
+        // adds the glyphs to the sprites' atlas, upload() them after.
+        // without sprites there's no text
+        explicit debug_renderer(sprite_batch* sprites);
+
+        // column major, see light_clusters::perspective
+        void set_camera(const float view[16], const float projection[16]);
+
+        // takes what every thread drew since the last frame
+        void collect();
+
+        // one instanced draw of every line
+        void draw_lines(
+            draw_queue&, vkframe_ring&,
+            VkPipeline, VkPipelineLayout, uint32_t pipeline_id, uint8_t layer,
+            VkExtent2D viewport);
+
+        // the text as sprites, before the batch is flushed
+        void draw_text(sprite_batch&, uint8_t layer);
+
+        const stats& get_stats() const;
+    };
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "./memory_telemetry.hpp"
+
+#include "core/input/input.hpp"
+#include "core/debug/debug_draw.hpp"
+#include "utils/log.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+    #include <unistd.h>
+#endif
+
+using namespace core;
+
+namespace {
+    const float bar_width = 240.0f;
+    const float bar_height = 10.0f;
+    // room for a line of debug text, 16 pixels at its default scale
+    const float row_height = 18.0f;
+    const float text_gap = 8.0f;
+    const structs::color text_color = { 230, 230, 230, 255 };
+
+    const structs::color background     = { 32, 32, 32, 192 };
+    const structs::color used           = { 64, 192, 96, 255 };
+    // usage past this part of the budget
+    const float warning_fraction = 0.9f;
+    const structs::color over_warning   = { 224, 64, 48, 255 };
+
+    const structs::color category_colors[memory_telemetry::category_count] = {
+        { 80, 140, 230, 255 },  // buffer
+        { 220, 180, 60, 255 },  // image
+        { 180, 100, 220, 255 }, // staging
+        { 90, 210, 210, 255 },  // render_target
+    };
+    static_assert(sizeof(category_colors) / sizeof(category_colors[0]) == memory_telemetry::category_count,
+        "A color per vkmemory::category");
+
+    uint64_t resident_bytes() {
+#ifdef __linux__
+        // total and resident pages
+        FILE* statm = fopen("/proc/self/statm", "r");
+        if(statm == nullptr) return 0;
+
+        unsigned long long total = 0, resident = 0;
+        int read = fscanf(statm, "%llu %llu", &total, &resident);
+        fclose(statm);
+
+        if(read != 2) return 0;
+        return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+#if GAME_DEBUG_DRAW
+    double mib(uint64_t bytes) {
+        return double(bytes) / (1024.0 * 1024.0);
+    }
+#endif
+
+    // sprite_batch::draw takes the center
+    void bar(sprite_batch& sprites, float x, float y, float width, structs::color color, uint8_t layer) {
+        if(width <= 0.0f) return;
+        structs::rect r{ { width, bar_height }, color };
+        sprites.draw(r, x + width * 0.5f, y + bar_height * 0.5f, layer);
+    }
+}
+
+memory_telemetry::memory_telemetry(VkPhysicalDevice physical_device, bool has_budget, double interval)
+    : _physical_device(physical_device), _has_budget(has_budget),
+      _time(0.0), _next_sample(0.0), _interval(interval), _last{},
+      _stream(nullptr), overlay_visible(false)
+{}
+
+memory_telemetry::~memory_telemetry() {
+    if(_stream != nullptr) fclose(_stream);
+}
+
+bool memory_telemetry::stream_to(const std::string& path) {
+    if(_stream != nullptr) fclose(_stream);
+
+    _stream = fopen(path.c_str(), "a");
+    if(_stream == nullptr) {
+        LOG("[MEMORY] could not open %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool memory_telemetry::update(core::registry& registry, float delta) {
+    _time += delta;
+    if(_time < _next_sample) return false;
+    _next_sample = _time + _interval;
+
+    sample s{};
+    s.time = _time;
+    s.has_budget = _has_budget;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = _has_budget ? &budget : nullptr;
+    vkGetPhysicalDeviceMemoryProperties2(_physical_device, &properties);
+
+    for(uint32_t c = 0; c < category_count; c++) {
+        s.categories[c] = vkmemory::get_usage(vkmemory::category(c));
+    }
+
+    // without the extension all we know is what we allocated, and not
+    // which heap it went to. it's all put on the device local heaps
+    uint64_t tracked = 0;
+    for(auto& c : s.categories) tracked += c.bytes;
+
+    auto& memory_properties = properties.memoryProperties;
+    s.heap_count = memory_properties.memoryHeapCount;
+    for(uint32_t i = 0; i < s.heap_count; i++) {
+        auto& h = s.heaps[i];
+        h.size = memory_properties.memoryHeaps[i].size;
+        h.device_local = (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+        if(_has_budget) {
+            h.budget = budget.heapBudget[i];
+            h.usage = budget.heapUsage[i];
+        } else {
+            h.budget = h.size;
+            h.usage = h.device_local ? tracked : 0;
+        }
+    }
+
+    s.resident_bytes = resident_bytes();
+    s.allocations = memory::total_allocations();
+
+    for(size_t i = 0; i < _pool_types.size(); i++) {
+        _pool_types[i].measure(registry, _pools[i]);
+    }
+
+    _last = s;
+    if(_stream != nullptr) this->write_line();
+    return true;
+}
+
+void memory_telemetry::write_line() {
+    const sample& s = _last;
+
+    fprintf(_stream, "{\"time\": %.3f, \"budget_extension\": %s, \"heaps\": [", s.time, s.has_budget ? "true" : "false");
+    for(uint32_t i = 0; i < s.heap_count; i++) {
+        auto& h = s.heaps[i];
+        fprintf(_stream, "%s{\"size\": %llu, \"budget\": %llu, \"usage\": %llu, \"device_local\": %s}",
+            i > 0 ? ", " : "",
+            (unsigned long long)h.size, (unsigned long long)h.budget, (unsigned long long)h.usage,
+            h.device_local ? "true" : "false");
+    }
+
+    fprintf(_stream, "], \"categories\": {");
+    for(uint32_t c = 0; c < category_count; c++) {
+        fprintf(_stream, "%s\"%s\": {\"bytes\": %llu, \"allocations\": %llu}",
+            c > 0 ? ", " : "", vkmemory::name(vkmemory::category(c)),
+            (unsigned long long)s.categories[c].bytes, (unsigned long long)s.categories[c].allocations);
+    }
+
+    fprintf(_stream, "}, \"resident_bytes\": %llu, \"allocations\": %llu, \"allocated_bytes\": %llu, \"components\": {",
+        (unsigned long long)s.resident_bytes,
+        (unsigned long long)s.allocations.count, (unsigned long long)s.allocations.bytes);
+    for(size_t i = 0; i < _pools.size(); i++) {
+        auto& p = _pools[i];
+        fprintf(_stream, "%s\"%s\": {\"count\": %llu, \"capacity\": %llu, \"bytes\": %llu}",
+            i > 0 ? ", " : "", p.name,
+            (unsigned long long)p.count, (unsigned long long)p.capacity, (unsigned long long)p.bytes);
+    }
+    fprintf(_stream, "}}\n");
+
+    // a soak run may get killed, lose at most one line
+    fflush(_stream);
+}
+
+const memory_telemetry::sample& memory_telemetry::last() const {
+    return _last;
+}
+
+const std::vector<memory_telemetry::component_pool>& memory_telemetry::pools() const {
+    return _pools;
+}
+
+void memory_telemetry::draw_overlay(sprite_batch& sprites, float x, float y, uint8_t layer) const {
+    if(!overlay_visible) return;
+
+    // bars are centered in their row, the numbers go right of them
+    const float bar_y = (row_height - bar_height) * 0.5f;
+    [[maybe_unused]] const float text_x = x + bar_width + text_gap;
+    uint64_t device_budget = 0;
+
+    for(uint32_t i = 0; i < _last.heap_count; i++) {
+        auto& h = _last.heaps[i];
+        if(h.budget == 0) continue;
+        if(h.device_local) device_budget = std::max(device_budget, h.budget);
+
+        float fraction = std::min(float(double(h.usage) / double(h.budget)), 1.0f);
+        bar(sprites, x, y + bar_y, bar_width, background, layer);
+        bar(sprites, x, y + bar_y, bar_width * fraction, fraction > warning_fraction ? over_warning : used, layer + 1);
+        DEBUG_TEXT(text_x, y, text_color, "heap %u %s %.1f / %.1f MiB",
+            i, h.device_local ? "device" : "host", mib(h.usage), mib(h.budget));
+        y += row_height;
+    }
+
+    if(device_budget != 0) {
+        // ours, one after the other on the same scale as the heaps
+        bar(sprites, x, y + bar_y, bar_width, background, layer);
+        float offset = 0.0f;
+        uint64_t ours = 0;
+        for(uint32_t c = 0; c < category_count; c++) {
+            float width = bar_width * float(double(_last.categories[c].bytes) / double(device_budget));
+            width = std::min(width, bar_width - offset);
+            bar(sprites, x + offset, y + bar_y, width, category_colors[c], layer + 1);
+            offset += width;
+            ours += _last.categories[c].bytes;
+        }
+        DEBUG_TEXT(text_x, y, text_color, "ours %.1f MiB", mib(ours));
+        y += row_height;
+    }
+
+#if GAME_DEBUG_DRAW
+    // the rest is only numbers, which need debug text. a swatch per
+    // category to match it with the stacked bar
+    for(uint32_t c = 0; c < category_count; c++) {
+        auto& usage = _last.categories[c];
+        bar(sprites, x, y + bar_y, bar_height, category_colors[c], layer + 1);
+        DEBUG_TEXT(x + bar_height + text_gap, y, text_color, "%s %.1f MiB in %llu allocations",
+            vkmemory::name(vkmemory::category(c)), mib(usage.bytes), (unsigned long long)usage.allocations);
+        y += row_height;
+    }
+
+    DEBUG_TEXT(x, y, text_color, "resident %.1f MiB", mib(_last.resident_bytes));
+    y += row_height;
+    if(memory::allocation_tracking_enabled()) {
+        DEBUG_TEXT(x, y, text_color, "new %llu times, %.1f MiB in total",
+            (unsigned long long)_last.allocations.count, mib(_last.allocations.bytes));
+        y += row_height;
+    }
+
+    for(auto& p : _pools) {
+        DEBUG_TEXT(x, y, text_color, "%s %llu / %llu, %.1f MiB",
+            p.name, (unsigned long long)p.count, (unsigned long long)p.capacity, mib(p.bytes));
+        y += row_height;
+    }
+#endif
+}
+
+void core::register_memory_telemetry(world& w, memory_telemetry& telemetry, sprite_batch* sprites) {
+    w.add_update_system([&telemetry, sprites](world& w) {
+        auto input = w.get_resource<input::state>();
+        if(input.pressed(GLFW_KEY_F3)) telemetry.overlay_visible = !telemetry.overlay_visible;
+
+        telemetry.update(w.get_registry(), w.get_resource<world::delta_time>());
+
+        // the top two sprite layers, over everything else
+        if(sprites != nullptr) telemetry.draw_overlay(*sprites, 8.0f, 8.0f, sprite_batch::max_layers - 2);
+    });
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "core/vulkan/vkmemory.hpp"
+#include "core/memory/alloc_stats.hpp"
+#include "core/graphics/sprite_batch.hpp"
+#include "core/ecs/world.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "entt/entt.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+namespace core {
+    // where memory goes, sampled a few times a second:
+    //
+    //   heaps        the driver's usage and budget per heap, with
+    //                VK_EXT_memory_budget. without it the budget is the
+    //                heap size and usage is only what vkmemory tracked
+    //   categories   our own device allocations, see core::vkmemory
+    //   process      resident set size, and operator new totals in
+    //                GAME_TRACK_ALLOCATIONS builds
+    //   components   size of the ECS pools that were registered
+    //
+    // every sample can be appended to a file as a line of json, to find
+    // leaks and budget overruns in long runs, and the last one drawn as
+    // bars over the scene, with every number as debug text in builds
+    // that have it
+    class memory_telemetry {
+    public:
+        static const uint32_t max_heaps = VK_MAX_MEMORY_HEAPS;
+        static const uint32_t category_count = uint32_t(vkmemory::category::count);
+
+        struct heap {
+            uint64_t size;
+            uint64_t budget;
+            uint64_t usage;
+            bool device_local;
+        };
+
+        struct component_pool {
+            const char* name;
+            uint64_t count;
+            uint64_t capacity;
+            // capacity times the component's size, what the pool's
+            // packed array takes
+            uint64_t bytes;
+        };
+
+        struct sample {
+            // seconds since the first update()
+            double time;
+
+            bool has_budget;
+            uint32_t heap_count;
+            heap heaps[max_heaps];
+
+            vkmemory::usage categories[category_count];
+
+            // 0 where /proc isn't there
+            uint64_t resident_bytes;
+            memory::allocation_counters allocations;
+        };
+
+    private:
+        struct pool_type {
+            const char* name;
+            void (*measure)(registry&, component_pool&);
+        };
+
+        VkPhysicalDevice _physical_device;
+        bool _has_budget;
+
+        std::vector<pool_type> _pool_types;
+        std::vector<component_pool> _pools;
+
+        double _time;
+        double _next_sample;
+        double _interval;
+        sample _last;
+
+        FILE* _stream;
+
+        void write_line();
+
+    public:
+        // draw_overlay() only draws while it's set
+        bool overlay_visible;
+
+        // has_budget if VK_EXT_memory_budget was enabled on the device.
+        // samples every interval seconds
+        memory_telemetry(VkPhysicalDevice, bool has_budget, double interval = 0.5);
+        ~memory_telemetry();
+
+        memory_telemetry(const memory_telemetry&) = delete;
+        memory_telemetry& operator=(const memory_telemetry&) = delete;
+
+        template<typename T>
+        void track_component(const char* name) {
+            _pool_types.push_back({ name, [](registry& r, component_pool& out) {
+                auto& storage = r.storage<T>();
+                out.count = storage.size();
+                out.capacity = storage.capacity();
+                out.bytes = out.capacity * sizeof(T);
+            }});
+            _pools.push_back({ name, 0, 0, 0 });
+        }
+
+        // appends every sample from now on to path, as json lines. false
+        // if it can't be opened
+        bool stream_to(const std::string& path);
+
+        // true if it took a sample
+        bool update(registry&, float delta);
+
+        const sample& last() const;
+        const std::vector<component_pool>& pools() const;
+
+        // a bar per heap, usage over budget, and one of our categories
+        // stacked against the biggest device local heap. with debug text
+        // the numbers go next to them, followed by a line per category,
+        // the process and every tracked component pool. top left corner
+        // at x, y in pixels
+        void draw_overlay(sprite_batch&, float x, float y, uint8_t layer) const;
+    };
+
+    // samples every frame and draws the overlay while it's on, F3
+    // toggles it. telemetry and sprites have to outlive the world's
+    // updates, sprites may be null
+    void register_memory_telemetry(world&, memory_telemetry&, sprite_batch* sprites);
+}
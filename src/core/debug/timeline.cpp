@@ -0,0 +1,54 @@
+#include "./timeline.hpp"
+
+#include "utils/log.hpp"
+
+#include <cstdio>
+
+using namespace core;
+
+timeline::scope::scope(timeline* t, const char* name, uint32_t thread)
+    : _timeline(t), _name(name), _thread(thread), _start(t ? t->now_ms() : 0.0)
+{}
+
+timeline::scope::~scope() {
+    if(_timeline) _timeline->record(_name, _thread, _start, _timeline->now_ms());
+}
+
+timeline::timeline() : _origin(clock::now()) {}
+
+double timeline::now_ms() const {
+    return std::chrono::duration<double, std::milli>(clock::now() - _origin).count();
+}
+
+void timeline::record(const char* name, uint32_t thread, double start_ms, double end_ms) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _spans.push_back({ name, thread, start_ms, end_ms });
+}
+
+std::vector<timeline::span> timeline::spans() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _spans;
+}
+
+bool timeline::write(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if(file == nullptr) {
+        LOG("[TRACE] could not open %s", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // complete events, the trace format counts in microseconds
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for(size_t i = 0; i < _spans.size(); i++) {
+        auto& s = _spans[i];
+        fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.1f, \"dur\": %.1f}",
+            i > 0 ? ",\n" : "", s.name, s.thread, s.start_ms * 1000.0, (s.end_ms - s.start_ms) * 1000.0);
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // named spans of time on one clock, from any thread. written out as a
+    // chrome trace, which chrome://tracing and ui.perfetto.dev open, one
+    // row per thread
+    class timeline {
+    public:
+        struct span {
+            const char* name;
+            // the job thread it ran on, 0 for the main thread
+            uint32_t thread;
+            // since the timeline was made
+            double start_ms, end_ms;
+        };
+
+        // records from its construction to its destruction
+        class scope {
+        private:
+            timeline* _timeline;
+            const char* _name;
+            uint32_t _thread;
+            double _start;
+
+        public:
+            // does nothing with a null timeline
+            scope(timeline*, const char* name, uint32_t thread = 0);
+            ~scope();
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        clock::time_point _origin;
+
+        std::mutex _mutex;
+        std::vector<span> _spans;
+
+    public:
+        timeline();
+
+        timeline(const timeline&) = delete;
+        timeline& operator=(const timeline&) = delete;
+
+        double now_ms() const;
+
+        // name has to outlive the timeline, a string literal
+        void record(const char* name, uint32_t thread, double start_ms, double end_ms);
+
+        // in the order they ended
+        std::vector<span> spans();
+
+        // false if the file can't be written
+        bool write(const std::string& path);
+    };
+}
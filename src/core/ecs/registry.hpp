@@ -0,0 +1,10 @@
+#pragma once
+
+#include "entt/entt.hpp"
+#include <memory_resource>
+
+namespace core {
+    // the registry a world owns. its pools allocate from the world's
+    // memory resource, see world::memory()
+    using registry = entt::basic_registry<entt::entity, std::pmr::polymorphic_allocator<entt::entity>>;
+}
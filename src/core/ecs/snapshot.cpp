@@ -0,0 +1,497 @@
+#include "./snapshot.hpp"
+
+#include "utils/log.hpp"
+#include "utils/assert.hpp"
+
+#include <cstdio>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace core;
+using snapshot_format::kind;
+
+// SNAPSHOT
+
+snapshot::snapshot()
+    : _fd(-1), _mapping(nullptr), _mapping_size(0), _base(nullptr), _size(0)
+{}
+
+snapshot::snapshot(std::vector<char>&& bytes)
+    : snapshot()
+{
+    _bytes = std::move(bytes);
+    _base = _bytes.data();
+    _size = _bytes.size();
+
+    if(!validate()) _base = nullptr;
+}
+
+snapshot::snapshot(const std::string& path)
+    : snapshot()
+{
+    _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(_fd < 0) {
+        LOG("[SNAPSHOT] could not open %s", path.c_str());
+        return;
+    }
+
+    struct stat info;
+    fstat(_fd, &info);
+    _mapping_size = info.st_size;
+
+    if(_mapping_size < sizeof(snapshot_format::header)) {
+        LOG("[SNAPSHOT] %s is too small", path.c_str());
+        return;
+    }
+
+    void* mapping = mmap(nullptr, _mapping_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if(mapping == MAP_FAILED) {
+        LOG("[SNAPSHOT] could not map %s", path.c_str());
+        return;
+    }
+
+    _mapping = static_cast<const char*>(mapping);
+    _base = _mapping;
+    _size = _mapping_size;
+
+    // restore reads every block front to back
+    madvise(const_cast<char*>(_mapping), _mapping_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    if(!validate()) {
+        LOG("[SNAPSHOT] %s is not a valid snapshot", path.c_str());
+        _base = nullptr;
+    }
+}
+
+snapshot::~snapshot() {
+    if(_mapping) munmap(const_cast<char*>(_mapping), _mapping_size);
+    if(_fd >= 0) close(_fd);
+}
+
+snapshot::snapshot(snapshot&& o) noexcept
+    : snapshot()
+{
+    *this = std::move(o);
+}
+
+snapshot& snapshot::operator=(snapshot&& o) noexcept {
+    // a moved vector keeps its buffer, so _base stays valid
+    std::swap(_bytes, o._bytes);
+    std::swap(_fd, o._fd);
+    std::swap(_mapping, o._mapping);
+    std::swap(_mapping_size, o._mapping_size);
+    std::swap(_base, o._base);
+    std::swap(_size, o._size);
+    return *this;
+}
+
+bool snapshot::validate() {
+    if(_size < sizeof(snapshot_format::header)) return false;
+
+    auto& h = get_header();
+    if(h.magic != snapshot_format::magic) return false;
+    if(h.version != snapshot_format::version) return false;
+    if(h.file_size != _size) return false;
+
+    // every block has to be inside the file
+    auto inside = [this](uint64_t offset, uint64_t size) {
+        return offset <= _size && size <= _size - offset;
+    };
+
+    if(!inside(h.pools_offset, uint64_t(h.pool_count) * sizeof(snapshot_format::pool))) return false;
+    if(!inside(h.destroyed_offset, uint64_t(h.destroyed_count) * sizeof(entt::entity))) return false;
+
+    auto* pools = at<snapshot_format::pool>(h.pools_offset);
+    for(uint32_t i = 0; i < h.pool_count; i++) {
+        auto& p = pools[i];
+        if(!inside(p.entities_offset, uint64_t(p.count) * sizeof(entt::entity))) return false;
+        if(!inside(p.removed_offset, uint64_t(p.removed_count) * sizeof(entt::entity))) return false;
+        if(!inside(p.data_offset, p.data_size)) return false;
+
+        uint64_t expected = p.element_size != 0
+            ? uint64_t(p.count) * p.element_size
+            : (uint64_t(p.count) + 1) * sizeof(uint32_t);
+        if(p.element_size != 0 ? p.data_size != expected : p.data_size < expected) return false;
+    }
+
+    return true;
+}
+
+bool snapshot::is_valid() const {
+    return _base != nullptr;
+}
+
+bool snapshot::save(const std::string& path) const {
+    ASSERT(is_valid(), "Saving an invalid snapshot");
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if(file == nullptr) {
+        LOG("[SNAPSHOT] could not write %s", path.c_str());
+        return false;
+    }
+
+    bool written = fwrite(_base, 1, _size, file) == _size;
+    fclose(file);
+
+    if(!written) {
+        LOG("[SNAPSHOT] short write to %s", path.c_str());
+    }
+    return written;
+}
+
+const snapshot_format::header& snapshot::get_header() const {
+    return *at<snapshot_format::header>(0);
+}
+
+const snapshot_format::pool* snapshot::find(uint64_t hash) const {
+    auto& h = get_header();
+    auto* pools = at<snapshot_format::pool>(h.pools_offset);
+
+    for(uint32_t i = 0; i < h.pool_count; i++) {
+        if(pools[i].hash == hash) return &pools[i];
+    }
+    return nullptr;
+}
+
+const char* snapshot::data() const {
+    return _base;
+}
+
+size_t snapshot::size() const {
+    return _size;
+}
+
+// SCHEMA
+
+namespace {
+    const uint32_t none = 0xffffffff;
+
+    uint32_t index_of(entt::entity e) {
+        return entt::to_entity(e);
+    }
+
+    // appends a block on an alignment boundary, returns its offset.
+    // with no data the block is only made room for
+    uint64_t append(std::vector<char>& out, const void* data, size_t size) {
+        size_t offset = (out.size() + snapshot_format::alignment - 1) & ~(snapshot_format::alignment - 1);
+
+        // grow geometrically, resize alone would only grow to fit
+        if(offset + size > out.capacity()) out.reserve(std::max(offset + size, out.capacity() * 2));
+
+        out.resize(offset + size);
+        if(data != nullptr && size > 0) memcpy(out.data() + offset, data, size);
+        return offset;
+    }
+
+    // sizes a table indexed by entity index so all of these fit
+    template<typename T>
+    void fit(const entt::entity* entities, size_t count, std::vector<T>& table, T empty) {
+        uint32_t highest = 0;
+        for(size_t i = 0; i < count; i++) highest = std::max(highest, index_of(entities[i]));
+        if(count > 0 && highest >= table.size()) table.resize(highest + 1, empty);
+    }
+
+    // entity index -> position in a pool, for looking up base components
+    void build_lookup(const entt::entity* entities, uint32_t count, std::vector<uint32_t>& lookup) {
+        std::fill(lookup.begin(), lookup.end(), none);
+        fit(entities, count, lookup, none);
+        for(uint32_t i = 0; i < count; i++) lookup[index_of(entities[i])] = i;
+    }
+
+    // marks every entity of a pool in a set indexed by entity index
+    void mark(const entt::entity* entities, size_t count, std::vector<entt::entity>& set) {
+        fit(entities, count, set, entt::entity(entt::null));
+        for(size_t i = 0; i < count; i++) set[index_of(entities[i])] = entities[i];
+    }
+
+    bool in(const std::vector<entt::entity>& set, entt::entity e) {
+        uint32_t index = index_of(e);
+        return index < set.size() && set[index] == e;
+    }
+}
+
+const snapshot_schema::component_type* snapshot_schema::find(uint64_t hash) const {
+    for(auto& t : _types) {
+        if(t.hash == hash) return &t;
+    }
+    return nullptr;
+}
+
+snapshot snapshot_schema::capture(core::registry& registry, uint64_t frame) const {
+    return build(registry, nullptr, frame);
+}
+
+snapshot snapshot_schema::capture_delta(core::registry& registry, const snapshot& base, uint64_t frame) const {
+    ASSERT(base.is_valid() && base.get_header().type == kind::full, "Deltas are taken against a full snapshot");
+    return build(registry, &base, frame);
+}
+
+snapshot snapshot_schema::build(core::registry& registry, const snapshot* base, uint64_t frame) const {
+    std::vector<char> out;
+
+    snapshot_format::header header{};
+    header.magic = snapshot_format::magic;
+    header.version = snapshot_format::version;
+    header.type = base ? kind::delta : kind::full;
+    header.pool_count = _types.size();
+    header.frame = frame;
+    header.base_frame = base ? base->get_header().frame : frame;
+
+    append(out, &header, sizeof(header));
+
+    std::vector<snapshot_format::pool> pools(_types.size());
+    header.pools_offset = append(out, pools.data(), pools.size() * sizeof(snapshot_format::pool));
+
+    std::vector<entt::entity> entities, removed;
+    std::vector<uint32_t> offsets;
+    std::vector<char> bytes, element;
+
+    std::vector<uint32_t> base_lookup;
+    // pool_set only ever holds the current pool, the other two everything
+    std::vector<entt::entity> pool_set, current_set, base_set;
+
+    for(size_t i = 0; i < _types.size(); i++) {
+        auto& t = _types[i];
+        auto& p = pools[i];
+
+        p.hash = t.hash;
+        p.schema_version = t.version;
+        p.element_size = t.element_size;
+
+        t.entities(registry, entities);
+        mark(entities.data(), entities.size(), current_set);
+        mark(entities.data(), entities.size(), pool_set);
+
+        // one element's bytes, for comparing against the base
+        auto element_bytes = [&](entt::entity e) {
+            element.clear();
+            if(t.element_size != 0) {
+                element.resize(t.element_size);
+                t.copy_out(registry, &e, 1, element.data());
+            } else {
+                t.write(registry, e, element, t.write_context);
+            }
+        };
+
+        removed.clear();
+
+        const snapshot_format::pool* base_pool = base ? base->find(t.hash) : nullptr;
+        bool comparable = base_pool && base_pool->element_size == t.element_size
+            && base_pool->schema_version == t.version;
+
+        if(base_pool) {
+            auto* base_entities = base->at<entt::entity>(base_pool->entities_offset);
+            mark(base_entities, base_pool->count, base_set);
+
+            // in the base but not anymore
+            for(uint32_t j = 0; j < base_pool->count; j++) {
+                if(!in(pool_set, base_entities[j])) removed.push_back(base_entities[j]);
+            }
+        }
+
+        for(auto e : entities) pool_set[index_of(e)] = entt::null;
+
+        if(comparable) {
+            auto* base_entities = base->at<entt::entity>(base_pool->entities_offset);
+            auto* base_data = base->at<char>(base_pool->data_offset);
+            auto* base_offsets = base->at<uint32_t>(base_pool->data_offset);
+            const char* base_payload = base_data + (uint64_t(base_pool->count) + 1) * sizeof(uint32_t);
+
+            build_lookup(base_entities, base_pool->count, base_lookup);
+
+            // keep only what's new or different
+            size_t kept = 0;
+            for(size_t j = 0; j < entities.size(); j++) {
+                entt::entity e = entities[j];
+                uint32_t index = index_of(e);
+                uint32_t k = index < base_lookup.size() ? base_lookup[index] : none;
+
+                bool same = false;
+                if(k != none && base_entities[k] == e) {
+                    element_bytes(e);
+                    if(t.element_size != 0) {
+                        same = memcmp(element.data(), base_data + size_t(k) * t.element_size, t.element_size) == 0;
+                    } else {
+                        uint32_t size = base_offsets[k + 1] - base_offsets[k];
+                        same = size == element.size()
+                            && memcmp(element.data(), base_payload + base_offsets[k], size) == 0;
+                    }
+                }
+
+                if(!same) entities[kept++] = e;
+            }
+            entities.resize(kept);
+        }
+
+        p.count = entities.size();
+        p.removed_count = removed.size();
+        p.entities_offset = append(out, entities.data(), entities.size() * sizeof(entt::entity));
+
+        // data, in entity order. raw components go straight into the output
+        if(t.element_size != 0) {
+            p.data_size = entities.size() * size_t(t.element_size);
+            p.data_offset = append(out, nullptr, p.data_size);
+            t.copy_out(registry, entities.data(), entities.size(), out.data() + p.data_offset);
+        } else {
+            bytes.clear();
+            offsets.clear();
+            for(auto e : entities) {
+                offsets.push_back(bytes.size());
+                t.write(registry, e, bytes, t.write_context);
+            }
+            offsets.push_back(bytes.size());
+
+            // the offsets table goes in front of the payload
+            size_t table = offsets.size() * sizeof(uint32_t);
+            p.data_size = table + bytes.size();
+            p.data_offset = append(out, offsets.data(), table);
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        }
+
+        p.removed_offset = append(out, removed.data(), removed.size() * sizeof(entt::entity));
+    }
+
+    // entities that were in the base and aren't in any pool now
+    removed.clear();
+    if(base) {
+        for(auto e : base_set) {
+            if(e != entt::null && !in(current_set, e)) removed.push_back(e);
+        }
+    }
+    header.destroyed_count = removed.size();
+    header.destroyed_offset = append(out, removed.data(), removed.size() * sizeof(entt::entity));
+    header.file_size = out.size();
+
+    memcpy(out.data(), &header, sizeof(header));
+    memcpy(out.data() + header.pools_offset, pools.data(), pools.size() * sizeof(snapshot_format::pool));
+
+    return snapshot(std::move(out));
+}
+
+bool snapshot_schema::restore(core::registry& registry, const snapshot& s) const {
+    if(!s.is_valid()) return false;
+
+    auto& header = s.get_header();
+    auto* pools = s.at<snapshot_format::pool>(header.pools_offset);
+
+    // everything gets checked and decoded before the registry is touched,
+    // so a broken snapshot leaves it as it was. raw pools are used in place
+    std::vector<staged> decoded;
+    decoded.reserve(header.pool_count);
+    std::vector<entt::entity> wanted;
+
+    for(uint32_t i = 0; i < header.pool_count; i++) {
+        auto& p = pools[i];
+        decoded.emplace_back(nullptr, [](void*) {});
+
+        auto* t = find(p.hash);
+        if(t == nullptr) {
+            LOG("[SNAPSHOT] skipping pool %016llx, not registered", (unsigned long long) p.hash);
+            continue;
+        }
+        if(p.element_size != t->element_size || (t->element_size != 0 && p.schema_version != t->version)) {
+            LOG("[SNAPSHOT] %s was saved with a different layout", t->name.c_str());
+            return false;
+        }
+
+        // two versions of one entity can't both come back
+        auto* entities = s.at<entt::entity>(p.entities_offset);
+        fit(entities, p.count, wanted, entt::entity(entt::null));
+        for(uint32_t j = 0; j < p.count; j++) {
+            auto& slot = wanted[index_of(entities[j])];
+            if(slot != entt::null && slot != entities[j]) {
+                LOG("[SNAPSHOT] %s has an entity twice, with different versions", t->name.c_str());
+                return false;
+            }
+            slot = entities[j];
+        }
+
+        if(t->element_size != 0) continue;
+
+        auto* data = s.at<char>(p.data_offset);
+        auto* offsets = reinterpret_cast<const uint32_t*>(data);
+        const char* payload = data + (uint64_t(p.count) + 1) * sizeof(uint32_t);
+        uint64_t payload_size = p.data_size - (uint64_t(p.count) + 1) * sizeof(uint32_t);
+
+        for(uint32_t j = 0; j < p.count; j++) {
+            if(offsets[j] > offsets[j + 1] || offsets[j + 1] > payload_size) {
+                LOG("[SNAPSHOT] %s has a broken offset table", t->name.c_str());
+                return false;
+            }
+        }
+
+        decoded.back() = t->read(payload, offsets, p.count, p.schema_version, t->read_context);
+        if(!decoded.back()) {
+            LOG("[SNAPSHOT] could not read %s version %u", t->name.c_str(), p.schema_version);
+            return false;
+        }
+    }
+
+    // an entity that's gone can still have its slot held by a newer version,
+    // which is in the way of the one coming back. the snapshot wins
+    auto make_alive = [&registry](const entt::entity* entities, uint32_t count) {
+        for(uint32_t i = 0; i < count; i++) {
+            auto e = entities[i];
+            if(registry.valid(e)) continue;
+
+            auto blocker = entt::entt_traits<entt::entity>::construct(index_of(e), registry.current(e));
+            if(registry.valid(blocker)) registry.destroy(blocker);
+
+            auto created = registry.create(e);
+            if(created != e) {
+                // only if the registry hands out slots some other way
+                registry.destroy(created);
+                LOG("[SNAPSHOT] could not bring back entity %u", index_of(e));
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if(header.type == kind::full) {
+        // everything that has a registered component right now
+        std::vector<entt::entity> entities, existing;
+        for(auto& t : _types) {
+            t.entities(registry, entities);
+            mark(entities.data(), entities.size(), existing);
+            t.clear(registry);
+        }
+
+        for(auto e : existing) {
+            if(e != entt::null && !in(wanted, e) && registry.valid(e)) registry.destroy(e);
+        }
+    } else {
+        auto* destroyed = s.at<entt::entity>(header.destroyed_offset);
+        for(uint32_t i = 0; i < header.destroyed_count; i++) {
+            if(registry.valid(destroyed[i])) registry.destroy(destroyed[i]);
+        }
+    }
+
+    bool replace = header.type == kind::delta;
+
+    for(uint32_t i = 0; i < header.pool_count; i++) {
+        auto& p = pools[i];
+        auto* t = find(p.hash);
+        if(t == nullptr) continue;
+
+        auto* entities = s.at<entt::entity>(p.entities_offset);
+
+        if(p.removed_count > 0) {
+            t->remove(registry, s.at<entt::entity>(p.removed_offset), p.removed_count);
+        }
+
+        if(!make_alive(entities, p.count)) return false;
+
+        if(t->element_size != 0) {
+            t->insert(registry, entities, s.at<char>(p.data_offset), p.count, replace);
+        } else {
+            t->apply(registry, entities, p.count, decoded[i].get());
+        }
+    }
+
+    return true;
+}
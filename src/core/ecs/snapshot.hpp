@@ -0,0 +1,207 @@
+#pragma once
+
+#include "entt/entt.hpp"
+#include "core/ecs/registry.hpp"
+#include "core/ecs/snapshot_format.hpp"
+#include "core/assets/archive_format.hpp"
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace core {
+    // one saved state of a registry, either built in memory by
+    // snapshot_schema or mmap'd from a file. read-only once made
+    class snapshot {
+    private:
+        std::vector<char> _bytes;
+
+        int _fd;
+        const char* _mapping;
+        size_t _mapping_size;
+
+        const char* _base;
+        size_t _size;
+
+        bool validate();
+
+    public:
+        snapshot();
+        // takes a buffer written by snapshot_schema
+        explicit snapshot(std::vector<char>&&);
+        // maps a saved snapshot, is_valid() is false if it can't
+        explicit snapshot(const std::string& path);
+        ~snapshot();
+
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+        snapshot(snapshot&&) noexcept;
+        snapshot& operator=(snapshot&&) noexcept;
+
+        bool is_valid() const;
+        bool save(const std::string& path) const;
+
+        const snapshot_format::header& get_header() const;
+        const snapshot_format::pool* find(uint64_t hash) const;
+
+        const char* data() const;
+        size_t size() const;
+
+        // typed pointer to a block, offsets are from the start of the file
+        template<typename T>
+        const T* at(uint64_t offset) const {
+            return reinterpret_cast<const T*>(_base + offset);
+        }
+    };
+
+    // the component types that go into snapshots, and how.
+    //
+    // trivially copyable components are copied as raw bytes, a pool at a
+    // time. anything else registers a writer and a reader; the reader gets
+    // the schema version the data was written with, so it can load old
+    // saves after the component changes. components that aren't added
+    // here are left alone by capture and restore
+    class snapshot_schema {
+    public:
+        // appends one component's bytes
+        template<typename T>
+        using write_fn = void(*)(const T&, std::vector<char>& out);
+        // fills in a component from bytes written by some version of the writer
+        template<typename T>
+        using read_fn = bool(*)(T&, const char* data, size_t size, uint32_t version);
+
+    private:
+        // a pool decoded ahead of restoring it, freed by its own deleter
+        using staged = std::unique_ptr<void, void(*)(void*)>;
+
+        struct component_type {
+            uint64_t hash;
+            std::string name;
+            uint32_t version;
+            // 0 for components with a writer
+            uint32_t element_size;
+
+            void (*entities)(registry&, std::vector<entt::entity>&);
+            void (*clear)(registry&);
+            void (*remove)(registry&, const entt::entity*, uint32_t count);
+
+            // trivially copyable
+            void (*copy_out)(registry&, const entt::entity*, uint32_t count, char* out);
+            void (*insert)(registry&, const entt::entity*, const char* data, uint32_t count, bool replace);
+
+            // with a writer, type-erased write_fn/read_fn behind them. read
+            // decodes a whole pool without touching the registry (null if
+            // the reader fails), apply moves what it made in
+            void (*write)(registry&, entt::entity, std::vector<char>&, void* fn);
+            staged (*read)(const char* payload, const uint32_t* offsets, uint32_t count, uint32_t version, void* fn);
+            void (*apply)(registry&, const entt::entity*, uint32_t count, void* values);
+            void* write_context;
+            void* read_context;
+        };
+
+        std::vector<component_type> _types;
+
+        template<typename T>
+        component_type make_type(std::string_view name, uint32_t version) {
+            component_type t{};
+            t.hash = archive_format::hash_name(name);
+            t.name = std::string(name);
+            t.version = version;
+
+            t.entities = [](registry& r, std::vector<entt::entity>& out) {
+                auto& storage = r.storage<T>();
+                out.assign(storage.data(), storage.data() + storage.size());
+            };
+            t.clear = [](registry& r) {
+                r.clear<T>();
+            };
+            t.remove = [](registry& r, const entt::entity* e, uint32_t count) {
+                r.remove<T>(e, e + count);
+            };
+
+            return t;
+        }
+
+        const component_type* find(uint64_t hash) const;
+        snapshot build(registry&, const snapshot* base, uint64_t frame) const;
+
+    public:
+        // raw bytes, a schema change means a new name
+        template<typename T>
+        void add(std::string_view name) {
+            static_assert(std::is_trivially_copyable_v<T>,
+                "Components that can't be memcpy'd need a writer and reader");
+
+            auto t = make_type<T>(name, 0);
+            t.element_size = sizeof(T);
+
+            t.copy_out = [](registry& r, const entt::entity* e, uint32_t count, char* out) {
+                auto& storage = r.storage<T>();
+                for(uint32_t i = 0; i < count; i++) {
+                    memcpy(out + size_t(i) * sizeof(T), &storage.get(e[i]), sizeof(T));
+                }
+            };
+            t.insert = [](registry& r, const entt::entity* e, const char* data, uint32_t count, bool replace) {
+                // blocks are aligned, so the data can be used in place
+                auto* values = reinterpret_cast<const T*>(data);
+                if(replace) {
+                    for(uint32_t i = 0; i < count; i++) r.emplace_or_replace<T>(e[i], values[i]);
+                } else {
+                    r.insert<T>(e, e + count, values);
+                }
+            };
+
+            _types.push_back(std::move(t));
+        }
+
+        // through a versioned writer/reader
+        template<typename T>
+        void add(std::string_view name, uint32_t version, write_fn<T> writer, read_fn<T> reader) {
+            static_assert(std::is_default_constructible_v<T>, "Components with a reader need a default constructor");
+
+            auto t = make_type<T>(name, version);
+            t.element_size = 0;
+
+            t.write = [](registry& r, entt::entity e, std::vector<char>& out, void* fn) {
+                reinterpret_cast<write_fn<T>>(fn)(r.storage<T>().get(e), out);
+            };
+            t.read = [](const char* payload, const uint32_t* offsets, uint32_t count, uint32_t version, void* fn) {
+                auto values = std::make_unique<std::vector<T>>(count);
+                for(uint32_t i = 0; i < count; i++) {
+                    const char* data = payload + offsets[i];
+                    if(!reinterpret_cast<read_fn<T>>(fn)((*values)[i], data, offsets[i + 1] - offsets[i], version)) {
+                        return staged(nullptr, [](void*) {});
+                    }
+                }
+                return staged(values.release(), [](void* p) { delete static_cast<std::vector<T>*>(p); });
+            };
+            t.apply = [](registry& r, const entt::entity* e, uint32_t count, void* values) {
+                auto& v = *static_cast<std::vector<T>*>(values);
+                for(uint32_t i = 0; i < count; i++) r.emplace_or_replace<T>(e[i], std::move(v[i]));
+            };
+            t.write_context = reinterpret_cast<void*>(writer);
+            t.read_context = reinterpret_cast<void*>(reader);
+
+            _types.push_back(std::move(t));
+        }
+
+        // every registered component of every entity that has one
+        snapshot capture(registry&, uint64_t frame = 0) const;
+
+        // only what changed since base, which has to be a full capture of
+        // the same registry. keep one full snapshot and take every delta
+        // against it, so any of them can be restored in one step
+        snapshot capture_delta(registry&, const snapshot& base, uint64_t frame = 0) const;
+
+        // a full snapshot replaces every registered component and destroys
+        // entities that had one but aren't in it. a delta applies on top
+        // of the state its base was taken from. false if the snapshot is
+        // broken or a pool doesn't match its registration, and then the
+        // registry is left as it was
+        bool restore(registry&, const snapshot&) const;
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+// binary layout of a world snapshot (.snap)
+//
+//   header
+//   pools      header.pool_count entries, one per component type
+//   blocks     per pool: entities, data, removed (each 16 byte aligned)
+//   destroyed  delta only, entities gone since the base
+//
+// entities are stored as their raw 32 bit identifiers (index + version),
+// so a restored registry hands out the exact same handles.
+//
+// components that are trivially copyable are stored as one tightly
+// packed array, element_size bytes each, in the same order as the
+// entities. everything else is written through its schema's writer:
+//
+//   uint32_t offsets[count + 1]   from the start of the payload
+//   payload
+//
+// a delta snapshot only has the components that were added or changed
+// since its base, plus the entities that lost them (removed) and the
+// entities that are gone altogether (destroyed)
+
+namespace core::snapshot_format {
+    const uint32_t magic = 0x504e5347; // "GSNP"
+    const uint32_t version = 1;
+
+    // every block starts on this, so a mapped snapshot can be read in place
+    const uint64_t alignment = 16;
+
+    enum class kind : uint32_t {
+        full = 0,
+        delta = 1,
+    };
+
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        kind type;
+        uint32_t pool_count;
+        uint64_t frame;
+        // frame of the snapshot a delta applies on top of
+        uint64_t base_frame;
+        uint64_t destroyed_offset;
+        uint32_t destroyed_count;
+        uint32_t reserved;
+        uint64_t pools_offset;
+        uint64_t file_size;
+    };
+
+    struct pool {
+        uint64_t hash;              // archive_format::hash_name(component name)
+        uint32_t schema_version;
+        uint32_t element_size;      // 0 when written through a schema
+        uint32_t count;
+        uint32_t removed_count;
+        uint64_t entities_offset;
+        uint64_t data_offset;
+        uint64_t data_size;
+        uint64_t removed_offset;
+    };
+
+    static_assert(sizeof(header) == 64, "snapshot header must be packed");
+    static_assert(sizeof(pool) == 56, "snapshot pool must be packed");
+}
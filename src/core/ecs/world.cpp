@@ -2,8 +2,10 @@
 
 using namespace core;
 
-world::world()
-    : _registry(), _world_entity() 
+world::world(std::pmr::memory_resource* memory)
+    : _memory(memory), _world_entity(), _registry(std::pmr::polymorphic_allocator<entt::entity>(memory)),
+      _startup_systems(memory), _update_systems(memory), _dispose_systems(memory),
+      _started(0), _disposed(false)
 {
     _world_entity = _registry.create();
 }
@@ -14,10 +16,14 @@ world::~world() {
 
 // impls
 
-entt::registry& world::get_registry() {
+registry& world::get_registry() {
     return _registry;
 }
 
+std::pmr::memory_resource* world::memory() {
+    return _memory;
+}
+
 void world::add_startup_system(system s) {
     _startup_systems.push_back(s);
 }
@@ -31,13 +37,20 @@ void world::add_dispose_system(system s) {
 }
 
 void world::tick_startup() {
-    for(auto& f : _startup_systems) f(*this);
+    for(; _started < _startup_systems.size(); _started++) _startup_systems[_started](*this);
 }
 
 void world::tick_update(float delta) {
+    // systems read it back with get_resource<delta_time>()
+    insert_resource<delta_time>(delta);
     for(auto& f : _update_systems) f(*this);
 }
 
 void world::tick_dispose() {
+    // the owner may dispose early, eg. a server ending a match, and the
+    // destructor runs it again
+    if(_disposed) return;
+    _disposed = true;
+
     for(auto& f : _dispose_systems) f(*this);
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "entt/entt.hpp"
+#include "core/ecs/registry.hpp"
 #include <vector>
 #include <functional>
+#include <memory_resource>
 
 #define WORLD_REGISTER_ALL(w, s)     \
     w.add_startup_system(setup_##s); \
@@ -18,15 +20,28 @@ namespace core
         using delta_time = float;
 
     private:
+        std::pmr::memory_resource* _memory;
         entt::entity _world_entity;
-        entt::registry _registry;
-        std::vector<system> _startup_systems, _update_systems, _dispose_systems;
+        registry _registry;
+        std::pmr::vector<system> _startup_systems, _update_systems, _dispose_systems;
+        // startup systems tick_startup() already ran
+        size_t _started;
+        bool _disposed;
 
     public:
-        world();
+        // memory is where the world's long-lived allocations go: the
+        // registry's pools, the system lists and whatever systems put in
+        // memory(). std::function keeps captures of up to two pointers
+        // inline, bigger ones still go to the global heap
+        world(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+        // disposes, unless tick_dispose() already ran
         ~world();
 
-        entt::registry &get_registry();
+        world(const world&) = delete;
+        world& operator=(const world&) = delete;
+
+        registry &get_registry();
+        std::pmr::memory_resource* memory();
 
         void add_startup_system(system);
         void add_update_system(system);
@@ -48,8 +63,11 @@ namespace core
             _registry.emplace_or_replace<T>(_world_entity, args...);
         }
 
+        // runs the startup systems added since the last call, so systems
+        // registered after a first tick_startup() still get set up
         void tick_startup();
         void tick_update(float);
+        // only runs the dispose systems once
         void tick_dispose();
     };
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "./atlas.hpp"
+
+#include <limits>
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+// PACKER
+
+atlas_packer::atlas_packer(uint32_t width, uint32_t height)
+    : _width(width), _height(height), _used_area(0)
+{
+    _skyline.push_back({ 0, 0, width });
+}
+
+std::optional<uint32_t> atlas_packer::fit(size_t i, uint32_t width, uint32_t height) const {
+    uint32_t x = _skyline[i].x;
+    if(x + width > _width) return {};
+
+    // it rests on the highest segment under it
+    uint32_t y = 0;
+    uint32_t remaining = width;
+
+    for(size_t j = i; remaining > 0; j++) {
+        if(j == _skyline.size()) return {};
+
+        y = std::max(y, _skyline[j].y);
+        if(y + height > _height) return {};
+
+        remaining -= std::min(remaining, _skyline[j].width);
+    }
+
+    return y;
+}
+
+std::optional<atlas_packer::placement> atlas_packer::insert(uint32_t width, uint32_t height) {
+    if(width == 0 || height == 0) return {};
+
+    size_t best = _skyline.size();
+    uint32_t best_y = std::numeric_limits<uint32_t>::max();
+    uint32_t best_width = std::numeric_limits<uint32_t>::max();
+
+    for(size_t i = 0; i < _skyline.size(); i++) {
+        auto y = fit(i, width, height);
+        if(!y) continue;
+
+        // lowest top edge first, then the narrowest segment to waste less
+        uint32_t top = *y + height;
+        if(top < best_y || (top == best_y && _skyline[i].width < best_width)) {
+            best = i;
+            best_y = top;
+            best_width = _skyline[i].width;
+        }
+    }
+
+    if(best == _skyline.size()) return {};
+
+    placement result{ _skyline[best].x, best_y - height };
+
+    // the new segment covers [x, x + width), everything under it shrinks
+    // or goes away
+    _skyline.insert(_skyline.begin() + best, { result.x, best_y, width });
+
+    for(size_t i = best + 1; i < _skyline.size();) {
+        auto& previous = _skyline[i - 1];
+        auto& current = _skyline[i];
+
+        uint32_t previous_end = previous.x + previous.width;
+        if(current.x >= previous_end) break;
+
+        uint32_t overlap = previous_end - current.x;
+        if(overlap >= current.width) {
+            _skyline.erase(_skyline.begin() + i);
+            continue;
+        }
+
+        current.x += overlap;
+        current.width -= overlap;
+        break;
+    }
+
+    // neighbours at the same height become one segment
+    for(size_t i = 1; i < _skyline.size();) {
+        if(_skyline[i - 1].y == _skyline[i].y) {
+            _skyline[i - 1].width += _skyline[i].width;
+            _skyline.erase(_skyline.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    _used_area += uint64_t(width) * height;
+    return result;
+}
+
+float atlas_packer::occupancy() const {
+    return float(_used_area) / (float(_width) * _height);
+}
+
+// ATLAS
+
+sprite_atlas::sprite_atlas(uint32_t page_size, uint32_t padding)
+    : _page_size(page_size), _padding(padding)
+{
+    const uint8_t white[4] = { 255, 255, 255, 255 };
+    add(white, 1, 1);
+}
+
+std::optional<sprite_atlas::sprite_id> sprite_atlas::add(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    // nothing to copy, and the edge clamping below needs a last texel
+    if(width == 0 || height == 0) return {};
+
+    uint32_t padded_width = width + _padding * 2;
+    uint32_t padded_height = height + _padding * 2;
+    if(padded_width > _page_size || padded_height > _page_size) return {};
+
+    // first page with room, a new one otherwise
+    std::optional<atlas_packer::placement> placed;
+    uint32_t page_index = 0;
+
+    for(; page_index < _pages.size(); page_index++) {
+        placed = _pages[page_index].packer.insert(padded_width, padded_height);
+        if(placed) break;
+    }
+
+    if(!placed) {
+        // packed on its own first, the page only gets kept if it took
+        atlas_packer packer(_page_size, _page_size);
+        placed = packer.insert(padded_width, padded_height);
+        if(!placed) return {};
+
+        _pages.push_back({
+            std::move(packer),
+            std::vector<uint8_t>(size_t(_page_size) * _page_size * 4, 0),
+            true
+        });
+        page_index = _pages.size() - 1;
+    }
+
+    auto& p = _pages[page_index];
+    p.dirty = true;
+
+    // copy with clamped coordinates, so the padding repeats the edges
+    for(uint32_t y = 0; y < padded_height; y++) {
+        uint32_t source_y = std::min(uint32_t(std::max(int(y) - int(_padding), 0)), height - 1);
+        uint8_t* row = &p.pixels[(size_t(placed->y + y) * _page_size + placed->x) * 4];
+
+        for(uint32_t x = 0; x < padded_width; x++) {
+            uint32_t source_x = std::min(uint32_t(std::max(int(x) - int(_padding), 0)), width - 1);
+            memcpy(row + x * 4, rgba + (size_t(source_y) * width + source_x) * 4, 4);
+        }
+    }
+
+    region r{};
+    r.page = page_index;
+    r.x = placed->x + _padding;
+    r.y = placed->y + _padding;
+    r.width = width;
+    r.height = height;
+
+    float scale = 65535.0f / _page_size;
+    r.uv[0] = uint16_t(r.x * scale + 0.5f);
+    r.uv[1] = uint16_t(r.y * scale + 0.5f);
+    r.uv[2] = uint16_t((r.x + width) * scale + 0.5f);
+    r.uv[3] = uint16_t((r.y + height) * scale + 0.5f);
+
+    _regions.push_back(r);
+    return _regions.size() - 1;
+}
+
+const sprite_atlas::region& sprite_atlas::get(sprite_id id) const {
+    return _regions[id];
+}
+
+uint32_t sprite_atlas::page_size() const {
+    return _page_size;
+}
+
+uint32_t sprite_atlas::page_count() const {
+    return _pages.size();
+}
+
+sprite_atlas::page& sprite_atlas::get_page(uint32_t index) {
+    return _pages[index];
+}
+
+const sprite_atlas::page& sprite_atlas::get_page(uint32_t index) const {
+    return _pages[index];
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace core {
+    // skyline packer for one page: keeps the top edge of everything placed
+    // so far as a list of horizontal segments, and puts each rectangle
+    // where it ends up lowest (ties go to the tightest fit). simpler and
+    // much faster than maxrects, and close enough for sprites
+    class atlas_packer {
+    public:
+        struct placement {
+            uint32_t x, y;
+        };
+
+    private:
+        struct segment {
+            uint32_t x, y, width;
+        };
+
+        uint32_t _width, _height;
+        std::vector<segment> _skyline;
+        uint64_t _used_area;
+
+        // lowest y a rectangle of this width can sit at, starting at segment i
+        std::optional<uint32_t> fit(size_t i, uint32_t width, uint32_t height) const;
+
+    public:
+        atlas_packer(uint32_t width, uint32_t height);
+
+        std::optional<placement> insert(uint32_t width, uint32_t height);
+
+        // fraction of the page covered by rectangles
+        float occupancy() const;
+    };
+
+    // packs small RGBA8 images into as many pages as needed, CPU side.
+    // sprite 0 is always a white texel, for untextured rects
+    class sprite_atlas {
+    public:
+        using sprite_id = uint32_t;
+
+        struct region {
+            uint32_t page;
+            uint32_t x, y, width, height;
+            // [min u, min v, max u, max v] as unorm16, ready for instances
+            uint16_t uv[4];
+        };
+
+        struct page {
+            atlas_packer packer;
+            std::vector<uint8_t> pixels;
+            // changed since the last upload
+            bool dirty;
+        };
+
+    private:
+        uint32_t _page_size;
+        uint32_t _padding;
+        std::vector<page> _pages;
+        std::vector<region> _regions;
+
+    public:
+        sprite_atlas(uint32_t page_size = 2048, uint32_t padding = 1);
+
+        // copies the pixels in, edges get repeated into the padding so
+        // filtering doesn't bleed in neighbours. empty for a 0 sized
+        // image, or one that can't fit even an empty page
+        std::optional<sprite_id> add(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+        const region& get(sprite_id) const;
+        uint32_t page_size() const;
+        uint32_t page_count() const;
+
+        page& get_page(uint32_t);
+        const page& get_page(uint32_t) const;
+    };
+}
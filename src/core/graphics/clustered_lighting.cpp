@@ -0,0 +1,208 @@
+#include "./clustered_lighting.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+namespace {
+    const uint32_t workgroup_size = 64;
+
+    const VkMemoryPropertyFlags host_memory =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+clustered_lighting::clustered_lighting(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    VkDescriptorSetLayout cull_layout,
+    VkDescriptorSetLayout shading_layout,
+    uint32_t frames_in_flight,
+    uint32_t max_lights
+) : _device(device), _max_lights(max_lights), _params{}, _stats{}
+{
+    // a camera at the origin until set_camera()
+    memset(_view, 0, sizeof(_view));
+    _view[0] = _view[5] = _view[10] = _view[15] = 1.0f;
+
+    _lights.reserve(max_lights);
+
+    // two sets per frame, a uniform buffer and three storage buffers each
+    VkDescriptorPoolSize pool_sizes[2]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    pool_sizes[0].descriptorCount = 2 * frames_in_flight;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[1].descriptorCount = 2 * 3 * frames_in_flight;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 2 * frames_in_flight;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    VK_ASSERT(vkCreateDescriptorPool(device, &pool_info, nullptr, &_descriptor_pool));
+
+    VkDeviceSize index_size = VkDeviceSize(light_clusters::cluster_count) *
+        light_clusters::max_lights_per_cluster * sizeof(uint32_t);
+
+    _frames.resize(frames_in_flight);
+    for(auto& f : _frames) {
+        f.params = vkbuffer(
+            device, physical_device, sizeof(light_clusters::params),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, host_memory);
+        f.lights = vkbuffer(
+            device, physical_device, VkDeviceSize(max_lights) * sizeof(light_clusters::light),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host_memory);
+        f.counts = vkbuffer(
+            device, physical_device, light_clusters::cluster_count * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        f.indices = vkbuffer(
+            device, physical_device, index_size,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        f.mapped_params = f.params.map(device);
+        f.mapped_lights = f.lights.map(device);
+
+        VkDescriptorSetLayout set_layouts[2] = { cull_layout, shading_layout };
+        VkDescriptorSet sets[2];
+
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = _descriptor_pool;
+        set_info.descriptorSetCount = 2;
+        set_info.pSetLayouts = set_layouts;
+        VK_ASSERT(vkAllocateDescriptorSets(device, &set_info, sets));
+
+        f.cull_set = sets[0];
+        f.shading_set = sets[1];
+
+        // both sets see the same four buffers, the stages differ
+        VkDescriptorBufferInfo buffers[4] = {
+            { f.params.handle, 0, VK_WHOLE_SIZE },
+            { f.lights.handle, 0, VK_WHOLE_SIZE },
+            { f.counts.handle, 0, VK_WHOLE_SIZE },
+            { f.indices.handle, 0, VK_WHOLE_SIZE },
+        };
+
+        VkWriteDescriptorSet writes[8]{};
+        for(uint32_t i = 0; i < 8; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = sets[i / 4];
+            writes[i].dstBinding = i % 4;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i % 4 == 0 ?
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &buffers[i % 4];
+        }
+        vkUpdateDescriptorSets(device, 8, writes, 0, nullptr);
+    }
+}
+
+clustered_lighting::~clustered_lighting() {
+    for(auto& f : _frames) {
+        f.params.unmap(_device);
+        f.lights.unmap(_device);
+        f.params.destroy(_device);
+        f.lights.destroy(_device);
+        f.counts.destroy(_device);
+        f.indices.destroy(_device);
+    }
+
+    // frees the sets too
+    vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+}
+
+void clustered_lighting::set_camera(
+    const float view[16], const float projection[16], float near_plane, float far_plane, VkExtent2D extent)
+{
+    memcpy(_view, view, sizeof(_view));
+    _params = light_clusters::make_params(
+        projection, near_plane, far_plane, float(extent.width), float(extent.height));
+}
+
+void clustered_lighting::clear() {
+    _lights.clear();
+    _stats = {};
+}
+
+void clustered_lighting::add(const structs::vector3& position, const components::point_light& source) {
+    _stats.lights++;
+    if(_lights.size() == _max_lights) {
+        _stats.dropped++;
+        return;
+    }
+
+    const float* m = _view;
+
+    light_clusters::light l;
+    l.position[0] = m[0] * position.x + m[4] * position.y + m[8] * position.z + m[12];
+    l.position[1] = m[1] * position.x + m[5] * position.y + m[9] * position.z + m[13];
+    l.position[2] = m[2] * position.x + m[6] * position.y + m[10] * position.z + m[14];
+    l.radius = source.radius;
+    l.color[0] = source.color.r / 255.0f;
+    l.color[1] = source.color.g / 255.0f;
+    l.color[2] = source.color.b / 255.0f;
+    l.intensity = source.intensity;
+
+    _lights.push_back(l);
+}
+
+void clustered_lighting::flush(uint32_t frame) {
+    auto& f = _frames[frame];
+
+    _params.light_count = uint32_t(_lights.size());
+    memcpy(f.mapped_params, &_params, sizeof(_params));
+    memcpy(f.mapped_lights, _lights.data(), _lights.size() * sizeof(light_clusters::light));
+}
+
+void clustered_lighting::dispatch(VkCommandBuffer command_buffer, VkPipeline pipeline, VkPipelineLayout layout, uint32_t frame) {
+    auto& f = _frames[frame];
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &f.cull_set, 0, nullptr);
+    vkCmdDispatch(command_buffer, (light_clusters::cluster_count + workgroup_size - 1) / workgroup_size, 1, 1);
+
+    // the render graph only tracks images, the lists need their own barrier
+    VkBufferMemoryBarrier barriers[2]{};
+    for(auto& b : barriers) {
+        b.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        b.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        b.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.size = VK_WHOLE_SIZE;
+    }
+    barriers[0].buffer = f.counts.handle;
+    barriers[1].buffer = f.indices.handle;
+
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 2, barriers, 0, nullptr);
+}
+
+VkDescriptorSet clustered_lighting::shading_set(uint32_t frame) const {
+    return _frames[frame].shading_set;
+}
+
+const light_clusters::params& clustered_lighting::params() const {
+    return _params;
+}
+
+const clustered_lighting::stats& clustered_lighting::get_stats() const {
+    return _stats;
+}
+
+void core::register_lighting(world& w, clustered_lighting& lighting) {
+    w.add_update_system([&lighting](world& w) {
+        lighting.clear();
+
+        auto& registry = w.get_registry();
+        auto view = registry.view<const components::transform, const components::point_light>();
+
+        for(auto [entity, transform, light] : view.each()) {
+            lighting.add(transform.position, light);
+        }
+    });
+}
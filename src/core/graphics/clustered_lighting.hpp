@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core/graphics/light_clusters.hpp"
+#include "core/vulkan/vkbuffer.hpp"
+#include "core/ecs/world.hpp"
+#include "components/components.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // GPU side of light_clusters: the lights are written every frame,
+    // light_cull.comp bins them into clusters and lit.frag reads the
+    // lists back. a frame's buffers are only touched once its fence has
+    // signaled, so there's a set of them per frame in flight
+    class clustered_lighting {
+    public:
+        struct stats {
+            uint32_t lights;
+            // past max_lights, not sent to the GPU
+            uint32_t dropped;
+        };
+
+    private:
+        struct frame_buffers {
+            vkbuffer params;
+            vkbuffer lights;
+            // written by the cull pass, read by the shading pass
+            vkbuffer counts;
+            vkbuffer indices;
+            void* mapped_params;
+            void* mapped_lights;
+
+            VkDescriptorSet cull_set;
+            VkDescriptorSet shading_set;
+        };
+
+        VkDevice _device;
+        uint32_t _max_lights;
+
+        VkDescriptorPool _descriptor_pool;
+        std::vector<frame_buffers> _frames;
+
+        // column major, world to view
+        float _view[16];
+        light_clusters::params _params;
+        std::vector<light_clusters::light> _lights;
+        stats _stats;
+
+    public:
+        // cull_layout is set 0 of the light_cull.comp pipeline,
+        // shading_layout set 0 of the lit pipeline
+        clustered_lighting(
+            VkDevice,
+            VkPhysicalDevice,
+            VkDescriptorSetLayout cull_layout,
+            VkDescriptorSetLayout shading_layout,
+            uint32_t frames_in_flight,
+            uint32_t max_lights = 4096);
+        ~clustered_lighting();
+
+        clustered_lighting(const clustered_lighting&) = delete;
+        clustered_lighting& operator=(const clustered_lighting&) = delete;
+
+        // view and projection are column major, see
+        // light_clusters::perspective for the projection it expects
+        void set_camera(const float view[16], const float projection[16], float near_plane, float far_plane, VkExtent2D);
+
+        // lights are collected every frame, world space in
+        void clear();
+        void add(const structs::vector3& position, const components::point_light&);
+
+        // writes this frame's lights and camera. frame's fence must have
+        // signaled
+        void flush(uint32_t frame);
+
+        // bins the frame's lights, then makes the lists visible to
+        // fragment shaders. outside of any render pass
+        void dispatch(VkCommandBuffer, VkPipeline, VkPipelineLayout, uint32_t frame);
+
+        // set 0 of the lit pipeline
+        VkDescriptorSet shading_set(uint32_t frame) const;
+
+        const light_clusters::params& params() const;
+        const stats& get_stats() const;
+    };
+
+    // gathers every entity with a transform and a components::point_light
+    // into the lighting each update. lighting has to outlive the world's
+    // updates
+    void register_lighting(world&, clustered_lighting&);
+}
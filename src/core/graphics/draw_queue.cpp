@@ -0,0 +1,138 @@
+#include "./draw_queue.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+uint64_t draw_queue::make_key(
+    uint8_t layer, uint32_t pipeline, uint32_t material,
+    float view_depth, float far_plane, bool back_to_front
+) {
+    ASSERT(pipeline < (1u << pipeline_bits), "Pipeline id doesn't fit the sort key");
+    ASSERT(material < (1u << material_bits), "Material id doesn't fit the sort key");
+
+    const uint32_t depth_max = (1u << depth_bits) - 1;
+
+    float normalized = std::clamp(view_depth / far_plane, 0.0f, 1.0f);
+    uint32_t depth = uint32_t(normalized * depth_max);
+    if(back_to_front) depth = depth_max - depth;
+
+    return
+        (uint64_t(layer) << (pipeline_bits + material_bits + depth_bits)) |
+        (uint64_t(pipeline) << (material_bits + depth_bits)) |
+        (uint64_t(material) << depth_bits) |
+        uint64_t(depth);
+}
+
+void draw_queue::clear() {
+    _packets.clear();
+    _push_data.clear();
+    _sorted.clear();
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _stats = {};
+}
+
+uint32_t draw_queue::push_data(const void* data, uint32_t size) {
+    // push constant offsets/sizes are multiples of 4
+    uint32_t offset = (_push_data.size() + 3) & ~3u;
+    _push_data.resize(offset + size);
+    memcpy(_push_data.data() + offset, data, size);
+    return offset;
+}
+
+void draw_queue::push(const draw_packet& packet) {
+    _packets.push_back(packet);
+}
+
+void draw_queue::sort() {
+    size_t count = _packets.size();
+
+    _sorted.resize(count);
+    _sort_scratch.resize(count);
+    for(size_t i = 0; i < count; i++) {
+        _sorted[i] = { _packets[i].key, uint32_t(i) };
+    }
+
+    // every byte's histogram in one read over the keys
+    uint32_t histograms[8][256] = {};
+    for(auto& entry : _sorted) {
+        for(int b = 0; b < 8; b++) {
+            histograms[b][(entry.key >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    for(int b = 0; b < 8; b++) {
+        auto& histogram = histograms[b];
+
+        // all keys share this byte, the pass wouldn't move anything
+        if(count == 0 || histogram[(_sorted[0].key >> (b * 8)) & 0xff] == count) continue;
+
+        uint32_t offset = 0;
+        for(auto& bucket : histogram) {
+            uint32_t n = bucket;
+            bucket = offset;
+            offset += n;
+        }
+
+        for(auto& entry : _sorted) {
+            _sort_scratch[histogram[(entry.key >> (b * 8)) & 0xff]++] = entry;
+        }
+
+        _sorted.swap(_sort_scratch);
+    }
+}
+
+void draw_queue::encode(VkCommandBuffer command_buffer, uint32_t first, uint32_t count) {
+    ASSERT(_sorted.size() == _packets.size(), "Sort the queue before encoding it");
+
+    vkencoder encoder(command_buffer);
+
+    for(uint32_t i = first; i < first + count; i++) {
+        auto& packet = _packets[_sorted[i].packet];
+
+        encoder.bind_pipeline(packet.pipeline, packet.layout);
+
+        if(packet.material != VK_NULL_HANDLE) {
+            encoder.bind_descriptor_set(material_set, packet.material);
+        }
+
+        if(packet.frame_data != VK_NULL_HANDLE) {
+            encoder.bind_dynamic_set(frame_set, packet.frame_data, packet.frame_offset);
+        }
+
+        if(packet.push_size > 0) {
+            encoder.push_constants(
+                packet.push_stages, 0, packet.push_size, _push_data.data() + packet.push_offset);
+        }
+
+        if(packet.vertex_buffer != VK_NULL_HANDLE) {
+            encoder.bind_vertex_buffer(packet.vertex_buffer, packet.vertex_buffer_offset);
+        }
+
+        if(packet.indirect_buffer != VK_NULL_HANDLE) {
+            encoder.draw_indirect(packet.indirect_buffer, packet.indirect_offset);
+        } else if(packet.index_buffer != VK_NULL_HANDLE) {
+            encoder.bind_index_buffer(packet.index_buffer, packet.index_type);
+            encoder.draw_indexed(
+                packet.count, packet.instance_count, packet.first, packet.vertex_offset, packet.first_instance);
+        } else {
+            encoder.draw(packet.count, packet.instance_count, packet.first, packet.first_instance);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _stats += encoder.get_stats();
+}
+
+uint32_t draw_queue::size() const {
+    return _packets.size();
+}
+
+vkencoder::stats draw_queue::get_stats() {
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    return _stats;
+}
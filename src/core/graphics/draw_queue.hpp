@@ -0,0 +1,113 @@
+#pragma once
+
+#include "core/vulkan/vkencoder.hpp"
+#include "core/vulkan/vkframe_ring.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // everything needed to issue one draw, by value so packets can be
+    // pushed from anywhere and sorted freely
+    struct draw_packet {
+        uint64_t key;
+
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+        // bound at draw_queue::material_set, none if null
+        VkDescriptorSet material;
+        // per-draw data in the frame ring, bound at draw_queue::frame_set
+        // with frame_offset as the dynamic offset. none if null
+        VkDescriptorSet frame_data;
+        uint32_t frame_offset;
+
+        VkBuffer vertex_buffer;
+        VkDeviceSize vertex_buffer_offset;
+        // non-indexed draw if null
+        VkBuffer index_buffer;
+        VkIndexType index_type;
+
+        // indices, or vertices for non-indexed draws
+        uint32_t count;
+        uint32_t first;
+        int32_t vertex_offset;
+        uint32_t instance_count;
+        uint32_t first_instance;
+
+        // draws the VkDrawIndirectCommand at indirect_offset instead of
+        // the counts above, if not null
+        VkBuffer indirect_buffer;
+        VkDeviceSize indirect_offset;
+
+        // range of the queue's push constant data
+        VkShaderStageFlags push_stages;
+        uint32_t push_offset;
+        uint32_t push_size;
+    };
+
+    // a frame's draws, sorted by a 64-bit key so that draws sharing state
+    // end up next to each other:
+    //
+    //   63      56 55        44 43              24 23                 0
+    //   | layer  | pipeline   | material          | depth             |
+    //
+    // layer decides order first (opaque before translucent, ...), then
+    // draws are grouped by pipeline, then material, and front to back
+    // inside a group. translucent layers want back to front, make_key
+    // flips the depth for those
+    class draw_queue {
+    public:
+        static const uint32_t material_set = 0;
+        static const uint32_t frame_set = vkframe_ring::descriptor_set;
+
+        static const uint32_t pipeline_bits = 12;
+        static const uint32_t material_bits = 20;
+        static const uint32_t depth_bits = 24;
+
+        // pipeline and material are small ids the caller hands out, the
+        // handles themselves go in the packet
+        static uint64_t make_key(
+            uint8_t layer, uint32_t pipeline, uint32_t material,
+            float view_depth, float far_plane, bool back_to_front = false);
+
+    private:
+        struct sort_entry {
+            uint64_t key;
+            uint32_t packet;
+        };
+
+        std::vector<draw_packet> _packets;
+        std::vector<char> _push_data;
+
+        // scratch, kept so sorting doesn't allocate once warmed up
+        std::vector<sort_entry> _sorted;
+        std::vector<sort_entry> _sort_scratch;
+
+        std::mutex _stats_mutex;
+        vkencoder::stats _stats;
+
+    public:
+        void clear();
+
+        // copies size bytes of push constants, returns their offset
+        uint32_t push_data(const void*, uint32_t size);
+        void push(const draw_packet&);
+
+        // LSD radix sort over the keys, 8 bits at a time. passes where
+        // every key has the same byte are skipped. stable, so packets
+        // with equal keys keep the order they were pushed in
+        void sort();
+
+        // encodes sorted packets [first, first + count), eg. one chunk of
+        // a vkrecorder. thread-safe, the stats of every call add up
+        void encode(VkCommandBuffer, uint32_t first, uint32_t count);
+
+        uint32_t size() const;
+        // what encode() issued since the last clear()
+        vkencoder::stats get_stats();
+    };
+}
@@ -0,0 +1,91 @@
+#include "./ktx2.hpp"
+
+#include "utils/log.hpp"
+
+#include <cstring>
+
+using namespace core;
+
+static const uint8_t identifier[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// the fixed part, identifier + header + index
+static const size_t fixed_size = 80;
+
+struct file_header {
+    uint8_t identifier[12];
+    uint32_t format;
+    uint32_t type_size;
+    uint32_t width, height, depth;
+    uint32_t layer_count, face_count, level_count;
+    uint32_t supercompression;
+    uint32_t dfd_offset, dfd_size;
+    uint32_t kvd_offset, kvd_size;
+    uint64_t sgd_offset, sgd_size;
+};
+
+static_assert(sizeof(file_header) == fixed_size, "ktx2 header must be packed");
+
+size_t ktx2::header_size(uint32_t level_count) {
+    return fixed_size + (level_count ? level_count : 1) * sizeof(level);
+}
+
+bool ktx2::parse(const char* data, size_t size, info& out) {
+    if(size < fixed_size) return false;
+
+    file_header header;
+    memcpy(&header, data, sizeof(header));
+
+    if(memcmp(header.identifier, identifier, sizeof(identifier)) != 0) {
+        LOG("[KTX2] not a ktx2 file");
+        return false;
+    }
+
+    // streaming works on plain 2D textures only, no arrays/cubes/volumes
+    if(header.depth > 1 || header.layer_count > 1 || header.face_count != 1) {
+        LOG("[KTX2] only 2D textures are supported");
+        return false;
+    }
+
+    if(header.supercompression == uint32_t(supercompression::basis)) {
+        LOG("[KTX2] basis supercompression is not supported");
+        return false;
+    }
+
+    uint32_t level_count = header.level_count ? header.level_count : 1;
+    if(size < header_size(level_count)) return false;
+
+    out.format = static_cast<VkFormat>(header.format);
+    out.width = header.width;
+    out.height = header.height;
+    out.scheme = static_cast<supercompression>(header.supercompression);
+    out.levels.resize(level_count);
+    memcpy(out.levels.data(), data + fixed_size, level_count * sizeof(level));
+
+    return true;
+}
+
+bool ktx2::is_supported(VkFormat format) {
+    switch(format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
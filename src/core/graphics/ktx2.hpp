@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// just enough of KTX2 (khronos texture container) to stream 2D textures
+// straight into vulkan images. formats are vulkan formats already, so
+// block compressed data gets uploaded without ever being decoded
+//
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+namespace core::ktx2 {
+    enum class supercompression : uint32_t {
+        none = 0,
+        basis = 1,  // not supported, would need transcoding
+        zstd = 2,
+    };
+
+    struct level {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t uncompressed_size;
+    };
+
+    struct info {
+        VkFormat format;
+        uint32_t width, height;
+        supercompression scheme;
+        // level 0 is the full resolution one
+        std::vector<level> levels;
+    };
+
+    // bytes the header and level index take, with level_count levels
+    size_t header_size(uint32_t level_count);
+
+    // data must hold at least the first 80 bytes to read the level count,
+    // and header_size() bytes to read everything
+    bool parse(const char* data, size_t size, info& out);
+
+    // formats we know how to upload and sample (BC1-7 and plain RGBA8)
+    bool is_supported(VkFormat);
+
+    inline uint32_t mip_size(uint32_t size, uint32_t mip) {
+        uint32_t s = size >> mip;
+        return s ? s : 1;
+    }
+}
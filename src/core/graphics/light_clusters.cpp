@@ -0,0 +1,161 @@
+#include "./light_clusters.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+namespace {
+    uint32_t slice(const light_clusters::params& p, float depth) {
+        float s = std::floor(std::log(depth) * p.slice_scale - p.slice_bias);
+        return uint32_t(std::min(std::max(s, 0.0f), float(light_clusters::size_z - 1)));
+    }
+
+    // squared distance from v to [min, max]
+    float outside2(float v, float min, float max) {
+        float d = std::max(std::max(min - v, 0.0f), v - max);
+        return d * d;
+    }
+}
+
+light_clusters::light_clusters()
+    : _counts(cluster_count, 0), _indices(size_t(cluster_count) * max_lights_per_cluster, 0), _stats{}
+{}
+
+void light_clusters::perspective(float fov_y, float aspect, float near_plane, float far_plane, float out[16]) {
+    float t = std::tan(fov_y * 0.5f);
+
+    memset(out, 0, sizeof(float) * 16);
+    out[0] = 1.0f / (aspect * t);
+    out[5] = -1.0f / t;
+    out[10] = far_plane / (near_plane - far_plane);
+    out[11] = -1.0f;
+    out[14] = near_plane * far_plane / (near_plane - far_plane);
+}
+
+light_clusters::params light_clusters::make_params(
+    const float projection[16], float near_plane, float far_plane, float width, float height)
+{
+    params p{};
+    memcpy(p.projection, projection, sizeof(p.projection));
+    p.near_plane = near_plane;
+    p.far_plane = far_plane;
+    p.inv_scale_x = 1.0f / projection[0];
+    p.inv_scale_y = 1.0f / projection[5];
+    p.width = width;
+    p.height = height;
+
+    float range = std::log(far_plane / near_plane);
+    p.slice_scale = size_z / range;
+    p.slice_bias = size_z * std::log(near_plane) / range;
+    return p;
+}
+
+void light_clusters::bounds(const params& p, uint32_t x, uint32_t y, uint32_t z, float min[3], float max[3]) {
+    float ratio = p.far_plane / p.near_plane;
+    float near_depth = p.near_plane * std::pow(ratio, float(z) / size_z);
+    float far_depth = p.near_plane * std::pow(ratio, float(z + 1) / size_z);
+
+    // tile edges as x/depth and y/depth of the rays through them
+    float sx0 = (-1.0f + 2.0f * x / size_x) * p.inv_scale_x;
+    float sx1 = (-1.0f + 2.0f * (x + 1) / size_x) * p.inv_scale_x;
+    float sy0 = (-1.0f + 2.0f * y / size_y) * p.inv_scale_y;
+    float sy1 = (-1.0f + 2.0f * (y + 1) / size_y) * p.inv_scale_y;
+
+    min[0] = std::min({ sx0 * near_depth, sx0 * far_depth, sx1 * near_depth, sx1 * far_depth });
+    max[0] = std::max({ sx0 * near_depth, sx0 * far_depth, sx1 * near_depth, sx1 * far_depth });
+    min[1] = std::min({ sy0 * near_depth, sy0 * far_depth, sy1 * near_depth, sy1 * far_depth });
+    max[1] = std::max({ sy0 * near_depth, sy0 * far_depth, sy1 * near_depth, sy1 * far_depth });
+    min[2] = -far_depth;
+    max[2] = -near_depth;
+}
+
+uint32_t light_clusters::index(const params& p, float window_x, float window_y, float depth) {
+    uint32_t x = std::min(uint32_t(std::max(window_x, 0.0f) / p.width * size_x), size_x - 1);
+    uint32_t y = std::min(uint32_t(std::max(window_y, 0.0f) / p.height * size_y), size_y - 1);
+    return x + size_x * (y + size_y * slice(p, std::max(depth, p.near_plane)));
+}
+
+void light_clusters::build(const params& p, const light* lights, uint32_t count) {
+    // a cluster's box is its column's x range times its row's y range
+    // times its slice's depth range, all three only change with the camera
+    _bounds.resize(size_z * (size_x + size_y + 1));
+    for(uint32_t z = 0; z < size_z; z++) {
+        float min[3], max[3];
+        auto* b = &_bounds[z * (size_x + size_y + 1)];
+
+        for(uint32_t x = 0; x < size_x; x++) {
+            bounds(p, x, 0, z, min, max);
+            b[x] = { min[0], max[0] };
+        }
+        for(uint32_t y = 0; y < size_y; y++) {
+            bounds(p, 0, y, z, min, max);
+            b[size_x + y] = { min[1], max[1] };
+        }
+        b[size_x + size_y] = { min[2], max[2] };
+    }
+
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _stats = {};
+    _stats.lights = count;
+
+    for(uint32_t i = 0; i < count; i++) {
+        const light& l = lights[i];
+        const float radius2 = l.radius * l.radius;
+
+        float depth = -l.position[2];
+        if(depth + l.radius < p.near_plane || depth - l.radius > p.far_plane) continue;
+
+        // only the slices the light's depth range covers, then the same
+        // sphere against box test the shader does, one axis at a time
+        uint32_t z0 = slice(p, std::max(depth - l.radius, p.near_plane));
+        uint32_t z1 = slice(p, std::min(depth + l.radius, p.far_plane));
+
+        bool visible = false;
+        for(uint32_t z = z0; z <= z1; z++) {
+            const auto* b = &_bounds[z * (size_x + size_y + 1)];
+
+            float dz2 = outside2(l.position[2], b[size_x + size_y].min, b[size_x + size_y].max);
+            if(dz2 > radius2) continue;
+
+            for(uint32_t y = 0; y < size_y; y++) {
+                float dyz2 = dz2 + outside2(l.position[1], b[size_x + y].min, b[size_x + y].max);
+                if(dyz2 > radius2) continue;
+
+                for(uint32_t x = 0; x < size_x; x++) {
+                    if(dyz2 + outside2(l.position[0], b[x].min, b[x].max) > radius2) continue;
+
+                    visible = true;
+                    uint32_t cluster = x + size_x * (y + size_y * z);
+                    uint32_t& n = _counts[cluster];
+                    if(n == max_lights_per_cluster) {
+                        _stats.dropped++;
+                        continue;
+                    }
+                    _indices[size_t(cluster) * max_lights_per_cluster + n++] = i;
+                }
+            }
+        }
+
+        if(visible) _stats.visible_lights++;
+    }
+
+    for(uint32_t n : _counts) {
+        if(n > 0) _stats.occupied_clusters++;
+        _stats.max_per_cluster = std::max(_stats.max_per_cluster, n);
+        _stats.references += n;
+    }
+}
+
+const std::vector<uint32_t>& light_clusters::counts() const {
+    return _counts;
+}
+
+const std::vector<uint32_t>& light_clusters::indices() const {
+    return _indices;
+}
+
+const light_clusters::stats& light_clusters::get_stats() const {
+    return _stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // the view frustum cut into a 3D grid of clusters: screen tiles,
+    // times slices that get exponentially deeper with distance. every
+    // cluster keeps the list of point lights that reach into it, so a
+    // fragment only shades the lights of its own cluster.
+    //
+    // the lists are built on the GPU each frame by light_cull.comp (see
+    // clustered_lighting). build() is the same algorithm on the CPU, for
+    // benchmarks and for checking the shader, and the layouts below are
+    // the ones the shaders read.
+    //
+    // view space is right handed, looking down -z, depth is -z
+    class light_clusters {
+    public:
+        static const uint32_t size_x = 16;
+        static const uint32_t size_y = 9;
+        static const uint32_t size_z = 24;
+        static const uint32_t cluster_count = size_x * size_y * size_z;
+        // lights past this in one cluster are dropped
+        static const uint32_t max_lights_per_cluster = 128;
+
+        // std430, view space
+        struct light {
+            float position[3];
+            float radius;
+            float color[3];
+            float intensity;
+        };
+
+        // std140
+        struct params {
+            float projection[16];
+            float near_plane, far_plane;
+            // 1 / projection[0] and 1 / projection[5], turn NDC into the
+            // x/depth and y/depth of a view ray
+            float inv_scale_x, inv_scale_y;
+            float width, height;
+            // slice = log(depth) * slice_scale - slice_bias
+            float slice_scale, slice_bias;
+            uint32_t light_count;
+            uint32_t padding[3];
+        };
+
+        struct stats {
+            uint32_t lights;
+            // in at least one cluster
+            uint32_t visible_lights;
+            uint32_t occupied_clusters;
+            uint32_t max_per_cluster;
+            // sum of every cluster's list, what shading an evenly lit
+            // screen costs is this over cluster_count
+            uint32_t references;
+            uint32_t dropped;
+        };
+
+    private:
+        struct range {
+            float min, max;
+        };
+
+        // per slice: size_x column x ranges, size_y row y ranges, the depth range
+        std::vector<range> _bounds;
+        std::vector<uint32_t> _counts;
+        std::vector<uint32_t> _indices;
+        stats _stats;
+
+    public:
+        light_clusters();
+
+        // a vulkan perspective: depth 0 at near, 1 at far, y pointing down
+        // the screen
+        static void perspective(float fov_y, float aspect, float near_plane, float far_plane, float out[16]);
+        static params make_params(const float projection[16], float near_plane, float far_plane, float width, float height);
+
+        // view space bounding box of a cluster
+        static void bounds(const params&, uint32_t x, uint32_t y, uint32_t z, float min[3], float max[3]);
+        // cluster of a fragment, from its window position and depth
+        static uint32_t index(const params&, float window_x, float window_y, float depth);
+
+        // bins lights the way light_cull.comp does, each list ends up
+        // sorted by light index
+        void build(const params&, const light*, uint32_t count);
+
+        // lights in each cluster
+        const std::vector<uint32_t>& counts() const;
+        // max_lights_per_cluster slots per cluster
+        const std::vector<uint32_t>& indices() const;
+        const stats& get_stats() const;
+    };
+}
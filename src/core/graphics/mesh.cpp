@@ -0,0 +1,139 @@
+#include "./mesh.hpp"
+
+#include "core/assets/archive.hpp"
+#include "utils/file.hpp"
+#include "utils/assert.hpp"
+#include "utils/log.hpp"
+
+#include <cstddef>
+
+using namespace core;
+
+mesh::mesh()
+    : _header(nullptr), _lods(nullptr), _vertices(nullptr), _indices(nullptr)
+{}
+
+mesh::mesh(std::vector<char> data)
+    : mesh()
+{
+    _data = std::move(data);
+
+    if(_data.size() < sizeof(mesh_format::header)) {
+        LOG("[MESH] file too small to be a mesh");
+        return;
+    }
+
+    auto header = reinterpret_cast<const mesh_format::header*>(_data.data());
+
+    // checked in release too, a broken file stays an invalid mesh
+    const char* error =
+        header->magic != mesh_format::magic ? "not a mesh file" :
+        header->version != mesh_format::version ? "unsupported mesh version" :
+        header->index_size != 2 && header->index_size != 4 ? "bad index size" :
+        header->lod_count == 0 ? "no lods" :
+        // nothing to put in a buffer, and Vulkan has no empty buffers
+        header->vertex_count == 0 || header->index_count == 0 ? "empty mesh" :
+        nullptr;
+
+    if(error != nullptr) {
+        LOG("[MESH] %s", error);
+        return;
+    }
+
+    size_t lods_offset = sizeof(mesh_format::header);
+    size_t vertices_offset = lods_offset + size_t(header->lod_count) * sizeof(mesh_format::lod);
+    size_t indices_offset = vertices_offset + size_t(header->vertex_count) * sizeof(mesh_format::packed_vertex);
+    size_t size = indices_offset + size_t(header->index_count) * header->index_size;
+
+    if(_data.size() < size) {
+        LOG("[MESH] file is truncated");
+        return;
+    }
+
+    _header = header;
+    _lods = reinterpret_cast<const mesh_format::lod*>(_data.data() + lods_offset);
+    _vertices = _data.data() + vertices_offset;
+    _indices = _data.data() + indices_offset;
+}
+
+mesh mesh::load(const std::string& path) {
+    return mesh(utils::file::read_binary(path));
+}
+
+mesh mesh::load(const archive& pak, const std::string& name) {
+    return mesh(pak.read(name));
+}
+
+bool mesh::is_valid() const {
+    return _header != nullptr;
+}
+
+const mesh_format::header& mesh::header() const {
+    return *_header;
+}
+
+const mesh_format::lod& mesh::lod(uint32_t i) const {
+    return _lods[i];
+}
+
+uint32_t mesh::lod_count() const {
+    return _header ? _header->lod_count : 0;
+}
+
+const char* mesh::vertex_data() const {
+    return _vertices;
+}
+
+size_t mesh::vertex_data_size() const {
+    return _header->vertex_count * sizeof(mesh_format::packed_vertex);
+}
+
+const char* mesh::index_data() const {
+    return _indices;
+}
+
+size_t mesh::index_data_size() const {
+    return size_t(_header->index_count) * _header->index_size;
+}
+
+uint32_t mesh::pick_lod(float max_error) const {
+    uint32_t picked = 0;
+
+    // lods are sorted from most to least detailed
+    for(uint32_t i = 1; i < lod_count(); i++) {
+        if(_lods[i].error > max_error) break;
+        picked = i;
+    }
+
+    return picked;
+}
+
+structs::vertex_layout mesh::vertex_layout() {
+    using mesh_format::packed_vertex;
+
+    structs::vertex_layout layout;
+
+    VkVertexInputBindingDescription binding{};
+    binding.binding = 0;
+    binding.stride = sizeof(packed_vertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    layout.bindings.push_back(binding);
+
+    // the shader still reads floats, the fixed function fetch expands them
+    struct { uint32_t location; VkFormat format; uint32_t offset; } attributes[] = {
+        { 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(packed_vertex, position) },
+        { 1, VK_FORMAT_R16G16_SNORM,       offsetof(packed_vertex, normal) },
+        { 2, VK_FORMAT_R16G16_SFLOAT,      offsetof(packed_vertex, uv) },
+    };
+
+    for(auto& a : attributes) {
+        VkVertexInputAttributeDescription attribute{};
+        attribute.location = a.location;
+        attribute.binding = 0;
+        attribute.format = a.format;
+        attribute.offset = a.offset;
+        layout.attributes.push_back(attribute);
+    }
+
+    return layout;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/graphics/mesh_format.hpp"
+#include "core/vulkan/vkstructs.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    class archive;
+
+    // a .mesh file loaded in memory, ready to be uploaded. the data is
+    // used as is, nothing gets decoded on the CPU. is_valid() is false
+    // for anything broken or empty
+    class mesh {
+    private:
+        std::vector<char> _data;
+
+        const mesh_format::header* _header;
+        const mesh_format::lod* _lods;
+        const char* _vertices;
+        const char* _indices;
+
+    public:
+        mesh();
+        mesh(std::vector<char> data);
+
+        // the pointers above point into _data, moving keeps them valid
+        mesh(const mesh&) = delete;
+        mesh& operator=(const mesh&) = delete;
+        mesh(mesh&&) = default;
+        mesh& operator=(mesh&&) = default;
+
+        static mesh load(const std::string& path);
+        static mesh load(const archive&, const std::string& name);
+
+        bool is_valid() const;
+
+        const mesh_format::header& header() const;
+        const mesh_format::lod& lod(uint32_t) const;
+        uint32_t lod_count() const;
+
+        const char* vertex_data() const;
+        size_t vertex_data_size() const;
+
+        const char* index_data() const;
+        size_t index_data_size() const;
+
+        // lowest detail lod whose error is still below max_error
+        uint32_t pick_lod(float max_error) const;
+
+        // one interleaved binding, locations match lit.vert
+        static structs::vertex_layout vertex_layout();
+    };
+}
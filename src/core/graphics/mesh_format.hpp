@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// on-disk layout of a .mesh file, written by tools/meshc
+//
+//   header
+//   lod       header.lod_count entries, lod 0 is the full detail mesh
+//   vertices  header.vertex_count packed_vertex, shared by every lod
+//   indices   header.index_count, uint16 or uint32 (header.index_size)
+//
+// vertices are quantized to 16 bytes (a float vertex with the same data
+// takes 32), and get decoded in the vertex shader (see lit.vert)
+
+namespace core::mesh_format {
+    const uint32_t magic = 0x48534d47; // "GMSH"
+    const uint32_t version = 1;
+
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t lod_count;
+        uint32_t index_size;     // 2 or 4 bytes
+        // positions are stored relative to the bounding box
+        float bounds_min[3];
+        float bounds_extent[3];
+    };
+
+    struct lod {
+        uint32_t index_offset;
+        uint32_t index_count;
+        // world-space size of the detail that was thrown away
+        float error;
+        uint32_t reserved;
+    };
+
+    struct packed_vertex {
+        uint16_t position[4];   // unorm16 inside the bounds, w unused
+        int16_t normal[2];      // octahedral encoded, snorm16
+        uint16_t uv[2];         // half floats
+    };
+
+    static_assert(sizeof(header) == 48, "mesh header must be packed");
+    static_assert(sizeof(lod) == 16, "mesh lod must be packed");
+    static_assert(sizeof(packed_vertex) == 16, "packed vertex must stay 16 bytes");
+
+    // quantization helpers
+
+    inline uint16_t quantize_unorm16(float v) {
+        v = std::clamp(v, 0.0f, 1.0f);
+        return static_cast<uint16_t>(v * 65535.0f + 0.5f);
+    }
+
+    inline int16_t quantize_snorm16(float v) {
+        v = std::clamp(v, -1.0f, 1.0f);
+        return static_cast<int16_t>(std::lround(v * 32767.0f));
+    }
+
+    // octahedral normal encoding: fold the unit sphere onto a square,
+    // 2 components instead of 3 with a very even error distribution
+    inline void encode_octahedral(const float n[3], int16_t out[2]) {
+        float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+        float x = n[0] / l1, y = n[1] / l1;
+
+        if(n[2] < 0.0f) {
+            float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+
+        out[0] = quantize_snorm16(x);
+        out[1] = quantize_snorm16(y);
+    }
+
+    inline void decode_octahedral(const int16_t in[2], float n[3]) {
+        float x = std::max(in[0] / 32767.0f, -1.0f);
+        float y = std::max(in[1] / 32767.0f, -1.0f);
+        float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+        if(z < 0.0f) {
+            float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+
+        float length = std::sqrt(x * x + y * y + z * z);
+        n[0] = x / length;
+        n[1] = y / length;
+        n[2] = z / length;
+    }
+
+    // float -> IEEE half, rounding to nearest
+    inline uint16_t to_half(float f) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if(exponent <= 0) {
+            // too small even for a denormal
+            if(exponent < -10) return sign;
+            mantissa |= 0x800000;
+            uint32_t shift = 14 - exponent;
+            return sign | ((mantissa + (1u << (shift - 1))) >> shift);
+        }
+
+        if(exponent >= 31) return sign | 0x7c00; // inf
+
+        uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+        // round, letting the carry bump the exponent if needed
+        return half + ((mantissa >> 12) & 1);
+    }
+}
@@ -0,0 +1,554 @@
+#include "./mesh_processing.hpp"
+#include "./mesh_format.hpp"
+
+#include "utils/assert.hpp"
+
+#include <set>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace core;
+using mesh_processing::vertex;
+
+// forsyth's scoring, the cache here is a model for the heuristic, not
+// the actual hardware (that one's closer to the FIFO in analyze_vertex_cache)
+static const uint32_t max_cache_size = 32;
+
+static float vertex_score(int cache_position, uint32_t live_triangles) {
+    // nothing left to draw with this vertex
+    if(live_triangles == 0) return -1.0f;
+
+    float score = 0.0f;
+
+    if(cache_position >= 0) {
+        // the last triangle's vertices get a fixed score, so the algorithm
+        // doesn't just keep zig-zagging through a strip
+        if(cache_position < 3) {
+            score = 0.75f;
+        } else {
+            float scaler = 1.0f / (max_cache_size - 3.0f);
+            score = std::pow(1.0f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+
+    // vertices with few triangles left get a boost, to finish them off
+    // instead of leaving lone triangles behind
+    score += 2.0f / std::sqrt(float(live_triangles));
+
+    return score;
+}
+
+mesh_processing::cache_stats mesh_processing::analyze_vertex_cache(
+    const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size
+) {
+    // a vertex is in the cache if fewer than cache_size misses happened since it was loaded
+    std::vector<uint32_t> loaded_at(vertex_count, 0);
+    std::vector<bool> used(vertex_count, false);
+
+    uint32_t timestamp = cache_size + 1;
+    size_t misses = 0, unique = 0;
+
+    for(auto index : indices) {
+        if(timestamp - loaded_at[index] > cache_size) {
+            loaded_at[index] = timestamp++;
+            misses++;
+        }
+
+        if(!used[index]) {
+            used[index] = true;
+            unique++;
+        }
+    }
+
+    cache_stats stats{};
+    if(!indices.empty()) {
+        stats.acmr = float(misses) / (indices.size() / 3);
+        stats.atvr = float(misses) / unique;
+    }
+    return stats;
+}
+
+void mesh_processing::optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertex_count) {
+    size_t triangle_count = indices.size() / 3;
+    if(triangle_count == 0) return;
+
+    // triangles using each vertex, live ones first in each list
+    std::vector<uint32_t> live(vertex_count, 0);
+    for(auto index : indices) live[index]++;
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for(size_t v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < indices.size(); i++) {
+            adjacency[cursor[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> scores(vertex_count);
+    for(size_t v = 0; v < vertex_count; v++) scores[v] = vertex_score(-1, live[v]);
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t cache[max_cache_size + 3];
+    uint32_t new_cache[max_cache_size + 3];
+    uint32_t cache_count = 0;
+
+    size_t input_cursor = 0;
+    int64_t best = -1;
+
+    while(output.size() < indices.size()) {
+        // nothing in the cache has triangles left, start somewhere new
+        if(best < 0) {
+            while(emitted[input_cursor]) input_cursor++;
+            best = input_cursor;
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        emitted[best] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for(int i = 0; i < 3; i++) {
+            uint32_t v = triangle[i];
+
+            // swap the triangle out of the live part of the list
+            uint32_t* list = &adjacency[offsets[v]];
+            uint32_t* position = std::find(list, list + live[v], uint32_t(best));
+            std::swap(*position, list[live[v] - 1]);
+            live[v]--;
+        }
+
+        // the triangle's vertices go to the front, the rest get pushed back
+        uint32_t new_count = 0;
+        for(int i = 0; i < 3; i++) new_cache[new_count++] = triangle[i];
+
+        for(uint32_t i = 0; i < cache_count; i++) {
+            uint32_t v = cache[i];
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        for(uint32_t i = 0; i < new_count; i++) {
+            uint32_t v = new_cache[i];
+            cache_position[v] = i < max_cache_size ? int(i) : -1;
+            scores[v] = vertex_score(cache_position[v], live[v]);
+        }
+
+        cache_count = std::min(new_count, max_cache_size);
+        std::copy(new_cache, new_cache + cache_count, cache);
+
+        // only triangles around the cache changed score, the best next
+        // triangle is almost always one of them
+        best = -1;
+        float best_score = -1.0f;
+
+        for(uint32_t i = 0; i < new_count; i++) {
+            uint32_t v = new_cache[i];
+            const uint32_t* list = &adjacency[offsets[v]];
+
+            for(uint32_t j = 0; j < live[v]; j++) {
+                uint32_t t = list[j];
+                const uint32_t* tri = &indices[t * 3];
+
+                float score = scores[tri[0]] + scores[tri[1]] + scores[tri[2]];
+
+                if(score > best_score) {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+struct triangle_geometry {
+    float centroid[3];
+    // not normalized, length is twice the area
+    float normal[3];
+};
+
+static triangle_geometry get_triangle_geometry(const std::vector<vertex>& vertices, const uint32_t* triangle) {
+    const float* a = vertices[triangle[0]].position;
+    const float* b = vertices[triangle[1]].position;
+    const float* c = vertices[triangle[2]].position;
+
+    float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+    triangle_geometry g;
+    for(int i = 0; i < 3; i++) g.centroid[i] = (a[i] + b[i] + c[i]) / 3.0f;
+
+    g.normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    g.normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    g.normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+
+    return g;
+}
+
+void mesh_processing::optimize_overdraw(
+    std::vector<uint32_t>& indices, const std::vector<vertex>& vertices, float threshold
+) {
+    const uint32_t cache_size = 16;
+    const size_t min_cluster_size = 32;
+
+    size_t triangle_count = indices.size() / 3;
+    if(triangle_count == 0) return;
+
+    float mesh_acmr = analyze_vertex_cache(indices, vertices.size(), cache_size).acmr;
+
+    // split the cache optimized order in clusters. a triangle that misses
+    // on all three vertices starts from a cold cache anyway, so cutting
+    // there is free. longer runs also get cut once they've done well
+    // enough, that's what the threshold trades
+    std::vector<size_t> cluster_starts{ 0 };
+    {
+        std::vector<uint32_t> loaded_at(vertices.size(), 0);
+        uint32_t timestamp = cache_size + 1;
+
+        size_t cluster_start = 0, cluster_misses = 0;
+        bool soft_cut = false;
+
+        for(size_t t = 0; t < triangle_count; t++) {
+            int misses = 0;
+            for(int i = 0; i < 3; i++) {
+                uint32_t v = indices[t * 3 + i];
+                if(timestamp - loaded_at[v] > cache_size) {
+                    loaded_at[v] = timestamp++;
+                    misses++;
+                }
+            }
+
+            if(t != cluster_start && (misses == 3 || soft_cut)) {
+                cluster_starts.push_back(t);
+                cluster_start = t;
+                cluster_misses = 0;
+            }
+
+            cluster_misses += misses;
+
+            size_t cluster_size = t - cluster_start + 1;
+            soft_cut =
+                cluster_size >= min_cluster_size &&
+                float(cluster_misses) / cluster_size <= mesh_acmr * threshold;
+        }
+    }
+    cluster_starts.push_back(triangle_count);
+
+    size_t cluster_count = cluster_starts.size() - 1;
+
+    // area weighted centroid and normal, per cluster and for the whole mesh
+    std::vector<triangle_geometry> clusters(cluster_count, triangle_geometry{});
+    float mesh_centroid[3] = {};
+    float mesh_area = 0.0f;
+    std::vector<float> cluster_area(cluster_count, 0.0f);
+
+    for(size_t c = 0; c < cluster_count; c++) {
+        auto& cluster = clusters[c];
+
+        for(size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+            auto g = get_triangle_geometry(vertices, &indices[t * 3]);
+            float area = std::sqrt(g.normal[0] * g.normal[0] + g.normal[1] * g.normal[1] + g.normal[2] * g.normal[2]);
+
+            for(int i = 0; i < 3; i++) {
+                cluster.centroid[i] += g.centroid[i] * area;
+                cluster.normal[i] += g.normal[i];
+                mesh_centroid[i] += g.centroid[i] * area;
+            }
+            cluster_area[c] += area;
+            mesh_area += area;
+        }
+    }
+
+    if(mesh_area > 0.0f) {
+        for(int i = 0; i < 3; i++) mesh_centroid[i] /= mesh_area;
+    }
+
+    // clusters facing away from the center are the most likely to occlude
+    // the rest, so they get drawn first
+    std::vector<float> keys(cluster_count, 0.0f);
+    for(size_t c = 0; c < cluster_count; c++) {
+        auto& cluster = clusters[c];
+        if(cluster_area[c] <= 0.0f) continue;
+
+        float length = std::sqrt(
+            cluster.normal[0] * cluster.normal[0] +
+            cluster.normal[1] * cluster.normal[1] +
+            cluster.normal[2] * cluster.normal[2]);
+        if(length <= 0.0f) continue;
+
+        float dot = 0.0f;
+        for(int i = 0; i < 3; i++) {
+            dot += (cluster.centroid[i] / cluster_area[c] - mesh_centroid[i]) * cluster.normal[i] / length;
+        }
+        keys[c] = dot;
+    }
+
+    std::vector<size_t> order(cluster_count);
+    for(size_t c = 0; c < cluster_count; c++) order[c] = c;
+
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for(auto c : order) {
+        output.insert(
+            output.end(),
+            indices.begin() + cluster_starts[c] * 3,
+            indices.begin() + cluster_starts[c + 1] * 3);
+    }
+
+    indices.swap(output);
+}
+
+void mesh_processing::optimize_vertex_fetch(
+    std::vector<vertex>& vertices, std::vector<std::vector<uint32_t>*> index_lists
+) {
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    uint32_t next = 0;
+
+    for(auto list : index_lists) {
+        for(auto& index : *list) {
+            if(remap[index] == unused) remap[index] = next++;
+            index = remap[index];
+        }
+    }
+
+    // vertices no index points to get dropped
+    std::vector<vertex> reordered(next);
+    for(size_t v = 0; v < vertices.size(); v++) {
+        if(remap[v] != unused) reordered[remap[v]] = vertices[v];
+    }
+
+    vertices.swap(reordered);
+}
+
+static void get_bounds(const std::vector<vertex>& vertices, float min[3], float max[3]) {
+    for(int i = 0; i < 3; i++) {
+        min[i] = std::numeric_limits<float>::max();
+        max[i] = std::numeric_limits<float>::lowest();
+    }
+
+    for(auto& v : vertices) {
+        for(int i = 0; i < 3; i++) {
+            min[i] = std::min(min[i], v.position[i]);
+            max[i] = std::max(max[i], v.position[i]);
+        }
+    }
+
+    if(vertices.empty()) {
+        for(int i = 0; i < 3; i++) min[i] = max[i] = 0.0f;
+    }
+}
+
+std::vector<uint32_t> mesh_processing::simplify_clustered(
+    const std::vector<uint32_t>& indices, const std::vector<vertex>& vertices, uint32_t grid_size
+) {
+    float min[3], max[3];
+    get_bounds(vertices, min, max);
+
+    float extent = std::max({ max[0] - min[0], max[1] - min[1], max[2] - min[2] });
+    float cell_size = extent > 0.0f ? extent / grid_size : 1.0f;
+
+    auto cell_of = [&](const vertex& v) {
+        uint64_t cell = 0;
+        for(int i = 0; i < 3; i++) {
+            int64_t c = int64_t((v.position[i] - min[i]) / cell_size);
+            c = std::clamp<int64_t>(c, 0, grid_size - 1);
+            cell = cell * grid_size + c;
+        }
+        return cell;
+    };
+
+    // average of every used vertex in each cell
+    struct cell {
+        float sum[3];
+        uint32_t count;
+        uint32_t representative;
+        float best_distance;
+    };
+
+    std::unordered_map<uint64_t, cell> cells;
+    std::vector<uint64_t> vertex_cell(vertices.size(), 0);
+    std::vector<bool> used(vertices.size(), false);
+
+    for(auto index : indices) {
+        if(used[index]) continue;
+        used[index] = true;
+
+        uint64_t id = cell_of(vertices[index]);
+        vertex_cell[index] = id;
+
+        auto& c = cells.try_emplace(id, cell{ {0, 0, 0}, 0, index, std::numeric_limits<float>::max() }).first->second;
+        for(int i = 0; i < 3; i++) c.sum[i] += vertices[index].position[i];
+        c.count++;
+    }
+
+    // an existing vertex stands in for its whole cell, the one closest to
+    // the average, so the lods don't need vertices of their own
+    for(size_t v = 0; v < vertices.size(); v++) {
+        if(!used[v]) continue;
+
+        auto& c = cells[vertex_cell[v]];
+        float distance = 0.0f;
+        for(int i = 0; i < 3; i++) {
+            float d = vertices[v].position[i] - c.sum[i] / c.count;
+            distance += d * d;
+        }
+
+        if(distance < c.best_distance) {
+            c.best_distance = distance;
+            c.representative = v;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    std::set<std::array<uint32_t, 3>> seen;
+
+    for(size_t t = 0; t + 2 < indices.size(); t += 3) {
+        std::array<uint32_t, 3> triangle;
+        for(int i = 0; i < 3; i++) triangle[i] = cells[vertex_cell[indices[t + i]]].representative;
+
+        // collapsed into a line or a point
+        if(triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) continue;
+
+        // rotate (keeping the winding) so duplicates compare equal
+        auto smallest = std::min_element(triangle.begin(), triangle.end());
+        std::rotate(triangle.begin(), smallest, triangle.end());
+
+        if(!seen.insert(triangle).second) continue;
+
+        output.insert(output.end(), triangle.begin(), triangle.end());
+    }
+
+    return output;
+}
+
+mesh_processing::lod_chain mesh_processing::build_lods(
+    std::vector<vertex>& vertices, std::vector<uint32_t> indices, uint32_t max_lods
+) {
+    lod_chain chain;
+
+    optimize_vertex_cache(indices, vertices.size());
+    optimize_overdraw(indices, vertices);
+
+    float min[3], max[3];
+    get_bounds(vertices, min, max);
+    float extent = std::max({ max[0] - min[0], max[1] - min[1], max[2] - min[2] });
+
+    // lods are always simplified from the original, each one a coarser
+    // grid. grids that barely remove anything get skipped
+    for(uint32_t grid = 256; grid >= 2 && chain.lods.size() + 1 < max_lods; grid /= 2) {
+        size_t previous = chain.lods.empty() ? indices.size() : chain.lods.back().size();
+
+        auto simplified = simplify_clustered(indices, vertices, grid);
+        if(simplified.empty()) break;
+        if(simplified.size() > previous * 3 / 4) continue;
+
+        // distant lods cover few pixels, overdraw doesn't matter there
+        optimize_vertex_cache(simplified, vertices.size());
+
+        chain.lods.push_back(std::move(simplified));
+        chain.errors.push_back(extent / grid);
+    }
+
+    chain.lods.insert(chain.lods.begin(), std::move(indices));
+    chain.errors.insert(chain.errors.begin(), 0.0f);
+
+    std::vector<std::vector<uint32_t>*> index_lists;
+    for(auto& lod : chain.lods) index_lists.push_back(&lod);
+    optimize_vertex_fetch(vertices, index_lists);
+
+    return chain;
+}
+
+std::vector<char> mesh_processing::write_mesh(const std::vector<vertex>& vertices, const lod_chain& chain) {
+    ASSERT(chain.lods.size() == chain.errors.size(), "Every lod needs an error");
+
+    mesh_format::header header{};
+    header.magic = mesh_format::magic;
+    header.version = mesh_format::version;
+    header.vertex_count = vertices.size();
+    header.lod_count = chain.lods.size();
+    header.index_size = vertices.size() <= 0xffff ? 2 : 4;
+
+    float min[3], max[3];
+    get_bounds(vertices, min, max);
+    for(int i = 0; i < 3; i++) {
+        header.bounds_min[i] = min[i];
+        header.bounds_extent[i] = max[i] - min[i];
+    }
+
+    std::vector<mesh_format::lod> lods;
+    for(size_t i = 0; i < chain.lods.size(); i++) {
+        mesh_format::lod lod{};
+        lod.index_offset = header.index_count;
+        lod.index_count = chain.lods[i].size();
+        lod.error = chain.errors[i];
+        lods.push_back(lod);
+
+        header.index_count += lod.index_count;
+    }
+
+    std::vector<mesh_format::packed_vertex> packed(vertices.size());
+    for(size_t v = 0; v < vertices.size(); v++) {
+        auto& in = vertices[v];
+        auto& out = packed[v];
+
+        for(int i = 0; i < 3; i++) {
+            float extent = header.bounds_extent[i];
+            out.position[i] = mesh_format::quantize_unorm16(extent > 0.0f ? (in.position[i] - min[i]) / extent : 0.0f);
+        }
+        out.position[3] = 0;
+
+        float normal[3] = { in.normal[0], in.normal[1], in.normal[2] };
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(length > 0.0f) {
+            for(int i = 0; i < 3; i++) normal[i] /= length;
+        } else {
+            normal[0] = 0.0f; normal[1] = 0.0f; normal[2] = 1.0f;
+        }
+        mesh_format::encode_octahedral(normal, out.normal);
+
+        out.uv[0] = mesh_format::to_half(in.uv[0]);
+        out.uv[1] = mesh_format::to_half(in.uv[1]);
+    }
+
+    std::vector<char> out;
+    auto append = [&](const void* data, size_t size) {
+        auto bytes = static_cast<const char*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    };
+
+    append(&header, sizeof(header));
+    append(lods.data(), lods.size() * sizeof(mesh_format::lod));
+    append(packed.data(), packed.size() * sizeof(mesh_format::packed_vertex));
+
+    for(auto& lod : chain.lods) {
+        for(auto index : lod) {
+            if(header.index_size == 2) {
+                uint16_t small = index;
+                append(&small, sizeof(small));
+            } else {
+                append(&index, sizeof(index));
+            }
+        }
+    }
+
+    return out;
+}
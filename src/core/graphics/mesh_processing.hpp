@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// offline mesh processing, used by the mesh compiler (tools/meshc).
+// nothing in here runs while the game is running
+
+namespace core::mesh_processing {
+    struct vertex {
+        float position[3];
+        float normal[3];
+        float uv[2];
+    };
+
+    struct cache_stats {
+        // average cache miss ratio, vertex shader runs per triangle (0.5 - 3)
+        float acmr;
+        // vertex shader runs per unique vertex (1 is perfect)
+        float atvr;
+    };
+
+    // simulates a FIFO post-transform cache like the ones on actual hardware
+    cache_stats analyze_vertex_cache(
+        const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16);
+
+    // reorders triangles so vertices get reused while still in the
+    // post-transform cache (Tom Forsyth's linear-speed algorithm)
+    void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+    // reorders clusters of triangles so outward facing ones come first,
+    // which cuts overdraw. cache friendly runs are kept together, and
+    // threshold says how much worse the ACMR may get (1.05 = 5%)
+    void optimize_overdraw(
+        std::vector<uint32_t>& indices, const std::vector<vertex>&, float threshold = 1.05f);
+
+    // reorders vertices in the order they're first used, so fetches are
+    // mostly linear. every index list using the vertices gets remapped
+    void optimize_vertex_fetch(std::vector<vertex>&, std::vector<std::vector<uint32_t>*> index_lists);
+
+    // vertex clustering: snaps vertices to a grid_size^3 grid over the
+    // bounds and drops the triangles that collapse. the result indexes the
+    // same vertices, so every lod can share one vertex buffer
+    std::vector<uint32_t> simplify_clustered(
+        const std::vector<uint32_t>& indices, const std::vector<vertex>&, uint32_t grid_size);
+
+    // full-detail mesh + a chain of simplified lods, every lod optimized
+    struct lod_chain {
+        std::vector<std::vector<uint32_t>> lods;
+        // world-space error of each lod, 0 for the original
+        std::vector<float> errors;
+    };
+
+    lod_chain build_lods(
+        std::vector<vertex>&, std::vector<uint32_t> indices, uint32_t max_lods = 4);
+
+    // quantizes and lays out a .mesh file (see mesh_format.hpp)
+    std::vector<char> write_mesh(const std::vector<vertex>&, const lod_chain&);
+}
@@ -0,0 +1,345 @@
+#include "./occlusion.hpp"
+
+#include "core/physics/simd.hpp"
+#include "utils/assert.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+using physics::float4;
+
+namespace {
+    // below this w a point is treated as on or behind the near plane
+    const float near_w = 1e-5f;
+
+    // column major, out = a * b
+    void multiply(const float a[16], const float b[16], float out[16]) {
+        for(int c = 0; c < 4; c++) {
+            for(int r = 0; r < 4; r++) {
+                out[c * 4 + r] =
+                    a[0 * 4 + r] * b[c * 4 + 0] + a[1 * 4 + r] * b[c * 4 + 1] +
+                    a[2 * 4 + r] * b[c * 4 + 2] + a[3 * 4 + r] * b[c * 4 + 3];
+            }
+        }
+    }
+
+    void to_clip(const float m[16], float x, float y, float z, float out[4]) {
+        for(int r = 0; r < 4; r++) {
+            out[r] = m[0 * 4 + r] * x + m[1 * 4 + r] * y + m[2 * 4 + r] * z + m[3 * 4 + r];
+        }
+    }
+
+    // A * x + B * y + C, positive on the inside of a counter-clockwise edge
+    struct edge {
+        float a, b, c;
+
+        edge(float x0, float y0, float x1, float y1)
+            : a(y0 - y1), b(x1 - x0), c(x0 * y1 - x1 * y0)
+        {}
+    };
+}
+
+occlusion_culler::occlusion_culler(uint32_t width, uint32_t height, jobs::thread_pool* jobs)
+    : _width(width), _height(height), _jobs(jobs), _view_proj{}, _stats{}
+{
+    ASSERT(width % 4 == 0 && width > 0 && height > 0, "Occlusion buffer width has to be a multiple of 4");
+
+    _tiles_x = (width + tile_width - 1) / tile_width;
+    _tiles_y = (height + tile_height - 1) / tile_height;
+
+    _threads.resize(jobs ? jobs->thread_count() : 1);
+    for(auto& t : _threads) t.tiles.resize(_tiles_x * _tiles_y);
+
+    uint32_t w = width, h = height;
+    while(true) {
+        _levels.emplace_back(size_t(w) * h, 1.0f);
+        _level_widths.push_back(w);
+        _level_heights.push_back(h);
+
+        if(w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+void occlusion_culler::begin(const float view_proj[16]) {
+    memcpy(_view_proj, view_proj, sizeof(_view_proj));
+    _occluders.clear();
+    _stats = {};
+}
+
+void occlusion_culler::add_occluder(
+    const float* positions, uint32_t stride,
+    const uint32_t* indices, uint32_t index_count,
+    const float model[16])
+{
+    occluder o;
+    o.positions = positions;
+    o.stride = stride;
+    o.indices = indices;
+    o.index_count = index_count;
+    multiply(_view_proj, model, o.transform);
+
+    _occluders.push_back(o);
+}
+
+void occlusion_culler::bin(const occluder& o, thread_bins& out) {
+    const float w = float(_width), h = float(_height);
+
+    for(uint32_t i = 0; i + 2 < o.index_count; i += 3) {
+        float clip[3][4];
+        for(int v = 0; v < 3; v++) {
+            const float* p = o.positions + size_t(o.indices[i + v]) * o.stride;
+            to_clip(o.transform, p[0], p[1], p[2], clip[v]);
+        }
+
+        // crossing the near plane: drop it, an occluder can only lose area
+        if(clip[0][3] < near_w || clip[1][3] < near_w || clip[2][3] < near_w) continue;
+
+        // all three outside the same side
+        bool outside = false;
+        for(int axis = 0; axis < 2 && !outside; axis++) {
+            outside =
+                (clip[0][axis] > clip[0][3] && clip[1][axis] > clip[1][3] && clip[2][axis] > clip[2][3]) ||
+                (clip[0][axis] < -clip[0][3] && clip[1][axis] < -clip[1][3] && clip[2][axis] < -clip[2][3]);
+        }
+        if(outside) continue;
+
+        triangle t;
+        for(int v = 0; v < 3; v++) {
+            float inv_w = 1.0f / clip[v][3];
+            t.x[v] = (clip[v][0] * inv_w * 0.5f + 0.5f) * w;
+            t.y[v] = (clip[v][1] * inv_w * 0.5f + 0.5f) * h;
+            // pushed away from the near plane only, that can only lose
+            // occlusion. past the far plane stays there, pulled in it would
+            // hide what's in front of it; the buffer starts at 1 so those
+            // pixels just don't change
+            t.z[v] = std::max(clip[v][2] * inv_w, 0.0f);
+        }
+
+        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        if(std::fabs(area) < 1e-6f) continue;
+
+        // both windings are drawn, closed meshes keep their front anyway
+        if(area < 0.0f) {
+            std::swap(t.x[1], t.x[2]);
+            std::swap(t.y[1], t.y[2]);
+            std::swap(t.z[1], t.z[2]);
+        }
+
+        float min_x = std::min({ t.x[0], t.x[1], t.x[2] }), max_x = std::max({ t.x[0], t.x[1], t.x[2] });
+        float min_y = std::min({ t.y[0], t.y[1], t.y[2] }), max_y = std::max({ t.y[0], t.y[1], t.y[2] });
+        if(max_x < 0.0f || max_y < 0.0f || min_x >= w || min_y >= h) continue;
+
+        int tx0 = std::max(0, int(min_x) / int(tile_width));
+        int ty0 = std::max(0, int(min_y) / int(tile_height));
+        int tx1 = std::min(int(_tiles_x) - 1, int(max_x) / int(tile_width));
+        int ty1 = std::min(int(_tiles_y) - 1, int(max_y) / int(tile_height));
+
+        uint32_t index = out.triangles.size();
+        out.triangles.push_back(t);
+
+        for(int ty = ty0; ty <= ty1; ty++) {
+            for(int tx = tx0; tx <= tx1; tx++) {
+                out.tiles[ty * _tiles_x + tx].push_back(index);
+            }
+        }
+    }
+}
+
+void occlusion_culler::rasterize_tile(uint32_t tile) {
+    auto& depth = _levels[0];
+
+    const int tile_x0 = int(tile % _tiles_x * tile_width);
+    const int tile_y0 = int(tile / _tiles_x * tile_height);
+    const int tile_x1 = std::min(tile_x0 + int(tile_width), int(_width));
+    const int tile_y1 = std::min(tile_y0 + int(tile_height), int(_height));
+
+    for(int y = tile_y0; y < tile_y1; y++) {
+        std::fill(depth.begin() + size_t(y) * _width + tile_x0, depth.begin() + size_t(y) * _width + tile_x1, 1.0f);
+    }
+
+    // pixel centers of one 4 wide span, relative to its first pixel
+    alignas(16) const float offsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+    const float4 lane_offsets = float4::load(offsets);
+    const float4 zero(0.0f);
+
+    for(auto& thread : _threads) {
+        for(uint32_t index : thread.tiles[tile]) {
+            const triangle& t = thread.triangles[index];
+
+            edge e0(t.x[1], t.y[1], t.x[2], t.y[2]);
+            edge e1(t.x[2], t.y[2], t.x[0], t.y[0]);
+            edge e2(t.x[0], t.y[0], t.x[1], t.y[1]);
+
+            // depth as a plane, from the barycentrics
+            float area = e2.a * t.x[2] + e2.b * t.y[2] + e2.c;
+            float inv_area = 1.0f / area;
+            float za = (e0.a * t.z[0] + e1.a * t.z[1] + e2.a * t.z[2]) * inv_area;
+            float zb = (e0.b * t.z[0] + e1.b * t.z[1] + e2.b * t.z[2]) * inv_area;
+            float zc = (e0.c * t.z[0] + e1.c * t.z[1] + e2.c * t.z[2]) * inv_area;
+
+            int x0 = std::max(tile_x0, int(std::floor(std::min({ t.x[0], t.x[1], t.x[2] }))));
+            int x1 = std::min(tile_x1, int(std::ceil(std::max({ t.x[0], t.x[1], t.x[2] }))));
+            int y0 = std::max(tile_y0, int(std::floor(std::min({ t.y[0], t.y[1], t.y[2] }))));
+            int y1 = std::min(tile_y1, int(std::ceil(std::max({ t.y[0], t.y[1], t.y[2] }))));
+
+            // spans start on a multiple of 4, tiles and the buffer are too
+            x0 &= ~3;
+
+            const float4 a0(e0.a), a1(e1.a), a2(e2.a), az(za);
+
+            for(int y = y0; y < y1; y++) {
+                float py = float(y) + 0.5f;
+                float4 row0(e0.b * py + e0.c), row1(e1.b * py + e1.c), row2(e2.b * py + e2.c);
+                float4 row_z(zb * py + zc);
+                float* line = depth.data() + size_t(y) * _width;
+
+                for(int x = x0; x < x1; x += 4) {
+                    float4 px = float4(float(x)) + lane_offsets;
+
+                    float4 inside =
+                        ~(a0 * px + row0 < zero) &
+                        ~(a1 * px + row1 < zero) &
+                        ~(a2 * px + row2 < zero);
+                    if(inside.mask() == 0) continue;
+
+                    float4 current = float4::load(line + x);
+                    float4 z = az * px + row_z;
+                    physics::select(inside, physics::min(current, z), current).store(line + x);
+                }
+            }
+        }
+    }
+}
+
+void occlusion_culler::build_mips() {
+    for(size_t level = 1; level < _levels.size(); level++) {
+        const auto& source = _levels[level - 1];
+        uint32_t source_width = _level_widths[level - 1], source_height = _level_heights[level - 1];
+
+        auto& target = _levels[level];
+        uint32_t w = _level_widths[level], h = _level_heights[level];
+
+        for(uint32_t y = 0; y < h; y++) {
+            // odd sizes: the last texel only has itself to the right/below
+            uint32_t sy0 = y * 2, sy1 = std::min(y * 2 + 1, source_height - 1);
+            for(uint32_t x = 0; x < w; x++) {
+                uint32_t sx0 = x * 2, sx1 = std::min(x * 2 + 1, source_width - 1);
+
+                target[y * w + x] = std::max(
+                    std::max(source[sy0 * source_width + sx0], source[sy0 * source_width + sx1]),
+                    std::max(source[sy1 * source_width + sx0], source[sy1 * source_width + sx1]));
+            }
+        }
+    }
+}
+
+void occlusion_culler::rasterize() {
+    for(auto& t : _threads) {
+        t.triangles.clear();
+        for(auto& tile : t.tiles) tile.clear();
+    }
+
+    auto bin_job = [this](uint32_t i, uint32_t thread) {
+        bin(_occluders[i], _threads[thread]);
+    };
+    auto tile_job = [this](uint32_t tile, uint32_t) {
+        rasterize_tile(tile);
+    };
+
+    if(_jobs) {
+        _jobs->parallel_for(_occluders.size(), bin_job);
+        _jobs->parallel_for(_tiles_x * _tiles_y, tile_job);
+    } else {
+        for(uint32_t i = 0; i < _occluders.size(); i++) bin_job(i, 0);
+        for(uint32_t i = 0; i < _tiles_x * _tiles_y; i++) tile_job(i, 0);
+    }
+
+    build_mips();
+
+    _stats.occluders = _occluders.size();
+    for(auto& t : _threads) _stats.triangles += t.triangles.size();
+}
+
+bool occlusion_culler::is_visible(const box& b) const {
+    const float w = float(_width), h = float(_height);
+
+    float min_x = w, max_x = -1.0f, min_y = h, max_y = -1.0f, min_z = 1.0f;
+    for(int corner = 0; corner < 8; corner++) {
+        float clip[4];
+        to_clip(_view_proj,
+            corner & 1 ? b.max[0] : b.min[0],
+            corner & 2 ? b.max[1] : b.min[1],
+            corner & 4 ? b.max[2] : b.min[2],
+            clip);
+
+        // reaches the camera, can't tell
+        if(clip[3] < near_w) return true;
+
+        float inv_w = 1.0f / clip[3];
+        float x = (clip[0] * inv_w * 0.5f + 0.5f) * w;
+        float y = (clip[1] * inv_w * 0.5f + 0.5f) * h;
+
+        min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+        min_z = std::min(min_z, clip[2] * inv_w);
+    }
+
+    if(min_z <= 0.0f) return true;
+    if(max_x < 0.0f || max_y < 0.0f || min_x >= w || min_y >= h) return false;
+
+    int x0 = std::max(0, int(min_x)), x1 = std::min(int(_width) - 1, int(max_x));
+    int y0 = std::max(0, int(min_y)), y1 = std::min(int(_height) - 1, int(max_y));
+
+    // the level where the rect is about 2 texels across, so a few texels
+    // cover it
+    uint32_t size = uint32_t(std::max(x1 - x0, y1 - y0)) + 1;
+    uint32_t level = 0;
+    while((size >> level) > 2 && level + 1 < _levels.size()) level++;
+
+    const auto& texels = _levels[level];
+    uint32_t level_width = _level_widths[level];
+
+    for(int y = y0 >> level; y <= y1 >> level; y++) {
+        for(int x = x0 >> level; x <= x1 >> level; x++) {
+            if(texels[y * level_width + x] >= min_z) return true;
+        }
+    }
+
+    return false;
+}
+
+void occlusion_culler::test(const box* boxes, uint32_t count, uint8_t* visible) {
+    const uint32_t batch = 256;
+    uint32_t batches = (count + batch - 1) / batch;
+
+    auto job = [&](uint32_t i, uint32_t) {
+        uint32_t end = std::min(count, (i + 1) * batch);
+        for(uint32_t j = i * batch; j < end; j++) visible[j] = is_visible(boxes[j]) ? 1 : 0;
+    };
+
+    if(_jobs) _jobs->parallel_for(batches, job);
+    else for(uint32_t i = 0; i < batches; i++) job(i, 0);
+
+    _stats.tested += count;
+    for(uint32_t i = 0; i < count; i++) _stats.culled += visible[i] == 0;
+}
+
+const occlusion_culler::stats& occlusion_culler::get_stats() const {
+    return _stats;
+}
+
+uint32_t occlusion_culler::width() const {
+    return _width;
+}
+
+uint32_t occlusion_culler::height() const {
+    return _height;
+}
+
+const float* occlusion_culler::depth() const {
+    return _levels[0].data();
+}
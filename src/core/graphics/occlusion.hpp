@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/jobs/thread_pool.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // software occlusion culling, entirely on the CPU.
+    //
+    // a handful of big occluder meshes get rasterized into a small depth
+    // buffer, then every renderable's bounding box is tested against a
+    // mip chain of that buffer where each texel holds the farthest depth
+    // under it. run it before building the frame's draw packets and skip
+    // whatever comes back hidden.
+    //
+    // rasterizing is two passes: occluders are transformed and their
+    // triangles binned into screen tiles (one occluder per job), then
+    // every tile is filled on its own (one tile per job), 4 pixels at a
+    // time. min depth doesn't care about order, so the result is the same
+    // whatever the thread count.
+    //
+    // matrices are column major, depth is z/w of a vulkan projection: 0 at
+    // the near plane, 1 at the far one. it errs on the visible side: boxes
+    // crossing the near plane are visible, occluder triangles crossing it
+    // are dropped and depths past the far plane aren't pulled back in.
+    // pixels count as covered when their center is inside a triangle, so
+    // an occluder's outline is only exact to half a texel
+    class occlusion_culler {
+    public:
+        static const uint32_t tile_width = 64;
+        static const uint32_t tile_height = 32;
+
+        struct box {
+            float min[3];
+            float max[3];
+        };
+
+        struct stats {
+            uint32_t occluders;
+            // made it through clipping into at least one tile
+            uint32_t triangles;
+            uint32_t tested;
+            // hidden behind occluders, or outside the view
+            uint32_t culled;
+        };
+
+    private:
+        struct occluder {
+            const float* positions;
+            uint32_t stride;
+            const uint32_t* indices;
+            uint32_t index_count;
+            float transform[16];
+        };
+
+        // screen space, counter-clockwise once binned
+        struct triangle {
+            float x[3], y[3], z[3];
+        };
+
+        struct thread_bins {
+            std::vector<triangle> triangles;
+            // per tile, indices into triangles
+            std::vector<std::vector<uint32_t>> tiles;
+        };
+
+        uint32_t _width, _height;
+        uint32_t _tiles_x, _tiles_y;
+        jobs::thread_pool* _jobs;
+
+        float _view_proj[16];
+        std::vector<occluder> _occluders;
+        std::vector<thread_bins> _threads;
+
+        // level 0 is the rasterized depth, each level after that the max
+        // of 2x2 texels of the one before
+        std::vector<std::vector<float>> _levels;
+        std::vector<uint32_t> _level_widths, _level_heights;
+
+        stats _stats;
+
+        void bin(const occluder&, thread_bins&);
+        void rasterize_tile(uint32_t tile);
+        void build_mips();
+
+    public:
+        // the width has to be a multiple of 4
+        occlusion_culler(uint32_t width, uint32_t height, jobs::thread_pool* = nullptr);
+
+        // starts a frame, drops last frame's occluders
+        void begin(const float view_proj[16]);
+
+        // positions are xyz floats, stride floats apart. nothing is copied,
+        // the data has to stay alive until rasterize()
+        void add_occluder(
+            const float* positions, uint32_t stride,
+            const uint32_t* indices, uint32_t index_count,
+            const float model[16]);
+
+        // bins, fills and builds the mip chain, after this boxes can be tested
+        void rasterize();
+
+        // world space box
+        bool is_visible(const box&) const;
+        // visible[i] is 1 if boxes[i] may be seen, split across the pool
+        void test(const box* boxes, uint32_t count, uint8_t* visible);
+
+        const stats& get_stats() const;
+
+        uint32_t width() const;
+        uint32_t height() const;
+        // width * height rasterized depths, 1 where nothing was drawn
+        const float* depth() const;
+    };
+}
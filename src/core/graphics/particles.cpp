@@ -0,0 +1,335 @@
+#include "./particles.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+using namespace core;
+
+namespace {
+    const uint32_t workgroup_size = 64;
+
+    // particles.comp's stage constant
+    const uint32_t stage_reset     = 0;
+    const uint32_t stage_emit      = 1;
+    const uint32_t stage_prepare   = 2;
+    const uint32_t stage_simulate  = 3;
+    const uint32_t stage_finalize  = 4;
+    const uint32_t stage_sort_pad  = 5;
+    const uint32_t stage_sort_step = 6;
+
+    // where the draw's VkDrawIndirectCommand starts in the args buffer,
+    // after the dispatch's
+    const VkDeviceSize draw_args_offset = 16;
+
+    // the passes only talk through storage buffers and the indirect args
+    void compute_barrier(VkCommandBuffer command_buffer) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask =
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+particle_system::particle_system(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    vkframe_ring& ring,
+    VkDescriptorSetLayout compute_layout,
+    VkDescriptorSetLayout emitter_layout,
+    VkDescriptorSetLayout draw_layout,
+    uint32_t capacity,
+    bool sort
+) : _device(device), _capacity(capacity), _sort(sort),
+    _parity(0), _needs_reset(true), _delta(0.0f), _seed(1),
+    _emit_count(0), _stats{}, _emitter_offset(0)
+{
+    _entry_count = 1;
+    while(_entry_count < capacity) _entry_count *= 2;
+
+    // one thread per entry in the sort passes
+    ASSERT(_entry_count / workgroup_size <= 65535, "Particle capacity past the dispatch limit");
+
+    memset(_view, 0, sizeof(_view));
+    memset(_projection, 0, sizeof(_projection));
+    _view[0] = _view[5] = _view[10] = _view[15] = 1.0f;
+
+    _emitters.reserve(max_emitters);
+
+    const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    const VkMemoryPropertyFlags device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    // lists are a count followed by the indices
+    VkDeviceSize list_size = (VkDeviceSize(capacity) + 1) * sizeof(uint32_t);
+
+    _particles = vkbuffer(device, physical_device, VkDeviceSize(capacity) * sizeof(gpu_particle), storage, device_local);
+    _lists[0] = vkbuffer(device, physical_device, list_size, storage, device_local);
+    _lists[1] = vkbuffer(device, physical_device, list_size, storage, device_local);
+    _dead = vkbuffer(device, physical_device, list_size, storage, device_local);
+    _args = vkbuffer(
+        device, physical_device, 32, storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, device_local);
+    _entries = vkbuffer(device, physical_device, VkDeviceSize(_entry_count) * 2 * sizeof(uint32_t), storage, device_local);
+
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = 2 * 6 + 2;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 3;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    VK_ASSERT(vkCreateDescriptorPool(device, &pool_info, nullptr, &_descriptor_pool));
+
+    VkDescriptorSetLayout set_layouts[3] = { compute_layout, compute_layout, draw_layout };
+    VkDescriptorSet sets[3];
+
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = _descriptor_pool;
+    set_info.descriptorSetCount = 3;
+    set_info.pSetLayouts = set_layouts;
+    VK_ASSERT(vkAllocateDescriptorSets(device, &set_info, sets));
+
+    _compute_sets[0] = sets[0];
+    _compute_sets[1] = sets[1];
+    _draw_set = sets[2];
+
+    auto write = [&](VkDescriptorSet set, uint32_t binding, const vkbuffer& buffer) {
+        VkDescriptorBufferInfo buffer_info{ buffer.handle, 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet w{};
+        w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        w.dstSet = set;
+        w.dstBinding = binding;
+        w.descriptorCount = 1;
+        w.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        w.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(device, 1, &w, 0, nullptr);
+    };
+
+    for(uint32_t parity = 0; parity < 2; parity++) {
+        write(_compute_sets[parity], 0, _particles);
+        write(_compute_sets[parity], 1, _lists[parity]);
+        write(_compute_sets[parity], 2, _lists[parity ^ 1]);
+        write(_compute_sets[parity], 3, _dead);
+        write(_compute_sets[parity], 4, _args);
+        write(_compute_sets[parity], 5, _entries);
+    }
+    write(_draw_set, 0, _particles);
+    write(_draw_set, 5, _entries);
+
+    _emitter_set = ring.create_set(
+        emitter_layout, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, max_emitters * sizeof(emitter));
+}
+
+particle_system::~particle_system() {
+    _particles.destroy(_device);
+    _lists[0].destroy(_device);
+    _lists[1].destroy(_device);
+    _dead.destroy(_device);
+    _args.destroy(_device);
+    _entries.destroy(_device);
+
+    // frees the sets too, the emitter set belongs to the ring
+    vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+}
+
+void particle_system::set_camera(const float view[16], const float projection[16]) {
+    memcpy(_view, view, sizeof(_view));
+    memcpy(_projection, projection, sizeof(_projection));
+}
+
+void particle_system::advance(float delta) {
+    _delta += delta;
+}
+
+void particle_system::emit(const structs::vector3& position, const components::particle_emitter& source, uint32_t count) {
+    // no more than the pool holds can spawn in one frame, and it keeps the
+    // emit dispatch as small as the reset one
+    count = std::min(count, _capacity - _emit_count);
+    if(count == 0) return;
+
+    if(_emitters.size() == max_emitters) {
+        _stats.dropped_emitters++;
+        return;
+    }
+
+    emitter e;
+    e.position[0] = position.x;
+    e.position[1] = position.y;
+    e.position[2] = position.z;
+    e.lifetime = source.lifetime;
+    e.speed = source.speed;
+    e.spread = source.spread;
+    e.size = source.size;
+    e.color = source.color.packed();
+    e.first = _emit_count;
+    e.count = count;
+    // new random numbers every emitter of every frame
+    e.seed = _seed++ * 0x9e3779b9u;
+    e.padding = 0;
+
+    _emitters.push_back(e);
+    _emit_count += count;
+}
+
+void particle_system::flush(vkframe_ring& ring) {
+    _stats.emitters = uint32_t(_emitters.size());
+    _stats.emitted = _emit_count;
+
+    // the whole range the set was made with, every pass binds it
+    auto a = ring.allocate(max_emitters * sizeof(emitter));
+    if(!a.has_value()) {
+        _emitter_offset = UINT32_MAX;
+        return;
+    }
+
+    memcpy(a->data, _emitters.data(), _emitters.size() * sizeof(emitter));
+    _emitter_offset = a->offset;
+}
+
+void particle_system::run(
+    VkCommandBuffer command_buffer, const stage_pipelines& pipelines,
+    const pass_constants& constants, uint32_t stage, uint32_t threads)
+{
+    const vkpipeline& pipeline = pipelines.get(stage);
+
+    // same layout for every stage, the sets stay bound
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle);
+    vkCmdPushConstants(command_buffer, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(command_buffer, (threads + workgroup_size - 1) / workgroup_size, 1, 1);
+    compute_barrier(command_buffer);
+}
+
+void particle_system::dispatch(VkCommandBuffer command_buffer, const stage_pipelines& pipelines) {
+    // no room in the ring this frame, everything stays as it is
+    if(_emitter_offset == UINT32_MAX) return;
+
+    VkPipelineLayout layout = pipelines.get(stage_reset).layout;
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &_compute_sets[_parity], 0, nullptr);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout,
+        vkframe_ring::descriptor_set, 1, &_emitter_set, 1, &_emitter_offset);
+
+    // last frame's draw reads what these passes are about to overwrite
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    pass_constants constants{};
+    memcpy(constants.view, _view, sizeof(_view));
+    constants.emitter_count = uint32_t(_emitters.size());
+    constants.emit_count = _emit_count;
+    constants.capacity = _capacity;
+    constants.delta = _delta;
+    constants.entry_count = _entry_count;
+
+    // the buffers start out as garbage, the first frame fills the dead list
+    if(_needs_reset) {
+        run(command_buffer, pipelines, constants, stage_reset, _capacity);
+        _needs_reset = false;
+    }
+
+    if(_emit_count > 0) run(command_buffer, pipelines, constants, stage_emit, _emit_count);
+    run(command_buffer, pipelines, constants, stage_prepare, 1);
+
+    // as many threads as there are live particles, only the GPU knows
+    const vkpipeline& simulate = pipelines.get(stage_simulate);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulate.handle);
+    vkCmdPushConstants(command_buffer, simulate.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatchIndirect(command_buffer, _args.handle, 0);
+    compute_barrier(command_buffer);
+
+    run(command_buffer, pipelines, constants, stage_finalize, 1);
+
+    if(_sort) {
+        run(command_buffer, pipelines, constants, stage_sort_pad, _entry_count);
+
+        for(uint32_t k = 2; k <= _entry_count; k *= 2) {
+            for(uint32_t j = k / 2; j > 0; j /= 2) {
+                constants.sort_k = k;
+                constants.sort_j = j;
+                run(command_buffer, pipelines, constants, stage_sort_step, _entry_count);
+            }
+        }
+    }
+
+    // the draw reads the particles, the entries and its instance count
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    _parity ^= 1;
+    _delta = 0.0f;
+    _emitters.clear();
+    _emit_count = 0;
+}
+
+void particle_system::draw(
+    draw_queue& queue, VkPipeline pipeline, VkPipelineLayout layout, uint32_t pipeline_id, uint8_t layer)
+{
+    // dispatch() skips the frame, the args may not be written yet
+    if(_emitter_offset == UINT32_MAX) return;
+
+    float camera[32];
+    memcpy(camera, _view, sizeof(_view));
+    memcpy(camera + 16, _projection, sizeof(_projection));
+
+    draw_packet packet{};
+    packet.key = draw_queue::make_key(layer, pipeline_id, 0, 0.0f, 1.0f);
+    packet.pipeline = pipeline;
+    packet.layout = layout;
+    packet.material = _draw_set;
+    packet.indirect_buffer = _args.handle;
+    packet.indirect_offset = draw_args_offset;
+    packet.push_stages = VK_SHADER_STAGE_VERTEX_BIT;
+    packet.push_offset = queue.push_data(camera, sizeof(camera));
+    packet.push_size = sizeof(camera);
+    queue.push(packet);
+}
+
+uint32_t particle_system::capacity() const {
+    return _capacity;
+}
+
+const particle_system::stats& particle_system::get_stats() const {
+    return _stats;
+}
+
+void core::register_particles(world& w, particle_system& particles) {
+    w.add_update_system([&particles](world& w) {
+        float delta = w.get_resource<world::delta_time>();
+        particles.advance(delta);
+
+        auto& registry = w.get_registry();
+        auto view = registry.view<const components::transform, components::particle_emitter>();
+
+        for(auto [entity, transform, emitter] : view.each()) {
+            emitter.pending += emitter.rate * delta;
+            uint32_t count = uint32_t(emitter.pending);
+            emitter.pending -= float(count);
+
+            particles.emit(transform.position, emitter, count);
+        }
+    });
+}
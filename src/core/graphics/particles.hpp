@@ -0,0 +1,159 @@
+#pragma once
+
+#include "core/graphics/draw_queue.hpp"
+#include "core/vulkan/vkbuffer.hpp"
+#include "core/vulkan/vkframe_ring.hpp"
+#include "core/vulkan/vkpipeline_variants.hpp"
+#include "core/ecs/world.hpp"
+#include "components/components.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // particles that only exist on the GPU. the CPU hands over how many
+    // each emitter spawns this frame, particles.comp does the rest:
+    //
+    //   emit       pops free slots off the dead list into the alive list
+    //   prepare    sizes the simulate dispatch from the alive count
+    //   simulate   integrates, dead ones go back on the dead list and the
+    //              rest are packed into the other alive list
+    //   finalize   writes the instance count of the indirect draw
+    //   sort       optional bitonic sort, back to front for blending
+    //
+    // the alive lists swap every frame. the state carries over between
+    // frames, which queue submission order keeps in sequence, so there's
+    // one copy of it and not one per frame in flight
+    class particle_system {
+    public:
+        // set 1 of particles.comp, std430
+        struct emitter {
+            float position[3];
+            float lifetime;
+            float speed;
+            float spread;
+            float size;
+            uint32_t color;
+            uint32_t first;
+            uint32_t count;
+            uint32_t seed;
+            uint32_t padding;
+        };
+
+        struct stats {
+            uint32_t emitters;
+            // asked for this frame, the GPU drops them if it's full
+            uint32_t emitted;
+            // past max_emitters, not sent
+            uint32_t dropped_emitters;
+        };
+
+        static const uint32_t max_emitters = 1024;
+
+        // particles.comp's stage constant, a pipeline per pass
+        using stage_variants = variant_set<spec_option<0, 7>>;
+        using stage_pipelines = vkpipeline_variants<stage_variants>;
+
+    private:
+        struct gpu_particle {
+            float position_age[4];
+            float velocity_lifetime[4];
+            uint32_t color_size[4];
+        };
+
+        // particles.comp's push constants
+        struct pass_constants {
+            float view[16];
+            uint32_t emitter_count;
+            uint32_t emit_count;
+            uint32_t capacity;
+            float delta;
+            uint32_t sort_j, sort_k;
+            uint32_t entry_count;
+        };
+
+        VkDevice _device;
+        uint32_t _capacity;
+        // capacity rounded up to a power of two, for the sort
+        uint32_t _entry_count;
+        bool _sort;
+
+        vkbuffer _particles;
+        vkbuffer _lists[2];
+        vkbuffer _dead;
+        vkbuffer _args;
+        vkbuffer _entries;
+
+        VkDescriptorPool _descriptor_pool;
+        // [parity], which list is current
+        VkDescriptorSet _compute_sets[2];
+        VkDescriptorSet _draw_set;
+        VkDescriptorSet _emitter_set;
+
+        uint32_t _parity;
+        bool _needs_reset;
+        float _delta;
+        uint32_t _seed;
+
+        float _view[16], _projection[16];
+
+        std::vector<emitter> _emitters;
+        uint32_t _emit_count;
+        stats _stats;
+
+        // this frame's emitters, bound at set 1 of every pass
+        uint32_t _emitter_offset;
+
+        void run(VkCommandBuffer, const stage_pipelines&, const pass_constants&, uint32_t stage, uint32_t threads);
+
+    public:
+        // compute_layout and emitter_layout are sets 0 and 1 of the
+        // particles.comp pipelines, draw_layout set 0 of the particle
+        // draw pipeline
+        particle_system(
+            VkDevice,
+            VkPhysicalDevice,
+            vkframe_ring&,
+            VkDescriptorSetLayout compute_layout,
+            VkDescriptorSetLayout emitter_layout,
+            VkDescriptorSetLayout draw_layout,
+            uint32_t capacity = 1 << 20,
+            bool sort = true);
+        ~particle_system();
+
+        particle_system(const particle_system&) = delete;
+        particle_system& operator=(const particle_system&) = delete;
+
+        // column major, see light_clusters::perspective
+        void set_camera(const float view[16], const float projection[16]);
+
+        // spawns count particles at position this frame
+        void emit(const structs::vector3& position, const components::particle_emitter&, uint32_t count);
+
+        // time the next dispatch simulates, adds up if it's called more
+        // than once in between
+        void advance(float delta);
+
+        // writes the frame's emitters into the ring, after wait_frame()
+        void flush(vkframe_ring&);
+
+        // every pass of the frame, outside of any render pass. every
+        // stage has to be prewarmed
+        void dispatch(VkCommandBuffer, const stage_pipelines&);
+
+        // one indirect draw of every live particle, its instance count is
+        // written by dispatch()
+        void draw(draw_queue&, VkPipeline, VkPipelineLayout, uint32_t pipeline_id, uint8_t layer);
+
+        uint32_t capacity() const;
+        const stats& get_stats() const;
+    };
+
+    // spawns particles at every entity with a transform and a
+    // components::particle_emitter, at the emitter's rate. particles has
+    // to outlive the world's updates
+    void register_particles(world&, particle_system&);
+}
@@ -0,0 +1,788 @@
+#include "./render_graph.hpp"
+
+#include "core/vulkan/vkutils.hpp"
+#include "core/vulkan/vkmemory.hpp"
+#include "utils/assert.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+
+using namespace core;
+
+render_graph::render_graph()
+    : _device(VK_NULL_HANDLE), _physical_device(VK_NULL_HANDLE), _dynamic_rendering(false),
+      _begin_rendering(nullptr), _end_rendering(nullptr), _stats{}, _compiled(false)
+{}
+
+render_graph::render_graph(VkDevice device, VkPhysicalDevice physical_device, bool dynamic_rendering)
+    : render_graph()
+{
+    _device = device;
+    _physical_device = physical_device;
+    _dynamic_rendering = dynamic_rendering;
+
+    if(_dynamic_rendering) {
+        // core in 1.3, an extension before that
+        _begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdBeginRendering"));
+        _end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdEndRendering"));
+
+        if(!_begin_rendering || !_end_rendering) {
+            _begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+                vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+            _end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+                vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+        }
+
+        _dynamic_rendering = _begin_rendering && _end_rendering;
+    }
+}
+
+// DECLARING
+
+render_graph::resource_id render_graph::create_image(std::string name, VkFormat format, VkExtent2D extent) {
+    resource r{};
+    r.name = std::move(name);
+    r.imported = false;
+    r.format = format;
+    r.extent = extent;
+    r.final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    _resources.push_back(std::move(r));
+    return _resources.size() - 1;
+}
+
+render_graph::resource_id render_graph::import_image(
+    std::string name, VkFormat format, VkExtent2D extent,
+    VkImageLayout initial_layout, VkImageLayout final_layout
+) {
+    resource r{};
+    r.name = std::move(name);
+    r.imported = true;
+    r.format = format;
+    r.extent = extent;
+    // whoever handed it over (eg. the acquire semaphore) synchronized
+    // somewhere in the pipeline, so the first barrier waits on everything
+    r.initial_state = { initial_layout, 0, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+    r.final_layout = final_layout;
+
+    _resources.push_back(std::move(r));
+    return _resources.size() - 1;
+}
+
+void render_graph::bind_image(resource_id id, VkImage image, VkImageView view) {
+    ASSERT(_resources[id].imported, "Only imported images can be bound");
+    _resources[id].image = image;
+    _resources[id].view = view;
+}
+
+render_graph::pass_id render_graph::add_pass(std::string name, execute_callback execute) {
+    ASSERT(!_compiled, "Passes can't be added to a compiled graph");
+
+    pass p{};
+    p.name = std::move(name);
+    p.execute = std::move(execute);
+    p.render_pass = VK_NULL_HANDLE;
+
+    _passes.push_back(std::move(p));
+    return _passes.size() - 1;
+}
+
+void render_graph::write_color(pass_id p, resource_id r, VkAttachmentLoadOp load_op, VkClearColorValue clear) {
+    resource_use u{};
+    u.resource = r;
+    u.type = access::color_write;
+    u.load_op = load_op;
+    u.clear.color = clear;
+    _passes[p].uses.push_back(u);
+}
+
+void render_graph::write_depth(pass_id p, resource_id r, VkAttachmentLoadOp load_op, float clear_depth) {
+    resource_use u{};
+    u.resource = r;
+    u.type = access::depth_write;
+    u.load_op = load_op;
+    u.clear.depthStencil = { clear_depth, 0 };
+    _passes[p].uses.push_back(u);
+}
+
+void render_graph::use(pass_id p, resource_id r, access type) {
+    ASSERT(type != access::color_write && type != access::depth_write,
+        "Attachment writes go through write_color/write_depth");
+
+    resource_use u{};
+    u.resource = r;
+    u.type = type;
+    u.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+    _passes[p].uses.push_back(u);
+}
+
+void render_graph::keep(pass_id p) {
+    _passes[p].side_effects = true;
+}
+
+void render_graph::secondary_contents(pass_id p) {
+    _passes[p].secondary = true;
+}
+
+// COMPILING
+
+void render_graph::compile() {
+    ASSERT(!_compiled, "Graph was already compiled");
+
+    for(auto& p : _passes) {
+        for(size_t i = 0; i < p.uses.size(); i++) {
+            for(size_t j = i + 1; j < p.uses.size(); j++) {
+                ASSERT(p.uses[i].resource != p.uses[j].resource, "A pass uses the same image twice");
+            }
+        }
+    }
+
+    cull();
+    create_transients();
+    alias_transients();
+    plan_barriers();
+
+    if(!_dynamic_rendering) {
+        for(auto& p : _passes) {
+            if(!p.culled) create_render_pass(p);
+        }
+    }
+
+    _stats.pass_count = _passes.size();
+    _compiled = true;
+
+    LOG("[GRAPH] %u passes (%u culled), %u barriers, %u transients in %lu KiB (%lu KiB unaliased)",
+        _stats.pass_count, _stats.culled_passes, _stats.barrier_count, _stats.transient_count,
+        _stats.allocated_bytes / 1024, _stats.transient_bytes / 1024);
+}
+
+// walks back from the outputs: a pass is needed if it writes something
+// that's needed later, and whatever a needed pass reads becomes needed
+void render_graph::cull() {
+    std::vector<bool> needed(_resources.size(), false);
+    for(size_t r = 0; r < _resources.size(); r++) {
+        needed[r] = _resources[r].imported && _resources[r].final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    _stats.culled_passes = 0;
+
+    for(size_t i = _passes.size(); i-- > 0;) {
+        auto& p = _passes[i];
+
+        bool writes_needed = false;
+        for(auto& u : p.uses) {
+            writes_needed |= is_write(u.type) && needed[u.resource];
+        }
+
+        p.culled = !p.side_effects && !writes_needed;
+        if(p.culled) {
+            _stats.culled_passes++;
+            continue;
+        }
+
+        // a full overwrite doesn't care what was there before, so earlier
+        // writers aren't needed just because of it
+        for(auto& u : p.uses) {
+            if(is_attachment(u.type) && u.load_op != VK_ATTACHMENT_LOAD_OP_LOAD) needed[u.resource] = false;
+        }
+        for(auto& u : p.uses) {
+            if(!is_attachment(u.type) || u.load_op == VK_ATTACHMENT_LOAD_OP_LOAD) needed[u.resource] = true;
+        }
+    }
+}
+
+void render_graph::create_transients() {
+    for(auto& r : _resources) {
+        r.first_use = -1;
+        r.last_use = -1;
+        r.usage = 0;
+    }
+
+    for(size_t i = 0; i < _passes.size(); i++) {
+        auto& p = _passes[i];
+        if(p.culled) continue;
+
+        for(auto& u : p.uses) {
+            auto& r = _resources[u.resource];
+            if(r.first_use < 0) r.first_use = i;
+            r.last_use = i;
+
+            switch(u.type) {
+                case access::color_write:   r.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+                case access::depth_write:   r.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+                case access::depth_read:    r.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; break;
+                case access::sampled:       r.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+                case access::storage_read:
+                case access::storage_write: r.usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+                case access::transfer_src:  r.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; break;
+                case access::transfer_dst:  r.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; break;
+            }
+        }
+    }
+
+    _stats.transient_count = 0;
+    _stats.transient_bytes = 0;
+
+    for(auto& r : _resources) {
+        // only used by culled passes, never created
+        if(r.imported || r.first_use < 0) continue;
+
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = r.format;
+        image_info.extent = { r.extent.width, r.extent.height, 1 };
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = r.usage;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VK_ASSERT(vkCreateImage(_device, &image_info, nullptr, &r.image));
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(_device, r.image, &requirements);
+
+        // offsets are always 0, so alignment only matters for the size
+        r.size = (requirements.size + requirements.alignment - 1) & ~(requirements.alignment - 1);
+        r.memory_type_bits = requirements.memoryTypeBits;
+
+        _stats.transient_count++;
+        _stats.transient_bytes += r.size;
+    }
+}
+
+// greedy: biggest images first, each one goes into the first block whose
+// users are all dead by the time it's needed (or born after it's done)
+void render_graph::alias_transients() {
+    std::vector<resource_id> order;
+    for(resource_id r = 0; r < _resources.size(); r++) {
+        if(!_resources[r].imported && _resources[r].first_use >= 0) order.push_back(r);
+    }
+
+    std::sort(order.begin(), order.end(), [&](resource_id a, resource_id b) {
+        return _resources[a].size > _resources[b].size;
+    });
+
+    for(auto id : order) {
+        auto& r = _resources[id];
+        memory_block* target = nullptr;
+
+        for(auto& block : _blocks) {
+            if(!(block.memory_type_bits & r.memory_type_bits) || block.size < r.size) continue;
+
+            bool overlaps = false;
+            for(auto other : block.users) {
+                auto& o = _resources[other];
+                overlaps |= r.first_use <= o.last_use && o.first_use <= r.last_use;
+            }
+
+            if(!overlaps) {
+                target = &block;
+                break;
+            }
+        }
+
+        if(target == nullptr) {
+            _blocks.push_back({ VK_NULL_HANDLE, r.size, r.memory_type_bits, {} });
+            target = &_blocks.back();
+        }
+
+        target->memory_type_bits &= r.memory_type_bits;
+        target->users.push_back(id);
+    }
+
+    _stats.allocated_bytes = 0;
+
+    for(auto& block : _blocks) {
+        VkMemoryAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocate_info.allocationSize = block.size;
+        allocate_info.memoryTypeIndex = vkutils::find_memory_type(
+            _physical_device, block.memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        block.memory = vkmemory::allocate(_device, allocate_info, vkmemory::category::render_target);
+        _stats.allocated_bytes += block.size;
+
+        for(auto id : block.users) {
+            auto& r = _resources[id];
+            VK_ASSERT(vkBindImageMemory(_device, r.image, block.memory, 0));
+
+            VkImageViewCreateInfo view_info{};
+            view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            view_info.image = r.image;
+            view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view_info.format = r.format;
+            view_info.subresourceRange.aspectMask =
+                is_depth_format(r.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            view_info.subresourceRange.levelCount = 1;
+            view_info.subresourceRange.layerCount = 1;
+
+            VK_ASSERT(vkCreateImageView(_device, &view_info, nullptr, &r.view));
+        }
+    }
+}
+
+// replays the frame tracking each image's layout/access/stages, and puts
+// a barrier only where a hazard shows up: a layout change, or a write
+// on either side. reads after reads just widen the stages a later write
+// has to wait for
+void render_graph::plan_barriers() {
+    std::vector<state> current(_resources.size());
+
+    for(size_t r = 0; r < _resources.size(); r++) {
+        // transients start every frame from nothing, but their memory may
+        // have just been written through an alias (or by the previous
+        // frame), so the first barrier waits on all earlier writes
+        current[r] = _resources[r].imported
+            ? _resources[r].initial_state
+            : state{ VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_MEMORY_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+    }
+
+    _stats.barrier_count = 0;
+
+    for(size_t i = 0; i < _passes.size(); i++) {
+        auto& p = _passes[i];
+        if(p.culled) continue;
+
+        p.barriers.clear();
+        p.store_ops.clear();
+        p.extent = { 0, 0 };
+
+        for(auto& u : p.uses) {
+            auto& r = _resources[u.resource];
+            auto& cur = current[u.resource];
+            state next = state_for(u.type);
+
+            const VkAccessFlags write_bits =
+                VK_ACCESS_SHADER_WRITE_BIT |
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                VK_ACCESS_TRANSFER_WRITE_BIT |
+                VK_ACCESS_MEMORY_WRITE_BIT;
+
+            bool hazard = cur.layout != next.layout || (cur.access & write_bits) || is_write(u.type);
+
+            if(hazard) {
+                barrier b{};
+                b.resource = u.resource;
+                // old contents get thrown away anyway, skip preserving them
+                b.old_layout = is_attachment(u.type) && u.load_op != VK_ATTACHMENT_LOAD_OP_LOAD
+                    ? VK_IMAGE_LAYOUT_UNDEFINED : cur.layout;
+                b.new_layout = next.layout;
+                // write-after-read only needs the execution dependency
+                b.src_access = cur.access & write_bits;
+                b.dst_access = next.access;
+                b.src_stages = cur.stages;
+                b.dst_stages = next.stages;
+
+                p.barriers.push_back(b);
+                _stats.barrier_count++;
+
+                cur = next;
+            } else {
+                cur.access |= next.access;
+                cur.stages |= next.stages;
+            }
+
+            if(is_attachment(u.type)) {
+                ASSERT(p.extent.width == 0 ||
+                    (p.extent.width == r.extent.width && p.extent.height == r.extent.height),
+                    "Attachments of a pass must have the same size");
+                p.extent = r.extent;
+
+                // nobody reads it after this pass, so the tile memory never
+                // has to be written back
+                bool read_later = r.imported || r.last_use > int(i);
+                p.store_ops.push_back(read_later ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+            }
+        }
+    }
+
+    _final_barriers.clear();
+    for(resource_id id = 0; id < _resources.size(); id++) {
+        auto& r = _resources[id];
+        if(!r.imported || r.final_layout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+
+        auto& cur = current[id];
+        if(cur.layout == r.final_layout) continue;
+
+        barrier b{};
+        b.resource = id;
+        b.old_layout = cur.layout;
+        b.new_layout = r.final_layout;
+        b.src_access = cur.access;
+        b.dst_access = 0;
+        b.src_stages = cur.stages;
+        b.dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        _final_barriers.push_back(b);
+        _stats.barrier_count++;
+    }
+}
+
+// without dynamic rendering: one single-subpass render pass per graph
+// pass. the graph already moved the attachments to the right layouts
+void render_graph::create_render_pass(pass& p) {
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> color_refs;
+    VkAttachmentReference depth_ref{};
+    bool has_depth = false;
+
+    size_t attachment_index = 0;
+    for(auto& u : p.uses) {
+        if(!is_attachment(u.type)) continue;
+
+        auto& r = _resources[u.resource];
+        VkImageLayout layout = state_for(u.type).layout;
+
+        VkAttachmentDescription attachment{};
+        attachment.format = r.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = u.load_op;
+        attachment.storeOp = p.store_ops[attachment_index];
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = layout;
+        attachment.finalLayout = layout;
+
+        VkAttachmentReference ref{};
+        ref.attachment = attachments.size();
+        ref.layout = layout;
+
+        if(u.type == access::color_write) {
+            color_refs.push_back(ref);
+        } else {
+            depth_ref = ref;
+            has_depth = true;
+        }
+
+        attachments.push_back(attachment);
+        attachment_index++;
+    }
+
+    // passes without attachments (compute, copies) run outside render passes
+    if(attachments.empty()) return;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = color_refs.size();
+    subpass.pColorAttachments = color_refs.data();
+    subpass.pDepthStencilAttachment = has_depth ? &depth_ref : nullptr;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = attachments.size();
+    render_pass_info.pAttachments = attachments.data();
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+
+    VK_ASSERT(vkCreateRenderPass(_device, &render_pass_info, nullptr, &p.render_pass));
+}
+
+// EXECUTING
+
+void render_graph::execute(VkCommandBuffer command_buffer) {
+    ASSERT(_compiled, "Graph must be compiled before executing");
+
+    for(auto& p : _passes) {
+        if(p.culled) continue;
+
+        emit_barriers(command_buffer, p.barriers);
+
+        bool renders = !p.store_ops.empty();
+        if(renders) begin_rendering(command_buffer, p);
+
+        if(p.execute) p.execute(command_buffer);
+
+        if(renders) end_rendering(command_buffer, p);
+    }
+
+    emit_barriers(command_buffer, _final_barriers);
+}
+
+// a pass' barriers all go in one call
+void render_graph::emit_barriers(VkCommandBuffer command_buffer, const std::vector<barrier>& barriers) {
+    if(barriers.empty()) return;
+
+    _barrier_scratch.clear();
+    VkPipelineStageFlags src_stages = 0, dst_stages = 0;
+
+    for(auto& b : barriers) {
+        auto& r = _resources[b.resource];
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = b.old_layout;
+        barrier.newLayout = b.new_layout;
+        barrier.srcAccessMask = b.src_access;
+        barrier.dstAccessMask = b.dst_access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = r.image;
+        barrier.subresourceRange.aspectMask =
+            is_depth_format(r.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+
+        _barrier_scratch.push_back(barrier);
+        src_stages |= b.src_stages;
+        dst_stages |= b.dst_stages;
+    }
+
+    vkCmdPipelineBarrier(
+        command_buffer, src_stages, dst_stages, 0,
+        0, nullptr, 0, nullptr,
+        _barrier_scratch.size(), _barrier_scratch.data());
+}
+
+void render_graph::begin_rendering(VkCommandBuffer command_buffer, pass& p) {
+    VkRect2D area{ { 0, 0 }, p.extent };
+
+    if(!_dynamic_rendering) {
+        _clear_scratch.clear();
+        for(auto& u : p.uses) {
+            if(is_attachment(u.type)) _clear_scratch.push_back(u.clear);
+        }
+
+        VkRenderPassBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        begin_info.renderPass = p.render_pass;
+        begin_info.framebuffer = get_framebuffer(p);
+        begin_info.renderArea = area;
+        begin_info.clearValueCount = _clear_scratch.size();
+        begin_info.pClearValues = _clear_scratch.data();
+
+        vkCmdBeginRenderPass(
+            command_buffer, &begin_info,
+            p.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+
+    // depth goes last, so growing the scratch never moves the colors
+    _attachment_scratch.clear();
+    int depth_index = -1;
+    size_t attachment_index = 0;
+
+    for(auto& u : p.uses) {
+        if(!is_attachment(u.type)) continue;
+
+        VkRenderingAttachmentInfoKHR attachment{};
+        attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        attachment.imageView = _resources[u.resource].view;
+        attachment.imageLayout = state_for(u.type).layout;
+        attachment.loadOp = u.load_op;
+        attachment.storeOp = p.store_ops[attachment_index++];
+        attachment.clearValue = u.clear;
+
+        if(u.type == access::depth_write) {
+            depth_index = attachment_index - 1;
+        }
+        _attachment_scratch.push_back(attachment);
+    }
+
+    if(depth_index >= 0) {
+        std::rotate(
+            _attachment_scratch.begin() + depth_index,
+            _attachment_scratch.begin() + depth_index + 1,
+            _attachment_scratch.end());
+    }
+
+    uint32_t color_count = _attachment_scratch.size() - (depth_index >= 0 ? 1 : 0);
+
+    VkRenderingInfoKHR rendering_info{};
+    rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    rendering_info.flags = p.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    rendering_info.renderArea = area;
+    rendering_info.layerCount = 1;
+    rendering_info.colorAttachmentCount = color_count;
+    rendering_info.pColorAttachments = _attachment_scratch.data();
+    rendering_info.pDepthAttachment = depth_index >= 0 ? &_attachment_scratch.back() : nullptr;
+
+    _begin_rendering(command_buffer, &rendering_info);
+}
+
+void render_graph::end_rendering(VkCommandBuffer command_buffer, pass&) {
+    if(_dynamic_rendering) {
+        _end_rendering(command_buffer);
+    } else {
+        vkCmdEndRenderPass(command_buffer);
+    }
+}
+
+// imported views change from frame to frame (one per swapchain image),
+// so framebuffers get made the first time a set of views shows up
+VkFramebuffer render_graph::get_framebuffer(pass& p) {
+    _view_scratch.clear();
+    for(auto& u : p.uses) {
+        if(is_attachment(u.type)) _view_scratch.push_back(_resources[u.resource].view);
+    }
+
+    for(auto& f : p.framebuffers) {
+        if(f.views == _view_scratch) return f.handle;
+    }
+
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = p.render_pass;
+    framebuffer_info.attachmentCount = _view_scratch.size();
+    framebuffer_info.pAttachments = _view_scratch.data();
+    framebuffer_info.width = p.extent.width;
+    framebuffer_info.height = p.extent.height;
+    framebuffer_info.layers = 1;
+
+    framebuffer f{ _view_scratch, VK_NULL_HANDLE };
+    VK_ASSERT(vkCreateFramebuffer(_device, &framebuffer_info, nullptr, &f.handle));
+
+    p.framebuffers.push_back(std::move(f));
+    return p.framebuffers.back().handle;
+}
+
+// QUERIES
+
+structs::render_target_info render_graph::target_info(pass_id id) const {
+    ASSERT(_compiled, "Graph must be compiled first");
+
+    auto& p = _passes[id];
+    structs::render_target_info info;
+    info.render_pass = p.render_pass;
+
+    for(auto& u : p.uses) {
+        if(u.type == access::color_write) info.color_formats.push_back(_resources[u.resource].format);
+        if(u.type == access::depth_write) info.depth_format = _resources[u.resource].format;
+    }
+
+    return info;
+}
+
+VkImageView render_graph::view(resource_id id) const {
+    return _resources[id].view;
+}
+
+bool render_graph::is_culled(pass_id id) const {
+    return _passes[id].culled;
+}
+
+const render_graph::stats& render_graph::get_stats() const {
+    return _stats;
+}
+
+void render_graph::forget() {
+    _passes.clear();
+    _resources.clear();
+    _blocks.clear();
+    _final_barriers.clear();
+    _stats = {};
+    _compiled = false;
+}
+
+void render_graph::destroy(vkdeletion_queue& deletions) {
+    for(auto& p : _passes) {
+        for(auto& f : p.framebuffers) deletions.retire(f.handle);
+        deletions.retire(p.render_pass);
+    }
+
+    for(auto& r : _resources) {
+        if(r.imported || r.image == VK_NULL_HANDLE) continue;
+        deletions.retire(r.view);
+        deletions.retire(r.image);
+    }
+
+    for(auto& block : _blocks) {
+        deletions.retire(block.memory);
+    }
+
+    forget();
+}
+
+void render_graph::destroy() {
+    for(auto& p : _passes) {
+        for(auto& f : p.framebuffers) vkDestroyFramebuffer(_device, f.handle, nullptr);
+        if(p.render_pass != VK_NULL_HANDLE) vkDestroyRenderPass(_device, p.render_pass, nullptr);
+    }
+
+    for(auto& r : _resources) {
+        if(r.imported || r.image == VK_NULL_HANDLE) continue;
+        vkDestroyImageView(_device, r.view, nullptr);
+        vkDestroyImage(_device, r.image, nullptr);
+    }
+
+    for(auto& block : _blocks) {
+        vkmemory::free(_device, block.memory);
+    }
+
+    forget();
+}
+
+// HELPERS
+
+render_graph::state render_graph::state_for(access type) {
+    switch(type) {
+        case access::color_write:
+            return {
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+            };
+        case access::depth_write:
+            return {
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+            };
+        case access::depth_read:
+            return {
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+            };
+        case access::sampled:
+            return {
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            };
+        case access::storage_read:
+            return {
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            };
+        case access::storage_write:
+            return {
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            };
+        case access::transfer_src:
+            return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+        case access::transfer_dst:
+            return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+    }
+
+    return { VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+}
+
+bool render_graph::is_write(access type) {
+    return
+        type == access::color_write ||
+        type == access::depth_write ||
+        type == access::storage_write ||
+        type == access::transfer_dst;
+}
+
+bool render_graph::is_attachment(access type) {
+    return type == access::color_write || type == access::depth_write;
+}
+
+bool render_graph::is_depth_format(VkFormat format) {
+    return
+        format == VK_FORMAT_D16_UNORM ||
+        format == VK_FORMAT_D32_SFLOAT ||
+        format == VK_FORMAT_D24_UNORM_S8_UINT ||
+        format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
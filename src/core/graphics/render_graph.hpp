@@ -0,0 +1,203 @@
+#pragma once
+
+#include "core/vulkan/vkstructs.hpp"
+#include "core/vulkan/vkdeletion_queue.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace core {
+    // a frame described as passes that say which images they read and
+    // write. compile() works out everything in between:
+    //
+    //  - passes whose results nobody uses are dropped
+    //  - layout transitions and barriers, only where a hazard exists
+    //  - transient images with lifetimes that don't overlap share memory
+    //  - dynamic rendering when the device has it, render passes otherwise
+    //
+    // the graph is built and compiled once (and again when the swapchain
+    // changes), then executed every frame, which doesn't allocate
+    class render_graph {
+    public:
+        using resource_id = uint32_t;
+        using pass_id = uint32_t;
+        using execute_callback = std::function<void(VkCommandBuffer)>;
+
+        enum class access {
+            color_write,
+            depth_write,
+            depth_read,
+            sampled,
+            storage_read,
+            storage_write,
+            transfer_src,
+            transfer_dst,
+        };
+
+        struct stats {
+            uint32_t pass_count;
+            uint32_t culled_passes;
+            // per execute
+            uint32_t barrier_count;
+            uint32_t transient_count;
+            // what transients would take each on their own, and what they
+            // take sharing memory
+            VkDeviceSize transient_bytes;
+            VkDeviceSize allocated_bytes;
+        };
+
+    private:
+        struct state {
+            VkImageLayout layout;
+            VkAccessFlags access;
+            VkPipelineStageFlags stages;
+        };
+
+        struct resource {
+            std::string name;
+            bool imported;
+            VkFormat format;
+            VkExtent2D extent;
+
+            // imported images come as initial_state and leave in final_layout
+            state initial_state;
+            VkImageLayout final_layout;
+
+            VkImage image;
+            VkImageView view;
+
+            // compiled, only for transients
+            VkImageUsageFlags usage;
+            VkDeviceSize size;
+            uint32_t memory_type_bits;
+            int first_use, last_use;
+        };
+
+        struct resource_use {
+            resource_id resource;
+            access type;
+            VkAttachmentLoadOp load_op;
+            VkClearValue clear;
+        };
+
+        struct barrier {
+            resource_id resource;
+            VkImageLayout old_layout, new_layout;
+            VkAccessFlags src_access, dst_access;
+            VkPipelineStageFlags src_stages, dst_stages;
+        };
+
+        struct framebuffer {
+            std::vector<VkImageView> views;
+            VkFramebuffer handle;
+        };
+
+        struct pass {
+            std::string name;
+            execute_callback execute;
+            std::vector<resource_use> uses;
+            bool side_effects;
+            bool secondary;
+
+            // compiled
+            bool culled;
+            std::vector<barrier> barriers;
+            std::vector<VkAttachmentStoreOp> store_ops;
+            VkExtent2D extent;
+            VkRenderPass render_pass;
+            std::vector<framebuffer> framebuffers;
+        };
+
+        struct memory_block {
+            VkDeviceMemory memory;
+            VkDeviceSize size;
+            uint32_t memory_type_bits;
+            std::vector<resource_id> users;
+        };
+
+        VkDevice _device;
+        VkPhysicalDevice _physical_device;
+        bool _dynamic_rendering;
+
+        PFN_vkCmdBeginRenderingKHR _begin_rendering;
+        PFN_vkCmdEndRenderingKHR _end_rendering;
+
+        std::vector<resource> _resources;
+        std::vector<pass> _passes;
+        std::vector<memory_block> _blocks;
+        std::vector<barrier> _final_barriers;
+        stats _stats;
+        bool _compiled;
+
+        // scratch for execute()
+        std::vector<VkImageMemoryBarrier> _barrier_scratch;
+        std::vector<VkRenderingAttachmentInfoKHR> _attachment_scratch;
+        std::vector<VkClearValue> _clear_scratch;
+        std::vector<VkImageView> _view_scratch;
+
+        void cull();
+        void create_transients();
+        void alias_transients();
+        void plan_barriers();
+        void create_render_pass(pass&);
+
+        void emit_barriers(VkCommandBuffer, const std::vector<barrier>&);
+        void begin_rendering(VkCommandBuffer, pass&);
+        void end_rendering(VkCommandBuffer, pass&);
+        VkFramebuffer get_framebuffer(pass&);
+        // drops every pass and resource, after they were destroyed
+        void forget();
+
+        static state state_for(access);
+        static bool is_write(access);
+        static bool is_attachment(access);
+        static bool is_depth_format(VkFormat);
+
+    public:
+        render_graph();
+        render_graph(VkDevice, VkPhysicalDevice, bool dynamic_rendering);
+
+        // lives only inside the graph, usage is worked out from the passes
+        resource_id create_image(std::string name, VkFormat, VkExtent2D);
+
+        // owned by someone else (eg. the swapchain), bind the actual image
+        // before every execute(). a final layout other than undefined marks
+        // it as an output of the graph
+        resource_id import_image(
+            std::string name, VkFormat, VkExtent2D,
+            VkImageLayout initial_layout, VkImageLayout final_layout);
+        void bind_image(resource_id, VkImage, VkImageView);
+
+        pass_id add_pass(std::string name, execute_callback);
+
+        void write_color(pass_id, resource_id, VkAttachmentLoadOp, VkClearColorValue = {});
+        void write_depth(pass_id, resource_id, VkAttachmentLoadOp, float clear_depth = 1.0f);
+        // anything that isn't an attachment write
+        void use(pass_id, resource_id, access);
+        // for passes with results outside the graph, never culled
+        void keep(pass_id);
+        // the pass records into secondary command buffers (eg. through a
+        // vkrecorder) instead of the graph's command buffer
+        void secondary_contents(pass_id);
+
+        void compile();
+        void execute(VkCommandBuffer);
+
+        // for pipelines that draw in this pass
+        structs::render_target_info target_info(pass_id) const;
+        // a transient's view, to sample it in a later pass
+        VkImageView view(resource_id) const;
+        bool is_culled(pass_id) const;
+        const stats& get_stats() const;
+
+        // frees everything and forgets every pass and resource
+        void destroy();
+        // same, once the frames that used them are done
+        void destroy(vkdeletion_queue&);
+    };
+}
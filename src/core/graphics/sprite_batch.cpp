@@ -0,0 +1,311 @@
+#include "./sprite_batch.hpp"
+
+#include "core/vulkan/vkutils.hpp"
+#include "core/vulkan/vkmemory.hpp"
+#include "utils/assert.hpp"
+
+#include <cstring>
+#include <cstddef>
+
+using namespace core;
+
+structs::vertex_layout sprite_batch::vertex_layout() {
+    structs::vertex_layout layout;
+
+    layout.bindings.push_back({ 0, sizeof(instance), VK_VERTEX_INPUT_RATE_INSTANCE });
+
+    layout.attributes.push_back({ 0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(instance, position) });
+    layout.attributes.push_back({ 1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(instance, size) });
+    layout.attributes.push_back({ 2, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(instance, uv) });
+    layout.attributes.push_back({ 3, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(instance, color) });
+    layout.attributes.push_back({ 4, 0, VK_FORMAT_R32_SFLOAT, offsetof(instance, rotation) });
+
+    return layout;
+}
+
+sprite_batch::sprite_batch(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    VkQueue queue,
+    VkCommandPool command_pool,
+    VkDescriptorSetLayout set_layout
+) : _device(device), _physical_device(physical_device), _queue(queue),
+    _command_pool(command_pool), _set_layout(set_layout), _stats{}
+{
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxLod = 0.0f;
+    VK_ASSERT(vkCreateSampler(device, &sampler_info, nullptr, &_sampler));
+
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_size.descriptorCount = max_pages;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = max_pages;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    VK_ASSERT(vkCreateDescriptorPool(device, &pool_info, nullptr, &_descriptor_pool));
+}
+
+sprite_batch::~sprite_batch() {
+    for(auto& p : _pages) {
+        vkDestroyImageView(_device, p.view, nullptr);
+        vkDestroyImage(_device, p.image, nullptr);
+        vkmemory::free(_device, p.memory);
+    }
+
+    // frees the sets too
+    vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+    vkDestroySampler(_device, _sampler, nullptr);
+}
+
+std::optional<sprite_atlas::sprite_id> sprite_batch::add_sprite(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    return _atlas.add(rgba, width, height);
+}
+
+void sprite_batch::upload() {
+    bool any_dirty = false;
+    for(uint32_t i = 0; i < _atlas.page_count(); i++) {
+        any_dirty |= _atlas.get_page(i).dirty;
+    }
+    if(!any_dirty) return;
+
+    // pages being replaced may still be sampled by frames in flight
+    vkQueueWaitIdle(_queue);
+
+    ASSERT(_atlas.page_count() <= max_pages, "Too many sprite atlas pages");
+
+    size_t old_count = _pages.size();
+    for(uint32_t i = 0; i < _atlas.page_count(); i++) {
+        if(_atlas.get_page(i).dirty) upload_page(i);
+    }
+    if(_pages.size() == old_count) return;
+
+    // bins are [layer * page count + page], a new page moves every layer
+    // after the first. sprites drawn before this upload keep their page
+    std::vector<std::vector<instance>> bins(max_layers * _pages.size());
+    for(uint32_t layer = 0; layer < max_layers; layer++) {
+        for(uint32_t page = 0; page < old_count; page++) {
+            bins[layer * _pages.size() + page] = std::move(_bins[layer * old_count + page]);
+        }
+    }
+    _bins = std::move(bins);
+}
+
+void sprite_batch::upload_page(uint32_t index) {
+    auto& source = _atlas.get_page(index);
+    uint32_t size = _atlas.page_size();
+
+    if(index == _pages.size()) {
+        gpu_page p{};
+
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = VK_FORMAT_R8G8B8A8_SRGB;
+        image_info.extent = { size, size, 1 };
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_ASSERT(vkCreateImage(_device, &image_info, nullptr, &p.image));
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(_device, p.image, &requirements);
+
+        VkMemoryAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocate_info.allocationSize = requirements.size;
+        allocate_info.memoryTypeIndex = vkutils::find_memory_type(
+            _physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        p.memory = vkmemory::allocate(_device, allocate_info, vkmemory::category::image);
+        VK_ASSERT(vkBindImageMemory(_device, p.image, p.memory, 0));
+
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = p.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = image_info.format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+        VK_ASSERT(vkCreateImageView(_device, &view_info, nullptr, &p.view));
+
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = _descriptor_pool;
+        set_info.descriptorSetCount = 1;
+        set_info.pSetLayouts = &_set_layout;
+        VK_ASSERT(vkAllocateDescriptorSets(_device, &set_info, &p.set));
+
+        VkDescriptorImageInfo descriptor_image{};
+        descriptor_image.sampler = _sampler;
+        descriptor_image.imageView = p.view;
+        descriptor_image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = p.set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &descriptor_image;
+        vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+
+        _pages.push_back(p);
+    }
+
+    auto& p = _pages[index];
+
+    VkDeviceSize bytes = source.pixels.size();
+    vkbuffer staging(
+        _device, _physical_device, bytes,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    staging.write(_device, source.pixels.data(), bytes);
+
+    VkCommandBuffer command_buffer = vkutils::begin_one_time_commands(_device, _command_pool);
+
+    // the whole page gets rewritten, old contents don't matter
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = p.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { size, size, 1 };
+    vkCmdCopyBufferToImage(
+        command_buffer, staging.handle, p.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkutils::submit_one_time_commands(_device, _command_pool, _queue, command_buffer);
+    staging.destroy(_device);
+
+    source.dirty = false;
+}
+
+void sprite_batch::draw(
+    sprite_atlas::sprite_id sprite,
+    float x, float y, float width, float height,
+    structs::color color, float rotation, uint8_t layer
+) {
+    auto& r = _atlas.get(sprite);
+    ASSERT(r.page < _pages.size(), "Sprite's atlas page wasn't uploaded");
+    ASSERT(layer < max_layers, "Sprite layer out of range");
+
+    instance i;
+    i.position[0] = x;
+    i.position[1] = y;
+    i.size[0] = width;
+    i.size[1] = height;
+    memcpy(i.uv, r.uv, sizeof(i.uv));
+    i.color = color.packed();
+    i.rotation = rotation;
+
+    _bins[layer * _pages.size() + r.page].push_back(i);
+}
+
+void sprite_batch::draw(const structs::rect& rect, float x, float y, uint8_t layer) {
+    // sprite 0 is the white texel
+    draw(0, x, y, rect.dimensions.w, rect.dimensions.h, rect.color, 0.0f, layer);
+}
+
+void sprite_batch::flush(
+    draw_queue& queue,
+    vkframe_ring& ring,
+    VkPipeline pipeline, VkPipelineLayout layout, uint32_t pipeline_id,
+    VkExtent2D viewport,
+    uint8_t first_layer
+) {
+    _stats = {};
+
+    size_t total = 0;
+    for(auto& bin : _bins) total += bin.size();
+    if(total == 0) return;
+
+    auto instances = ring.allocate(total * sizeof(instance));
+    if(!instances.has_value()) {
+        _stats.dropped = total;
+        for(auto& bin : _bins) bin.clear();
+        return;
+    }
+
+    // pixels to clip space
+    float scale[2] = { 2.0f / viewport.width, 2.0f / viewport.height };
+    uint32_t push_offset = queue.push_data(scale, sizeof(scale));
+
+    auto* out = static_cast<instance*>(instances->data);
+    uint32_t written = 0;
+
+    for(uint32_t layer = 0; layer < max_layers; layer++) {
+        for(uint32_t page = 0; page < _pages.size(); page++) {
+            auto& bin = _bins[layer * _pages.size() + page];
+            if(bin.empty()) continue;
+
+            memcpy(out + written, bin.data(), bin.size() * sizeof(instance));
+
+            draw_packet packet{};
+            packet.key = draw_queue::make_key(first_layer + layer, pipeline_id, page, 0.0f, 1.0f);
+            packet.pipeline = pipeline;
+            packet.layout = layout;
+            packet.material = _pages[page].set;
+            packet.vertex_buffer = instances->buffer;
+            packet.vertex_buffer_offset = instances->offset;
+            // two triangles, the corners come from gl_VertexIndex
+            packet.count = 6;
+            packet.instance_count = bin.size();
+            packet.first_instance = written;
+            packet.push_stages = VK_SHADER_STAGE_VERTEX_BIT;
+            packet.push_offset = push_offset;
+            packet.push_size = sizeof(scale);
+            queue.push(packet);
+
+            written += bin.size();
+            _stats.draws++;
+            bin.clear();
+        }
+    }
+
+    _stats.sprites = written;
+}
+
+sprite_atlas& sprite_batch::atlas() {
+    return _atlas;
+}
+
+const sprite_batch::stats& sprite_batch::get_stats() const {
+    return _stats;
+}
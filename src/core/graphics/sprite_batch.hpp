@@ -0,0 +1,112 @@
+#pragma once
+
+#include "core/graphics/atlas.hpp"
+#include "core/graphics/draw_queue.hpp"
+#include "core/vulkan/vkbuffer.hpp"
+#include "core/vulkan/vkframe_ring.hpp"
+#include "core/vulkan/vkstructs.hpp"
+#include "components/structs.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace core {
+    // 2D path: sprites are instances of one quad, grouped by layer and
+    // atlas page. each group is a single instanced draw, so the draw count
+    // is layers x pages no matter how many sprites there are
+    class sprite_batch {
+    public:
+        // one per sprite, read by sprite.vert as per-instance attributes
+        struct instance {
+            float position[2];  // center, in pixels
+            float size[2];
+            uint16_t uv[4];     // atlas rect, unorm16
+            uint32_t color;     // RGBA8
+            float rotation;     // radians
+        };
+
+        static const uint32_t max_layers = 8;
+
+        struct stats {
+            uint32_t sprites;
+            uint32_t draws;
+            // didn't fit in the frame ring, not drawn
+            uint32_t dropped;
+        };
+
+        static structs::vertex_layout vertex_layout();
+
+    private:
+        struct gpu_page {
+            VkImage image;
+            VkDeviceMemory memory;
+            VkImageView view;
+            VkDescriptorSet set;
+        };
+
+        VkDevice _device;
+        VkPhysicalDevice _physical_device;
+        VkQueue _queue;
+        VkCommandPool _command_pool;
+
+        sprite_atlas _atlas;
+        std::vector<gpu_page> _pages;
+
+        VkSampler _sampler;
+        VkDescriptorPool _descriptor_pool;
+        VkDescriptorSetLayout _set_layout;
+
+        // [layer * page count + page], cleared (not freed) every flush
+        std::vector<std::vector<instance>> _bins;
+        stats _stats;
+
+        void upload_page(uint32_t index);
+
+    public:
+        static const uint32_t max_pages = 64;
+
+        // set_layout is the sprite pipeline's set 0, one sampled image
+        sprite_batch(
+            VkDevice,
+            VkPhysicalDevice,
+            VkQueue,
+            VkCommandPool,
+            VkDescriptorSetLayout);
+        ~sprite_batch();
+
+        sprite_batch(const sprite_batch&) = delete;
+        sprite_batch& operator=(const sprite_batch&) = delete;
+
+        // packs an RGBA8 image into the atlas, visible after upload()
+        std::optional<sprite_atlas::sprite_id> add_sprite(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+        // sends pages that changed to the GPU. waits for the GPU to go
+        // idle, for loading time only
+        void upload();
+
+        void draw(
+            sprite_atlas::sprite_id,
+            float x, float y, float width, float height,
+            structs::color = { 255, 255, 255, 255 },
+            float rotation = 0.0f,
+            uint8_t layer = 0);
+        // an untextured rect, centered on x, y
+        void draw(const structs::rect&, float x, float y, uint8_t layer = 0);
+
+        // writes this frame's instances into the ring and turns every
+        // non-empty bin into a draw packet
+        void flush(
+            draw_queue&,
+            vkframe_ring&,
+            VkPipeline, VkPipelineLayout, uint32_t pipeline_id,
+            VkExtent2D viewport,
+            uint8_t first_layer);
+
+        sprite_atlas& atlas();
+        const stats& get_stats() const;
+    };
+}
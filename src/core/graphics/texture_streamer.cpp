@@ -0,0 +1,629 @@
+#include "./texture_streamer.hpp"
+
+#include "core/vulkan/vkutils.hpp"
+#include "core/vulkan/vkmemory.hpp"
+#include "utils/log.hpp"
+#include "utils/assert.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef GAME_HAS_ZSTD
+    #include <zstd.h>
+#endif
+
+using namespace core;
+
+// loads in flight at once, the most urgent ones go first
+static const uint32_t max_pending_loads = 4;
+// staging buffer offsets, enough for every block size
+static const size_t upload_alignment = 16;
+// 16 mips is a 32k texture, plenty
+static const uint32_t max_levels = 16;
+
+static uint64_t level_bytes(const ktx2::level& level) {
+    return level.uncompressed_size ? level.uncompressed_size : level.size;
+}
+
+static bool read_at(int fd, char* dst, size_t size, uint64_t offset) {
+    while(size > 0) {
+        ssize_t n = pread(fd, dst, size, offset);
+        if(n <= 0) return false;
+
+        dst += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static void transition(
+    VkCommandBuffer command_buffer, VkImage image,
+    uint32_t base_mip, uint32_t mip_count,
+    VkImageLayout old_layout, VkImageLayout new_layout,
+    VkAccessFlags src_access, VkAccessFlags dst_access,
+    VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage
+) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = base_mip;
+    barrier.subresourceRange.levelCount = mip_count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+
+    vkCmdPipelineBarrier(
+        command_buffer, src_stage, dst_stage, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+texture_streamer::texture_streamer(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    VkQueue queue,
+    uint32_t queue_family,
+    vkdeletion_queue& deletions,
+    VkDeviceSize budget
+) : _device(device), _physical_device(physical_device), _queue(queue),
+    _deletions(deletions), _stats{}, _frame(0), _running(true)
+{
+    _stats.budget_bytes = budget;
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags =
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+
+    VK_ASSERT(vkCreateCommandPool(_device, &pool_info, nullptr, &_command_pool));
+
+    _loader = std::thread(&texture_streamer::loader_loop, this);
+}
+
+texture_streamer::~texture_streamer() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _wake.notify_all();
+    if(_loader.joinable()) _loader.join();
+
+    retire_submissions(true);
+
+    for(auto& t : _textures) {
+        vkDestroyImageView(_device, t.view, nullptr);
+        vkDestroyImage(_device, t.image, nullptr);
+        vkmemory::free(_device, t.memory);
+        close(t.fd);
+    }
+
+    vkDestroyCommandPool(_device, _command_pool, nullptr);
+}
+
+std::optional<texture_streamer::texture_id> texture_streamer::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        LOG("[TEXTURE] could not open %s", path.c_str());
+        return {};
+    }
+
+    // the fixed part first, it says how long the level index is
+    std::vector<char> header(ktx2::header_size(1));
+    uint32_t level_count = 0;
+
+    bool valid = read_at(fd, header.data(), header.size() - sizeof(ktx2::level), 0);
+    if(valid) {
+        memcpy(&level_count, header.data() + 40, sizeof(level_count));
+
+        // before sizing anything by it. 0 asks the loader to generate
+        // the mips, there's nothing to stream then
+        if(level_count == 0 || level_count > max_levels) {
+            LOG("[TEXTURE] %s has %u mip levels, streaming needs 1 to %u", path.c_str(), level_count, max_levels);
+            valid = false;
+        }
+    }
+    if(valid) {
+        header.resize(ktx2::header_size(level_count));
+        valid = read_at(fd, header.data(), header.size(), 0);
+    }
+
+    texture t{};
+    t.path = path;
+    t.fd = fd;
+
+    valid = valid && ktx2::parse(header.data(), header.size(), t.info);
+    valid = valid && t.info.levels.size() <= max_levels;
+
+    if(valid && !ktx2::is_supported(t.info.format)) {
+        LOG("[TEXTURE] %s uses a format that can't be streamed", path.c_str());
+        valid = false;
+    }
+
+    if(valid) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(_physical_device, t.info.format, &properties);
+
+        if(!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            LOG("[TEXTURE] %s uses a format this GPU can't sample", path.c_str());
+            valid = false;
+        }
+    }
+
+#ifndef GAME_HAS_ZSTD
+    if(valid && t.info.scheme == ktx2::supercompression::zstd) {
+        LOG("[TEXTURE] %s is zstd supercompressed, this build has no zstd", path.c_str());
+        valid = false;
+    }
+#endif
+
+    if(!valid) {
+        close(fd);
+        return {};
+    }
+
+    uint32_t levels = t.info.levels.size();
+
+    t.tail_mip = levels - 1;
+    for(uint32_t mip = 0; mip < levels; mip++) {
+        uint32_t largest = std::max(
+            ktx2::mip_size(t.info.width, mip),
+            ktx2::mip_size(t.info.height, mip));
+
+        if(largest <= tail_size) {
+            t.tail_mip = mip;
+            break;
+        }
+    }
+
+    t.resident_mip = levels;
+    t.wanted_mip = t.tail_mip;
+    t.last_used = _frame;
+
+    texture_id id = _textures.size();
+    _textures.push_back(std::move(t));
+
+    // the tail is tiny, so it's read right here
+    load_job job{};
+    job.id = id;
+    job.fd = fd;
+    job.scheme = _textures[id].info.scheme;
+    job.first_mip = _textures[id].tail_mip;
+    job.last_mip = levels;
+    job.levels = _textures[id].info.levels;
+
+    read_mips(job);
+    if(job.failed) {
+        LOG("[TEXTURE] could not read %s", path.c_str());
+        close(fd);
+        _textures.pop_back();
+        return {};
+    }
+
+    reallocate(_textures[id], job.first_mip, &job);
+    _stats.streamed_bytes += job.data.size();
+
+    return id;
+}
+
+void texture_streamer::request(texture_id id, float screen_size) {
+    auto& t = _textures[id];
+    uint32_t levels = t.info.levels.size();
+
+    // one texel per pixel: each halving of the screen size drops a mip
+    float size = std::max(t.info.width, t.info.height);
+    uint32_t mip = levels - 1;
+
+    if(screen_size >= size) {
+        mip = 0;
+    } else if(screen_size >= 1.0f) {
+        mip = std::min<uint32_t>(std::floor(std::log2(size / screen_size)), levels - 1);
+    }
+
+    request_mip(id, mip);
+}
+
+void texture_streamer::request_mip(texture_id id, uint32_t mip) {
+    auto& t = _textures[id];
+    t.wanted_mip = std::min(t.wanted_mip, mip);
+    t.last_used = _frame;
+}
+
+void texture_streamer::update() {
+    retire_submissions(false);
+
+    // apply what the loader finished
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finished_scratch.swap(_finished);
+    }
+
+    for(auto& job : _finished_scratch) {
+        auto& t = _textures[job.id];
+        t.loading = false;
+        _stats.pending_loads--;
+
+        if(job.failed) {
+            LOG("[TEXTURE] could not read mips of %s", t.path.c_str());
+            continue;
+        }
+
+        // the demand may be gone by now, but the data is here already,
+        // so it stays as long as there's room
+        if(!make_room(mip_bytes(t, job.first_mip, job.last_mip), job.id)) continue;
+
+        reallocate(t, job.first_mip, &job);
+        _stats.streamed_bytes += job.data.size();
+    }
+    _finished_scratch.clear();
+
+    // queue loads for whatever is missing, biggest gaps first
+    _order.clear();
+    for(texture_id id = 0; id < _textures.size(); id++) {
+        auto& t = _textures[id];
+        if(!t.loading && t.wanted_mip < t.resident_mip) _order.push_back(id);
+    }
+
+    std::sort(_order.begin(), _order.end(), [&](texture_id a, texture_id b) {
+        auto& ta = _textures[a];
+        auto& tb = _textures[b];
+        return ta.resident_mip - ta.wanted_mip > tb.resident_mip - tb.wanted_mip;
+    });
+
+    bool queued = false;
+    for(auto id : _order) {
+        if(_stats.pending_loads >= max_pending_loads) break;
+
+        auto& t = _textures[id];
+
+        // would never fit, even with everything else evicted
+        if(mip_bytes(t, t.wanted_mip, t.resident_mip) > _stats.budget_bytes) continue;
+
+        load_job job{};
+        job.id = id;
+        job.fd = t.fd;
+        job.scheme = t.info.scheme;
+        job.first_mip = t.wanted_mip;
+        job.last_mip = t.resident_mip;
+        job.levels = t.info.levels;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queued.push_back(std::move(job));
+        }
+
+        t.loading = true;
+        _stats.pending_loads++;
+        queued = true;
+    }
+
+    if(queued) _wake.notify_one();
+
+    // the budget may have been lowered
+    make_room(0, _textures.size());
+
+    _stats.texture_count = _textures.size();
+    _stats.satisfied = 0;
+    _stats.wanted_bytes = 0;
+
+    for(auto& t : _textures) {
+        if(t.resident_mip <= t.wanted_mip) _stats.satisfied++;
+        _stats.wanted_bytes += mip_bytes(t, t.wanted_mip, t.info.levels.size());
+
+        // requests only last a frame
+        t.wanted_mip = t.tail_mip;
+    }
+
+    _frame++;
+}
+
+bool texture_streamer::make_room(VkDeviceSize extra, texture_id keep) {
+    auto fits = [&] { return _stats.resident_bytes + extra <= _stats.budget_bytes; };
+    if(fits()) return true;
+
+    _order.clear();
+    for(texture_id id = 0; id < _textures.size(); id++) {
+        auto& t = _textures[id];
+        if(id != keep && !t.loading && t.resident_mip < t.tail_mip) _order.push_back(id);
+    }
+
+    std::sort(_order.begin(), _order.end(), [&](texture_id a, texture_id b) {
+        return _textures[a].last_used < _textures[b].last_used;
+    });
+
+    for(auto id : _order) {
+        auto& t = _textures[id];
+
+        // used this frame: only what nobody asked for can go
+        uint32_t target = t.last_used == _frame ? t.wanted_mip : t.tail_mip;
+        if(target <= t.resident_mip) continue;
+
+        VkDeviceSize before = t.size;
+        reallocate(t, target, nullptr);
+
+        _stats.evicted_bytes += before - t.size;
+        _stats.evictions++;
+
+        if(fits()) return true;
+    }
+
+    return fits();
+}
+
+VkDeviceSize texture_streamer::mip_bytes(const texture& t, uint32_t first, uint32_t last) const {
+    VkDeviceSize bytes = 0;
+    for(uint32_t mip = first; mip < last; mip++) bytes += level_bytes(t.info.levels[mip]);
+    return bytes;
+}
+
+void texture_streamer::reallocate(texture& t, uint32_t first_mip, const load_job* job) {
+    uint32_t levels = t.info.levels.size();
+    uint32_t width  = ktx2::mip_size(t.info.width, first_mip);
+    uint32_t height = ktx2::mip_size(t.info.height, first_mip);
+
+    // loaded mips have to sit right above what's resident
+    ASSERT(!job || (job->first_mip == first_mip && job->last_mip == std::min(t.resident_mip, levels)),
+        "Loaded mips don't line up with the resident ones");
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = t.info.format;
+    image_info.extent = { width, height, 1 };
+    image_info.mipLevels = levels - first_mip;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage =
+        VK_IMAGE_USAGE_SAMPLED_BIT |
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImage image;
+    VK_ASSERT(vkCreateImage(_device, &image_info, nullptr, &image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, image, &requirements);
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = vkutils::find_memory_type(
+        _physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkDeviceMemory memory = vkmemory::allocate(_device, allocate_info, vkmemory::category::image);
+    VK_ASSERT(vkBindImageMemory(_device, image, memory, 0));
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = t.info.format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = levels - first_mip;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    VK_ASSERT(vkCreateImageView(_device, &view_info, nullptr, &view));
+
+    auto command_buffer = vkutils::begin_one_time_commands(_device, _command_pool);
+
+    transition(
+        command_buffer, image, 0, levels - first_mip,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    // mips both images have come from the old one, GPU to GPU
+    if(t.image != VK_NULL_HANDLE) {
+        uint32_t keep_from = std::max(first_mip, t.resident_mip);
+
+        transition(
+            command_buffer, t.image, keep_from - t.resident_mip, levels - keep_from,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkImageCopy regions[max_levels]{};
+        uint32_t region_count = 0;
+
+        for(uint32_t mip = keep_from; mip < levels; mip++) {
+            auto& region = regions[region_count++];
+            region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - t.resident_mip, 0, 1 };
+            region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - first_mip, 0, 1 };
+            region.extent = {
+                ktx2::mip_size(t.info.width, mip),
+                ktx2::mip_size(t.info.height, mip),
+                1
+            };
+        }
+
+        vkCmdCopyImage(
+            command_buffer,
+            t.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            region_count, regions);
+    }
+
+    submission s{};
+
+    // freshly loaded mips come from a staging buffer, as they are on disk
+    if(job) {
+        s.staging = vkbuffer(
+            _device, _physical_device, job->data.size(),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        s.staging.write(_device, job->data.data(), job->data.size());
+
+        VkBufferImageCopy regions[max_levels]{};
+        uint32_t region_count = 0;
+
+        for(uint32_t mip = job->first_mip; mip < job->last_mip; mip++) {
+            auto& region = regions[region_count];
+            region.bufferOffset = job->offsets[region_count];
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - first_mip, 0, 1 };
+            region.imageExtent = {
+                ktx2::mip_size(t.info.width, mip),
+                ktx2::mip_size(t.info.height, mip),
+                1
+            };
+            region_count++;
+        }
+
+        vkCmdCopyBufferToImage(
+            command_buffer, s.staging.handle,
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            region_count, regions);
+    }
+
+    transition(
+        command_buffer, image, 0, levels - first_mip,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    VK_ASSERT(vkEndCommandBuffer(command_buffer));
+
+    // no waiting here, update() frees everything once the fence signals
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VK_ASSERT(vkCreateFence(_device, &fence_info, nullptr, &s.fence));
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    VK_ASSERT(vkQueueSubmit(_queue, 1, &submit_info, s.fence));
+
+    s.command_buffer = command_buffer;
+    s.old_image = t.image;
+    s.old_memory = t.memory;
+    s.old_view = t.view;
+    _submissions.push_back(s);
+
+    _stats.resident_bytes = _stats.resident_bytes - t.size + requirements.size;
+
+    t.image = image;
+    t.memory = memory;
+    t.view = view;
+    t.size = requirements.size;
+    t.resident_mip = first_mip;
+}
+
+void texture_streamer::retire_submissions(bool wait) {
+    for(size_t i = 0; i < _submissions.size();) {
+        auto& s = _submissions[i];
+
+        if(wait) vkWaitForFences(_device, 1, &s.fence, VK_TRUE, UINT64_MAX);
+
+        if(vkGetFenceStatus(_device, s.fence) != VK_SUCCESS) {
+            i++;
+            continue;
+        }
+
+        vkFreeCommandBuffers(_device, _command_pool, 1, &s.command_buffer);
+        vkDestroyFence(_device, s.fence, nullptr);
+        s.staging.destroy(_device);
+
+        // frames recorded before the swap may still sample it
+        if(s.old_image != VK_NULL_HANDLE) {
+            _deletions.retire(s.old_view);
+            _deletions.retire(s.old_image);
+            _deletions.retire(s.old_memory);
+        }
+
+        _submissions[i] = _submissions.back();
+        _submissions.pop_back();
+    }
+}
+
+void texture_streamer::loader_loop() {
+    while(true) {
+        load_job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return !_running || !_queued.empty(); });
+            if(!_running) return;
+
+            job = std::move(_queued.front());
+            _queued.pop_front();
+        }
+
+        read_mips(job);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finished.push_back(std::move(job));
+    }
+}
+
+// reads mips [first_mip, last_mip) into one buffer, laid out for
+// vkCmdCopyBufferToImage. runs on the loader thread, or for the tail in load()
+void texture_streamer::read_mips(load_job& job) {
+    size_t total = 0;
+    job.offsets.clear();
+
+    for(uint32_t mip = job.first_mip; mip < job.last_mip; mip++) {
+        total = (total + upload_alignment - 1) & ~(upload_alignment - 1);
+        job.offsets.push_back(total);
+        total += level_bytes(job.levels[mip]);
+    }
+
+    job.data.resize(total);
+    job.failed = false;
+
+    std::vector<char> compressed;
+
+    for(uint32_t mip = job.first_mip; mip < job.last_mip; mip++) {
+        auto& level = job.levels[mip];
+        char* dst = job.data.data() + job.offsets[mip - job.first_mip];
+
+        if(job.scheme == ktx2::supercompression::none) {
+            job.failed |= !read_at(job.fd, dst, level.size, level.offset);
+            continue;
+        }
+
+#ifdef GAME_HAS_ZSTD
+        compressed.resize(level.size);
+        if(!read_at(job.fd, compressed.data(), level.size, level.offset)) {
+            job.failed = true;
+            continue;
+        }
+
+        size_t result = ZSTD_decompress(dst, level_bytes(level), compressed.data(), level.size);
+        job.failed |= ZSTD_isError(result) || result != level_bytes(level);
+#else
+        job.failed = true;
+#endif
+    }
+}
+
+VkImageView texture_streamer::view(texture_id id) const {
+    return _textures[id].view;
+}
+
+uint32_t texture_streamer::resident_mip(texture_id id) const {
+    return _textures[id].resident_mip;
+}
+
+void texture_streamer::set_budget(VkDeviceSize budget) {
+    _stats.budget_bytes = budget;
+}
+
+const texture_streamer::stats& texture_streamer::get_stats() const {
+    return _stats;
+}
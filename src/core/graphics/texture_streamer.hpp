@@ -0,0 +1,167 @@
+#pragma once
+
+#include "core/graphics/ktx2.hpp"
+#include "core/vulkan/vkbuffer.hpp"
+#include "core/vulkan/vkdeletion_queue.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <condition_variable>
+
+namespace core {
+    // keeps only the mips that are actually needed on screen in VRAM.
+    //
+    // every texture always has its mip tail (everything <= tail_size) in,
+    // anything above that gets read from disk on a loader thread when
+    // something asks for it with request(). when the budget runs out, the
+    // textures that went unused the longest lose their top mips first
+    //
+    // without sparse residency an image can't grow in place, so changing
+    // what's resident means a new image with just those mips, filled from
+    // the old one plus whatever was loaded. views change when that
+    // happens, fetch them with view() every frame
+    class texture_streamer {
+    public:
+        using texture_id = uint32_t;
+
+        // mips up to this size are loaded right away and never evicted
+        static const uint32_t tail_size = 64;
+
+        struct stats {
+            uint32_t texture_count;
+            // textures with every mip they were asked for resident
+            uint32_t satisfied;
+            uint32_t pending_loads;
+            VkDeviceSize resident_bytes;
+            // what resident_bytes would be if every request got its mips
+            VkDeviceSize wanted_bytes;
+            VkDeviceSize budget_bytes;
+            // totals since startup
+            uint64_t streamed_bytes;
+            uint64_t evicted_bytes;
+            uint64_t evictions;
+        };
+
+    private:
+        struct texture {
+            std::string path;
+            ktx2::info info;
+            int fd;
+
+            VkImage image;
+            VkDeviceMemory memory;
+            VkImageView view;
+            VkDeviceSize size;
+
+            // most detailed mip on the GPU
+            uint32_t resident_mip;
+            uint32_t tail_mip;
+            // most detailed mip asked for this frame
+            uint32_t wanted_mip;
+            uint64_t last_used;
+            bool loading;
+        };
+
+        // mips [first_mip, last_mip) of a texture, packed for a buffer copy
+        struct load_job {
+            texture_id id;
+            int fd;
+            ktx2::supercompression scheme;
+            uint32_t first_mip, last_mip;
+            std::vector<ktx2::level> levels;
+
+            std::vector<char> data;
+            std::vector<size_t> offsets;
+            bool failed;
+        };
+
+        // a copy on the GPU, plus what can be freed once it's done
+        struct submission {
+            VkFence fence;
+            VkCommandBuffer command_buffer;
+            vkbuffer staging;
+
+            // the image this replaced, may still be in use by older
+            // frames. retired once the copy is done
+            VkImage old_image;
+            VkDeviceMemory old_memory;
+            VkImageView old_view;
+        };
+
+        VkDevice _device;
+        VkPhysicalDevice _physical_device;
+        VkQueue _queue;
+        VkCommandPool _command_pool;
+        vkdeletion_queue& _deletions;
+
+        std::vector<texture> _textures;
+        std::vector<submission> _submissions;
+        stats _stats;
+        uint64_t _frame;
+
+        // scratch, kept around so update() doesn't allocate
+        std::vector<texture_id> _order;
+        std::vector<load_job> _finished_scratch;
+
+        std::thread _loader;
+        std::atomic<bool> _running;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::deque<load_job> _queued;
+        std::vector<load_job> _finished;
+
+        void loader_loop();
+        static void read_mips(load_job&);
+
+        // moves a texture to a new image holding [first_mip, levels),
+        // filled from the current image and the job's data, if any
+        void reallocate(texture&, uint32_t first_mip, const load_job*);
+
+        // evicts least recently used mips until extra bytes fit the budget
+        bool make_room(VkDeviceSize extra, texture_id keep);
+        VkDeviceSize mip_bytes(const texture&, uint32_t first, uint32_t last) const;
+
+        void retire_submissions(bool wait);
+
+    public:
+        texture_streamer(
+            VkDevice,
+            VkPhysicalDevice,
+            VkQueue,
+            uint32_t queue_family,
+            // replaced images go here, it has to outlive the streamer
+            vkdeletion_queue&,
+            VkDeviceSize budget);
+        ~texture_streamer();
+
+        texture_streamer(const texture_streamer&) = delete;
+        texture_streamer& operator=(const texture_streamer&) = delete;
+
+        // loads the header and the mip tail, blocks only for those.
+        // empty if the file can't be streamed (format, missing, ...)
+        std::optional<texture_id> load(const std::string& ktx2_path);
+
+        // screen_size is how many pixels the texture's largest side
+        // covers on screen. call every frame the texture is visible
+        void request(texture_id, float screen_size);
+        void request_mip(texture_id, uint32_t mip);
+
+        // starts/finishes loads and evictions, once per frame
+        void update();
+
+        VkImageView view(texture_id) const;
+        uint32_t resident_mip(texture_id) const;
+
+        void set_budget(VkDeviceSize);
+        const stats& get_stats() const;
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace core::input {
+    // single producer, single consumer ring buffer. push() and pop() never
+    // block or allocate, so it's safe to push from a callback or another
+    // thread while the consumer drains it. when full, push() drops the
+    // event and says so
+    template<typename T, size_t Capacity>
+    class event_ring {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    private:
+        T _items[Capacity];
+
+        // free-running counters, the index is the counter mod Capacity.
+        // kept on separate cache lines so producer and consumer don't
+        // fight over one
+        alignas(64) std::atomic<uint64_t> _head;    // next to pop
+        alignas(64) std::atomic<uint64_t> _tail;    // next to push
+
+    public:
+        event_ring() : _head(0), _tail(0) {}
+
+        event_ring(const event_ring&) = delete;
+        event_ring& operator=(const event_ring&) = delete;
+
+        // producer only
+        bool push(const T& item) {
+            uint64_t tail = _tail.load(std::memory_order_relaxed);
+            if(tail - _head.load(std::memory_order_acquire) == Capacity) return false;
+
+            _items[tail & (Capacity - 1)] = item;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only
+        bool pop(T& out) {
+            uint64_t head = _head.load(std::memory_order_relaxed);
+            if(head == _tail.load(std::memory_order_acquire)) return false;
+
+            out = _items[head & (Capacity - 1)];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size() const {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+        }
+    };
+}
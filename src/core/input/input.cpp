@@ -0,0 +1,182 @@
+#include "./input.hpp"
+
+#include "utils/assert.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace core;
+using namespace core::input;
+
+input_system::input_system(GLFWwindow* window)
+    : _window(window), _dropped(0), _state{}, _has_cursor(false),
+      _samples{}, _sample_count(0), _pending_event_ns(0)
+{
+    ASSERT(glfwGetWindowUserPointer(window) == nullptr, "Window user pointer is already taken");
+    glfwSetWindowUserPointer(window, this);
+
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, button_callback);
+    glfwSetCursorPosCallback(window, cursor_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+}
+
+input_system::~input_system() {
+    glfwSetKeyCallback(_window, nullptr);
+    glfwSetMouseButtonCallback(_window, nullptr);
+    glfwSetCursorPosCallback(_window, nullptr);
+    glfwSetScrollCallback(_window, nullptr);
+    glfwSetWindowUserPointer(_window, nullptr);
+}
+
+uint64_t input_system::now_ns() {
+    auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+}
+
+// CALLBACKS
+// these run inside glfwPollEvents, they only queue
+
+void input_system::push(const event& e) {
+    if(!_events.push(e)) _dropped++;
+}
+
+void input_system::key_callback(GLFWwindow* window, int key, int, int action, int mods) {
+    auto* self = static_cast<input_system*>(glfwGetWindowUserPointer(window));
+    self->push({ event::kind::key, key, action, mods, 0.0, 0.0, now_ns() });
+}
+
+void input_system::button_callback(GLFWwindow* window, int button, int action, int mods) {
+    auto* self = static_cast<input_system*>(glfwGetWindowUserPointer(window));
+    self->push({ event::kind::button, button, action, mods, 0.0, 0.0, now_ns() });
+}
+
+void input_system::cursor_callback(GLFWwindow* window, double x, double y) {
+    auto* self = static_cast<input_system*>(glfwGetWindowUserPointer(window));
+    self->push({ event::kind::cursor, 0, 0, 0, x, y, now_ns() });
+}
+
+void input_system::scroll_callback(GLFWwindow* window, double x, double y) {
+    auto* self = static_cast<input_system*>(glfwGetWindowUserPointer(window));
+    self->push({ event::kind::scroll, 0, 0, 0, x, y, now_ns() });
+}
+
+// FRAME
+
+void input_system::poll() {
+    glfwPollEvents();
+}
+
+void input_system::apply(const event& e) {
+    auto& s = _state;
+
+    switch(e.type) {
+        case event::kind::key: {
+            // GLFW_KEY_UNKNOWN is -1
+            if(e.code < 0 || e.code >= state::key_count) break;
+
+            if(e.action == GLFW_PRESS) {
+                s.keys_down.set(e.code);
+                s.keys_pressed.set(e.code);
+            } else if(e.action == GLFW_RELEASE) {
+                s.keys_down.reset(e.code);
+                s.keys_released.set(e.code);
+            }
+            break;
+        }
+        case event::kind::button: {
+            if(e.code < 0 || e.code >= state::button_count) break;
+
+            if(e.action == GLFW_PRESS) {
+                s.buttons_down.set(e.code);
+                s.buttons_pressed.set(e.code);
+            } else if(e.action == GLFW_RELEASE) {
+                s.buttons_down.reset(e.code);
+                s.buttons_released.set(e.code);
+            }
+            break;
+        }
+        case event::kind::cursor: {
+            // the first position isn't a movement
+            if(_has_cursor) {
+                s.cursor_dx += e.x - s.cursor_x;
+                s.cursor_dy += e.y - s.cursor_y;
+            }
+            s.cursor_x = e.x;
+            s.cursor_y = e.y;
+            _has_cursor = true;
+            break;
+        }
+        case event::kind::scroll: {
+            s.scroll_x += e.x;
+            s.scroll_y += e.y;
+            break;
+        }
+    }
+}
+
+void input_system::update(world& w) {
+    poll();
+
+    auto& s = _state;
+    s.keys_pressed.reset();
+    s.keys_released.reset();
+    s.buttons_pressed.reset();
+    s.buttons_released.reset();
+    s.cursor_dx = s.cursor_dy = 0.0;
+    s.scroll_x = s.scroll_y = 0.0;
+    s.events = 0;
+    s.oldest_event_ns = 0;
+
+    event e;
+    while(_events.pop(e)) {
+        if(s.events == 0) s.oldest_event_ns = e.timestamp_ns;
+        s.events++;
+        apply(e);
+    }
+
+    // a frame with no input has nothing to measure
+    if(s.events > 0) _pending_event_ns = s.oldest_event_ns;
+
+    w.insert_resource<state>(s);
+}
+
+void input_system::frame_presented() {
+    if(_pending_event_ns == 0) return;
+
+    float ms = (now_ns() - _pending_event_ns) / 1e6f;
+    _samples[_sample_count % latency_window] = ms;
+    _sample_count++;
+    _pending_event_ns = 0;
+}
+
+const state& input_system::get_state() const {
+    return _state;
+}
+
+input_system::latency input_system::get_latency() const {
+    latency l{};
+    l.samples = std::min(_sample_count, latency_window);
+    if(l.samples == 0) return l;
+
+    l.last_ms = _samples[(_sample_count - 1) % latency_window];
+
+    float total = 0.0f;
+    for(uint32_t i = 0; i < l.samples; i++) {
+        total += _samples[i];
+        l.max_ms = std::max(l.max_ms, _samples[i]);
+    }
+    l.average_ms = total / l.samples;
+
+    return l;
+}
+
+uint32_t input_system::dropped() const {
+    return _dropped;
+}
+
+void input::register_input(world& w, input_system& input) {
+    w.add_update_system([&input](world& w) {
+        input.update(w);
+    });
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "core/ecs/world.hpp"
+#include "core/input/event_ring.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <bitset>
+#include <cstdint>
+
+namespace core::input {
+    struct event {
+        enum class kind : uint8_t {
+            key,
+            button,
+            cursor,
+            scroll
+        };
+
+        kind type;
+        // key/button code, GLFW_PRESS/RELEASE/REPEAT, modifiers
+        int code;
+        int action;
+        int mods;
+        // cursor position, or scroll offset
+        double x, y;
+        // steady clock, when the callback ran
+        uint64_t timestamp_ns;
+    };
+
+    // what the input looked like this frame, as a world resource.
+    // pressed/released only hold for the frame the change happened in
+    struct state {
+        static const int key_count = GLFW_KEY_LAST + 1;
+        static const int button_count = GLFW_MOUSE_BUTTON_LAST + 1;
+
+        std::bitset<key_count> keys_down, keys_pressed, keys_released;
+        std::bitset<button_count> buttons_down, buttons_pressed, buttons_released;
+
+        double cursor_x, cursor_y;
+        double cursor_dx, cursor_dy;
+        double scroll_x, scroll_y;
+
+        // events that went into this frame, and when the oldest one came in
+        uint32_t events;
+        uint64_t oldest_event_ns;
+
+        bool down(int key) const { return key >= 0 && key < key_count && keys_down[key]; }
+        bool pressed(int key) const { return key >= 0 && key < key_count && keys_pressed[key]; }
+        bool released(int key) const { return key >= 0 && key < key_count && keys_released[key]; }
+    };
+
+    // GLFW callbacks only stamp events and push them into a ring buffer,
+    // nothing runs in the middle of glfwPollEvents. update() polls as
+    // late as it can, right before the simulation, and folds the queued
+    // events into the frame's state.
+    //
+    // latency is measured from the oldest event a frame used to the
+    // moment that frame was handed to the presentation engine. what the
+    // display does after that isn't visible without present timing
+    // extensions, so the real input-to-photon time is this plus scanout
+    class input_system {
+    public:
+        struct latency {
+            float last_ms;
+            float average_ms;
+            float max_ms;
+            uint32_t samples;
+        };
+
+    private:
+        static const size_t ring_capacity = 1024;
+        static const uint32_t latency_window = 128;
+
+        GLFWwindow* _window;
+        event_ring<event, ring_capacity> _events;
+        uint32_t _dropped;
+
+        state _state;
+        bool _has_cursor;
+
+        // the last latency_window samples, in ms
+        float _samples[latency_window];
+        uint32_t _sample_count;
+        uint64_t _pending_event_ns;
+
+        void push(const event&);
+        void apply(const event&);
+
+        static void key_callback(GLFWwindow*, int key, int scancode, int action, int mods);
+        static void button_callback(GLFWwindow*, int button, int action, int mods);
+        static void cursor_callback(GLFWwindow*, double x, double y);
+        static void scroll_callback(GLFWwindow*, double x, double y);
+
+    public:
+        input_system(GLFWwindow*);
+        ~input_system();
+
+        input_system(const input_system&) = delete;
+        input_system& operator=(const input_system&) = delete;
+
+        // queues whatever GLFW has, main thread only
+        void poll();
+
+        // polls, drains the queue into the state and publishes it
+        void update(world&);
+
+        // the frame that used this update's input was presented
+        void frame_presented();
+
+        const state& get_state() const;
+        latency get_latency() const;
+
+        // events lost to a full ring, ever
+        uint32_t dropped() const;
+
+        static uint64_t now_ns();
+    };
+
+    // runs update() as a world update system. systems run in the order
+    // they're added, so add it before anything that reads the input
+    void register_input(world&, input_system&);
+}
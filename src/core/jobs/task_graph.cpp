@@ -0,0 +1,101 @@
+#include "./task_graph.hpp"
+
+#include "utils/assert.hpp"
+
+#include <mutex>
+#include <exception>
+#include <condition_variable>
+
+using namespace core::jobs;
+
+task_graph::task_id task_graph::add(const char* name, std::function<void()> fn, std::initializer_list<task_id> dependencies) {
+    return this->add(name, std::move(fn), dependencies, false);
+}
+
+task_graph::task_id task_graph::add_on_caller(const char* name, std::function<void()> fn, std::initializer_list<task_id> dependencies) {
+    return this->add(name, std::move(fn), dependencies, true);
+}
+
+task_graph::task_id task_graph::add(
+    const char* name, std::function<void()> fn, std::initializer_list<task_id> dependencies, bool on_caller)
+{
+    task_id id = _tasks.size();
+
+    task t;
+    t.name = name;
+    t.fn = std::move(fn);
+    t.waiting = 0;
+    t.on_caller = on_caller;
+
+    for(task_id dependency : dependencies) {
+        ASSERT(dependency < id, "A task can only depend on tasks added before it");
+        _tasks[dependency].dependents.push_back(id);
+        t.waiting++;
+    }
+
+    _tasks.push_back(std::move(t));
+    return id;
+}
+
+void task_graph::run(thread_pool& pool, timeline* trace) {
+    std::mutex mutex;
+    std::condition_variable changed;
+    // ready_caller only for thread 0, the caller
+    std::vector<task_id> ready, ready_caller;
+    size_t finished = 0;
+    std::exception_ptr failure;
+
+    auto make_ready = [&](task_id id) {
+        if(_tasks[id].on_caller) ready_caller.push_back(id);
+        else ready.push_back(id);
+    };
+
+    for(task_id id = 0; id < _tasks.size(); id++) {
+        if(_tasks[id].waiting == 0) make_ready(id);
+    }
+
+    // every thread takes ready tasks until there are none left to run.
+    // a thread may get more than one index, it just finds nothing to do.
+    // a worker keeps its index until everything ran, so one is always
+    // left for the caller
+    pool.parallel_for(pool.thread_count(), [&](uint32_t, uint32_t thread_index) {
+        bool caller = thread_index == 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            changed.wait(lock, [&] {
+                return !ready.empty() || (caller && !ready_caller.empty()) || finished == _tasks.size() || failure;
+            });
+            if(finished == _tasks.size() || failure) return;
+
+            auto& queue = caller && !ready_caller.empty() ? ready_caller : ready;
+            task_id id = queue.back();
+            queue.pop_back();
+            lock.unlock();
+
+            std::exception_ptr error;
+            try {
+                timeline::scope span(trace, _tasks[id].name, thread_index);
+                _tasks[id].fn();
+            } catch(...) {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            if(error && !failure) failure = error;
+
+            finished++;
+            for(task_id dependent : _tasks[id].dependents) {
+                if(--_tasks[dependent].waiting == 0) make_ready(dependent);
+            }
+            changed.notify_all();
+        }
+    });
+
+    _tasks.clear();
+    if(failure) std::rethrow_exception(failure);
+}
+
+size_t task_graph::size() const {
+    return _tasks.size();
+}
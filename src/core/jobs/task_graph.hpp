@@ -0,0 +1,52 @@
+#pragma once
+
+#include "./thread_pool.hpp"
+#include "core/debug/timeline.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+namespace core::jobs {
+    // one-off work with dependencies between the pieces, eg. startup:
+    // every task runs once all of its dependencies are done, as many at
+    // a time as the pool has threads.
+    //
+    // a task can only depend on tasks added before it, so there are no
+    // cycles. tasks can't use the pool themselves, its threads are all
+    // taken by run()
+    class task_graph {
+    public:
+        using task_id = uint32_t;
+
+    private:
+        struct task {
+            const char* name;
+            std::function<void()> fn;
+            std::vector<task_id> dependents;
+            // dependencies not done yet
+            uint32_t waiting;
+            bool on_caller;
+        };
+
+        std::vector<task> _tasks;
+
+        task_id add(const char* name, std::function<void()>, std::initializer_list<task_id>, bool on_caller);
+
+    public:
+        // name has to outlive the graph, a string literal
+        task_id add(const char* name, std::function<void()>, std::initializer_list<task_id> dependencies = {});
+        // only runs on the thread that calls run(), for what has to be
+        // done from the main thread (most of GLFW)
+        task_id add_on_caller(const char* name, std::function<void()>, std::initializer_list<task_id> dependencies = {});
+
+        // blocks until every task ran, each one goes on the timeline if
+        // there is one. if a task throws, tasks not started yet are
+        // skipped and the first exception is rethrown here. the graph is
+        // empty after
+        void run(thread_pool&, timeline* = nullptr);
+
+        size_t size() const;
+    };
+}
@@ -0,0 +1,114 @@
+#include "./thread_pool.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+using namespace core::jobs;
+
+bool core::jobs::pin_current_thread(uint32_t core) {
+#ifdef __linux__
+    uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+thread_pool::thread_pool(uint32_t workers)
+    : _running(true), _job(nullptr), _context(nullptr), _count(0),
+      _participants(0), _generation(0), _busy(0), _next(0)
+{
+    if(workers == 0) {
+        uint32_t hardware = std::thread::hardware_concurrency();
+        workers = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    _workers.reserve(workers);
+    for(uint32_t i = 0; i < workers; i++) {
+        _workers.emplace_back(&thread_pool::worker_loop, this, i + 1);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _wake.notify_all();
+
+    for(auto& worker : _workers) worker.join();
+}
+
+uint32_t thread_pool::thread_count() const {
+    return _workers.size() + 1;
+}
+
+void thread_pool::run(uint32_t count, uint32_t max_threads, job_fn job, void* context) {
+    if(count == 0) return;
+
+    uint32_t threads = max_threads == 0 ? thread_count() : std::min(max_threads, thread_count());
+    threads = std::min(threads, count);
+
+    // not worth waking anyone
+    if(threads == 1) {
+        for(uint32_t i = 0; i < count; i++) job(context, i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = job;
+        _context = context;
+        _count = count;
+        // workers 1..participants-1 join in, the caller is the last one
+        _participants = threads;
+        _busy = threads - 1;
+        _next.store(0, std::memory_order_relaxed);
+        _generation++;
+    }
+    _wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&] { return _busy == 0; });
+    _job = nullptr;
+}
+
+void thread_pool::work(uint32_t thread_index) {
+    while(true) {
+        uint32_t index = _next.fetch_add(1, std::memory_order_relaxed);
+        if(index >= _count) return;
+        _job(_context, index, thread_index);
+    }
+}
+
+void thread_pool::worker_loop(uint32_t thread_index) {
+    uint64_t seen = 0;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return !_running || _generation != seen; });
+            if(!_running) return;
+
+            seen = _generation;
+            // this job doesn't want that many threads
+            if(thread_index >= _participants) continue;
+        }
+
+        work(thread_index);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_busy == 0) _done.notify_one();
+    }
+}
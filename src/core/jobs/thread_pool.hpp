@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <condition_variable>
+
+namespace core::jobs {
+    // keeps the calling thread on one core (modulo the core count), so
+    // its caches stay warm. false where that isn't supported
+    bool pin_current_thread(uint32_t core);
+
+    // a fixed set of worker threads for fork/join work inside a frame.
+    //
+    // parallel_for() hands out indices one at a time to the workers and
+    // the calling thread, and returns once all of them are done. the
+    // caller takes part as thread 0, so a pool with no workers just runs
+    // everything inline. dispatching doesn't allocate
+    class thread_pool {
+    private:
+        using job_fn = void(*)(void* context, uint32_t index, uint32_t thread_index);
+
+        std::vector<std::thread> _workers;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        bool _running;
+
+        // the job being run, only changes while every worker is idle
+        job_fn _job;
+        void* _context;
+        uint32_t _count;
+        uint32_t _participants;
+        uint64_t _generation;
+        uint32_t _busy;
+        std::atomic<uint32_t> _next;
+
+        void worker_loop(uint32_t thread_index);
+        void work(uint32_t thread_index);
+        void run(uint32_t count, uint32_t max_threads, job_fn, void* context);
+
+    public:
+        // 0 workers means one per hardware thread, minus the caller
+        thread_pool(uint32_t workers = 0);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // workers plus the calling thread
+        uint32_t thread_count() const;
+
+        // calls fn(index, thread_index) for every index in [0, count),
+        // using at most max_threads threads (0 for all of them).
+        // thread_index is < thread_count(), and stable for the call
+        template<typename F>
+        void parallel_for(uint32_t count, F&& fn, uint32_t max_threads = 0) {
+            auto invoke = [](void* context, uint32_t index, uint32_t thread_index) {
+                (*static_cast<std::remove_reference_t<F>*>(context))(index, thread_index);
+            };
+            run(count, max_threads, invoke, const_cast<void*>(static_cast<const void*>(&fn)));
+        }
+    };
+}
@@ -0,0 +1,89 @@
+#include "./alloc_stats.hpp"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+using namespace core::memory;
+
+static std::atomic<uint64_t> total_count{0}, total_bytes{0};
+static thread_local uint64_t thread_count = 0, thread_bytes = 0;
+
+#ifdef GAME_TRACK_ALLOCATIONS
+
+static inline void record_allocation(size_t size) {
+    thread_count++;
+    thread_bytes += size;
+    total_count.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void* tracked_allocate(size_t size) {
+    record_allocation(size);
+
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+static void* tracked_allocate_aligned(size_t size, std::align_val_t alignment) {
+    record_allocation(size);
+
+    size_t align = static_cast<size_t>(alignment);
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t rounded = (size + align - 1) & ~(align - 1);
+
+    void* ptr = std::aligned_alloc(align, rounded == 0 ? align : rounded);
+    if(ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+// replacing the plain and aligned forms is enough, the array and
+// nothrow forms end up calling these
+void* operator new(size_t size) { return tracked_allocate(size); }
+void* operator new[](size_t size) { return tracked_allocate(size); }
+void* operator new(size_t size, std::align_val_t a) { return tracked_allocate_aligned(size, a); }
+void* operator new[](size_t size, std::align_val_t a) { return tracked_allocate_aligned(size, a); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+bool core::memory::allocation_tracking_enabled() {
+    return true;
+}
+
+#else
+
+bool core::memory::allocation_tracking_enabled() {
+    return false;
+}
+
+#endif
+
+allocation_counters core::memory::thread_allocations() {
+    return { thread_count, thread_bytes };
+}
+
+allocation_counters core::memory::total_allocations() {
+    return {
+        total_count.load(std::memory_order_relaxed),
+        total_bytes.load(std::memory_order_relaxed)
+    };
+}
+
+// allocation_probe
+
+allocation_probe::allocation_probe()
+    : _start(thread_allocations())
+{}
+
+allocation_counters allocation_probe::delta() const {
+    auto now = thread_allocations();
+    return { now.count - _start.count, now.bytes - _start.bytes };
+}
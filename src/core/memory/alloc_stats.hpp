@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// allocation instrumentation: when the build defines GAME_TRACK_ALLOCATIONS
+// (cmake -DGAME_TRACK_ALLOCATIONS=ON) the global operator new/delete get
+// replaced with counting versions. otherwise every counter stays at zero
+// and allocation_tracking_enabled() returns false.
+
+namespace core::memory {
+
+    struct allocation_counters {
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    bool allocation_tracking_enabled();
+
+    // allocations made by the calling thread
+    allocation_counters thread_allocations();
+    // allocations made by every thread in the process
+    allocation_counters total_allocations();
+
+    // counts how many allocations the current thread does while it's alive,
+    // eg. wrap a frame in one to check steady state frames don't allocate
+    class allocation_probe {
+    private:
+        allocation_counters _start;
+
+    public:
+        allocation_probe();
+
+        allocation_counters delta() const;
+    };
+}
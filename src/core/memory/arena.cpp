@@ -0,0 +1,162 @@
+#include "./arena.hpp"
+
+#include "utils/assert.hpp"
+
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+using namespace core::memory;
+
+static inline size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+linear_arena::linear_arena(size_t initial_size)
+    : _offset(0), _peak(0)
+{
+    // reserving up front so growing the block list doesn't allocate
+    // in the middle of a frame (unless we really overflow a lot)
+    _blocks.reserve(8);
+    grow(initial_size);
+}
+
+linear_arena::~linear_arena() {
+    for(auto& b : _blocks) ::operator delete(b.data);
+}
+
+void linear_arena::grow(size_t min_size) {
+    size_t size = _blocks.empty() ? min_size : std::max(min_size, _blocks.back().size * 2);
+
+    block b;
+    b.data = static_cast<std::byte*>(::operator new(size));
+    b.size = size;
+
+    _blocks.push_back(b);
+    _offset = 0;
+}
+
+void* linear_arena::allocate(size_t size, size_t alignment) {
+    ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+
+    size_t offset = align_up(_offset, alignment);
+
+    if(offset + size > _blocks.back().size) {
+        // worst case padding, so the fresh block is guaranteed to fit
+        grow(size + alignment);
+        offset = align_up(_offset, alignment);
+    }
+
+    void* ptr = _blocks.back().data + offset;
+    _offset = offset + size;
+    _peak = std::max(_peak, used());
+
+    return ptr;
+}
+
+void linear_arena::reset() {
+    if(_blocks.size() > 1) {
+        size_t total = capacity();
+
+        for(auto& b : _blocks) ::operator delete(b.data);
+        _blocks.clear();
+
+        grow(total);
+    }
+
+    _offset = 0;
+}
+
+size_t linear_arena::used() const {
+    size_t total = _offset;
+    for(size_t i = 0; i + 1 < _blocks.size(); i++) total += _blocks[i].size;
+    return total;
+}
+
+size_t linear_arena::capacity() const {
+    size_t total = 0;
+    for(auto& b : _blocks) total += b.size;
+    return total;
+}
+
+size_t linear_arena::peak() const {
+    return _peak;
+}
+
+// arena_resource
+
+arena_resource::arena_resource(linear_arena& arena)
+    : _arena(arena)
+{}
+
+void* arena_resource::do_allocate(size_t bytes, size_t alignment) {
+    return _arena.allocate(bytes, alignment);
+}
+
+void arena_resource::do_deallocate(void*, size_t, size_t) {
+    // freed in bulk on reset
+}
+
+bool arena_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// per-thread frame arenas
+
+static std::atomic<uint64_t> global_frame_index{0};
+
+struct thread_frame_arena {
+    linear_arena arena;
+    arena_resource resource;
+    uint64_t frame;
+
+    thread_frame_arena()
+        : arena(), resource(arena), frame(global_frame_index.load(std::memory_order_relaxed))
+    {}
+};
+
+static thread_frame_arena& current_thread_arena() {
+    thread_local thread_frame_arena t;
+
+    uint64_t frame = global_frame_index.load(std::memory_order_acquire);
+    if(t.frame != frame) {
+        t.arena.reset();
+        t.frame = frame;
+    }
+
+    return t;
+}
+
+// set by frame_arena_scope
+static thread_local linear_arena* scoped_arena = nullptr;
+static thread_local std::pmr::memory_resource* scoped_resource = nullptr;
+
+linear_arena& core::memory::frame_arena() {
+    if(scoped_arena != nullptr) return *scoped_arena;
+    return current_thread_arena().arena;
+}
+
+std::pmr::memory_resource* core::memory::frame_resource() {
+    if(scoped_resource != nullptr) return scoped_resource;
+    return &current_thread_arena().resource;
+}
+
+frame_arena_scope::frame_arena_scope(linear_arena& arena)
+    : _resource(arena), _previous_arena(scoped_arena), _previous_resource(scoped_resource)
+{
+    scoped_arena = &arena;
+    scoped_resource = &_resource;
+}
+
+frame_arena_scope::~frame_arena_scope() {
+    scoped_arena = _previous_arena;
+    scoped_resource = _previous_resource;
+}
+
+void core::memory::end_frame() {
+    global_frame_index.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t core::memory::frame_index() {
+    return global_frame_index.load(std::memory_order_acquire);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace core::memory {
+
+    // bump allocator: allocations are a pointer increment, nothing is
+    // freed individually, everything goes away at once on reset()
+    class linear_arena {
+    private:
+        struct block {
+            std::byte* data;
+            size_t size;
+        };
+
+        // first block is the "main" one, the rest are overflow blocks
+        // only alive until the next reset
+        std::vector<block> _blocks;
+        size_t _offset;
+        size_t _peak;
+
+        void grow(size_t min_size);
+
+    public:
+        linear_arena(size_t initial_size = 64 * 1024);
+        ~linear_arena();
+
+        linear_arena(const linear_arena&) = delete;
+        linear_arena& operator=(const linear_arena&) = delete;
+
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // if we overflowed during the frame, the blocks get merged into
+        // a single bigger one, so the next frame fits without growing
+        void reset();
+
+        size_t used() const;
+        size_t capacity() const;
+        size_t peak() const;
+    };
+
+    // pmr adapter, so std::pmr containers can sit on top of an arena
+    class arena_resource : public std::pmr::memory_resource {
+    private:
+        linear_arena& _arena;
+
+    public:
+        arena_resource(linear_arena& arena);
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    // per-thread arena that is implicitly reset once per frame:
+    // end_frame() bumps a global frame counter, and every thread's arena
+    // resets itself the first time it's touched on a new frame.
+    // nothing allocated from it may outlive the frame!
+    linear_arena& frame_arena();
+    std::pmr::memory_resource* frame_resource();
+
+    void end_frame();
+    uint64_t frame_index();
+
+    // makes an arena the calling thread's frame arena for as long as it
+    // lives, for work with frames of its own (eg. one world among many on
+    // a server thread). that arena isn't reset by end_frame(), its owner
+    // resets it
+    class frame_arena_scope {
+    private:
+        arena_resource _resource;
+        linear_arena* _previous_arena;
+        std::pmr::memory_resource* _previous_resource;
+
+    public:
+        frame_arena_scope(linear_arena&);
+        ~frame_arena_scope();
+
+        frame_arena_scope(const frame_arena_scope&) = delete;
+        frame_arena_scope& operator=(const frame_arena_scope&) = delete;
+    };
+
+    // containers for per-frame temporaries
+    template<typename T>
+    using frame_vector = std::pmr::vector<T>;
+
+    template<typename T>
+    inline frame_vector<T> make_frame_vector(size_t reserve = 0) {
+        frame_vector<T> v(frame_resource());
+        v.reserve(reserve);
+        return v;
+    }
+}
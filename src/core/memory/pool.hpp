@@ -0,0 +1,137 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <memory_resource>
+#include <vector>
+
+namespace core::memory {
+
+    // fixed-size block allocator for lots of small, same-sized objects.
+    // blocks are carved out of big chunks and recycled through an
+    // intrusive free list, so after warm-up it never touches the heap.
+    // not thread-safe, keep one per thread/system
+    class fixed_pool {
+    private:
+        struct free_node {
+            free_node* next;
+        };
+
+        size_t _block_size;
+        size_t _blocks_per_chunk;
+        size_t _live;
+
+        free_node* _free;
+        std::vector<void*> _chunks;
+
+        void add_chunk() {
+            auto* chunk = static_cast<std::byte*>(::operator new(_block_size * _blocks_per_chunk));
+            _chunks.push_back(chunk);
+
+            // thread the new blocks into the free list, in address order
+            for(size_t i = _blocks_per_chunk; i > 0; i--) {
+                auto* node = reinterpret_cast<free_node*>(chunk + (i - 1) * _block_size);
+                node->next = _free;
+                _free = node;
+            }
+        }
+
+    public:
+        fixed_pool(size_t block_size, size_t blocks_per_chunk = 256)
+            : _block_size(block_size < sizeof(free_node) ? sizeof(free_node) : block_size),
+              _blocks_per_chunk(blocks_per_chunk), _live(0), _free(nullptr)
+        {
+            // keep every block aligned like malloc would
+            constexpr size_t a = alignof(std::max_align_t);
+            _block_size = (_block_size + a - 1) & ~(a - 1);
+        }
+
+        ~fixed_pool() {
+            for(auto* c : _chunks) ::operator delete(c);
+        }
+
+        fixed_pool(const fixed_pool&) = delete;
+        fixed_pool& operator=(const fixed_pool&) = delete;
+
+        void* allocate() {
+            if(_free == nullptr) add_chunk();
+
+            free_node* node = _free;
+            _free = node->next;
+            _live++;
+            return node;
+        }
+
+        void deallocate(void* ptr) {
+            auto* node = static_cast<free_node*>(ptr);
+            node->next = _free;
+            _free = node;
+            _live--;
+        }
+
+        size_t block_size() const { return _block_size; }
+        size_t live() const { return _live; }
+        size_t capacity() const { return _chunks.size() * _blocks_per_chunk; }
+    };
+
+    // typed convenience wrapper, constructs objects in pool blocks
+    template<typename T>
+    class object_pool {
+    private:
+        fixed_pool _pool;
+
+    public:
+        object_pool(size_t objects_per_chunk = 256)
+            : _pool(sizeof(T), objects_per_chunk)
+        {}
+
+        template<typename... Args>
+        T* create(Args&&... args) {
+            return new (_pool.allocate()) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T* object) {
+            object->~T();
+            _pool.deallocate(object);
+        }
+
+        size_t live() const { return _pool.live(); }
+    };
+
+    // pmr adapter: requests that fit in a block come from the pool,
+    // anything bigger (eg. a vector growing) goes to the upstream resource
+    class pool_resource : public std::pmr::memory_resource {
+    private:
+        fixed_pool _pool;
+        std::pmr::memory_resource* _upstream;
+
+    public:
+        pool_resource(
+            size_t block_size,
+            size_t blocks_per_chunk = 256,
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource()
+        ) : _pool(block_size, blocks_per_chunk), _upstream(upstream)
+        {}
+
+        const fixed_pool& pool() const { return _pool; }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if(bytes <= _pool.block_size() && alignment <= alignof(std::max_align_t))
+                return _pool.allocate();
+            return _upstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+            if(bytes <= _pool.block_size() && alignment <= alignof(std::max_align_t))
+                _pool.deallocate(ptr);
+            else
+                _upstream->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
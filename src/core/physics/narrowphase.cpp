@@ -0,0 +1,175 @@
+#include "./narrowphase.hpp"
+#include "./simd.hpp"
+
+using namespace core;
+using namespace core::physics;
+
+namespace {
+    // one body's fields for four pairs, lane i from pair i
+    struct lanes {
+        float4 px, py, pz;
+        float4 hx, hy, hz;
+    };
+
+    // pads the tail with the last pair, those lanes get masked off
+    void gather(const shape_view& v, const body_pair* pairs, size_t count, bool second, lanes& out) {
+        alignas(16) float px[4], py[4], pz[4], hx[4], hy[4], hz[4];
+
+        for(size_t i = 0; i < 4; i++) {
+            const auto& p = pairs[i < count ? i : count - 1];
+            uint32_t b = second ? p.b : p.a;
+
+            px[i] = v.px[b]; py[i] = v.py[b]; pz[i] = v.pz[b];
+            hx[i] = v.hx[b]; hy[i] = v.hy[b]; hz[i] = v.hz[b];
+        }
+
+        out.px = float4::load(px); out.py = float4::load(py); out.pz = float4::load(pz);
+        out.hx = float4::load(hx); out.hy = float4::load(hy); out.hz = float4::load(hz);
+    }
+
+    // pushes a contact for every lane set in hit
+    void emit(
+        int hit, const body_pair* pairs, size_t count,
+        float4 nx, float4 ny, float4 nz, float4 depth,
+        std::pmr::vector<contact>& out)
+    {
+        if(count < 4) hit &= (1 << count) - 1;
+        if(hit == 0) return;
+
+        alignas(16) float x[4], y[4], z[4], d[4];
+        nx.store(x); ny.store(y); nz.store(z); depth.store(d);
+
+        for(size_t i = 0; i < 4; i++) {
+            if((hit & (1 << i)) == 0) continue;
+
+            contact c{};
+            c.a = pairs[i].a;
+            c.b = pairs[i].b;
+            c.normal[0] = x[i];
+            c.normal[1] = y[i];
+            c.normal[2] = z[i];
+            c.depth = d[i];
+            out.push_back(c);
+        }
+    }
+
+    // unit axis along the smallest of the three overlaps, pointing
+    // along d, plus that overlap
+    void min_axis(
+        float4 ox, float4 oy, float4 oz,
+        float4 dx, float4 dy, float4 dz,
+        float4& nx, float4& ny, float4& nz, float4& depth)
+    {
+        const float4 zero(0.0f);
+
+        // ties go x, then y, then z
+        float4 x_min = (ox <= oy) & (ox <= oz);
+        float4 y_min = ~x_min & (oy <= oz);
+        float4 z_min = ~(x_min | y_min);
+
+        nx = select(x_min, sign(dx), zero);
+        ny = select(y_min, sign(dy), zero);
+        nz = select(z_min, sign(dz), zero);
+        depth = select(x_min, ox, select(y_min, oy, oz));
+    }
+}
+
+void physics::collide_spheres(const shape_view& v, const body_pair* pairs, size_t count, std::pmr::vector<contact>& out) {
+    const float4 zero(0.0f), one(1.0f), epsilon(1e-12f);
+
+    for(size_t i = 0; i < count; i += 4) {
+        size_t n = count - i < 4 ? count - i : 4;
+        lanes a, b;
+        gather(v, pairs + i, n, false, a);
+        gather(v, pairs + i, n, true, b);
+
+        float4 dx = b.px - a.px, dy = b.py - a.py, dz = b.pz - a.pz;
+        float4 radii = a.hx + b.hx;
+        float4 distance2 = dx * dx + dy * dy + dz * dz;
+
+        int hit = (distance2 < radii * radii).mask();
+        if(hit == 0) continue;
+
+        // concentric spheres get pushed apart along +y
+        float4 distance = sqrt(distance2);
+        float4 apart = distance2 > epsilon;
+        float4 safe = select(apart, distance, one);
+
+        float4 nx = select(apart, dx / safe, zero);
+        float4 ny = select(apart, dy / safe, one);
+        float4 nz = select(apart, dz / safe, zero);
+
+        emit(hit, pairs + i, n, nx, ny, nz, radii - distance, out);
+    }
+}
+
+void physics::collide_boxes(const shape_view& v, const body_pair* pairs, size_t count, std::pmr::vector<contact>& out) {
+    const float4 zero(0.0f);
+
+    for(size_t i = 0; i < count; i += 4) {
+        size_t n = count - i < 4 ? count - i : 4;
+        lanes a, b;
+        gather(v, pairs + i, n, false, a);
+        gather(v, pairs + i, n, true, b);
+
+        float4 dx = b.px - a.px, dy = b.py - a.py, dz = b.pz - a.pz;
+
+        // overlap on each axis, they touch if all three are positive
+        float4 ox = a.hx + b.hx - abs(dx);
+        float4 oy = a.hy + b.hy - abs(dy);
+        float4 oz = a.hz + b.hz - abs(dz);
+
+        int hit = ((ox > zero) & (oy > zero) & (oz > zero)).mask();
+        if(hit == 0) continue;
+
+        float4 nx, ny, nz, depth;
+        min_axis(ox, oy, oz, dx, dy, dz, nx, ny, nz, depth);
+
+        emit(hit, pairs + i, n, nx, ny, nz, depth, out);
+    }
+}
+
+void physics::collide_box_sphere(const shape_view& v, const body_pair* pairs, size_t count, std::pmr::vector<contact>& out) {
+    const float4 zero(0.0f), one(1.0f);
+
+    for(size_t i = 0; i < count; i += 4) {
+        size_t n = count - i < 4 ? count - i : 4;
+        lanes box, sphere;
+        gather(v, pairs + i, n, false, box);
+        gather(v, pairs + i, n, true, sphere);
+
+        float4 dx = sphere.px - box.px, dy = sphere.py - box.py, dz = sphere.pz - box.pz;
+        float4 radius = sphere.hx;
+
+        // closest point on the box to the sphere's center, box space
+        float4 qx = min(max(dx, zero - box.hx), box.hx);
+        float4 qy = min(max(dy, zero - box.hy), box.hy);
+        float4 qz = min(max(dz, zero - box.hz), box.hz);
+
+        float4 ex = dx - qx, ey = dy - qy, ez = dz - qz;
+        float4 distance2 = ex * ex + ey * ey + ez * ez;
+
+        // center inside the box: the closest point is the center itself
+        float4 inside = ~(distance2 > zero);
+
+        int hit = (inside | (distance2 < radius * radius)).mask();
+        if(hit == 0) continue;
+
+        // outside, push along the center - closest point direction
+        float4 distance = sqrt(distance2);
+        float4 safe = select(inside, one, distance);
+        float4 nx = ex / safe, ny = ey / safe, nz = ez / safe;
+        float4 depth = radius - distance;
+
+        // inside, push out through the nearest face
+        float4 ix, iy, iz, face_depth;
+        min_axis(box.hx - abs(dx), box.hy - abs(dy), box.hz - abs(dz), dx, dy, dz, ix, iy, iz, face_depth);
+
+        nx = select(inside, ix, nx);
+        ny = select(inside, iy, ny);
+        nz = select(inside, iz, nz);
+        depth = select(inside, face_depth + radius, depth);
+
+        emit(hit, pairs + i, n, nx, ny, nz, depth, out);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <memory_resource>
+#include <cstddef>
+#include <cstdint>
+
+namespace core::physics {
+    // shapes don't rotate: boxes stay axis aligned and spheres are
+    // spheres (circles when the simulation is planar)
+    enum class shape : uint8_t {
+        sphere,
+        box
+    };
+
+    // dense indices of two bodies whose bounds overlap
+    struct body_pair {
+        uint32_t a, b;
+    };
+
+    // two bodies touching. normal points from a to b
+    struct contact {
+        uint32_t a, b;
+        float normal[3];
+        float depth;
+
+        // filled in by the solver
+        float mass;
+        float target;
+        float friction;
+        float normal_impulse;
+    };
+
+    // what the narrowphase reads, straight from the SoA storage.
+    // h is the radius on all three axes for spheres
+    struct shape_view {
+        const float *px, *py, *pz;
+        const float *hx, *hy, *hz;
+    };
+
+    // each one tests four pairs at a time and appends a contact for every
+    // pair that touches, in pair order
+    void collide_spheres(const shape_view&, const body_pair*, size_t count, std::pmr::vector<contact>&);
+    void collide_boxes(const shape_view&, const body_pair*, size_t count, std::pmr::vector<contact>&);
+    // a is the box, b the sphere
+    void collide_box_sphere(const shape_view&, const body_pair*, size_t count, std::pmr::vector<contact>&);
+}
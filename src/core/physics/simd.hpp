@@ -0,0 +1,136 @@
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define PHYSICS_SSE
+    #include <emmintrin.h>
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace core::physics {
+    // four floats processed at once. SSE2 where it's there, plain loops
+    // otherwise. both paths do the same IEEE operations in the same order
+    // so results don't depend on which one got compiled in (no FMA, no
+    // reciprocal approximations)
+#ifdef PHYSICS_SSE
+    struct float4 {
+        __m128 v;
+
+        float4() = default;
+        float4(__m128 v) : v(v) {}
+        explicit float4(float s) : v(_mm_set1_ps(s)) {}
+
+        static float4 load(const float* p) { return _mm_loadu_ps(p); }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+
+        // lanes set to all ones/zeros, from comparisons
+        int mask() const { return _mm_movemask_ps(v); }
+    };
+
+    inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+    inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+    inline float4 operator<(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    inline float4 operator>(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    inline float4 operator<=(float4 a, float4 b) { return _mm_cmple_ps(a.v, b.v); }
+    inline float4 operator&(float4 a, float4 b) { return _mm_and_ps(a.v, b.v); }
+    inline float4 operator|(float4 a, float4 b) { return _mm_or_ps(a.v, b.v); }
+    inline float4 operator~(float4 a) { return _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+
+    inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+    inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+    inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+    inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+    // +1/-1 from the sign bit, so 0 is +1 and -0 is -1
+    inline float4 sign(float4 a) {
+        return _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(_mm_set1_ps(-0.0f), a.v));
+    }
+
+    // mask ? a : b
+    inline float4 select(float4 mask, float4 a, float4 b) {
+        return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+    }
+#else
+    struct float4 {
+        float v[4];
+
+        float4() = default;
+        explicit float4(float s) : v{ s, s, s, s } {}
+
+        static float4 load(const float* p) { float4 r; for(int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+        void store(float* p) const { for(int i = 0; i < 4; i++) p[i] = v[i]; }
+
+        int mask() const {
+            int m = 0;
+            for(int i = 0; i < 4; i++) if(std::signbit(v[i])) m |= 1 << i;
+            return m;
+        }
+    };
+
+    namespace detail {
+        inline float from_bool(bool b) {
+            uint32_t bits = b ? 0xffffffffu : 0u;
+            float f;
+            memcpy(&f, &bits, 4);
+            return f;
+        }
+
+        inline uint32_t bits(float f) {
+            uint32_t b;
+            memcpy(&b, &f, 4);
+            return b;
+        }
+
+        inline float from_bits(uint32_t b) {
+            float f;
+            memcpy(&f, &b, 4);
+            return f;
+        }
+
+        template<typename F>
+        inline float4 each(float4 a, float4 b, F f) {
+            float4 r;
+            for(int i = 0; i < 4; i++) r.v[i] = f(a.v[i], b.v[i]);
+            return r;
+        }
+    }
+
+    inline float4 operator+(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x + y; }); }
+    inline float4 operator-(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x - y; }); }
+    inline float4 operator*(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x * y; }); }
+    inline float4 operator/(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x / y; }); }
+    inline float4 operator<(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return detail::from_bool(x < y); }); }
+    inline float4 operator>(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return detail::from_bool(x > y); }); }
+    inline float4 operator<=(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return detail::from_bool(x <= y); }); }
+    inline float4 operator&(float4 a, float4 b) {
+        return detail::each(a, b, [](float x, float y) { return detail::from_bits(detail::bits(x) & detail::bits(y)); });
+    }
+    inline float4 operator|(float4 a, float4 b) {
+        return detail::each(a, b, [](float x, float y) { return detail::from_bits(detail::bits(x) | detail::bits(y)); });
+    }
+
+    inline float4 operator~(float4 a) {
+        return detail::each(a, a, [](float x, float) { return detail::from_bits(~detail::bits(x)); });
+    }
+
+    // same NaN/zero handling as minps/maxps: the second operand wins ties
+    inline float4 min(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline float4 max(float4 a, float4 b) { return detail::each(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline float4 sqrt(float4 a) { return detail::each(a, a, [](float x, float) { return std::sqrt(x); }); }
+    inline float4 abs(float4 a) { return detail::each(a, a, [](float x, float) { return std::fabs(x); }); }
+
+    inline float4 sign(float4 a) {
+        return detail::each(a, a, [](float x, float) { return std::signbit(x) ? -1.0f : 1.0f; });
+    }
+
+    inline float4 select(float4 mask, float4 a, float4 b) {
+        float4 r;
+        for(int i = 0; i < 4; i++) r.v[i] = detail::bits(mask.v[i]) ? a.v[i] : b.v[i];
+        return r;
+    }
+#endif
+}
@@ -0,0 +1,444 @@
+#include "./simulation.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+using namespace core::physics;
+
+namespace {
+    const uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    // fraction of the penetration fixed per step, and how much is let go
+    // so resting contacts don't jitter
+    const float baumgarte = 0.2f;
+    const float slop = 0.005f;
+    // slower impacts than this don't bounce
+    const float restitution_threshold = 1.0f;
+
+    const float planar_depth = 1e30f;
+}
+
+simulation::simulation(const settings& s, jobs::thread_pool* jobs, std::pmr::memory_resource* memory)
+    : _settings(s), _jobs(jobs), _accumulator(0.0f),
+      _px(memory), _py(memory), _pz(memory),
+      _vx(memory), _vy(memory), _vz(memory),
+      _hx(memory), _hy(memory), _hz(memory),
+      _inv_mass(memory), _restitution(memory), _friction(memory),
+      _type(memory),
+      _ids(memory), _dense(memory), _free_ids(memory),
+      _order(memory), _min_x(memory), _resort(false),
+      _sphere_pairs(memory), _box_pairs(memory), _mixed_pairs(memory),
+      _contacts(memory), _sorted_contacts(memory),
+      _parent(memory), _island_of(memory), _island_offsets(memory),
+      _stats{}
+{
+    ASSERT(s.fixed_delta > 0.0f, "Physics needs a positive fixed delta");
+}
+
+body_id simulation::add_body(const body_desc& desc) {
+    uint32_t index = _px.size();
+
+    body_id id;
+    if(_free_ids.empty()) {
+        id = _dense.size();
+        _dense.push_back(index);
+    } else {
+        id = _free_ids.back();
+        _free_ids.pop_back();
+        _dense[id] = index;
+    }
+    _ids.push_back(id);
+
+    bool planar = _settings.planar;
+    _px.push_back(desc.position[0]);
+    _py.push_back(desc.position[1]);
+    _pz.push_back(planar ? 0.0f : desc.position[2]);
+    _vx.push_back(desc.velocity[0]);
+    _vy.push_back(desc.velocity[1]);
+    _vz.push_back(planar ? 0.0f : desc.velocity[2]);
+
+    // spheres keep their radius on every axis, so bounds work the same.
+    // planar boxes are as deep as they can be, so z is never the axis
+    // they get pushed apart on
+    bool sphere = desc.type == shape::sphere;
+    _hx.push_back(desc.extents[0]);
+    _hy.push_back(sphere ? desc.extents[0] : desc.extents[1]);
+    _hz.push_back(sphere ? desc.extents[0] : planar ? planar_depth : desc.extents[2]);
+
+    _inv_mass.push_back(desc.mass > 0.0f ? 1.0f / desc.mass : 0.0f);
+    _restitution.push_back(desc.restitution);
+    _friction.push_back(desc.friction);
+    _type.push_back(desc.type);
+
+    // new bodies land anywhere in x, a full sort is cheaper than the
+    // insertion sort fixing that up
+    _order.push_back(index);
+    _resort = true;
+
+    return id;
+}
+
+void simulation::remove_body(body_id id) {
+    ASSERT(valid(id), "Removing a body that doesn't exist");
+
+    uint32_t index = _dense[id];
+    uint32_t last = _px.size() - 1;
+
+    std::pmr::vector<float>* floats[] = {
+        &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_hx, &_hy, &_hz,
+        &_inv_mass, &_restitution, &_friction
+    };
+
+    for(auto* v : floats) {
+        (*v)[index] = (*v)[last];
+        v->pop_back();
+    }
+    _type[index] = _type[last];
+    _type.pop_back();
+
+    _ids[index] = _ids[last];
+    _ids.pop_back();
+    if(index != last) _dense[_ids[index]] = index;
+
+    _dense[id] = none;
+    _free_ids.push_back(id);
+
+    // the body that moved keeps its place in the sweep order, under its
+    // new index
+    _order.erase(std::find(_order.begin(), _order.end(), index));
+    for(auto& o : _order) {
+        if(o == last) o = index;
+    }
+}
+
+bool simulation::valid(body_id id) const {
+    return id < _dense.size() && _dense[id] != none;
+}
+
+uint32_t simulation::advance(float delta) {
+    _accumulator += delta;
+
+    uint32_t steps = 0;
+    while(_accumulator >= _settings.fixed_delta && steps < _settings.max_steps) {
+        step();
+        _accumulator -= _settings.fixed_delta;
+        steps++;
+    }
+
+    // too far behind to catch up, let the time go
+    if(_accumulator >= _settings.fixed_delta) _accumulator = 0.0f;
+
+    _stats.steps = steps;
+    return steps;
+}
+
+void simulation::step() {
+    float dt = _settings.fixed_delta;
+    uint32_t count = _px.size();
+
+    // gravity
+    const float* g = _settings.gravity;
+    for(uint32_t i = 0; i < count; i++) {
+        if(_inv_mass[i] == 0.0f) continue;
+
+        _vx[i] += g[0] * dt;
+        _vy[i] += g[1] * dt;
+        _vz[i] = _settings.planar ? 0.0f : _vz[i] + g[2] * dt;
+    }
+
+    broadphase();
+    narrowphase();
+    build_islands();
+
+    uint32_t islands = _island_offsets.empty() ? 0 : _island_offsets.size() - 1;
+
+    // islands share no dynamic body, the order they run in doesn't matter
+    if(_jobs != nullptr && islands > 1) {
+        _jobs->parallel_for(islands, [this](uint32_t island, uint32_t) {
+            solve_island(island);
+        });
+    } else {
+        for(uint32_t i = 0; i < islands; i++) solve_island(i);
+    }
+
+    integrate_positions(dt);
+
+    _stats.bodies = count;
+    _stats.contacts = _contacts.size();
+    _stats.islands = islands;
+}
+
+// STAGES
+
+void simulation::broadphase() {
+    uint32_t count = _px.size();
+
+    _min_x.resize(count);
+    for(uint32_t i = 0; i < count; i++) _min_x[i] = _px[i] - _hx[i];
+
+    // ids break ties, so the order never depends on where it started from
+    auto less = [this](uint32_t a, uint32_t b) {
+        if(_min_x[a] != _min_x[b]) return _min_x[a] < _min_x[b];
+        return _ids[a] < _ids[b];
+    };
+
+    if(_resort) {
+        std::sort(_order.begin(), _order.end(), less);
+        _resort = false;
+    } else {
+        // bodies barely move between steps, so this is close to linear
+        for(uint32_t i = 1; i < count; i++) {
+            uint32_t v = _order[i];
+            uint32_t j = i;
+            for(; j > 0 && less(v, _order[j - 1]); j--) _order[j] = _order[j - 1];
+            _order[j] = v;
+        }
+    }
+
+    _sphere_pairs.clear();
+    _box_pairs.clear();
+    _mixed_pairs.clear();
+
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t a = _order[i];
+        float max_x = _px[a] + _hx[a];
+
+        for(uint32_t j = i + 1; j < count; j++) {
+            uint32_t b = _order[j];
+            if(_min_x[b] > max_x) break;
+
+            if(_inv_mass[a] == 0.0f && _inv_mass[b] == 0.0f) continue;
+            if(std::fabs(_py[a] - _py[b]) > _hy[a] + _hy[b]) continue;
+            if(std::fabs(_pz[a] - _pz[b]) > _hz[a] + _hz[b]) continue;
+
+            bool a_sphere = _type[a] == shape::sphere;
+            bool b_sphere = _type[b] == shape::sphere;
+
+            if(a_sphere && b_sphere)        _sphere_pairs.push_back({ a, b });
+            else if(!a_sphere && !b_sphere) _box_pairs.push_back({ a, b });
+            else if(b_sphere)               _mixed_pairs.push_back({ a, b });
+            else                            _mixed_pairs.push_back({ b, a });
+        }
+    }
+
+    _stats.pairs = _sphere_pairs.size() + _box_pairs.size() + _mixed_pairs.size();
+}
+
+void simulation::narrowphase() {
+    _contacts.clear();
+
+    shape_view view{
+        _px.data(), _py.data(), _pz.data(),
+        _hx.data(), _hy.data(), _hz.data()
+    };
+
+    collide_spheres(view, _sphere_pairs.data(), _sphere_pairs.size(), _contacts);
+    collide_boxes(view, _box_pairs.data(), _box_pairs.size(), _contacts);
+    collide_box_sphere(view, _mixed_pairs.data(), _mixed_pairs.size(), _contacts);
+}
+
+uint32_t simulation::find(uint32_t i) {
+    while(_parent[i] != i) {
+        _parent[i] = _parent[_parent[i]];
+        i = _parent[i];
+    }
+    return i;
+}
+
+void simulation::build_islands() {
+    uint32_t count = _px.size();
+
+    // dynamic bodies touching each other end up under the same root.
+    // static bodies never join, or the floor would make one big island
+    _parent.resize(count);
+    for(uint32_t i = 0; i < count; i++) _parent[i] = i;
+
+    for(auto& c : _contacts) {
+        if(_inv_mass[c.a] == 0.0f || _inv_mass[c.b] == 0.0f) continue;
+
+        uint32_t a = find(c.a), b = find(c.b);
+        // the lower index wins, so roots don't depend on timing
+        if(a < b) _parent[b] = a;
+        else if(b < a) _parent[a] = b;
+    }
+
+    // islands are numbered in contact order
+    _island_of.assign(count, none);
+    _island_offsets.clear();
+    _island_offsets.push_back(0);
+
+    auto island = [this](const contact& c) {
+        return _island_of[find(_inv_mass[c.a] != 0.0f ? c.a : c.b)];
+    };
+
+    for(auto& c : _contacts) {
+        uint32_t root = find(_inv_mass[c.a] != 0.0f ? c.a : c.b);
+        if(_island_of[root] == none) {
+            _island_of[root] = _island_offsets.size() - 1;
+            _island_offsets.push_back(0);
+        }
+        _island_offsets[_island_of[root] + 1]++;
+    }
+
+    // stable counting sort by island, offsets[i] ends up where island i starts
+    uint32_t islands = _island_offsets.size() - 1;
+    for(uint32_t i = 1; i <= islands; i++) _island_offsets[i] += _island_offsets[i - 1];
+
+    _sorted_contacts.resize(_contacts.size());
+    for(auto& c : _contacts) _sorted_contacts[_island_offsets[island(c)]++] = c;
+
+    for(uint32_t i = islands; i > 0; i--) _island_offsets[i] = _island_offsets[i - 1];
+    _island_offsets[0] = 0;
+}
+
+void simulation::solve_island(uint32_t island) {
+    contact* begin = _sorted_contacts.data() + _island_offsets[island];
+    contact* end = _sorted_contacts.data() + _island_offsets[island + 1];
+
+    float dt = _settings.fixed_delta;
+
+    for(contact* c = begin; c != end; c++) {
+        uint32_t a = c->a, b = c->b;
+        const float* n = c->normal;
+
+        float vn =
+            (_vx[b] - _vx[a]) * n[0] +
+            (_vy[b] - _vy[a]) * n[1] +
+            (_vz[b] - _vz[a]) * n[2];
+
+        // bounce off fast impacts, push out of overlaps otherwise
+        float restitution = std::max(_restitution[a], _restitution[b]);
+        float bounce = vn < -restitution_threshold ? -restitution * vn : 0.0f;
+        float bias = baumgarte / dt * std::max(c->depth - slop, 0.0f);
+
+        c->mass = 1.0f / (_inv_mass[a] + _inv_mass[b]);
+        c->target = std::max(bounce, bias);
+        c->friction = std::sqrt(_friction[a] * _friction[b]);
+        c->normal_impulse = 0.0f;
+    }
+
+    // static bodies are shared between islands, only dynamic ones get written
+    auto apply = [this](uint32_t a, uint32_t b, float x, float y, float z) {
+        float ia = _inv_mass[a], ib = _inv_mass[b];
+        if(ia != 0.0f) {
+            _vx[a] -= x * ia;
+            _vy[a] -= y * ia;
+            _vz[a] -= z * ia;
+        }
+        if(ib != 0.0f) {
+            _vx[b] += x * ib;
+            _vy[b] += y * ib;
+            _vz[b] += z * ib;
+        }
+    };
+
+    for(uint32_t iteration = 0; iteration < _settings.iterations; iteration++) {
+        for(contact* c = begin; c != end; c++) {
+            uint32_t a = c->a, b = c->b;
+            const float* n = c->normal;
+
+            float rx = _vx[b] - _vx[a];
+            float ry = _vy[b] - _vy[a];
+            float rz = _vz[b] - _vz[a];
+            float vn = rx * n[0] + ry * n[1] + rz * n[2];
+
+            // accumulated impulses can shrink but never pull
+            float lambda = c->mass * (c->target - vn);
+            float previous = c->normal_impulse;
+            c->normal_impulse = std::max(previous + lambda, 0.0f);
+            lambda = c->normal_impulse - previous;
+
+            apply(a, b, n[0] * lambda, n[1] * lambda, n[2] * lambda);
+
+            // friction against whatever sliding is left, up to mu * normal
+            rx = _vx[b] - _vx[a];
+            ry = _vy[b] - _vy[a];
+            rz = _vz[b] - _vz[a];
+            vn = rx * n[0] + ry * n[1] + rz * n[2];
+
+            float tx = rx - n[0] * vn, ty = ry - n[1] * vn, tz = rz - n[2] * vn;
+            float sliding = std::sqrt(tx * tx + ty * ty + tz * tz);
+            if(sliding < 1e-6f) continue;
+
+            float limit = c->friction * c->normal_impulse;
+            float friction = std::min(c->mass * sliding, limit) / sliding;
+
+            apply(a, b, -tx * friction, -ty * friction, -tz * friction);
+        }
+    }
+}
+
+void simulation::integrate_positions(float dt) {
+    uint32_t count = _px.size();
+
+    for(uint32_t i = 0; i < count; i++) {
+        _px[i] += _vx[i] * dt;
+        _py[i] += _vy[i] * dt;
+        _pz[i] += _vz[i] * dt;
+    }
+}
+
+// QUERIES
+
+void simulation::position(body_id id, float out[3]) const {
+    uint32_t i = _dense[id];
+    out[0] = _px[i];
+    out[1] = _py[i];
+    out[2] = _pz[i];
+}
+
+void simulation::velocity(body_id id, float out[3]) const {
+    uint32_t i = _dense[id];
+    out[0] = _vx[i];
+    out[1] = _vy[i];
+    out[2] = _vz[i];
+}
+
+void simulation::set_velocity(body_id id, const float v[3]) {
+    uint32_t i = _dense[id];
+    if(_inv_mass[i] == 0.0f) return;
+
+    _vx[i] = v[0];
+    _vy[i] = v[1];
+    _vz[i] = _settings.planar ? 0.0f : v[2];
+}
+
+uint32_t simulation::body_count() const {
+    return _px.size();
+}
+
+const settings& simulation::get_settings() const {
+    return _settings;
+}
+
+const simulation::stats& simulation::get_stats() const {
+    return _stats;
+}
+
+uint64_t simulation::state_hash() const {
+    uint64_t hash = 14695981039346656037ull;
+
+    auto mix = [&hash](float f) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        for(int i = 0; i < 4; i++) {
+            hash ^= (bits >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    for(body_id id = 0; id < _dense.size(); id++) {
+        if(!valid(id)) continue;
+
+        uint32_t i = _dense[id];
+        mix(_px[i]); mix(_py[i]); mix(_pz[i]);
+        mix(_vx[i]); mix(_vy[i]); mix(_vz[i]);
+    }
+
+    return hash;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core/jobs/thread_pool.hpp"
+#include "core/physics/narrowphase.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <memory_resource>
+
+namespace core::physics {
+    using body_id = uint32_t;
+
+    struct body_desc {
+        shape type = shape::sphere;
+        float position[3] = { 0.0f, 0.0f, 0.0f };
+        float velocity[3] = { 0.0f, 0.0f, 0.0f };
+        // sphere radius, or box half extents
+        float extents[3] = { 0.5f, 0.5f, 0.5f };
+        // 0 makes it static
+        float mass = 1.0f;
+        float restitution = 0.0f;
+        float friction = 0.5f;
+    };
+
+    struct settings {
+        float gravity[3] = { 0.0f, -9.81f, 0.0f };
+        float fixed_delta = 1.0f / 60.0f;
+        // advance() drops time past this many steps, so a hitch doesn't
+        // snowball into longer and longer frames
+        uint32_t max_steps = 4;
+        uint32_t iterations = 8;
+        // 2D: z is pinned to 0
+        bool planar = false;
+    };
+
+    // rigid bodies in structure-of-arrays form, stepped at a fixed rate.
+    //
+    // a step is: gravity -> sweep-and-prune broadphase -> SIMD
+    // narrowphase -> contacts grouped into islands -> islands solved in
+    // parallel -> positions integrated. every stage visits bodies and
+    // pairs in an order that only depends on the inputs, and islands
+    // share no dynamic bodies, so the result is bit-identical for the
+    // same inputs no matter how many threads solve it.
+    // steady-state steps don't allocate
+    class simulation {
+    public:
+        struct stats {
+            uint32_t bodies;
+            uint32_t pairs;
+            uint32_t contacts;
+            uint32_t islands;
+            uint32_t steps;
+        };
+
+    private:
+        settings _settings;
+        jobs::thread_pool* _jobs;
+        float _accumulator;
+
+        // dense SoA storage, removal swaps the last body in
+        std::pmr::vector<float> _px, _py, _pz;
+        std::pmr::vector<float> _vx, _vy, _vz;
+        std::pmr::vector<float> _hx, _hy, _hz;
+        std::pmr::vector<float> _inv_mass, _restitution, _friction;
+        std::pmr::vector<shape> _type;
+
+        // body_id <-> dense index
+        std::pmr::vector<body_id> _ids;
+        std::pmr::vector<uint32_t> _dense;
+        std::pmr::vector<body_id> _free_ids;
+
+        // dense indices sorted by AABB min x, kept between steps so the
+        // insertion sort only has to fix up what moved
+        std::pmr::vector<uint32_t> _order;
+        std::pmr::vector<float> _min_x;
+        bool _resort;
+
+        // per-step scratch, cleared but never shrunk
+        std::pmr::vector<body_pair> _sphere_pairs, _box_pairs, _mixed_pairs;
+        std::pmr::vector<contact> _contacts, _sorted_contacts;
+        std::pmr::vector<uint32_t> _parent;
+        std::pmr::vector<uint32_t> _island_of;
+        std::pmr::vector<uint32_t> _island_offsets;
+
+        stats _stats;
+
+        void broadphase();
+        void narrowphase();
+        void build_islands();
+        void solve_island(uint32_t island);
+        void integrate_positions(float dt);
+
+        uint32_t find(uint32_t);
+
+    public:
+        // jobs is optional, islands are solved on the calling thread without
+        // it. every body and all step scratch live in memory
+        simulation(const settings& = {}, jobs::thread_pool* jobs = nullptr,
+            std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+        body_id add_body(const body_desc&);
+        void remove_body(body_id);
+        bool valid(body_id) const;
+
+        // runs as many fixed steps as fit in delta, returns how many ran
+        uint32_t advance(float delta);
+        void step();
+
+        void position(body_id, float out[3]) const;
+        void velocity(body_id, float out[3]) const;
+        void set_velocity(body_id, const float v[3]);
+
+        uint32_t body_count() const;
+        const settings& get_settings() const;
+        const stats& get_stats() const;
+
+        // FNV-1a over every body's position and velocity bits, in id
+        // order. two runs that agree here agree everywhere
+        uint64_t state_hash() const;
+    };
+}
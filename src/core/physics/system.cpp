@@ -0,0 +1,46 @@
+#include "./system.hpp"
+
+#include "components/components.hpp"
+
+using namespace core;
+
+void physics::register_physics(world& w, simulation& sim) {
+    w.add_update_system([&sim](world& w) {
+        if(sim.advance(w.get_resource<world::delta_time>()) == 0) return;
+
+        auto& registry = w.get_registry();
+        auto view = registry.view<components::transform, const components::rigid_body>();
+
+        for(auto [entity, transform, body] : view.each()) {
+            float p[3];
+            sim.position(body.id, p);
+
+            transform.position.x = p[0];
+            transform.position.y = p[1];
+            transform.position.z = p[2];
+        }
+    });
+}
+
+physics::body_id physics::attach_body(world& w, simulation& sim, entt::entity entity, body_desc desc) {
+    auto& registry = w.get_registry();
+
+    if(registry.all_of<components::transform>(entity)) {
+        auto& transform = registry.get<components::transform>(entity);
+        desc.position[0] = transform.position.x;
+        desc.position[1] = transform.position.y;
+        desc.position[2] = transform.position.z;
+    }
+
+    body_id id = sim.add_body(desc);
+    registry.emplace_or_replace<components::rigid_body>(entity, id);
+    return id;
+}
+
+void physics::detach_body(world& w, simulation& sim, entt::entity entity) {
+    auto& registry = w.get_registry();
+    if(!registry.all_of<components::rigid_body>(entity)) return;
+
+    sim.remove_body(registry.get<components::rigid_body>(entity).id);
+    registry.remove<components::rigid_body>(entity);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "entt/entt.hpp"
+#include "core/ecs/world.hpp"
+#include "core/physics/simulation.hpp"
+
+namespace core::physics {
+    // steps the simulation from the world's update at its fixed rate and
+    // copies body positions into the transforms of entities that have a
+    // components::rigid_body. the simulation has to stay alive for as long
+    // as the world updates
+    void register_physics(world&, simulation&);
+
+    // creates a body at the entity's transform (desc.position is ignored
+    // if it has one) and links the two
+    body_id attach_body(world&, simulation&, entt::entity, body_desc);
+    void detach_body(world&, simulation&, entt::entity);
+}
@@ -0,0 +1,235 @@
+#include "./shader_compiler.hpp"
+
+#include "utils/log.hpp"
+#include "utils/file.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
+
+#ifdef GAME_HAS_SHADERC
+    #include <shaderc/shaderc.h>
+#endif
+
+using namespace core;
+
+static std::string extension_of(const std::string& path) {
+    auto dot = path.find_last_of('.');
+    return dot == std::string::npos ? "" : path.substr(dot + 1);
+}
+
+static std::string directory_of(const std::string& path) {
+    auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// the files named by #include "..." or #include <...>, relative to the
+// including file
+static std::vector<std::string> includes_of(const std::string& path, const std::string& source) {
+    std::vector<std::string> out;
+
+    size_t line = 0;
+    while(line < source.size()) {
+        size_t end = source.find('\n', line);
+        if(end == std::string::npos) end = source.size();
+
+        size_t i = source.find_first_not_of(" \t", line);
+        if(i < end && source.compare(i, 8, "#include") == 0) {
+            size_t open = source.find_first_of("\"<", i + 8);
+            if(open < end) {
+                size_t close = source.find_first_of("\">", open + 1);
+                if(close < end) out.push_back(directory_of(path) + source.substr(open + 1, close - open - 1));
+            }
+        }
+
+        line = end + 1;
+    }
+    return out;
+}
+
+shader_compiler::shader_compiler(std::string cache_dir)
+    : _cache_dir(std::move(cache_dir))
+{
+    std::error_code err;
+    std::filesystem::create_directories(_cache_dir, err);
+}
+
+// FNV-1a, good enough to tell shader sources apart
+uint64_t shader_compiler::hash(const char* data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool shader_compiler::is_shader_source(const std::string& path) {
+    auto ext = extension_of(path);
+    return ext == "vert" || ext == "frag" || ext == "comp" || ext == "geom";
+}
+
+uint64_t shader_compiler::key(const std::string& path, const std::string& source) {
+    std::string keyed = extension_of(path) + '\0' + path + '\0' + source;
+
+    // includes of includes too, each file once
+    std::vector<std::string> pending = includes_of(path, source), seen;
+    while(!pending.empty()) {
+        auto include = std::move(pending.back());
+        pending.pop_back();
+
+        bool done = false;
+        for(auto& s : seen) done |= s == include;
+        if(done) continue;
+        seen.push_back(include);
+
+        auto contents = utils::file::read_contents(include);
+        keyed += '\0' + include + '\0' + contents;
+
+        auto nested = includes_of(include, contents);
+        pending.insert(pending.end(), nested.begin(), nested.end());
+    }
+
+    return hash(keyed.data(), keyed.size());
+}
+
+void shader_compiler::mark_current(const std::string& path) {
+    auto source = utils::file::read_contents(path);
+    _last_hash[path] = key(path, source);
+}
+
+std::vector<std::string> shader_compiler::sources() const {
+    std::vector<std::string> out;
+    for(auto& [path, h] : _last_hash) out.push_back(path);
+    return out;
+}
+
+std::optional<shader_compiler::result> shader_compiler::compile(const std::string& path) {
+    auto source = utils::file::read_contents(path);
+
+    // editors like to write the file in several steps, skip the empty ones
+    if(source.empty()) return {};
+
+    uint64_t h = key(path, source);
+
+    auto last = _last_hash.find(path);
+    if(last != _last_hash.end() && last->second == h) return {};
+
+    auto cached = _cache.find(h);
+    if(cached == _cache.end()) {
+        std::string cache_path = _cache_dir + std::to_string(h) + ".spv";
+        auto spirv = utils::file::read_binary(cache_path);
+
+        if(spirv.empty()) {
+            auto compiled = compile_source(path, source);
+            if(!compiled.has_value()) return {};
+
+            spirv = std::move(compiled.value());
+
+            std::ofstream out(cache_path, std::ios::binary);
+            out.write(spirv.data(), spirv.size());
+        }
+
+        cached = _cache.emplace(h, std::move(spirv)).first;
+    }
+
+    _last_hash[path] = h;
+
+    return result { path, h, cached->second };
+}
+
+#ifdef GAME_HAS_SHADERC
+
+namespace {
+    // what an include_result points into, freed by release_include
+    struct include_data {
+        std::string name, contents;
+        shaderc_include_result result;
+    };
+
+    shaderc_include_result* resolve_include(
+        void*, const char* requested, int, const char* requesting, size_t
+    ) {
+        auto data = new include_data();
+        data->name = directory_of(requesting) + requested;
+        data->contents = utils::file::read_contents(data->name);
+
+        // an empty name tells shaderc the include failed, the contents
+        // are the error then
+        if(data->contents.empty()) {
+            data->contents = "can't read " + data->name;
+            data->name.clear();
+        }
+
+        data->result = {
+            data->name.data(), data->name.size(),
+            data->contents.data(), data->contents.size(),
+            data
+        };
+        return &data->result;
+    }
+
+    void release_include(void*, shaderc_include_result* result) {
+        delete static_cast<include_data*>(result->user_data);
+    }
+}
+
+std::optional<std::vector<char>> shader_compiler::compile_source(
+    const std::string& path, const std::string& source
+) {
+    auto ext = extension_of(path);
+    shaderc_shader_kind kind =
+        ext == "vert" ? shaderc_vertex_shader :
+        ext == "frag" ? shaderc_fragment_shader :
+        ext == "comp" ? shaderc_compute_shader :
+        shaderc_geometry_shader;
+
+    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_include_callbacks(options, resolve_include, release_include, nullptr);
+
+    shaderc_compilation_result_t compiled = shaderc_compile_into_spv(
+        compiler, source.data(), source.size(), kind, path.c_str(), "main", options);
+
+    std::optional<std::vector<char>> spirv;
+
+    if(shaderc_result_get_compilation_status(compiled) == shaderc_compilation_status_success) {
+        const char* bytes = shaderc_result_get_bytes(compiled);
+        spirv = std::vector<char>(bytes, bytes + shaderc_result_get_length(compiled));
+    } else {
+        LOG("[SHADER] %s", shaderc_result_get_error_message(compiled));
+    }
+
+    shaderc_result_release(compiled);
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+
+    return spirv;
+}
+
+#else
+
+std::optional<std::vector<char>> shader_compiler::compile_source(
+    const std::string& path, const std::string&
+) {
+    const char* glslc = std::getenv("GLSLC");
+    std::string output = _cache_dir + "compiling.spv";
+
+    // compiler output ends up on stderr, so errors still show in the console
+    std::string command =
+        std::string(glslc ? glslc : "glslc") + " \"" + path + "\" -o \"" + output + "\"";
+
+    if(std::system(command.c_str()) != 0) {
+        LOG("[SHADER] failed to compile %s", path.c_str());
+        return {};
+    }
+
+    auto spirv = utils::file::read_binary(output);
+    std::remove(output.c_str());
+
+    if(spirv.empty()) return {};
+    return spirv;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace core {
+    // compiles GLSL sources into SPIR-V. uses shaderc in-process when the
+    // build found it (GAME_HAS_SHADERC), otherwise shells out to glslc.
+    //
+    // results are cached by a key over the stage, the path, the source and
+    // every file it #includes, both in memory and as <cache_dir>/<key>.spv,
+    // so unchanged shaders never get compiled twice, not even across runs.
+    // includes resolve relative to the including file, like glslc does
+    class shader_compiler {
+    public:
+        struct result {
+            std::string source_path;
+            uint64_t hash;
+            std::vector<char> spirv;
+        };
+
+    private:
+        std::string _cache_dir;
+        std::unordered_map<uint64_t, std::vector<char>> _cache;
+        // last key seen per source, so a save with no changes is ignored
+        std::unordered_map<std::string, uint64_t> _last_hash;
+
+        std::optional<std::vector<char>> compile_source(
+            const std::string& path, const std::string& source);
+
+        // stage, path, source and includes, see above
+        static uint64_t key(const std::string& path, const std::string& source);
+
+    public:
+        shader_compiler(std::string cache_dir);
+
+        // registers the current contents of a source without compiling it,
+        // for shaders whose .spv was already loaded at startup
+        void mark_current(const std::string& path);
+
+        // empty if the source didn't change since last time or failed to compile
+        std::optional<result> compile(const std::string& path);
+
+        // every source marked or compiled so far, eg. to recheck them all
+        // when a shared include changes
+        std::vector<std::string> sources() const;
+
+        static uint64_t hash(const char* data, size_t size);
+        static bool is_shader_source(const std::string& path);
+    };
+}
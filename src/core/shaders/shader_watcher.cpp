@@ -0,0 +1,117 @@
+#include "./shader_watcher.hpp"
+
+#include "utils/log.hpp"
+
+#include <filesystem>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/inotify.h>
+#endif
+
+using namespace core;
+
+shader_watcher::shader_watcher(std::string directory, std::string cache_dir)
+    : _directory(std::move(directory)), _compiler(std::move(cache_dir)),
+      _running(false), _inotify_fd(-1)
+{
+    // whatever is on disk right now is what got loaded at startup
+    std::error_code err;
+    for(auto& entry : std::filesystem::directory_iterator(_directory, err)) {
+        auto path = entry.path().string();
+        if(shader_compiler::is_shader_source(path)) _compiler.mark_current(path);
+    }
+
+#ifdef __linux__
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(_inotify_fd < 0) {
+        LOG("[SHADER] inotify not available, hot reload disabled");
+        return;
+    }
+
+    // editors either rewrite the file (close_write) or swap a temp file in (moved_to)
+    if(inotify_add_watch(_inotify_fd, _directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG("[SHADER] could not watch %s", _directory.c_str());
+        close(_inotify_fd);
+        _inotify_fd = -1;
+        return;
+    }
+
+    _running = true;
+    _thread = std::thread(&shader_watcher::watch_loop, this);
+#endif
+}
+
+shader_watcher::~shader_watcher() {
+    _running = false;
+    if(_thread.joinable()) _thread.join();
+
+#ifdef __linux__
+    if(_inotify_fd >= 0) close(_inotify_fd);
+#endif
+}
+
+void shader_watcher::watch_loop() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+
+    while(_running) {
+        // wake up now and then to check if we should stop
+        pollfd fd { _inotify_fd, POLLIN, 0 };
+        if(poll(&fd, 1, 250) <= 0) continue;
+
+        ssize_t length = read(_inotify_fd, buffer, sizeof(buffer));
+        if(length <= 0) continue;
+
+        // a single save can produce several events for the same file
+        std::vector<std::string> changed;
+        bool other_changed = false;
+
+        for(ssize_t i = 0; i < length;) {
+            auto* event = reinterpret_cast<inotify_event*>(buffer + i);
+            i += sizeof(inotify_event) + event->len;
+
+            if(event->len == 0) continue;
+
+            std::string path = _directory + event->name;
+            if(!shader_compiler::is_shader_source(path)) {
+                other_changed = true;
+                continue;
+            }
+
+            bool seen = false;
+            for(auto& c : changed) seen |= c == path;
+            if(!seen) changed.push_back(path);
+        }
+
+        // could be something a shader includes, the ones whose key is the
+        // same as before are skipped by compile()
+        if(other_changed) {
+            for(auto& path : _compiler.sources()) {
+                bool seen = false;
+                for(auto& c : changed) seen |= c == path;
+                if(!seen) changed.push_back(path);
+            }
+        }
+
+        for(auto& path : changed) {
+            auto compiled = _compiler.compile(path);
+            if(!compiled.has_value()) continue;
+
+            LOG("[SHADER] recompiled %s", path.c_str());
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _compiled.push_back(std::move(compiled.value()));
+        }
+    }
+#endif
+}
+
+std::vector<shader_compiler::result> shader_watcher::take_compiled() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<shader_compiler::result> compiled;
+    compiled.swap(_compiled);
+    return compiled;
+}
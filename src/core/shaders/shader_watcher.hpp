@@ -0,0 +1,41 @@
+#pragma once
+
+#include "core/shaders/shader_compiler.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+    // watches a directory of shader sources (inotify, linux only) and
+    // recompiles whatever changed on a background thread. the compiled
+    // results wait in a queue until the main thread picks them up at a
+    // frame boundary with take_compiled()
+    class shader_watcher {
+    private:
+        std::string _directory;
+        shader_compiler _compiler;
+
+        std::thread _thread;
+        std::atomic<bool> _running;
+
+        std::mutex _mutex;
+        std::vector<shader_compiler::result> _compiled;
+
+        int _inotify_fd;
+
+        void watch_loop();
+
+    public:
+        shader_watcher(std::string directory, std::string cache_dir);
+        ~shader_watcher();
+
+        shader_watcher(const shader_watcher&) = delete;
+        shader_watcher& operator=(const shader_watcher&) = delete;
+
+        // shaders that finished compiling since the last call
+        std::vector<shader_compiler::result> take_compiled();
+    };
+}
@@ -6,11 +6,30 @@
 #include "utils/file.hpp"
 #include "utils/assert.hpp"
 #include "core/vulkan/vkstructs.hpp"
+#include "core/jobs/task_graph.hpp"
 
 #include <vector>
 #include <string>
 #include <memory>
-#include <unordered_set>
+#include <cstdint>
+#include <functional>
+
+#ifdef GAME_EMBED_SHADERS
+    #include "shaders/basic.vert.hpp"
+    #include "shaders/basic.frag.hpp"
+    #include "shaders/sprite.vert.hpp"
+    #include "shaders/sprite.frag.hpp"
+    #include "shaders/light_cull.comp.hpp"
+    #include "shaders/lit.vert.hpp"
+    #include "shaders/lit.frag.hpp"
+    #include "shaders/particles.comp.hpp"
+    #include "shaders/particle.vert.hpp"
+    #include "shaders/particle.frag.hpp"
+    #if GAME_DEBUG_DRAW
+        #include "shaders/debug_line.vert.hpp"
+        #include "shaders/debug_line.frag.hpp"
+    #endif
+#endif
 
 const std::vector<const char*> validation_layers = {
     "VK_LAYER_KHRONOS_validation" // validation layer
@@ -20,6 +39,46 @@ const std::vector<const char*> device_extensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+const char* vertex_shader_path   = ASSETS"shaders/basic.vert";
+const char* fragment_shader_path = ASSETS"shaders/basic.frag";
+const char* sprite_vertex_shader_path   = ASSETS"shaders/sprite.vert";
+const char* sprite_fragment_shader_path = ASSETS"shaders/sprite.frag";
+const char* light_cull_shader_path      = ASSETS"shaders/light_cull.comp";
+const char* lit_vertex_shader_path      = ASSETS"shaders/lit.vert";
+const char* lit_fragment_shader_path    = ASSETS"shaders/lit.frag";
+const char* particle_compute_shader_path  = ASSETS"shaders/particles.comp";
+const char* particle_vertex_shader_path   = ASSETS"shaders/particle.vert";
+const char* particle_fragment_shader_path = ASSETS"shaders/particle.frag";
+#if GAME_DEBUG_DRAW
+const char* debug_line_vertex_shader_path   = ASSETS"shaders/debug_line.vert";
+const char* debug_line_fragment_shader_path = ASSETS"shaders/debug_line.frag";
+#endif
+
+// draw packet ids, for sorting
+const uint32_t basic_pipeline_id  = 0;
+const uint32_t sprite_pipeline_id = 1;
+const uint32_t particle_pipeline_id = 2;
+const uint32_t debug_line_pipeline_id = 3;
+// blended, after the opaque layers
+const uint8_t particle_layer      = 64;
+// over the scene, under the 2D layers
+const uint8_t debug_line_layer    = 96;
+// sprite layers go on top of everything else
+const uint8_t sprite_first_layer  = 128;
+
+// the lighting's camera until the scene has one of its own
+const float camera_fov_y = 1.0471976f; // 60 degrees
+const float camera_near  = 0.1f;
+const float camera_far   = 100.0f;
+
+// per frame in flight, for uniforms and instance data
+const VkDeviceSize frame_ring_size = 8 * 1024 * 1024;
+
+// VRAM textures may take, the streamer evicts mips past this
+#ifndef GAME_TEXTURE_BUDGET_MB
+    #define GAME_TEXTURE_BUDGET_MB 256
+#endif
+
 #ifdef NDEBUG
     const bool use_validation_layers = false;
 #else
@@ -28,43 +87,683 @@ const std::vector<const char*> device_extensions = {
 
 using namespace core;
 
-vkapp::vkapp(GLFWwindow* window) {
-    this->create_instance();
-    this->query_physical_device();
-    this->create_surface(window);
-    family_indices = vkutils::get_queue_family_indices(physical_device, surface);
-    this->create_logical_device();
-    
-    swapchain = vkswapchain(window, instance, physical_device, device, surface);
+vkapp::vkapp(GLFWwindow* window, core::timeline* trace, std::function<void()> cpu_startup)
+    : window(window), current_frame(0), frame_started(false), frame_number(0)
+{
+    // startup is a graph of tasks on the job threads: shader files are
+    // read while the device is being made, each feature's shaders and
+    // pipelines compile side by side, and the caller's CPU work runs
+    // alongside all of it
+    jobs = std::make_unique<core::jobs::thread_pool>();
+    jobs::task_graph startup;
+
+    auto device_ready = startup.add("device", [this, window] {
+        this->create_instance();
+        this->query_physical_device();
+        this->create_surface(window);
+        family_indices = vkutils::get_queue_family_indices(physical_device, surface);
+        this->create_logical_device();
+        layouts = vklayout_cache(device);
+    });
+
+    auto frames_ready = startup.add("frame resources", [this] {
+        this->create_command_pool();
+        this->create_frame_resources();
+        deletions = vkdeletion_queue(device);
+
+        frame_data = std::make_unique<core::vkframe_ring>(device, physical_device, frame_ring_size, frames_in_flight);
+        recorder = vkrecorder(device, family_indices.graphics_family.value(), *jobs, frames_in_flight);
+    }, { device_ready });
+
+    // reads the window size, GLFW wants that from the main thread
+    auto swapchain_ready = startup.add_on_caller("swapchain", [this, window] {
+        swapchain = vkswapchain(window, instance, physical_device, device, surface);
+
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        render_finished.resize(swapchain.images.size());
+        for(auto& semaphore : render_finished) {
+            VK_ASSERT(vkCreateSemaphore(device, &semaphore_info, nullptr, &semaphore));
+        }
+
+        this->build_graph();
+    }, { device_ready });
+
+#ifdef GAME_EMBED_SHADERS
+    // SPIR-V was baked into the binary by the build, no file reads
+    bool has_sprite_shaders = true;
+    bool has_lighting_shaders = true;
+    bool has_particle_shaders = true;
+#if GAME_DEBUG_DRAW
+    bool has_debug_line_shaders = true;
+#endif
 
-    auto vertex_shader_source =
-        utils::file::read_binary(ASSETS"shaders/basic.vert.spv");
-    
-    auto fragment_shader_source =
-        utils::file::read_binary(ASSETS"shaders/basic.frag.spv");
+    auto basic_shaders = startup.add("basic shaders", [this] {
+        using namespace shaders::embedded;
+        vertex_shader   = vkshader(device, basic_vert, basic_vert_size, VK_SHADER_STAGE_VERTEX_BIT);
+        fragment_shader = vkshader(device, basic_frag, basic_frag_size, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready });
+
+    auto sprite_shaders = startup.add("sprite shaders", [this] {
+        using namespace shaders::embedded;
+        sprite_vertex_shader   = vkshader(device, sprite_vert, sprite_vert_size, VK_SHADER_STAGE_VERTEX_BIT);
+        sprite_fragment_shader = vkshader(device, sprite_frag, sprite_frag_size, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready });
+
+    auto lighting_shaders = startup.add("lighting shaders", [this] {
+        using namespace shaders::embedded;
+        light_cull_shader   = vkshader(device, light_cull_comp, light_cull_comp_size, VK_SHADER_STAGE_COMPUTE_BIT);
+        lit_vertex_shader   = vkshader(device, lit_vert, lit_vert_size, VK_SHADER_STAGE_VERTEX_BIT);
+        lit_fragment_shader = vkshader(device, lit_frag, lit_frag_size, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready });
+
+    auto particle_shaders = startup.add("particle shaders", [this] {
+        using namespace shaders::embedded;
+        particle_compute_shader  = vkshader(device, particles_comp, particles_comp_size, VK_SHADER_STAGE_COMPUTE_BIT);
+        particle_vertex_shader   = vkshader(device, particle_vert, particle_vert_size, VK_SHADER_STAGE_VERTEX_BIT);
+        particle_fragment_shader = vkshader(device, particle_frag, particle_frag_size, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready });
+
+#if GAME_DEBUG_DRAW
+    auto debug_line_shaders = startup.add("debug line shaders", [this] {
+        using namespace shaders::embedded;
+        debug_line_vertex_shader   = vkshader(device, debug_line_vert, debug_line_vert_size, VK_SHADER_STAGE_VERTEX_BIT);
+        debug_line_fragment_shader = vkshader(device, debug_line_frag, debug_line_frag_size, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready });
+#endif
+#else
+    // only the basic shaders have prebuilt SPIR-V, the others need glslc.
+    // a feature whose shaders are missing is left out
+    std::vector<char> vertex_shader_source, fragment_shader_source;
+    std::vector<char> sprite_vertex_source, sprite_fragment_source;
+    std::vector<char> light_cull_source, lit_vertex_source, lit_fragment_source;
+    std::vector<char> particle_compute_source, particle_vertex_source, particle_fragment_source;
+    bool has_sprite_shaders = false;
+    bool has_lighting_shaders = false;
+    bool has_particle_shaders = false;
+#if GAME_DEBUG_DRAW
+    std::vector<char> debug_line_vertex_source, debug_line_fragment_source;
+    bool has_debug_line_shaders = false;
+#endif
 
-    vertex_shader   = vkshader(device, vertex_shader_source, VK_SHADER_STAGE_VERTEX_BIT);
-    fragment_shader = vkshader(device, fragment_shader_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    // doesn't need the device, runs while it's being made
+    auto shaders_read = startup.add("read shaders", [&] {
+        vertex_shader_source   = utils::file::read_binary(SHADERS"basic.vert.spv");
+        fragment_shader_source = utils::file::read_binary(SHADERS"basic.frag.spv");
+
+        sprite_vertex_source   = utils::file::read_binary(SHADERS"sprite.vert.spv");
+        sprite_fragment_source = utils::file::read_binary(SHADERS"sprite.frag.spv");
+        has_sprite_shaders = !sprite_vertex_source.empty() && !sprite_fragment_source.empty();
+
+        light_cull_source   = utils::file::read_binary(SHADERS"light_cull.comp.spv");
+        lit_vertex_source   = utils::file::read_binary(SHADERS"lit.vert.spv");
+        lit_fragment_source = utils::file::read_binary(SHADERS"lit.frag.spv");
+        has_lighting_shaders =
+            !light_cull_source.empty() && !lit_vertex_source.empty() && !lit_fragment_source.empty();
+
+        particle_compute_source  = utils::file::read_binary(SHADERS"particles.comp.spv");
+        particle_vertex_source   = utils::file::read_binary(SHADERS"particle.vert.spv");
+        particle_fragment_source = utils::file::read_binary(SHADERS"particle.frag.spv");
+        has_particle_shaders =
+            !particle_compute_source.empty() && !particle_vertex_source.empty() && !particle_fragment_source.empty();
+
+#if GAME_DEBUG_DRAW
+        debug_line_vertex_source   = utils::file::read_binary(SHADERS"debug_line.vert.spv");
+        debug_line_fragment_source = utils::file::read_binary(SHADERS"debug_line.frag.spv");
+        has_debug_line_shaders = !debug_line_vertex_source.empty() && !debug_line_fragment_source.empty();
+#endif
+    });
+
+    auto basic_shaders = startup.add("basic shaders", [&] {
+        vertex_shader   = vkshader(device, vertex_shader_source, VK_SHADER_STAGE_VERTEX_BIT);
+        fragment_shader = vkshader(device, fragment_shader_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready, shaders_read });
+
+    auto sprite_shaders = startup.add("sprite shaders", [&] {
+        if(!has_sprite_shaders) return;
+        sprite_vertex_shader   = vkshader(device, sprite_vertex_source, VK_SHADER_STAGE_VERTEX_BIT);
+        sprite_fragment_shader = vkshader(device, sprite_fragment_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready, shaders_read });
+
+    auto lighting_shaders = startup.add("lighting shaders", [&] {
+        if(!has_lighting_shaders) return;
+        light_cull_shader   = vkshader(device, light_cull_source, VK_SHADER_STAGE_COMPUTE_BIT);
+        lit_vertex_shader   = vkshader(device, lit_vertex_source, VK_SHADER_STAGE_VERTEX_BIT);
+        lit_fragment_shader = vkshader(device, lit_fragment_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready, shaders_read });
+
+    auto particle_shaders = startup.add("particle shaders", [&] {
+        if(!has_particle_shaders) return;
+        particle_compute_shader  = vkshader(device, particle_compute_source, VK_SHADER_STAGE_COMPUTE_BIT);
+        particle_vertex_shader   = vkshader(device, particle_vertex_source, VK_SHADER_STAGE_VERTEX_BIT);
+        particle_fragment_shader = vkshader(device, particle_fragment_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready, shaders_read });
+
+#if GAME_DEBUG_DRAW
+    auto debug_line_shaders = startup.add("debug line shaders", [&] {
+        if(!has_debug_line_shaders) return;
+        debug_line_vertex_shader   = vkshader(device, debug_line_vertex_source, VK_SHADER_STAGE_VERTEX_BIT);
+        debug_line_fragment_shader = vkshader(device, debug_line_fragment_source, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }, { device_ready, shaders_read });
+#endif
+#endif
 
-    std::vector<vkshader> shaders{vertex_shader, fragment_shader}; 
+    // every pipeline draws into the scene pass, which comes with the
+    // swapchain's render graph
+    startup.add("basic pipeline", [this] {
+        std::vector<vkshader> shaders{vertex_shader, fragment_shader};
+        pipeline = vkpipeline(device, graph.target_info(scene_pass), shaders, layouts);
+    }, { basic_shaders, swapchain_ready });
+
+    auto sprite_pipeline_ready = startup.add("sprite pipeline", [&] {
+        if(!has_sprite_shaders) return;
+        std::vector<vkshader> sprite_shaders{sprite_vertex_shader, sprite_fragment_shader};
+        sprite_pipeline = vkpipeline(
+            device, graph.target_info(scene_pass), sprite_shaders, layouts, sprite_batch::vertex_layout());
+    }, { sprite_shaders, swapchain_ready });
+
+    auto lighting_pipelines_ready = startup.add("lighting pipelines", [&] {
+        if(!has_lighting_shaders) return;
+        std::vector<vkshader> cull_shaders{light_cull_shader};
+        light_cull_pipeline = vkpipeline(device, cull_shaders, layouts);
+
+        std::vector<vkshader> lit_shaders{lit_vertex_shader, lit_fragment_shader};
+        lit_pipeline = vkpipeline(
+            device, graph.target_info(scene_pass), lit_shaders, layouts, mesh::vertex_layout());
+    }, { lighting_shaders, swapchain_ready });
+
+    auto particle_pipelines_ready = startup.add("particle pipelines", [&] {
+        if(!has_particle_shaders) return;
+        std::vector<vkshader> compute_shaders{particle_compute_shader};
+        particle_compute_pipelines = particle_system::stage_pipelines(compute_shaders);
+        // every stage runs every frame
+        particle_compute_pipelines.prewarm_all(device, layouts);
+
+        // no vertex buffer, the quads come from the particle buffer
+        std::vector<vkshader> draw_shaders{particle_vertex_shader, particle_fragment_shader};
+        particle_pipeline = vkpipeline(device, graph.target_info(scene_pass), draw_shaders, layouts);
+    }, { particle_shaders, swapchain_ready });
+
+#if GAME_DEBUG_DRAW
+    auto debug_line_pipeline_ready = startup.add("debug line pipeline", [&] {
+        if(!has_debug_line_shaders) return;
+        std::vector<vkshader> debug_line_shaders{debug_line_vertex_shader, debug_line_fragment_shader};
+        debug_line_pipeline = vkpipeline(
+            device, graph.target_info(scene_pass), debug_line_shaders, layouts, debug_renderer::vertex_layout());
+    }, { debug_line_shaders, swapchain_ready });
+#endif
 
-    pipeline = vkpipeline(device, swapchain, shaders);
+    // uploads go through graphics_queue, which only the sprite and debug
+    // draw tasks use and one after the other
+    [[maybe_unused]] auto sprites_ready = startup.add("sprites", [&] {
+        if(!has_sprite_shaders) {
+            LOG("Sprite shaders not found, 2D rendering disabled");
+            return;
+        }
+        sprites = std::make_unique<core::sprite_batch>(
+            device, physical_device, graphics_queue, command_pool,
+            sprite_pipeline.set_layouts.at(0));
+        // the white texel for untextured rects
+        sprites->upload();
+    }, { sprite_pipeline_ready, frames_ready });
+
+    auto lighting_ready = startup.add("lighting", [&] {
+        if(!has_lighting_shaders) {
+            LOG("Lighting shaders not found, clustered lighting disabled");
+            return;
+        }
+        lighting = std::make_unique<core::clustered_lighting>(
+            device, physical_device,
+            light_cull_pipeline.set_layouts.at(0), lit_pipeline.set_layouts.at(0),
+            frames_in_flight);
+    }, { lighting_pipelines_ready });
+
+    auto particles_ready = startup.add("particles", [&] {
+        if(!has_particle_shaders) {
+            LOG("Particle shaders not found, particles disabled");
+            return;
+        }
+        particles = std::make_unique<core::particle_system>(
+            device, physical_device, *frame_data,
+            particle_compute_pipelines.get(0).set_layouts.at(0),
+            particle_compute_pipelines.get(0).set_layouts.at(vkframe_ring::descriptor_set),
+            particle_pipeline.set_layouts.at(0));
+    }, { particle_pipelines_ready, frames_ready });
+
+#if GAME_DEBUG_DRAW
+    auto debug_draw_ready = startup.add("debug draw", [&] {
+        if(!has_debug_line_shaders) {
+            LOG("Debug line shaders not found, debug drawing disabled");
+            return;
+        }
+        // the glyphs go into the sprite atlas, no text without sprites
+        debug_draw = std::make_unique<core::debug_renderer>(sprites.get());
+        if(sprites) sprites->upload();
+    }, { debug_line_pipeline_ready, sprites_ready });
+#endif
 
-    swapchain.create_framebuffers(pipeline.render_pass, device);
+    startup.add("camera", [this] {
+        this->update_camera();
+    }, {
+        lighting_ready, particles_ready, swapchain_ready,
+#if GAME_DEBUG_DRAW
+        debug_draw_ready,
+#endif
+    });
+
+    startup.add("textures", [this] {
+        textures = std::make_unique<core::texture_streamer>(
+            device, physical_device, graphics_queue,
+            family_indices.graphics_family.value(),
+            deletions,
+            VkDeviceSize(GAME_TEXTURE_BUDGET_MB) * 1024 * 1024);
+    }, { frames_ready });
+
+    // eg. the world's startup systems, nothing of ours to wait for
+    if(cpu_startup) startup.add("cpu startup", std::move(cpu_startup));
+
+    startup.run(*jobs, trace);
+
+#ifdef GAME_SHADER_HOT_RELOAD
+    shader_watcher = std::make_unique<core::shader_watcher>(
+        ASSETS"shaders/", ASSETS"shaders/.cache/");
+#endif
 }
 
 vkapp::~vkapp() {
+    // the last frames may still be running
+    vkDeviceWaitIdle(device);
+
     // destroy every object
+    textures.reset();
+#if GAME_DEBUG_DRAW
+    if(debug_draw) {
+        debug_draw.reset();
+        debug_line_pipeline.destroy(device);
+        debug_line_vertex_shader.destroy(device);
+        debug_line_fragment_shader.destroy(device);
+    }
+#endif
+    if(particles) {
+        particles.reset();
+        particle_compute_pipelines.destroy(device);
+        particle_pipeline.destroy(device);
+        particle_compute_shader.destroy(device);
+        particle_vertex_shader.destroy(device);
+        particle_fragment_shader.destroy(device);
+    }
+    if(lighting) {
+        lighting.reset();
+        light_cull_pipeline.destroy(device);
+        lit_pipeline.destroy(device);
+        light_cull_shader.destroy(device);
+        lit_vertex_shader.destroy(device);
+        lit_fragment_shader.destroy(device);
+    }
+    if(sprites) {
+        sprites.reset();
+        sprite_pipeline.destroy(device);
+        sprite_vertex_shader.destroy(device);
+        sprite_fragment_shader.destroy(device);
+    }
+    recorder.destroy();
+    jobs.reset();
+    frame_data.reset();
+    graph.destroy();
     pipeline.destroy(device);
+    layouts.destroy();
     vertex_shader.destroy(device);
     fragment_shader.destroy(device);
     swapchain.destroy(device);
+    // after the streamer, it retires into the queue while shutting down
+    deletions.flush();
+    vkDestroyCommandPool(device, command_pool, nullptr);
+
+    for(auto& frame : frames) {
+        vkDestroyCommandPool(device, frame.command_pool, nullptr);
+        vkDestroySemaphore(device, frame.image_available, nullptr);
+        vkDestroyFence(device, frame.in_flight, nullptr);
+    }
+    for(auto semaphore : render_finished) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
 
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyDevice(device, nullptr);
     vkDestroyInstance(instance, nullptr);
 }
 
+void vkapp::reload_shaders() {
+    if(!shader_watcher) return;
+
+    auto compiled = shader_watcher->take_compiled();
+    if(compiled.empty()) return;
+
+    // modules are only read while creating pipelines, they can go right
+    // away. the old pipelines are retired, frames in flight still bind them
+    for(auto& c : compiled) {
+        vkshader* target =
+            c.source_path == vertex_shader_path   ? &vertex_shader :
+            c.source_path == fragment_shader_path ? &fragment_shader :
+            c.source_path == sprite_vertex_shader_path   && sprites ? &sprite_vertex_shader :
+            c.source_path == sprite_fragment_shader_path && sprites ? &sprite_fragment_shader :
+            c.source_path == light_cull_shader_path   && lighting ? &light_cull_shader :
+            c.source_path == lit_vertex_shader_path   && lighting ? &lit_vertex_shader :
+            c.source_path == lit_fragment_shader_path && lighting ? &lit_fragment_shader :
+            c.source_path == particle_compute_shader_path  && particles ? &particle_compute_shader :
+            c.source_path == particle_vertex_shader_path   && particles ? &particle_vertex_shader :
+            c.source_path == particle_fragment_shader_path && particles ? &particle_fragment_shader :
+#if GAME_DEBUG_DRAW
+            c.source_path == debug_line_vertex_shader_path   && debug_draw ? &debug_line_vertex_shader :
+            c.source_path == debug_line_fragment_shader_path && debug_draw ? &debug_line_fragment_shader :
+#endif
+            nullptr;
+
+        if(target == nullptr) continue;
+
+        auto stage = target->stage_flags;
+        target->destroy(device);
+        *target = vkshader(device, c.spirv, stage);
+    }
+
+    std::vector<vkshader> shaders{vertex_shader, fragment_shader};
+    pipeline.rebuild(device, shaders, layouts, deletions);
+
+    if(sprites) {
+        std::vector<vkshader> sprite_shaders{sprite_vertex_shader, sprite_fragment_shader};
+        sprite_pipeline.rebuild(device, sprite_shaders, layouts, deletions);
+    }
+
+    if(lighting) {
+        std::vector<vkshader> cull_shaders{light_cull_shader};
+        light_cull_pipeline.rebuild(device, cull_shaders, layouts, deletions);
+        std::vector<vkshader> lit_shaders{lit_vertex_shader, lit_fragment_shader};
+        lit_pipeline.rebuild(device, lit_shaders, layouts, deletions);
+    }
+
+    if(particles) {
+        std::vector<vkshader> compute_shaders{particle_compute_shader};
+        particle_compute_pipelines.rebuild(device, compute_shaders, layouts, deletions);
+        std::vector<vkshader> draw_shaders{particle_vertex_shader, particle_fragment_shader};
+        particle_pipeline.rebuild(device, draw_shaders, layouts, deletions);
+    }
+
+#if GAME_DEBUG_DRAW
+    if(debug_draw) {
+        std::vector<vkshader> debug_line_shaders{debug_line_vertex_shader, debug_line_fragment_shader};
+        debug_line_pipeline.rebuild(device, debug_line_shaders, layouts, deletions);
+    }
+#endif
+
+    LOG("[SHADER] pipelines rebuilt");
+}
+
+void vkapp::wait_frame() {
+    if(frame_started) return;
+
+    vkWaitForFences(device, 1, &frames[current_frame].in_flight, VK_TRUE, UINT64_MAX);
+
+    // the slot's last frame is done, and every frame before it
+    if(frame_number >= frames_in_flight) {
+        deletions.collect(frame_number - frames_in_flight);
+    }
+    frame_data->begin_frame(current_frame);
+
+    frame_started = true;
+}
+
+void vkapp::draw_frame() {
+    auto& frame = frames[current_frame];
+
+    // does nothing if the main loop already waited
+    this->wait_frame();
+
+    uint32_t image_index;
+    VkResult acquired = vkAcquireNextImageKHR(
+        device, swapchain.handle, UINT64_MAX, frame.image_available, VK_NULL_HANDLE, &image_index);
+
+    if(acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+        // this frame's draws are lost, they get pushed again next frame.
+        // the fence wasn't reset, the slot starts over
+        draws.clear();
+        frame_started = false;
+        this->recreate_swapchain();
+        return;
+    }
+    ASSERT(acquired == VK_SUCCESS || acquired == VK_SUBOPTIMAL_KHR, "Could not acquire a swapchain image");
+
+    // only reset once something will be submitted, or the next wait hangs
+    vkResetFences(device, 1, &frame.in_flight);
+    vkResetCommandPool(device, frame.command_pool, 0);
+    recorder.begin_frame(current_frame);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_ASSERT(vkBeginCommandBuffer(frame.command_buffer, &begin_info));
+
+    // the triangle, until the scene submits draws of its own
+    draw_packet triangle{};
+    triangle.key = draw_queue::make_key(0, basic_pipeline_id, 0, 0.0f, 1.0f);
+    triangle.pipeline = pipeline.handle;
+    triangle.layout = pipeline.layout;
+    triangle.count = 3;
+    triangle.instance_count = 1;
+    draws.push(triangle);
+
+#if GAME_DEBUG_DRAW
+    // before the sprites are flushed, the text is drawn with them
+    if(debug_draw) {
+        debug_draw->collect();
+        debug_draw->draw_lines(
+            draws, *frame_data, debug_line_pipeline.handle, debug_line_pipeline.layout, debug_line_pipeline_id,
+            debug_line_layer, swapchain.extent);
+        if(sprites) debug_draw->draw_text(*sprites, sprite_batch::max_layers - 1);
+    }
+#endif
+
+    if(sprites) {
+        sprites->flush(
+            draws, *frame_data, sprite_pipeline.handle, sprite_pipeline.layout, sprite_pipeline_id,
+            swapchain.extent, sprite_first_layer);
+    }
+
+    if(lighting) lighting->flush(current_frame);
+
+    if(particles) {
+        particles->flush(*frame_data);
+        particles->draw(
+            draws, particle_pipeline.handle, particle_pipeline.layout, particle_pipeline_id, particle_layer);
+    }
+
+    draws.sort();
+
+    graph.bind_image(backbuffer, swapchain.images[image_index], swapchain.image_views[image_index]);
+    graph.execute(frame.command_buffer);
+
+    draw_stats = draws.get_stats();
+    draws.clear();
+
+    VK_ASSERT(vkEndCommandBuffer(frame.command_buffer));
+
+    // the graph's first barrier on the backbuffer waits on all commands,
+    // which chains with this wait
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &frame.image_available;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &frame.command_buffer;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &render_finished[image_index];
+
+    VK_ASSERT(vkQueueSubmit(graphics_queue, 1, &submit_info, frame.in_flight));
+
+    // what gets retired from here on may be used by the next frame
+    frame_number++;
+    deletions.begin_frame(frame_number);
+    frame_started = false;
+
+    VkPresentInfoKHR present_info{};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &render_finished[image_index];
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &swapchain.handle;
+    present_info.pImageIndices = &image_index;
+
+    VkResult presented = vkQueuePresentKHR(present_queue, &present_info);
+
+    current_frame = (current_frame + 1) % frames_in_flight;
+
+    if(presented == VK_ERROR_OUT_OF_DATE_KHR || presented == VK_SUBOPTIMAL_KHR) {
+        this->recreate_swapchain();
+        return;
+    }
+    ASSERT(presented == VK_SUCCESS, "Could not present a swapchain image");
+}
+
+// the whole frame, as far as the GPU is concerned
+void vkapp::build_graph() {
+    graph = render_graph(device, physical_device, dynamic_rendering);
+
+    backbuffer = graph.import_image(
+        "backbuffer", swapchain.format.format, swapchain.extent,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    // light lists for this frame's lit draws, nothing in the graph reads
+    // them so it has to be kept
+    light_culling_pass = graph.add_pass("light_culling", [this](VkCommandBuffer command_buffer) {
+        if(!lighting) return;
+        lighting->dispatch(
+            command_buffer, light_cull_pipeline.handle, light_cull_pipeline.layout, current_frame);
+    });
+    graph.keep(light_culling_pass);
+
+    // simulates the particles the scene draws, through buffers the graph
+    // doesn't track
+    particles_pass = graph.add_pass("particles", [this](VkCommandBuffer command_buffer) {
+        if(!particles) return;
+        particles->dispatch(command_buffer, particle_compute_pipelines);
+    });
+    graph.keep(particles_pass);
+
+    // the sorted draw queue, recorded in chunks across the job threads
+    scene_pass = graph.add_pass("scene", [this](VkCommandBuffer primary) {
+        recorder.record(primary, pipeline.target, draws.size(), [this](VkCommandBuffer command_buffer, uint32_t first, uint32_t count) {
+            VkViewport viewport{};
+            viewport.width = swapchain.extent.width;
+            viewport.height = swapchain.extent.height;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            VkRect2D scissor{ { 0, 0 }, swapchain.extent };
+
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+            draws.encode(command_buffer, first, count);
+        });
+    });
+
+    graph.write_color(scene_pass, backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, {{ 0.0f, 0.0f, 0.0f, 1.0f }});
+    graph.secondary_contents(scene_pass);
+
+    graph.compile();
+}
+
+void vkapp::update_camera() {
+    float view[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+    float projection[16];
+    float aspect = float(swapchain.extent.width) / float(swapchain.extent.height);
+    light_clusters::perspective(camera_fov_y, aspect, camera_near, camera_far, projection);
+
+    if(lighting) lighting->set_camera(view, projection, camera_near, camera_far, swapchain.extent);
+    if(particles) particles->set_camera(view, projection);
+#if GAME_DEBUG_DRAW
+    if(debug_draw) debug_draw->set_camera(view, projection);
+#endif
+}
+
+void vkapp::recreate_swapchain() {
+    // minimized, nothing to draw into until it comes back
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    while(width == 0 || height == 0) {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+
+    // no waiting for the GPU, everything the frames in flight use is
+    // retired and the driver hands the old swapchain's images over
+    graph.destroy(deletions);
+
+    vkswapchain old_swapchain = swapchain;
+    swapchain = vkswapchain(window, instance, physical_device, device, surface, old_swapchain.handle);
+    old_swapchain.destroy(deletions);
+
+    // without dynamic rendering the pipeline was made against the old
+    // graph's render pass
+    this->build_graph();
+    pipeline.target = graph.target_info(scene_pass);
+
+    std::vector<vkshader> shaders{vertex_shader, fragment_shader};
+    pipeline.rebuild(device, shaders, layouts, deletions);
+
+    if(sprites) {
+        sprite_pipeline.target = pipeline.target;
+        std::vector<vkshader> sprite_shaders{sprite_vertex_shader, sprite_fragment_shader};
+        sprite_pipeline.rebuild(device, sprite_shaders, layouts, deletions);
+    }
+
+    if(lighting) {
+        lit_pipeline.target = pipeline.target;
+        std::vector<vkshader> lit_shaders{lit_vertex_shader, lit_fragment_shader};
+        lit_pipeline.rebuild(device, lit_shaders, layouts, deletions);
+    }
+
+    if(particles) {
+        particle_pipeline.target = pipeline.target;
+        std::vector<vkshader> draw_shaders{particle_vertex_shader, particle_fragment_shader};
+        particle_pipeline.rebuild(device, draw_shaders, layouts, deletions);
+    }
+
+#if GAME_DEBUG_DRAW
+    if(debug_draw) {
+        debug_line_pipeline.target = pipeline.target;
+        std::vector<vkshader> debug_line_shaders{debug_line_vertex_shader, debug_line_fragment_shader};
+        debug_line_pipeline.rebuild(device, debug_line_shaders, layouts, deletions);
+    }
+#endif
+
+    // clusters are cut in screen space, and the aspect changed
+    this->update_camera();
+
+    // the image count may have changed, and presents of the old images
+    // may still be waiting on these
+    for(auto semaphore : render_finished) {
+        deletions.retire(semaphore);
+    }
+    render_finished.clear();
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    render_finished.resize(swapchain.images.size());
+    for(auto& semaphore : render_finished) {
+        VK_ASSERT(vkCreateSemaphore(device, &semaphore_info, nullptr, &semaphore));
+    }
+}
+
 void vkapp::create_instance(){
     using std::vector;
 
@@ -131,38 +830,79 @@ void vkapp::query_physical_device(){
 }
 
 void vkapp::create_logical_device(){    
-    using std::vector, std::unordered_set;
-
-    // info about how many queues we want from each queue family
-    vector<VkDeviceQueueCreateInfo> device_queue_create_infos{};
-    unordered_set<uint32_t> unique_queue_family_indices = {
+    // info about how many queues we want from each queue family.
+    // graphics and present are often the same family, so at most 2
+    uint32_t unique_queue_family_indices[2] = {
         family_indices.graphics_family.value(),
         family_indices.present_family.value()
     };
+    uint32_t unique_queue_family_count =
+        unique_queue_family_indices[0] == unique_queue_family_indices[1] ? 1 : 2;
+
+    VkDeviceQueueCreateInfo device_queue_create_infos[2]{};
     float queue_priority = 1.0f;
-    for(auto unique_family_index : unique_queue_family_indices) {
-        VkDeviceQueueCreateInfo device_queue_create_info{};
+    for(uint32_t i = 0; i < unique_queue_family_count; i++) {
+        VkDeviceQueueCreateInfo& device_queue_create_info = device_queue_create_infos[i];
         device_queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        device_queue_create_info.queueFamilyIndex = unique_family_index;
+        device_queue_create_info.queueFamilyIndex = unique_queue_family_indices[i];
         device_queue_create_info.queueCount = 1;
         device_queue_create_info.pQueuePriorities = &queue_priority;
-    
-        device_queue_create_infos.push_back(device_queue_create_info);
     }
 
-    // we won't need this for now, but in the future we'll use
+    // we won't need most of these for now, but in the future we'll use
     // them to specify required features such as geometry shaders
+    VkPhysicalDeviceFeatures supported_features{};
+    vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+
     VkPhysicalDeviceFeatures physical_device_features{};
+    // lets BC textures go to the GPU as they are on disk
+    physical_device_features.textureCompressionBC = supported_features.textureCompressionBC;
+
+    // dynamic rendering is core in 1.3 and an extension on 1.2, the
+    // render graph falls back to render passes without it
+    std::vector<const char*> extensions = device_extensions;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    bool dynamic_rendering_core = properties.apiVersion >= VK_API_VERSION_1_3;
+    bool dynamic_rendering_extension = !dynamic_rendering_core &&
+        properties.apiVersion >= VK_API_VERSION_1_2 &&
+        vkutils::check_device_extension_support(physical_device, { VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME });
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+    dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    if(dynamic_rendering_core || dynamic_rendering_extension) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &dynamic_rendering_features;
+        vkGetPhysicalDeviceFeatures2(physical_device, &features2);
+    }
+
+    dynamic_rendering = dynamic_rendering_features.dynamicRendering == VK_TRUE;
+    if(dynamic_rendering && dynamic_rendering_extension) {
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+
+    LOG("Dynamic rendering: %s", dynamic_rendering ? "yes" : "no, using render passes");
+
+    // the driver's heap usage and budget, for core::memory_telemetry
+    memory_budget = vkutils::check_device_extension_support(physical_device, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+    if(memory_budget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
 
     // 
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_create_info.pQueueCreateInfos = device_queue_create_infos.data();
-    device_create_info.queueCreateInfoCount = device_queue_create_infos.size();
+    device_create_info.pNext = dynamic_rendering ? &dynamic_rendering_features : nullptr;
+    device_create_info.pQueueCreateInfos = device_queue_create_infos;
+    device_create_info.queueCreateInfoCount = unique_queue_family_count;
     device_create_info.pEnabledFeatures = &physical_device_features;
 
-    device_create_info.ppEnabledExtensionNames = device_extensions.data();
-    device_create_info.enabledExtensionCount   = device_extensions.size();
+    device_create_info.ppEnabledExtensionNames = extensions.data();
+    device_create_info.enabledExtensionCount   = extensions.size();
 
     if(use_validation_layers) {
         device_create_info.enabledLayerCount   = validation_layers.size();
@@ -198,17 +938,56 @@ void vkapp::create_surface(GLFWwindow* window) {
     ASSERT(surface != VK_NULL_HANDLE, "Surface not created succesfully")
 }
 
-void vkapp::create_image_view(){}
+void vkapp::create_command_pool() {
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags =
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = family_indices.graphics_family.value();
+
+    VK_ASSERT(
+        vkCreateCommandPool(device, &pool_info, nullptr, &command_pool)
+    );
+}
 
-void vkapp::create_framebuffer(){}
+// one pool per frame, reset whole when the frame comes around again
+void vkapp::create_frame_resources() {
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = family_indices.graphics_family.value();
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    // signaled, so the first wait on each frame returns right away
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for(auto& frame : frames) {
+        VK_ASSERT(vkCreateCommandPool(device, &pool_info, nullptr, &frame.command_pool));
+
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = frame.command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = 1;
+        VK_ASSERT(vkAllocateCommandBuffers(device, &allocate_info, &frame.command_buffer));
+
+        VK_ASSERT(vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.image_available));
+        VK_ASSERT(vkCreateFence(device, &fence_info, nullptr, &frame.in_flight));
+    }
+}
 
-void vkapp::create_render_pass(){}
+void vkapp::create_image_view(){}
 
 void vkapp::create_pipeline(){}
 
 //
 
-std::optional<VkPhysicalDevice> vkapp::pick_physical_device(std::vector<VkPhysicalDevice> available_devices) {
+std::optional<VkPhysicalDevice> vkapp::pick_physical_device(const std::vector<VkPhysicalDevice>& available_devices) {
     for(auto physical_device : available_devices) {
         VkPhysicalDeviceProperties physical_device_properties{};
         VkPhysicalDeviceFeatures physical_device_features{};
@@ -3,11 +3,28 @@
 #include "core/vulkan/vkshader.hpp"
 #include "core/vulkan/vkstructs.hpp"
 #include "core/vulkan/vkpipeline.hpp"
+#include "core/vulkan/vklayout_cache.hpp"
 #include "core/vulkan/vkswapchain.hpp"
+#include "core/graphics/mesh.hpp"
+#include "core/vulkan/vkrecorder.hpp"
+#include "core/vulkan/vkdeletion_queue.hpp"
+#include "core/vulkan/vkframe_ring.hpp"
+#include "core/jobs/thread_pool.hpp"
+#include "core/graphics/texture_streamer.hpp"
+#include "core/graphics/render_graph.hpp"
+#include "core/graphics/draw_queue.hpp"
+#include "core/graphics/sprite_batch.hpp"
+#include "core/graphics/clustered_lighting.hpp"
+#include "core/graphics/particles.hpp"
+#include "core/debug/debug_renderer.hpp"
+#include "core/debug/timeline.hpp"
+#include "core/shaders/shader_watcher.hpp"
 #include "components/components.hpp"
 
 #include <optional>
 #include <vector>
+#include <memory>
+#include <functional>
 
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
@@ -21,34 +38,132 @@ namespace core
         VkPhysicalDevice physical_device;
         VkDevice device;
         VkSurfaceKHR surface;
-        VkRenderPass render_pass;
+        GLFWwindow* window;
+
+        // core in 1.3, VK_KHR_dynamic_rendering on 1.2 devices
+        bool dynamic_rendering;
+        // VK_EXT_memory_budget was enabled
+        bool memory_budget;
 
         VkQueue graphics_queue;
         VkQueue present_queue;
 
+        // for uploads and other one-off commands
+        VkCommandPool command_pool;
+
         structs::queue_family_indices family_indices;
         core::vkswapchain swapchain;
 
+        core::vklayout_cache layouts;
         core::vkshader vertex_shader, fragment_shader;
         core::vkpipeline pipeline;
 
-        vkapp(GLFWwindow *);
+        // 2D, drawn after the 3D layers. null if the sprite shaders
+        // weren't built
+        core::vkshader sprite_vertex_shader, sprite_fragment_shader;
+        core::vkpipeline sprite_pipeline;
+        std::unique_ptr<core::sprite_batch> sprites;
+
+        // point lights binned by light_cull.comp, shaded by the lit
+        // pipeline. null if those shaders weren't built
+        core::vkshader light_cull_shader;
+        core::vkpipeline light_cull_pipeline;
+        core::vkshader lit_vertex_shader, lit_fragment_shader;
+        core::vkpipeline lit_pipeline;
+        std::unique_ptr<core::clustered_lighting> lighting;
+
+        // simulated by particles.comp, a pipeline per stage, drawn
+        // indirectly. null if those shaders weren't built
+        core::vkshader particle_compute_shader;
+        core::particle_system::stage_pipelines particle_compute_pipelines;
+        core::vkshader particle_vertex_shader, particle_fragment_shader;
+        core::vkpipeline particle_pipeline;
+        std::unique_ptr<core::particle_system> particles;
+
+#if GAME_DEBUG_DRAW
+        // what core::debug collected each frame, lines with their own
+        // pipeline and text through the sprites. null if the line
+        // shaders weren't built
+        core::vkshader debug_line_vertex_shader, debug_line_fragment_shader;
+        core::vkpipeline debug_line_pipeline;
+        std::unique_ptr<core::debug_renderer> debug_draw;
+#endif
+
+        // rebuilt with the swapchain
+        core::render_graph graph;
+        core::render_graph::resource_id backbuffer;
+        core::render_graph::pass_id light_culling_pass;
+        core::render_graph::pass_id particles_pass;
+        core::render_graph::pass_id scene_pass;
+
+        static const uint32_t frames_in_flight = 2;
+        structs::frame_resources frames[frames_in_flight];
+        uint32_t current_frame;
+        // wait_frame() ran for current_frame, it's been reset for recording
+        bool frame_started;
+        // frames submitted so far, what the deletion queue is keyed on
+        uint64_t frame_number;
+        // objects released while frames in flight may still use them
+        core::vkdeletion_queue deletions;
+        // one per swapchain image, presentation may hold on to it
+        std::vector<VkSemaphore> render_finished;
+
+        // workers for recording (and anything else that forks/joins
+        // inside a frame)
+        std::unique_ptr<core::jobs::thread_pool> jobs;
+        core::vkrecorder recorder;
+
+        // per-draw uniforms and instance data, start over every frame
+        std::unique_ptr<core::vkframe_ring> frame_data;
+
+        // filled during the frame, sorted and drawn by draw_frame()
+        core::draw_queue draws;
+        // what the last frame's draws took
+        core::vkencoder::stats draw_stats;
+
+        // only set in builds with GAME_SHADER_HOT_RELOAD
+        std::unique_ptr<core::shader_watcher> shader_watcher;
+
+        std::unique_ptr<core::texture_streamer> textures;
+
+        // startup runs as a task graph on the job threads, each task on
+        // the trace if given. cpu_startup is work that doesn't need the
+        // GPU (eg. the world's startup systems), it runs alongside
+        vkapp(GLFWwindow *, core::timeline* trace = nullptr, std::function<void()> cpu_startup = {});
         ~vkapp();
 
+        // swaps in shaders recompiled by the watcher, call between frames
+        void reload_shaders();
+
+        // blocks until the GPU is done with the frame slot draw_frame()
+        // is about to use. waiting here, before input is read, keeps the
+        // wait out of the input-to-present time. frame_data can be
+        // allocated from once this returns
+        void wait_frame();
+
+        // records the render graph into the next swapchain image and
+        // presents it
+        void draw_frame();
+
         void create_instance();
         void query_physical_device();
         void create_logical_device();
         void create_surface(GLFWwindow *);
+        void create_command_pool();
         void create_image_view();
-        void create_framebuffer();
-        void create_render_pass();
         void create_pipeline();
+        void create_frame_resources();
+        void build_graph();
+        void recreate_swapchain();
+        // the lighting's, particles' and debug lines' view of the scene, for now a fixed camera at the
+        // origin looking down -z
+        void update_camera();
 
     private:
         // HELPER FUNCTIONS
 
         std::optional<VkPhysicalDevice> pick_physical_device(
-            std::vector<VkPhysicalDevice> available_devices
+            const std::vector<VkPhysicalDevice>& available_devices
         );
     };
 }
\ No newline at end of file
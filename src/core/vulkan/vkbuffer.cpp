@@ -0,0 +1,71 @@
+#include "./vkbuffer.hpp"
+#include "./vkutils.hpp"
+#include "./vkmemory.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cstring>
+
+using namespace core;
+
+vkbuffer::vkbuffer()
+    : handle(VK_NULL_HANDLE), memory(VK_NULL_HANDLE), size(0)
+{}
+
+vkbuffer::vkbuffer(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties
+) : size(size) {
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VK_ASSERT(vkCreateBuffer(device, &buffer_info, nullptr, &handle));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, handle, &requirements);
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex =
+        vkutils::find_memory_type(physical_device, requirements.memoryTypeBits, properties);
+
+    // nothing but a copy source, what uploads go through
+    auto type = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? vkmemory::category::staging : vkmemory::category::buffer;
+
+    memory = vkmemory::allocate(device, allocate_info, type);
+    VK_ASSERT(vkBindBufferMemory(device, handle, memory, 0));
+}
+
+void* vkbuffer::map(VkDevice device) {
+    void* data = nullptr;
+    VK_ASSERT(vkMapMemory(device, memory, 0, size, 0, &data));
+    return data;
+}
+
+void vkbuffer::unmap(VkDevice device) {
+    vkUnmapMemory(device, memory);
+}
+
+void vkbuffer::write(VkDevice device, const void* data, size_t write_size, size_t offset) {
+    ASSERT(offset + write_size <= size, "Write goes past the end of the buffer");
+
+    char* mapped = static_cast<char*>(map(device));
+    memcpy(mapped + offset, data, write_size);
+    unmap(device);
+}
+
+void vkbuffer::destroy(VkDevice device) {
+    if(handle == VK_NULL_HANDLE) return;
+
+    vkDestroyBuffer(device, handle, nullptr);
+    vkmemory::free(device, memory);
+    handle = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <cstddef>
+
+namespace core {
+    // a buffer with its own allocation, fine for a handful of long lived
+    // buffers (meshes, per-frame data), not for thousands of small ones
+    class vkbuffer {
+    public:
+        VkBuffer handle;
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+
+        vkbuffer();
+        vkbuffer(
+            VkDevice,
+            VkPhysicalDevice,
+            VkDeviceSize size,
+            VkBufferUsageFlags,
+            VkMemoryPropertyFlags);
+
+        // only for host visible buffers
+        void* map(VkDevice);
+        void unmap(VkDevice);
+        void write(VkDevice, const void* data, size_t size, size_t offset = 0);
+
+        void destroy(VkDevice);
+    };
+}
@@ -0,0 +1,64 @@
+#include "./vkdeletion_queue.hpp"
+#include "./vkmemory.hpp"
+
+using namespace core;
+
+vkdeletion_queue::vkdeletion_queue() : _device(VK_NULL_HANDLE), _frame(0) {}
+
+vkdeletion_queue::vkdeletion_queue(VkDevice device) : _device(device), _frame(0) {
+    // a swapchain rebuild's worth, retiring shouldn't allocate
+    _entries.reserve(256);
+}
+
+void vkdeletion_queue::begin_frame(uint64_t frame) {
+    _frame = frame;
+}
+
+// handles are 64 bit on every platform, pointers or not
+void vkdeletion_queue::retire(VkBuffer h)         { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::buffer }); }
+void vkdeletion_queue::retire(VkDeviceMemory h)   { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::memory }); }
+void vkdeletion_queue::retire(VkImage h)          { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::image }); }
+void vkdeletion_queue::retire(VkImageView h)      { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::image_view }); }
+void vkdeletion_queue::retire(VkSampler h)        { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::sampler }); }
+void vkdeletion_queue::retire(VkPipeline h)       { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::pipeline }); }
+void vkdeletion_queue::retire(VkDescriptorPool h) { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::descriptor_pool }); }
+void vkdeletion_queue::retire(VkFramebuffer h)    { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::framebuffer }); }
+void vkdeletion_queue::retire(VkRenderPass h)     { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::render_pass }); }
+void vkdeletion_queue::retire(VkSemaphore h)      { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::semaphore }); }
+void vkdeletion_queue::retire(VkFence h)          { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::fence }); }
+void vkdeletion_queue::retire(VkSwapchainKHR h)   { if(h != VK_NULL_HANDLE) _entries.push_back({ _frame, (uint64_t)h, kind::swapchain }); }
+
+void vkdeletion_queue::collect(uint64_t completed_frame) {
+    size_t done = 0;
+    while(done < _entries.size() && _entries[done].frame <= completed_frame) {
+        destroy(_entries[done]);
+        done++;
+    }
+    _entries.erase(_entries.begin(), _entries.begin() + done);
+}
+
+void vkdeletion_queue::flush() {
+    for(auto& e : _entries) destroy(e);
+    _entries.clear();
+}
+
+size_t vkdeletion_queue::size() const {
+    return _entries.size();
+}
+
+void vkdeletion_queue::destroy(const entry& e) {
+    switch(e.type) {
+        case kind::buffer:          vkDestroyBuffer(_device, (VkBuffer)e.handle, nullptr); break;
+        case kind::memory:          vkmemory::free(_device, (VkDeviceMemory)e.handle); break;
+        case kind::image:           vkDestroyImage(_device, (VkImage)e.handle, nullptr); break;
+        case kind::image_view:      vkDestroyImageView(_device, (VkImageView)e.handle, nullptr); break;
+        case kind::sampler:         vkDestroySampler(_device, (VkSampler)e.handle, nullptr); break;
+        case kind::pipeline:        vkDestroyPipeline(_device, (VkPipeline)e.handle, nullptr); break;
+        case kind::descriptor_pool: vkDestroyDescriptorPool(_device, (VkDescriptorPool)e.handle, nullptr); break;
+        case kind::framebuffer:     vkDestroyFramebuffer(_device, (VkFramebuffer)e.handle, nullptr); break;
+        case kind::render_pass:     vkDestroyRenderPass(_device, (VkRenderPass)e.handle, nullptr); break;
+        case kind::semaphore:       vkDestroySemaphore(_device, (VkSemaphore)e.handle, nullptr); break;
+        case kind::fence:           vkDestroyFence(_device, (VkFence)e.handle, nullptr); break;
+        case kind::swapchain:       vkDestroySwapchainKHR(_device, (VkSwapchainKHR)e.handle, nullptr); break;
+    }
+}
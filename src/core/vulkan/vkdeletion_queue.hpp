@@ -0,0 +1,78 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // objects the GPU may still be using, destroyed once the frame that
+    // last used them has finished instead of waiting for the device to
+    // go idle.
+    //
+    // frames are numbered by whoever owns the queue (vkapp counts
+    // submissions). retire() tags an object with the frame being recorded,
+    // collect() frees everything tagged with a finished frame. not
+    // thread-safe, retire from the thread that draws
+    class vkdeletion_queue {
+    public:
+        enum class kind : uint8_t {
+            buffer,
+            memory,
+            image,
+            image_view,
+            sampler,
+            pipeline,
+            descriptor_pool,
+            framebuffer,
+            render_pass,
+            semaphore,
+            fence,
+            swapchain,
+        };
+
+    private:
+        struct entry {
+            uint64_t frame;
+            uint64_t handle;
+            kind type;
+        };
+
+        VkDevice _device;
+        uint64_t _frame;
+        // in retire order, so frames only go up
+        std::vector<entry> _entries;
+
+        void destroy(const entry&);
+
+    public:
+        vkdeletion_queue();
+        vkdeletion_queue(VkDevice);
+
+        // the frame being recorded, anything retired from now on may be
+        // used by it
+        void begin_frame(uint64_t frame);
+
+        void retire(VkBuffer);
+        void retire(VkDeviceMemory);
+        void retire(VkImage);
+        void retire(VkImageView);
+        void retire(VkSampler);
+        void retire(VkPipeline);
+        void retire(VkDescriptorPool);
+        void retire(VkFramebuffer);
+        void retire(VkRenderPass);
+        void retire(VkSemaphore);
+        void retire(VkFence);
+        void retire(VkSwapchainKHR);
+
+        // frees what was retired during frames up to and including
+        // completed_frame, call once its fence has signaled
+        void collect(uint64_t completed_frame);
+        // frees everything, the device has to be idle
+        void flush();
+
+        size_t size() const;
+    };
+}
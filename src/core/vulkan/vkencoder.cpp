@@ -0,0 +1,132 @@
+#include "./vkencoder.hpp"
+
+#include "utils/assert.hpp"
+
+using namespace core;
+
+vkencoder::stats& vkencoder::stats::operator+=(const stats& other) {
+    pipeline_binds += other.pipeline_binds;
+    descriptor_binds += other.descriptor_binds;
+    buffer_binds += other.buffer_binds;
+    push_constants += other.push_constants;
+    draws += other.draws;
+    skipped_binds += other.skipped_binds;
+    return *this;
+}
+
+vkencoder::vkencoder(VkCommandBuffer command_buffer)
+    : _command_buffer(command_buffer),
+      _pipeline(VK_NULL_HANDLE), _layout(VK_NULL_HANDLE), _sets{}, _offsets{},
+      _vertex_buffer(VK_NULL_HANDLE), _vertex_offset(0),
+      _index_buffer(VK_NULL_HANDLE), _index_offset(0), _index_type(VK_INDEX_TYPE_UINT16),
+      _stats{}
+{}
+
+void vkencoder::bind_pipeline(VkPipeline pipeline, VkPipelineLayout layout) {
+    if(pipeline == _pipeline) {
+        _stats.skipped_binds++;
+        return;
+    }
+
+    vkCmdBindPipeline(_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    _stats.pipeline_binds++;
+    _pipeline = pipeline;
+
+    // sets stay bound across pipelines only while the layouts match, the
+    // layout cache makes same layout mean same handle
+    if(layout != _layout) {
+        for(auto& set : _sets) set = VK_NULL_HANDLE;
+        _layout = layout;
+    }
+}
+
+void vkencoder::bind_descriptor_set(uint32_t set, VkDescriptorSet descriptor_set) {
+    ASSERT(set < max_sets, "Descriptor set index out of range");
+    ASSERT(_layout != VK_NULL_HANDLE, "Bind a pipeline before its descriptor sets");
+
+    if(_sets[set] == descriptor_set) {
+        _stats.skipped_binds++;
+        return;
+    }
+
+    vkCmdBindDescriptorSets(
+        _command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout,
+        set, 1, &descriptor_set, 0, nullptr);
+    _stats.descriptor_binds++;
+    _sets[set] = descriptor_set;
+}
+
+void vkencoder::bind_dynamic_set(uint32_t set, VkDescriptorSet descriptor_set, uint32_t offset) {
+    ASSERT(set < max_sets, "Descriptor set index out of range");
+    ASSERT(_layout != VK_NULL_HANDLE, "Bind a pipeline before its descriptor sets");
+
+    if(_sets[set] == descriptor_set && _offsets[set] == offset) {
+        _stats.skipped_binds++;
+        return;
+    }
+
+    vkCmdBindDescriptorSets(
+        _command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout,
+        set, 1, &descriptor_set, 1, &offset);
+    _stats.descriptor_binds++;
+    _sets[set] = descriptor_set;
+    _offsets[set] = offset;
+}
+
+void vkencoder::bind_vertex_buffer(VkBuffer buffer, VkDeviceSize offset) {
+    if(buffer == _vertex_buffer && offset == _vertex_offset) {
+        _stats.skipped_binds++;
+        return;
+    }
+
+    vkCmdBindVertexBuffers(_command_buffer, 0, 1, &buffer, &offset);
+    _stats.buffer_binds++;
+    _vertex_buffer = buffer;
+    _vertex_offset = offset;
+}
+
+void vkencoder::bind_index_buffer(VkBuffer buffer, VkIndexType type, VkDeviceSize offset) {
+    if(buffer == _index_buffer && type == _index_type && offset == _index_offset) {
+        _stats.skipped_binds++;
+        return;
+    }
+
+    vkCmdBindIndexBuffer(_command_buffer, buffer, offset, type);
+    _stats.buffer_binds++;
+    _index_buffer = buffer;
+    _index_type = type;
+    _index_offset = offset;
+}
+
+void vkencoder::push_constants(VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data) {
+    ASSERT(_layout != VK_NULL_HANDLE, "Bind a pipeline before pushing constants");
+
+    vkCmdPushConstants(_command_buffer, _layout, stages, offset, size, data);
+    _stats.push_constants++;
+}
+
+void vkencoder::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
+    vkCmdDraw(_command_buffer, vertex_count, instance_count, first_vertex, first_instance);
+    _stats.draws++;
+}
+
+void vkencoder::draw_indexed(
+    uint32_t index_count, uint32_t instance_count,
+    uint32_t first_index, int32_t vertex_offset, uint32_t first_instance
+) {
+    vkCmdDrawIndexed(_command_buffer, index_count, instance_count, first_index, vertex_offset, first_instance);
+    _stats.draws++;
+}
+
+void vkencoder::draw_indirect(VkBuffer buffer, VkDeviceSize offset) {
+    vkCmdDrawIndirect(_command_buffer, buffer, offset, 1, sizeof(VkDrawIndirectCommand));
+    _stats.draws++;
+}
+
+VkCommandBuffer vkencoder::command_buffer() const {
+    return _command_buffer;
+}
+
+const vkencoder::stats& vkencoder::get_stats() const {
+    return _stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <cstdint>
+
+namespace core {
+    // thin layer over a command buffer that remembers what's bound and
+    // drops binds that wouldn't change anything. starts knowing nothing,
+    // so use one per command buffer (secondaries don't inherit state)
+    class vkencoder {
+    public:
+        static const uint32_t max_sets = 4;
+
+        struct stats {
+            uint32_t pipeline_binds;
+            uint32_t descriptor_binds;
+            uint32_t buffer_binds;
+            uint32_t push_constants;
+            uint32_t draws;
+            // binds that were already current
+            uint32_t skipped_binds;
+
+            stats& operator+=(const stats&);
+        };
+
+    private:
+        VkCommandBuffer _command_buffer;
+
+        VkPipeline _pipeline;
+        VkPipelineLayout _layout;
+        VkDescriptorSet _sets[max_sets];
+        // of sets bound with bind_dynamic_set()
+        uint32_t _offsets[max_sets];
+        VkBuffer _vertex_buffer;
+        VkDeviceSize _vertex_offset;
+        VkBuffer _index_buffer;
+        VkDeviceSize _index_offset;
+        VkIndexType _index_type;
+
+        stats _stats;
+
+    public:
+        vkencoder(VkCommandBuffer);
+
+        void bind_pipeline(VkPipeline, VkPipelineLayout);
+        void bind_descriptor_set(uint32_t set, VkDescriptorSet);
+        // a set with one dynamic buffer, eg. from a vkframe_ring. only
+        // skipped if the offset is the same too
+        void bind_dynamic_set(uint32_t set, VkDescriptorSet, uint32_t offset);
+        void bind_vertex_buffer(VkBuffer, VkDeviceSize offset = 0);
+        void bind_index_buffer(VkBuffer, VkIndexType, VkDeviceSize offset = 0);
+        // always recorded, comparing the bytes costs about as much
+        void push_constants(VkShaderStageFlags, uint32_t offset, uint32_t size, const void*);
+
+        void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+        void draw_indexed(
+            uint32_t index_count, uint32_t instance_count,
+            uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+        // one VkDrawIndirectCommand at offset, written on the GPU
+        void draw_indirect(VkBuffer, VkDeviceSize offset);
+
+        VkCommandBuffer command_buffer() const;
+        const stats& get_stats() const;
+    };
+}
@@ -0,0 +1,123 @@
+#include "./vkframe_ring.hpp"
+
+#include "utils/assert.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+vkframe_ring::vkframe_ring(
+    VkDevice device,
+    VkPhysicalDevice physical_device,
+    VkDeviceSize frame_size,
+    uint32_t frames_in_flight
+) : _device(device), _frame(0), _head(0), _failed(0), _peak(0)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    // good for either kind of dynamic offset, and for vec4s in vertex data
+    _alignment = uint32_t(std::max({
+        properties.limits.minUniformBufferOffsetAlignment,
+        properties.limits.minStorageBufferOffsetAlignment,
+        VkDeviceSize(16) }));
+
+    _frame_size = (frame_size + _alignment - 1) / _alignment * _alignment;
+    ASSERT(_frame_size * frames_in_flight <= UINT32_MAX, "Frame ring too large for 32-bit offsets");
+
+    _buffer = vkbuffer(
+        device, physical_device, _frame_size * frames_in_flight,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    _mapped = static_cast<char*>(_buffer.map(device));
+
+    VkDescriptorPoolSize pool_sizes[2]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    pool_sizes[0].descriptorCount = max_sets;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    pool_sizes[1].descriptorCount = max_sets;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = max_sets;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    VK_ASSERT(vkCreateDescriptorPool(device, &pool_info, nullptr, &_descriptor_pool));
+}
+
+vkframe_ring::~vkframe_ring() {
+    _buffer.unmap(_device);
+    _buffer.destroy(_device);
+
+    // frees the sets too
+    vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+}
+
+void vkframe_ring::begin_frame(uint32_t frame) {
+    _peak = std::max<uint64_t>(_peak, std::min<uint64_t>(_head.load(std::memory_order_relaxed), _frame_size));
+    _frame = frame;
+    _head.store(0, std::memory_order_relaxed);
+}
+
+std::optional<vkframe_ring::allocation> vkframe_ring::allocate(VkDeviceSize size) {
+    // sizes are rounded up so every offset stays aligned
+    uint64_t aligned = (size + _alignment - 1) / _alignment * _alignment;
+    uint64_t start = _head.fetch_add(aligned, std::memory_order_relaxed);
+
+    if(start + aligned > _frame_size) {
+        _failed.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    uint64_t offset = _frame * _frame_size + start;
+    return allocation{ _mapped + offset, _buffer.handle, uint32_t(offset) };
+}
+
+std::optional<vkframe_ring::allocation> vkframe_ring::push(const void* data, VkDeviceSize size) {
+    auto a = allocate(size);
+    if(a.has_value()) memcpy(a->data, data, size);
+    return a;
+}
+
+VkDescriptorSet vkframe_ring::create_set(VkDescriptorSetLayout layout, VkDescriptorType type, VkDeviceSize range) {
+    ASSERT(
+        type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+        "Frame ring sets are dynamic buffers");
+
+    VkDescriptorSet set;
+
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = _descriptor_pool;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &layout;
+    VK_ASSERT(vkAllocateDescriptorSets(_device, &set_info, &set));
+
+    // the dynamic offset moves this window over the ring
+    VkDescriptorBufferInfo buffer_info{ _buffer.handle, 0, range };
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pBufferInfo = &buffer_info;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+
+    return set;
+}
+
+uint32_t vkframe_ring::alignment() const {
+    return _alignment;
+}
+
+vkframe_ring::stats vkframe_ring::get_stats() const {
+    stats s;
+    s.used = std::min<uint64_t>(_head.load(std::memory_order_relaxed), _frame_size);
+    s.peak = std::max(_peak, s.used);
+    s.failed = _failed.load(std::memory_order_relaxed);
+    return s;
+}
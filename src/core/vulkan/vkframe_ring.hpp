@@ -0,0 +1,92 @@
+#pragma once
+
+#include "./vkbuffer.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace core {
+    // scratch memory for data that lives one frame: uniforms, instance
+    // data, anything written by the CPU and read by the frame's draws.
+    //
+    // one persistently mapped buffer cut into a region per frame in
+    // flight. allocate() bumps a pointer inside the current region, every
+    // allocation is aligned for use as a dynamic uniform or storage buffer
+    // offset, and begin_frame() starts the region over once its fence has
+    // signaled. nothing is created, mapped or freed per draw
+    //
+    // uniform and storage buffers of descriptor_set are dynamic in every
+    // pipeline layout, create_set() makes a set pointing at the ring and
+    // allocation::offset is the dynamic offset to bind it with
+    class vkframe_ring {
+    public:
+        static const uint32_t descriptor_set = 1;
+
+        struct allocation {
+            void* data;
+            VkBuffer buffer;
+            // from the start of the buffer, a dynamic offset or a vertex
+            // or index buffer offset
+            uint32_t offset;
+        };
+
+        struct stats {
+            // current frame's bytes, alignment included
+            uint64_t used;
+            uint64_t peak;
+            // allocations that didn't fit, over the ring's lifetime
+            uint32_t failed;
+        };
+
+    private:
+        VkDevice _device;
+        vkbuffer _buffer;
+        char* _mapped;
+
+        VkDeviceSize _frame_size;
+        uint32_t _alignment;
+        uint32_t _frame;
+
+        // bytes used in the current frame's region, allocate() may run on
+        // any thread
+        std::atomic<uint64_t> _head;
+        std::atomic<uint32_t> _failed;
+        uint64_t _peak;
+
+        VkDescriptorPool _descriptor_pool;
+
+    public:
+        static const uint32_t max_sets = 32;
+
+        // frame_size bytes per frame in flight
+        vkframe_ring(VkDevice, VkPhysicalDevice, VkDeviceSize frame_size, uint32_t frames_in_flight);
+        ~vkframe_ring();
+
+        vkframe_ring(const vkframe_ring&) = delete;
+        vkframe_ring& operator=(const vkframe_ring&) = delete;
+
+        // frame's fence must have signaled, what was allocated in it before
+        // is gone
+        void begin_frame(uint32_t frame);
+
+        // empty if the frame's region is full. thread-safe
+        std::optional<allocation> allocate(VkDeviceSize size);
+
+        // copies data into a fresh allocation
+        std::optional<allocation> push(const void* data, VkDeviceSize size);
+
+        // a set of layout whose binding 0 is a dynamic uniform or storage
+        // buffer over the whole ring, range being the size the shader
+        // reads at each offset, so allocations bound through it have to be
+        // at least range bytes. lives as long as the ring
+        VkDescriptorSet create_set(VkDescriptorSetLayout, VkDescriptorType, VkDeviceSize range);
+
+        uint32_t alignment() const;
+        stats get_stats() const;
+    };
+}
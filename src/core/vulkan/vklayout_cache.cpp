@@ -0,0 +1,116 @@
+#include "./vklayout_cache.hpp"
+
+#include "utils/assert.hpp"
+#include "core/memory/arena.hpp"
+
+using namespace core;
+
+vklayout_cache::vklayout_cache()
+    : _device(VK_NULL_HANDLE)
+{}
+
+vklayout_cache::vklayout_cache(VkDevice device)
+    : _device(device), _mutex(std::make_unique<std::mutex>())
+{}
+
+VkDescriptorSetLayout vklayout_cache::get_set_layout(
+    const std::vector<vkreflection::descriptor_binding>& bindings
+) {
+    std::lock_guard<std::mutex> lock(*_mutex);
+
+    // two words per binding, every field whole. extension descriptor
+    // types and ray tracing/mesh stages don't fit in 16 bits
+    std::vector<uint64_t> key;
+    key.reserve(bindings.size() * 2);
+    for(auto& b : bindings) {
+        key.push_back((uint64_t(b.binding) << 32) | uint64_t(uint32_t(b.type)));
+        key.push_back((uint64_t(b.count) << 32) | uint64_t(b.stages));
+    }
+
+    auto found = _set_layouts.find(key);
+    if(found != _set_layouts.end()) return found->second;
+
+    auto layout_bindings = memory::make_frame_vector<VkDescriptorSetLayoutBinding>(bindings.size());
+    for(auto& b : bindings) {
+        VkDescriptorSetLayoutBinding layout_binding{};
+        layout_binding.binding = b.binding;
+        layout_binding.descriptorType = b.type;
+        layout_binding.descriptorCount = b.count;
+        layout_binding.stageFlags = b.stages;
+        layout_bindings.push_back(layout_binding);
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = layout_bindings.size();
+    layout_info.pBindings = layout_bindings.data();
+
+    VkDescriptorSetLayout layout;
+    VK_ASSERT(
+        vkCreateDescriptorSetLayout(
+            _device,
+            &layout_info,
+            nullptr,
+            &layout
+        )
+    );
+
+    _set_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkPipelineLayout vklayout_cache::get_pipeline_layout(
+    const std::vector<VkDescriptorSetLayout>& set_layouts,
+    const std::vector<VkPushConstantRange>& push_constants
+) {
+    std::lock_guard<std::mutex> lock(*_mutex);
+
+    std::vector<uint64_t> key;
+    key.reserve(set_layouts.size() + push_constants.size() * 2 + 1);
+    for(auto s : set_layouts) key.push_back(reinterpret_cast<uint64_t>(s));
+    // separates the two lists, so they can't be confused with each other
+    key.push_back(~0ull);
+    for(auto& p : push_constants) {
+        key.push_back((uint64_t(p.offset) << 32) | uint64_t(p.size));
+        key.push_back(uint64_t(p.stageFlags));
+    }
+
+    auto found = _pipeline_layouts.find(key);
+    if(found != _pipeline_layouts.end()) return found->second;
+
+    VkPipelineLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = set_layouts.size();
+    layout_info.pSetLayouts = set_layouts.empty() ? nullptr : set_layouts.data();
+    layout_info.pushConstantRangeCount = push_constants.size();
+    layout_info.pPushConstantRanges = push_constants.empty() ? nullptr : push_constants.data();
+
+    VkPipelineLayout layout;
+    VK_ASSERT(
+        vkCreatePipelineLayout(
+            _device,
+            &layout_info,
+            nullptr,
+            &layout
+        )
+    );
+
+    _pipeline_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+size_t vklayout_cache::set_layout_count() const {
+    return _set_layouts.size();
+}
+
+size_t vklayout_cache::pipeline_layout_count() const {
+    return _pipeline_layouts.size();
+}
+
+void vklayout_cache::destroy() {
+    for(auto& [key, layout] : _pipeline_layouts) vkDestroyPipelineLayout(_device, layout, nullptr);
+    for(auto& [key, layout] : _set_layouts) vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+
+    _pipeline_layouts.clear();
+    _set_layouts.clear();
+}
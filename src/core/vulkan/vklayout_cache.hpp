@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/vulkan/vkreflection.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace core
+{
+    // hands out descriptor set layouts and pipeline layouts, creating each
+    // distinct one only once. pipelines whose shaders agree on their
+    // interface end up sharing a layout, which means descriptor sets stay
+    // bound across pipeline switches and less churn in the pipeline cache.
+    // pipelines may be made from several threads at once (see vkapp's
+    // startup), the get_*() calls are locked
+    class vklayout_cache
+    {
+    private:
+        VkDevice _device;
+        // behind a pointer so the cache stays movable
+        std::unique_ptr<std::mutex> _mutex;
+
+        std::map<std::vector<uint64_t>, VkDescriptorSetLayout> _set_layouts;
+        std::map<std::vector<uint64_t>, VkPipelineLayout> _pipeline_layouts;
+
+    public:
+        vklayout_cache();
+        vklayout_cache(VkDevice);
+
+        // bindings must all belong to the same set
+        VkDescriptorSetLayout get_set_layout(const std::vector<vkreflection::descriptor_binding>&);
+        VkPipelineLayout get_pipeline_layout(
+            const std::vector<VkDescriptorSetLayout>&,
+            const std::vector<VkPushConstantRange>&);
+
+        size_t set_layout_count() const;
+        size_t pipeline_layout_count() const;
+
+        void destroy();
+    };
+}
@@ -0,0 +1,59 @@
+#include "./vkmemory.hpp"
+
+#include "utils/assert.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace core;
+
+namespace {
+    struct allocation {
+        VkDeviceSize size;
+        vkmemory::category type;
+    };
+
+    // allocations are rare and big, a lock is fine
+    std::mutex tracking_mutex;
+    std::unordered_map<VkDeviceMemory, allocation> live;
+    vkmemory::usage totals[uint32_t(vkmemory::category::count)];
+}
+
+const char* vkmemory::name(category c) {
+    switch(c) {
+        case category::buffer:        return "buffer";
+        case category::image:         return "image";
+        case category::staging:       return "staging";
+        case category::render_target: return "render_target";
+        default:                      return "unknown";
+    }
+}
+
+VkDeviceMemory vkmemory::allocate(VkDevice device, const VkMemoryAllocateInfo& info, category c) {
+    VkDeviceMemory memory;
+    VK_ASSERT(vkAllocateMemory(device, &info, nullptr, &memory));
+
+    std::lock_guard<std::mutex> lock(tracking_mutex);
+    live[memory] = { info.allocationSize, c };
+    totals[uint32_t(c)].bytes += info.allocationSize;
+    totals[uint32_t(c)].allocations++;
+    return memory;
+}
+
+void vkmemory::free(VkDevice device, VkDeviceMemory memory) {
+    if(memory == VK_NULL_HANDLE) return;
+    vkFreeMemory(device, memory, nullptr);
+
+    std::lock_guard<std::mutex> lock(tracking_mutex);
+    auto it = live.find(memory);
+    ASSERT(it != live.end(), "Freeing device memory that wasn't allocated through vkmemory");
+
+    totals[uint32_t(it->second.type)].bytes -= it->second.size;
+    totals[uint32_t(it->second.type)].allocations--;
+    live.erase(it);
+}
+
+vkmemory::usage vkmemory::get_usage(category c) {
+    std::lock_guard<std::mutex> lock(tracking_mutex);
+    return totals[uint32_t(c)];
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <cstdint>
+
+// every vkAllocateMemory goes through here, so what we hold on the GPU
+// can be told apart by what it's for. the driver's own view of the heaps
+// is in core::memory_telemetry
+namespace core::vkmemory {
+
+    enum class category : uint32_t {
+        buffer,
+        image,
+        // host visible upload buffers
+        staging,
+        // render graph transients
+        render_target,
+        count
+    };
+
+    struct usage {
+        uint64_t bytes;
+        uint64_t allocations;
+    };
+
+    const char* name(category);
+
+    // vkAllocateMemory, asserts on failure
+    VkDeviceMemory allocate(VkDevice, const VkMemoryAllocateInfo&, category);
+    // vkFreeMemory, memory has to come from allocate(). null is ignored
+    void free(VkDevice, VkDeviceMemory);
+
+    // live allocations, any thread
+    usage get_usage(category);
+}
@@ -3,6 +3,7 @@
 #include "utils/assert.hpp"
 
 #include <iostream>
+#include <algorithm>
 
 using namespace core;
 
@@ -10,46 +11,92 @@ vkpipeline::vkpipeline() {}
 
 vkpipeline::vkpipeline(
     VkDevice device,
-    vkswapchain& swapchain,
+    const structs::render_target_info& target,
+    std::vector<vkshader>& shaders,
+    vklayout_cache& layouts
+) : target(target) {
+    this->create_layout(layouts, shaders);
+    this->create_handle(device, shaders);
+}
+
+vkpipeline::vkpipeline(
+    VkDevice device,
+    const structs::render_target_info& target,
+    std::vector<vkshader>& shaders,
+    vklayout_cache& layouts,
+    const structs::vertex_layout& vertex_layout
+) : target(target), vertex_layout(vertex_layout) {
+    this->create_layout(layouts, shaders);
+    this->create_handle(device, shaders);
+}
+
+vkpipeline::vkpipeline(
+    VkDevice device,
+    std::vector<vkshader>& shaders,
+    vklayout_cache& layouts
+) {
+    this->create_layout(layouts, shaders);
+    this->create_handle(device, shaders);
+}
+
+// same targets as before, the layout is looked up again in case the
+// shader interface changed
+void vkpipeline::rebuild(
+    VkDevice device,
+    std::vector<vkshader>& shaders,
+    vklayout_cache& layouts,
+    vkdeletion_queue& deletions
+) {
+    deletions.retire(handle);
+    this->create_layout(layouts, shaders);
+    this->create_handle(device, shaders);
+}
+
+void vkpipeline::create_handle(
+    VkDevice device,
     std::vector<vkshader>& shaders
 ) {
+    if(shaders.size() == 1 && shaders[0].stage_flags == VK_SHADER_STAGE_COMPUTE_BIT) {
+        this->create_compute_handle(device, shaders);
+        return;
+    }
+
     std::vector<VkDynamicState> dynamic_states = {
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR
     };
 
-    this->create_layout(device);
-    this->create_render_pass(device, swapchain);
-
-    VkRect2D scissor;
-    scissor.extent = swapchain.extent;
-    scissor.offset = {};
+    // both are dynamic, set when recording
+    VkRect2D scissor{};
+    VkViewport viewport{};
 
-    VkViewport viewport;
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width  = swapchain.extent.width;
-    viewport.height = swapchain.extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    auto shader_stages_info     = get_shader_stage_infos(shaders);
+    auto specialization_infos   = memory::make_frame_vector<VkSpecializationInfo>(shaders.size());
+    auto shader_stages_info     = get_shader_stage_infos(shaders, specialization_infos);
     auto dynamic_state_info     = get_dynamic_state_info(dynamic_states);
-    auto vertex_input_info      = get_vertex_input_info();
+    auto vertex_input_info      = get_vertex_input_info(shaders);
     auto input_assembly_info    = get_input_assembly_info();
     auto rasterization_info     = get_rasterization_state_info();    
     auto multisample_info       = get_multisample_state_info();
     auto viewport_state_info    = get_viewport_state_info(&scissor, &viewport);
 
-    auto color_blend_attachment_info = create_color_blend_attachment_state();
-    auto color_blend_info = get_color_blend_state_info(&color_blend_attachment_info);
+    // one blend state per color target
+    std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments(
+        target.color_formats.size(), create_color_blend_attachment_state());
+    auto color_blend_info = get_color_blend_state_info(color_blend_attachments);
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+    depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_info.depthTestEnable = VK_TRUE;
+    depth_stencil_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    bool has_depth = target.depth_format != VK_FORMAT_UNDEFINED;
 
     VkGraphicsPipelineCreateInfo pipeline_info{};
     pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipeline_info.stageCount = shader_stages_info.size();
     pipeline_info.pStages = shader_stages_info.data();
     pipeline_info.layout = layout;
-    pipeline_info.renderPass = render_pass;
     pipeline_info.subpass = 0;
 
     pipeline_info.pDynamicState = &dynamic_state_info;
@@ -59,7 +106,22 @@ vkpipeline::vkpipeline(
     pipeline_info.pVertexInputState = &vertex_input_info;
     pipeline_info.pRasterizationState = &rasterization_info;
     pipeline_info.pInputAssemblyState = &input_assembly_info;
-    pipeline_info.pDepthStencilState = nullptr;
+    pipeline_info.pDepthStencilState = has_depth ? &depth_stencil_info : nullptr;
+
+    // with dynamic rendering there's no render pass, the pipeline only
+    // needs to know the formats it writes
+    VkPipelineRenderingCreateInfoKHR rendering_info{};
+    rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    rendering_info.colorAttachmentCount = target.color_formats.size();
+    rendering_info.pColorAttachmentFormats = target.color_formats.data();
+    rendering_info.depthAttachmentFormat = target.depth_format;
+
+    if(target.render_pass == VK_NULL_HANDLE) {
+        pipeline_info.pNext = &rendering_info;
+        pipeline_info.renderPass = VK_NULL_HANDLE;
+    } else {
+        pipeline_info.renderPass = target.render_pass;
+    }
 
     VK_ASSERT(
         vkCreateGraphicsPipelines(
@@ -73,57 +135,19 @@ vkpipeline::vkpipeline(
     );
 }
 
-void vkpipeline::create_render_pass(
+void vkpipeline::create_compute_handle(
     VkDevice device,
-    vkswapchain& swapchain
+    std::vector<vkshader>& shaders
 ) {
-    VkAttachmentDescription color_attachment{};
-    color_attachment.format = swapchain.format.format;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-
-    // clear color attachment when framebuffer is loaded
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    // since we want to see stuff, we store operations
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-    // since we aren't using stencil buffers, we don't care
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-    // since we're clearing the attachment, we don't care about layout
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    // we're going to show the image, so it's final layout must be
-    // present
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    // we're only using one Attach Descriptor (color_attachment)
-    // it's index is 0 and is used for color
-    VkAttachmentReference color_attach_ref{};
-    color_attach_ref.attachment = 0;
-    color_attach_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass_description{};
-    subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass_description.colorAttachmentCount = 1;
-    subpass_description.pColorAttachments = &color_attach_ref;
-    // the index of the attachment corresponds to the
-    // layout(location=X) index of shader 
-
-    VkRenderPassCreateInfo render_pass_info{};
-    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &subpass_description;
+    auto specialization_infos = memory::make_frame_vector<VkSpecializationInfo>(shaders.size());
+    auto shader_stages_info = get_shader_stage_infos(shaders, specialization_infos);
 
-    VK_ASSERT(
-        vkCreateRenderPass(
-            device,
-            &render_pass_info,
-            nullptr,
-            &render_pass
-        )
-    );
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage = shader_stages_info[0];
+    pipeline_info.layout = layout;
+
+    VK_ASSERT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &handle));
 }
 
 VkPipelineViewportStateCreateInfo vkpipeline::get_viewport_state_info(
@@ -140,32 +164,71 @@ VkPipelineViewportStateCreateInfo vkpipeline::get_viewport_state_info(
     return viewport_state_info;
 }
 
-void vkpipeline::create_layout(VkDevice device) {
-    VkPipelineLayoutCreateInfo layout_info{};
-    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    layout_info.setLayoutCount = 0;
-    layout_info.pSetLayouts = nullptr;
-    layout_info.pushConstantRangeCount = 0;
-    layout_info.pPushConstantRanges = nullptr;
+void vkpipeline::create_layout(vklayout_cache& layouts, const std::vector<vkshader>& shaders) {
+    using binding = vkreflection::descriptor_binding;
+
+    // merge what every stage declares, a binding used by several stages
+    // shows up once with all their stage flags
+    std::vector<binding> bindings;
+    std::vector<VkPushConstantRange> push_constants;
+
+    for(auto& shader : shaders) {
+        for(auto& b : shader.reflection.bindings) {
+            auto existing = std::find_if(bindings.begin(), bindings.end(), [&](binding& o) {
+                return o.set == b.set && o.binding == b.binding;
+            });
+
+            if(existing == bindings.end()) {
+                bindings.push_back(b);
+                continue;
+            }
+
+            ASSERT(existing->type == b.type, "Shader stages disagree on a descriptor type");
+            existing->stages |= b.stages;
+            existing->count = std::max(existing->count, b.count);
+        }
+
+        push_constants.insert(
+            push_constants.end(),
+            shader.reflection.push_constants.begin(),
+            shader.reflection.push_constants.end());
+    }
 
-    VK_ASSERT(
-        vkCreatePipelineLayout(
-            device,
-            &layout_info,
-            nullptr,
-            &layout 
-        )
-    );
+    // per-draw data comes from the frame ring at a dynamic offset, the
+    // shader can't tell the difference
+    for(auto& b : bindings) {
+        if(b.set != vkframe_ring::descriptor_set) continue;
+        if(b.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) b.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        if(b.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) b.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](binding& a, binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    // one layout per set index, sets nobody uses get an empty layout
+    uint32_t set_count = bindings.empty() ? 0 : bindings.back().set + 1;
+
+    set_layouts.clear();
+    for(uint32_t set = 0; set < set_count; set++) {
+        std::vector<binding> set_bindings;
+        for(auto& b : bindings) {
+            if(b.set == set) set_bindings.push_back(b);
+        }
+        set_layouts.push_back(layouts.get_set_layout(set_bindings));
+    }
+
+    layout = layouts.get_pipeline_layout(set_layouts, push_constants);
 }
 
 VkPipelineColorBlendStateCreateInfo vkpipeline::get_color_blend_state_info(
-    VkPipelineColorBlendAttachmentState* color_blend_attachment_state
+    const std::vector<VkPipelineColorBlendAttachmentState>& color_blend_attachment_states
 ) {
     VkPipelineColorBlendStateCreateInfo color_blend_info{};
 
     color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blend_info.attachmentCount = 1;
-    color_blend_info.pAttachments = color_blend_attachment_state;
+    color_blend_info.attachmentCount = color_blend_attachment_states.size();
+    color_blend_info.pAttachments = color_blend_attachment_states.data();
     
     // disable logicOp as it overwrites blending specified in color blend attachment
     color_blend_info.logicOpEnable = VK_FALSE;
@@ -248,22 +311,69 @@ VkPipelineInputAssemblyStateCreateInfo vkpipeline::get_input_assembly_info() {
     return input_assembly_info;
 }
 
-//TODO fill in this struct, not doing now as we're hardcoding the
-// vertices in shaders
-VkPipelineVertexInputStateCreateInfo vkpipeline::get_vertex_input_info() {
+// a single interleaved buffer in binding 0, attributes packed in
+// location order
+VkPipelineVertexInputStateCreateInfo vkpipeline::get_vertex_input_info(
+    const std::vector<vkshader>& shaders
+) {
+    vertex_bindings.clear();
+    vertex_attributes.clear();
+
+    for(auto& shader : shaders) {
+        if(shader.stage_flags != VK_SHADER_STAGE_VERTEX_BIT) continue;
+
+        if(vertex_layout.has_value()) {
+            // the formats may differ (unorm16 data read as vec4), but every
+            // input the shader reads has to come from somewhere
+            for(auto& input : shader.reflection.inputs) {
+                bool found = false;
+                for(auto& attribute : vertex_layout->attributes) {
+                    found |= attribute.location == input.location;
+                }
+                ASSERT(found, "Vertex layout is missing an input of the vertex shader");
+            }
+
+            vertex_bindings = vertex_layout->bindings;
+            vertex_attributes = vertex_layout->attributes;
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for(auto& input : shader.reflection.inputs) {
+            VkVertexInputAttributeDescription attribute{};
+            attribute.location = input.location;
+            attribute.binding = 0;
+            attribute.format = input.format;
+            attribute.offset = offset;
+            vertex_attributes.push_back(attribute);
+
+            offset += input.size;
+        }
+
+        if(!vertex_attributes.empty()) {
+            VkVertexInputBindingDescription binding{};
+            binding.binding = 0;
+            binding.stride = offset;
+            binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            vertex_bindings.push_back(binding);
+        }
+    }
+
     VkPipelineVertexInputStateCreateInfo vertex_input_info{};
     vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexAttributeDescriptionCount   = 0;
-    vertex_input_info.pVertexAttributeDescriptions      = nullptr;
-    vertex_input_info.vertexBindingDescriptionCount     = 0;
-    vertex_input_info.pVertexBindingDescriptions        = nullptr;
+    vertex_input_info.vertexAttributeDescriptionCount   = vertex_attributes.size();
+    vertex_input_info.pVertexAttributeDescriptions      = vertex_attributes.data();
+    vertex_input_info.vertexBindingDescriptionCount     = vertex_bindings.size();
+    vertex_input_info.pVertexBindingDescriptions        = vertex_bindings.data();
     return vertex_input_info;
 }
 
-std::vector<VkPipelineShaderStageCreateInfo> vkpipeline::get_shader_stage_infos(
-    std::vector<vkshader> shaders
+memory::frame_vector<VkPipelineShaderStageCreateInfo> vkpipeline::get_shader_stage_infos(
+    const std::vector<vkshader>& shaders,
+    memory::frame_vector<VkSpecializationInfo>& specialization_infos
 ) {
-    std::vector<VkPipelineShaderStageCreateInfo> shader_stages_create_info;
+    auto shader_stages_create_info =
+        memory::make_frame_vector<VkPipelineShaderStageCreateInfo>(shaders.size());
 
     for (auto &shader : shaders)
     {
@@ -273,6 +383,14 @@ std::vector<VkPipelineShaderStageCreateInfo> vkpipeline::get_shader_stage_infos(
         shader_stage_info.module = shader.handle;
         shader_stage_info.pName  = "main";
 
+        if(!shader.specialization.empty()) {
+            ASSERT(shader.specialization.matches(shader.reflection), "Specialization constant not in the shader");
+
+            // reserved up front, the pointers stay put
+            specialization_infos.push_back(shader.specialization.info());
+            shader_stage_info.pSpecializationInfo = &specialization_infos.back();
+        }
+
         shader_stages_create_info.push_back(shader_stage_info);
     }
 
@@ -288,7 +406,12 @@ VkPipelineDynamicStateCreateInfo vkpipeline::get_dynamic_state_info(std::vector<
 }
 
 void vkpipeline::destroy(VkDevice device) {
-    vkDestroyPipelineLayout(device, layout, nullptr);
-    vkDestroyRenderPass(device, render_pass, nullptr);
+    // the layout belongs to the layout cache, the render pass (if any)
+    // to the render graph
     vkDestroyPipeline(device, handle, nullptr);
+}
+
+void vkpipeline::destroy(vkdeletion_queue& deletions) {
+    deletions.retire(handle);
+    handle = VK_NULL_HANDLE;
 }
\ No newline at end of file
@@ -1,39 +1,68 @@
 #pragma once
 
 #include "./vkshader.hpp"
-#include "./vkswapchain.hpp"
+#include "./vklayout_cache.hpp"
+#include "./vkdeletion_queue.hpp"
+#include "./vkframe_ring.hpp"
+#include "./vkstructs.hpp"
+#include "core/memory/arena.hpp"
 
 #include <vector>
+#include <optional>
 
 namespace core {
     class vkpipeline {
     public:
         vkpipeline();
-        vkpipeline(VkDevice, core::vkswapchain&, std::vector<vkshader>&);
+        vkpipeline(VkDevice, const structs::render_target_info&, std::vector<vkshader>&, vklayout_cache&);
+        // vertex buffers laid out by the data (eg. quantized meshes), the
+        // shader only decides which locations have to be there
+        vkpipeline(VkDevice, const structs::render_target_info&, std::vector<vkshader>&, vklayout_cache&, const structs::vertex_layout&);
+        // a compute pipeline, from a single compute shader
+        vkpipeline(VkDevice, std::vector<vkshader>&, vklayout_cache&);
 
         VkPipeline handle;
+        // both owned by the layout cache, shared with other pipelines
         VkPipelineLayout layout;
-        VkRenderPass render_pass;
+        std::vector<VkDescriptorSetLayout> set_layouts;
+        // what it was made to draw into, the render graph pass' targets.
+        // unused by compute pipelines
+        structs::render_target_info target;
 
-        void create_layout(VkDevice);
+        // generated from the vertex shader's inputs, interleaved in binding 0,
+        // unless a vertex layout was given
+        std::vector<VkVertexInputBindingDescription> vertex_bindings;
+        std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+        std::optional<structs::vertex_layout> vertex_layout;
+
+        void create_layout(vklayout_cache&, const std::vector<vkshader>&);
         void destroy(VkDevice);
+        // once the frames that may still bind it are done
+        void destroy(vkdeletion_queue&);
+
+        // recreates only the pipeline object, eg. after a shader reload.
+        // the old one is retired, frames in flight keep using it
+        void rebuild(VkDevice, std::vector<vkshader>&, vklayout_cache&, vkdeletion_queue&);
 
     private:
-        std::vector<VkPipelineShaderStageCreateInfo> get_shader_stage_infos(std::vector<vkshader>);
+        // specialization_infos has to have room for one per shader
+        memory::frame_vector<VkPipelineShaderStageCreateInfo> get_shader_stage_infos(
+            const std::vector<vkshader>&, memory::frame_vector<VkSpecializationInfo>& specialization_infos);
         VkPipelineDynamicStateCreateInfo get_dynamic_state_info(std::vector<VkDynamicState> &dynamic_states);
-        VkPipelineVertexInputStateCreateInfo get_vertex_input_info();
+        VkPipelineVertexInputStateCreateInfo get_vertex_input_info(const std::vector<vkshader>&);
         VkPipelineInputAssemblyStateCreateInfo get_input_assembly_info();
         VkPipelineRasterizationStateCreateInfo get_rasterization_state_info();
         VkPipelineMultisampleStateCreateInfo get_multisample_state_info();
         VkPipelineColorBlendStateCreateInfo get_color_blend_state_info(
-            VkPipelineColorBlendAttachmentState*
+            const std::vector<VkPipelineColorBlendAttachmentState>&
         );
         VkPipelineColorBlendAttachmentState create_color_blend_attachment_state();
         VkPipelineViewportStateCreateInfo get_viewport_state_info(
             VkRect2D*, VkViewport*
         );
 
-        void create_render_pass(VkDevice, core::vkswapchain&);
+        void create_handle(VkDevice, std::vector<vkshader>&);
+        void create_compute_handle(VkDevice, std::vector<vkshader>&);
         
     };
 }
\ No newline at end of file
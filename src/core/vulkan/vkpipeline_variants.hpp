@@ -0,0 +1,191 @@
+#pragma once
+
+#include "./vkpipeline.hpp"
+#include "./vkshader.hpp"
+#include "./vkspecialization.hpp"
+#include "./vklayout_cache.hpp"
+#include "./vkdeletion_queue.hpp"
+#include "./vkstructs.hpp"
+#include "utils/assert.hpp"
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <initializer_list>
+
+// pipelines one variant_set may expand into, past this it doesn't compile
+#ifndef GAME_MAX_PIPELINE_VARIANTS
+    #define GAME_MAX_PIPELINE_VARIANTS 64
+#endif
+
+namespace core {
+    // one switch of a variant set: layout(constant_id = Id) takes the
+    // values 0 .. Count - 1. a bool is an option with two values
+    template<uint32_t Id, uint32_t Count = 2>
+    struct spec_option {
+        static_assert(Count > 0, "An option needs at least one value");
+
+        static const uint32_t id = Id;
+        static const uint32_t count = Count;
+    };
+
+    // every combination of some options, numbered with the first option
+    // changing fastest. the count is known at compile time, a set that
+    // would need too many pipelines doesn't build
+    template<typename... Options>
+    struct variant_set {
+        static const uint32_t option_count = sizeof...(Options);
+        static const uint32_t count = (Options::count * ... * 1u);
+
+        static_assert(count <= GAME_MAX_PIPELINE_VARIANTS, "Too many pipeline variants, see GAME_MAX_PIPELINE_VARIANTS");
+
+        // one value per option, in the order they were given
+        using values = std::array<uint32_t, option_count>;
+
+        static uint32_t index(const values& v) {
+            const uint32_t counts[] = { Options::count..., 1u };
+            uint32_t index = 0, stride = 1;
+            for(uint32_t i = 0; i < option_count; i++) {
+                ASSERT(v[i] < counts[i], "Variant value out of range");
+                index += v[i] * stride;
+                stride *= counts[i];
+            }
+            return index;
+        }
+
+        static values unpack(uint32_t index) {
+            const uint32_t counts[] = { Options::count..., 1u };
+            values v{};
+            for(uint32_t i = 0; i < option_count; i++) {
+                v[i] = index % counts[i];
+                index /= counts[i];
+            }
+            return v;
+        }
+
+        static vkspecialization specialization(uint32_t index) {
+            const uint32_t ids[] = { Options::id..., 0u };
+            values v = unpack(index);
+
+            vkspecialization s;
+            for(uint32_t i = 0; i < option_count; i++) {
+                s.set(ids[i], v[i]);
+            }
+            return s;
+        }
+    };
+
+    // the pipelines of a variant_set, all made from the same shaders and
+    // so sharing one layout, descriptor sets bound for one stay bound
+    // across the others. variants are made on first use, prewarm() the
+    // ones a frame is going to need so that never happens mid-frame
+    template<typename Set>
+    class vkpipeline_variants {
+    private:
+        // without specialization, each variant copies them and sets its own
+        std::vector<vkshader> _shaders;
+        bool _compute;
+        std::optional<structs::vertex_layout> _vertex_layout;
+
+        std::array<vkpipeline, Set::count> _pipelines;
+        std::array<bool, Set::count> _built;
+
+        vkpipeline make(VkDevice device, vklayout_cache& layouts, uint32_t index) {
+            auto shaders = _shaders;
+            for(auto& shader : shaders) {
+                shader.specialization = Set::specialization(index);
+            }
+
+            if(_compute) return vkpipeline(device, shaders, layouts);
+            if(_vertex_layout.has_value()) return vkpipeline(device, target, shaders, layouts, *_vertex_layout);
+            return vkpipeline(device, target, shaders, layouts);
+        }
+
+    public:
+        using variant_values = typename Set::values;
+
+        // what the graphics variants draw into, set it before rebuild()
+        // when the render graph changes
+        structs::render_target_info target;
+
+        vkpipeline_variants() : _compute(false) {
+            _built.fill(false);
+        }
+
+        // graphics pipelines, see the vkpipeline constructors
+        vkpipeline_variants(
+            const structs::render_target_info& target,
+            const std::vector<vkshader>& shaders,
+            std::optional<structs::vertex_layout> vertex_layout = std::nullopt
+        ) : _shaders(shaders), _compute(false), _vertex_layout(vertex_layout), target(target) {
+            _built.fill(false);
+        }
+
+        // compute pipelines, from a single compute shader
+        explicit vkpipeline_variants(const std::vector<vkshader>& shaders)
+            : _shaders(shaders), _compute(true)
+        {
+            _built.fill(false);
+        }
+
+        void prewarm(VkDevice device, vklayout_cache& layouts, std::initializer_list<uint32_t> indices) {
+            for(uint32_t index : indices) {
+                this->get(device, layouts, index);
+            }
+        }
+
+        void prewarm_all(VkDevice device, vklayout_cache& layouts) {
+            for(uint32_t index = 0; index < Set::count; index++) {
+                this->get(device, layouts, index);
+            }
+        }
+
+        // made now if it wasn't prewarmed
+        const vkpipeline& get(VkDevice device, vklayout_cache& layouts, uint32_t index) {
+            ASSERT(index < Set::count, "Variant index out of range");
+
+            if(!_built[index]) {
+                _pipelines[index] = this->make(device, layouts, index);
+                _built[index] = true;
+            }
+            return _pipelines[index];
+        }
+
+        const vkpipeline& get(VkDevice device, vklayout_cache& layouts, const variant_values& values) {
+            return this->get(device, layouts, Set::index(values));
+        }
+
+        // only variants that were made already
+        const vkpipeline& get(uint32_t index) const {
+            ASSERT(index < Set::count && _built[index], "Variant was never made");
+            return _pipelines[index];
+        }
+
+        // every variant made so far, with new shaders (eg. after a
+        // reload) or a new target. the old ones are retired
+        void rebuild(VkDevice device, const std::vector<vkshader>& shaders, vklayout_cache& layouts, vkdeletion_queue& deletions) {
+            _shaders = shaders;
+
+            for(uint32_t index = 0; index < Set::count; index++) {
+                if(!_built[index]) continue;
+
+                _pipelines[index].destroy(deletions);
+                _pipelines[index] = this->make(device, layouts, index);
+            }
+        }
+
+        void destroy(VkDevice device) {
+            for(uint32_t index = 0; index < Set::count; index++) {
+                if(_built[index]) _pipelines[index].destroy(device);
+                _built[index] = false;
+            }
+        }
+
+        uint32_t built() const {
+            uint32_t n = 0;
+            for(bool b : _built) n += b;
+            return n;
+        }
+    };
+}
@@ -0,0 +1,126 @@
+#include "./vkrecorder.hpp"
+
+#include "utils/assert.hpp"
+
+#include <algorithm>
+
+using namespace core;
+
+vkrecorder::vkrecorder()
+    : _device(VK_NULL_HANDLE), _jobs(nullptr), _thread_count(0), _frame(0)
+{}
+
+vkrecorder::vkrecorder(
+    VkDevice device,
+    uint32_t queue_family,
+    jobs::thread_pool& jobs,
+    uint32_t frames_in_flight
+) : _device(device), _jobs(&jobs), _thread_count(jobs.thread_count()), _frame(0) {
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+
+    _pools.resize(frames_in_flight * _thread_count);
+    for(auto& state : _pools) {
+        VK_ASSERT(vkCreateCommandPool(device, &pool_info, nullptr, &state.pool));
+        state.used = 0;
+    }
+}
+
+void vkrecorder::begin_frame(uint32_t frame) {
+    _frame = frame;
+
+    for(uint32_t t = 0; t < _thread_count; t++) {
+        auto& state = _pools[_frame * _thread_count + t];
+        vkResetCommandPool(_device, state.pool, 0);
+        state.used = 0;
+    }
+}
+
+// only ever called by the thread owning that pool
+VkCommandBuffer vkrecorder::next_buffer(uint32_t thread_index) {
+    auto& state = _pools[_frame * _thread_count + thread_index];
+
+    if(state.used == state.buffers.size()) {
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = state.pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        VK_ASSERT(vkAllocateCommandBuffers(_device, &allocate_info, &command_buffer));
+        state.buffers.push_back(command_buffer);
+    }
+
+    return state.buffers[state.used++];
+}
+
+void vkrecorder::record_chunks(
+    VkCommandBuffer primary,
+    const structs::render_target_info& target,
+    uint32_t count,
+    uint32_t min_chunk,
+    uint32_t max_threads,
+    record_fn fn,
+    void* context
+) {
+    if(count == 0) return;
+
+    // a few chunks per thread, so one slow chunk doesn't hold up the rest
+    uint32_t threads = max_threads == 0 ? _thread_count : std::min(max_threads, _thread_count);
+    uint32_t chunk_count = std::min(threads * 4, (count + min_chunk - 1) / std::max(min_chunk, 1u));
+    chunk_count = std::max(chunk_count, 1u);
+    uint32_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    _chunks.resize(chunk_count);
+
+    // with dynamic rendering the formats stand in for the render pass
+    VkCommandBufferInheritanceRenderingInfoKHR rendering_info{};
+    rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    rendering_info.colorAttachmentCount = target.color_formats.size();
+    rendering_info.pColorAttachmentFormats = target.color_formats.data();
+    rendering_info.depthAttachmentFormat = target.depth_format;
+    rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.pNext = target.render_pass == VK_NULL_HANDLE ? &rendering_info : nullptr;
+    inheritance_info.renderPass = target.render_pass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags =
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+        VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    _jobs->parallel_for(chunk_count, [&](uint32_t chunk, uint32_t thread_index) {
+        VkCommandBuffer command_buffer = next_buffer(thread_index);
+        VK_ASSERT(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+        uint32_t first = chunk * chunk_size;
+        fn(context, command_buffer, first, std::min(chunk_size, count - first));
+
+        VK_ASSERT(vkEndCommandBuffer(command_buffer));
+        _chunks[chunk] = command_buffer;
+    }, threads);
+
+    vkCmdExecuteCommands(primary, _chunks.size(), _chunks.data());
+}
+
+uint32_t vkrecorder::thread_count() const {
+    return _thread_count;
+}
+
+void vkrecorder::destroy() {
+    // freeing the pools frees their buffers
+    for(auto& state : _pools) {
+        vkDestroyCommandPool(_device, state.pool, nullptr);
+    }
+    _pools.clear();
+}
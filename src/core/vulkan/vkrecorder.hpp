@@ -0,0 +1,81 @@
+#pragma once
+
+#include "./vkstructs.hpp"
+#include "core/jobs/thread_pool.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace core {
+    // records a long draw list on every thread of a pool at once.
+    //
+    // the list is cut into chunks, each chunk goes into its own secondary
+    // command buffer from the recording thread's pool for this frame, and
+    // the primary executes them in chunk order. which thread recorded
+    // what doesn't change the result, so frames are reproducible
+    class vkrecorder {
+    private:
+        using record_fn = void(*)(void* context, VkCommandBuffer, uint32_t first, uint32_t count);
+
+        // one per thread per frame in flight, pools aren't thread-safe
+        struct thread_pool_state {
+            VkCommandPool pool;
+            // allocated on first use, reused every frame after that
+            std::vector<VkCommandBuffer> buffers;
+            uint32_t used;
+        };
+
+        VkDevice _device;
+        jobs::thread_pool* _jobs;
+        uint32_t _thread_count;
+
+        std::vector<thread_pool_state> _pools;
+        uint32_t _frame;
+
+        // secondaries of the current record(), indexed by chunk
+        std::vector<VkCommandBuffer> _chunks;
+
+        void record_chunks(
+            VkCommandBuffer primary,
+            const structs::render_target_info&,
+            uint32_t count, uint32_t min_chunk, uint32_t max_threads,
+            record_fn, void* context);
+
+        VkCommandBuffer next_buffer(uint32_t thread_index);
+
+    public:
+        vkrecorder();
+        vkrecorder(VkDevice, uint32_t queue_family, jobs::thread_pool&, uint32_t frames_in_flight);
+
+        // recycles the frame's pools, its fence must have signaled
+        void begin_frame(uint32_t frame);
+
+        // calls fn(command_buffer, first, count) for chunks of [0, count)
+        // with at least min_chunk items each, in parallel, then executes
+        // them in order into primary. must be called inside a render graph
+        // pass marked with secondary_contents(), target being that pass'
+        // targets. state isn't inherited, every chunk binds its own
+        template<typename F>
+        void record(
+            VkCommandBuffer primary,
+            const structs::render_target_info& target,
+            uint32_t count, F&& fn,
+            uint32_t min_chunk = 256, uint32_t max_threads = 0
+        ) {
+            auto invoke = [](void* context, VkCommandBuffer command_buffer, uint32_t first, uint32_t count) {
+                (*static_cast<std::remove_reference_t<F>*>(context))(command_buffer, first, count);
+            };
+            record_chunks(
+                primary, target, count, min_chunk, max_threads,
+                invoke, const_cast<void*>(static_cast<const void*>(&fn)));
+        }
+
+        uint32_t thread_count() const;
+
+        void destroy();
+    };
+}
@@ -0,0 +1,326 @@
+#include "./vkreflection.hpp"
+
+#include "utils/assert.hpp"
+
+#include <algorithm>
+
+using namespace core;
+
+// just the bits of the SPIR-V spec we need, see
+// https://registry.khronos.org/SPIR-V/specs/unified1/SPIRV.html
+namespace spv {
+    const uint32_t magic = 0x07230203;
+
+    enum op : uint16_t {
+        op_decorate = 71,
+        op_member_decorate = 72,
+        op_type_bool = 20,
+        op_type_int = 21,
+        op_type_float = 22,
+        op_type_vector = 23,
+        op_type_matrix = 24,
+        op_type_image = 25,
+        op_type_sampler = 26,
+        op_type_sampled_image = 27,
+        op_type_array = 28,
+        op_type_runtime_array = 29,
+        op_type_struct = 30,
+        op_type_pointer = 32,
+        op_constant = 43,
+        op_spec_constant_true = 48,
+        op_spec_constant_false = 49,
+        op_spec_constant = 50,
+        op_variable = 59,
+    };
+
+    enum decoration : uint32_t {
+        decoration_spec_id = 1,
+        decoration_block = 2,
+        decoration_buffer_block = 3,
+        decoration_array_stride = 6,
+        decoration_builtin = 11,
+        decoration_location = 30,
+        decoration_binding = 33,
+        decoration_descriptor_set = 34,
+        decoration_offset = 35,
+    };
+
+    enum storage_class : uint32_t {
+        storage_uniform_constant = 0,
+        storage_input = 1,
+        storage_uniform = 2,
+        storage_push_constant = 9,
+        storage_storage_buffer = 12,
+    };
+
+    const uint32_t none = ~0u;
+
+    // everything we learn about a single <id>
+    struct id_info {
+        uint16_t opcode = 0;
+
+        // types
+        uint32_t width = 0;           // int/float bit width
+        uint32_t is_signed = 0;
+        uint32_t element = none;      // vector/matrix/array element, pointer pointee
+        uint32_t count = 0;           // vector/matrix components
+        uint32_t length_id = none;    // array length constant
+        uint32_t sampled = 0;         // image: 1 = sampled, 2 = storage
+        uint32_t storage = none;      // pointer/variable storage class
+        std::vector<uint32_t> members;
+        std::vector<uint32_t> member_offsets;
+
+        // constants
+        uint32_t value = 0;
+
+        // decorations
+        uint32_t location = none;
+        uint32_t binding = none;
+        uint32_t set = none;
+        uint32_t spec_id = none;
+        uint32_t array_stride = 0;
+        bool builtin = false;
+        bool block = false;
+        bool buffer_block = false;
+    };
+}
+
+static uint32_t size_of(const std::vector<spv::id_info>& ids, uint32_t id) {
+    auto& t = ids[id];
+
+    switch(t.opcode) {
+        case spv::op_type_bool:
+            return 4;
+        case spv::op_type_int:
+        case spv::op_type_float:
+            return t.width / 8;
+        case spv::op_type_vector:
+        case spv::op_type_matrix:
+            return t.count * size_of(ids, t.element);
+        case spv::op_type_array: {
+            uint32_t stride = t.array_stride ? t.array_stride : size_of(ids, t.element);
+            return stride * ids[t.length_id].value;
+        }
+        case spv::op_type_struct: {
+            uint32_t size = 0;
+            for(size_t i = 0; i < t.members.size(); i++) {
+                uint32_t offset = i < t.member_offsets.size() ? t.member_offsets[i] : 0;
+                size = std::max(size, offset + size_of(ids, t.members[i]));
+            }
+            return size;
+        }
+        default:
+            return 0;
+    }
+}
+
+static VkFormat format_of(const std::vector<spv::id_info>& ids, uint32_t id) {
+    auto& t = ids[id];
+
+    uint32_t components = 1;
+    const spv::id_info* scalar = &t;
+
+    if(t.opcode == spv::op_type_vector) {
+        components = t.count;
+        scalar = &ids[t.element];
+    }
+
+    if(scalar->width != 32) return VK_FORMAT_UNDEFINED;
+
+    const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    const VkFormat sints[]  = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    const VkFormat uints[]  = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+    if(scalar->opcode == spv::op_type_float) return floats[components - 1];
+    if(scalar->opcode == spv::op_type_int) return scalar->is_signed ? sints[components - 1] : uints[components - 1];
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+vkreflection::vkreflection() {}
+
+vkreflection::vkreflection(
+    const uint32_t* code,
+    size_t code_size,
+    VkShaderStageFlagBits shader_stage
+) : stage(shader_stage) {
+    size_t word_count = code_size / 4;
+
+    ASSERT(word_count > 5 && code[0] == spv::magic, "Not a SPIR-V module");
+
+    // every <id> is below the bound, so a flat array works as a map
+    std::vector<spv::id_info> ids(code[3]);
+    std::vector<uint32_t> variables;
+
+    for(size_t i = 5; i < word_count;) {
+        uint16_t opcode = code[i] & 0xffff;
+        uint16_t length = code[i] >> 16;
+        const uint32_t* w = code + i;
+
+        ASSERT(length > 0 && i + length <= word_count, "Malformed SPIR-V");
+
+        switch(opcode) {
+            case spv::op_decorate: {
+                auto& t = ids[w[1]];
+                uint32_t literal = length > 3 ? w[3] : 0;
+                switch(w[2]) {
+                    case spv::decoration_spec_id:        t.spec_id = literal; break;
+                    case spv::decoration_block:          t.block = true; break;
+                    case spv::decoration_buffer_block:   t.buffer_block = true; break;
+                    case spv::decoration_array_stride:   t.array_stride = literal; break;
+                    case spv::decoration_builtin:        t.builtin = true; break;
+                    case spv::decoration_location:       t.location = literal; break;
+                    case spv::decoration_binding:        t.binding = literal; break;
+                    case spv::decoration_descriptor_set: t.set = literal; break;
+                }
+                break;
+            }
+            case spv::op_member_decorate: {
+                if(w[3] != spv::decoration_offset) break;
+                auto& t = ids[w[1]];
+                if(t.member_offsets.size() <= w[2]) t.member_offsets.resize(w[2] + 1);
+                t.member_offsets[w[2]] = w[4];
+                break;
+            }
+            case spv::op_type_bool:
+            case spv::op_type_sampler:
+                ids[w[1]].opcode = opcode;
+                break;
+            case spv::op_type_int:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].width = w[2];
+                ids[w[1]].is_signed = w[3];
+                break;
+            case spv::op_type_float:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].width = w[2];
+                break;
+            case spv::op_type_vector:
+            case spv::op_type_matrix:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].element = w[2];
+                ids[w[1]].count = w[3];
+                break;
+            case spv::op_type_image:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].sampled = w[7];
+                break;
+            case spv::op_type_sampled_image:
+            case spv::op_type_runtime_array:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].element = w[2];
+                break;
+            case spv::op_type_array:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].element = w[2];
+                ids[w[1]].length_id = w[3];
+                break;
+            case spv::op_type_struct:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].members.assign(w + 2, w + length);
+                break;
+            case spv::op_type_pointer:
+                ids[w[1]].opcode = opcode;
+                ids[w[1]].storage = w[2];
+                ids[w[1]].element = w[3];
+                break;
+            case spv::op_constant:
+            case spv::op_spec_constant:
+            case spv::op_spec_constant_true:
+            case spv::op_spec_constant_false:
+                ids[w[2]].opcode = opcode;
+                ids[w[2]].element = w[1];
+                ids[w[2]].value = length > 3 ? w[3] : (opcode == spv::op_spec_constant_true);
+                break;
+            case spv::op_variable:
+                ids[w[2]].opcode = opcode;
+                ids[w[2]].element = w[1];
+                ids[w[2]].storage = w[3];
+                variables.push_back(w[2]);
+                break;
+        }
+
+        i += length;
+    }
+
+    for(uint32_t id = 0; id < ids.size(); id++) {
+        auto& c = ids[id];
+        bool is_spec =
+            c.opcode == spv::op_spec_constant ||
+            c.opcode == spv::op_spec_constant_true ||
+            c.opcode == spv::op_spec_constant_false;
+
+        if(is_spec && c.spec_id != spv::none) {
+            // bools are VkBool32 on the API side
+            uint32_t size = ids[c.element].opcode == spv::op_type_bool ? 4 : size_of(ids, c.element);
+            specialization_constants.push_back({ c.spec_id, size });
+        }
+    }
+
+    for(auto id : variables) {
+        auto& var = ids[id];
+        uint32_t type_id = ids[var.element].element;
+
+        switch(var.storage) {
+            case spv::storage_input: {
+                if(shader_stage != VK_SHADER_STAGE_VERTEX_BIT) break;
+                if(var.builtin || var.location == spv::none) break;
+
+                inputs.push_back({ var.location, format_of(ids, type_id), size_of(ids, type_id) });
+                break;
+            }
+            case spv::storage_push_constant: {
+                auto& block = ids[type_id];
+                uint32_t offset = block.member_offsets.empty() ? 0 :
+                    *std::min_element(block.member_offsets.begin(), block.member_offsets.end());
+
+                VkPushConstantRange range{};
+                range.stageFlags = shader_stage;
+                range.offset = offset;
+                range.size = size_of(ids, type_id) - offset;
+                push_constants.push_back(range);
+                break;
+            }
+            case spv::storage_uniform_constant:
+            case spv::storage_uniform:
+            case spv::storage_storage_buffer: {
+                if(var.binding == spv::none) break;
+
+                uint32_t count = 1;
+                while(ids[type_id].opcode == spv::op_type_array || ids[type_id].opcode == spv::op_type_runtime_array) {
+                    // runtime arrays need descriptor indexing, count them as one
+                    if(ids[type_id].opcode == spv::op_type_array) count *= ids[ids[type_id].length_id].value;
+                    type_id = ids[type_id].element;
+                }
+
+                auto& type = ids[type_id];
+                VkDescriptorType descriptor_type;
+
+                if(var.storage == spv::storage_storage_buffer || type.buffer_block)
+                    descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                else if(var.storage == spv::storage_uniform)
+                    descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                else if(type.opcode == spv::op_type_sampled_image)
+                    descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                else if(type.opcode == spv::op_type_sampler)
+                    descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+                else if(type.opcode == spv::op_type_image && type.sampled == 2)
+                    descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                else
+                    descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+
+                uint32_t set = var.set == spv::none ? 0 : var.set;
+                bindings.push_back({ set, var.binding, descriptor_type, count, static_cast<VkShaderStageFlags>(shader_stage) });
+                break;
+            }
+        }
+    }
+
+    std::sort(inputs.begin(), inputs.end(), [](auto& a, auto& b) {
+        return a.location < b.location;
+    });
+
+    std::sort(bindings.begin(), bindings.end(), [](auto& a, auto& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+}
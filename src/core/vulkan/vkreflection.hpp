@@ -0,0 +1,53 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace core
+{
+    // what a shader expects from the pipeline, read straight out of its
+    // SPIR-V so the C++ side never has to be kept in sync by hand
+    class vkreflection
+    {
+    public:
+        struct vertex_input
+        {
+            uint32_t location;
+            VkFormat format;
+            uint32_t size;
+        };
+
+        struct descriptor_binding
+        {
+            uint32_t set;
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t count;
+            VkShaderStageFlags stages;
+        };
+
+        struct specialization_constant
+        {
+            uint32_t id;
+            uint32_t size;
+        };
+
+        VkShaderStageFlagBits stage;
+
+        // sorted by location, only filled for vertex shaders
+        std::vector<vertex_input> inputs;
+        // sorted by (set, binding)
+        std::vector<descriptor_binding> bindings;
+        std::vector<VkPushConstantRange> push_constants;
+        std::vector<specialization_constant> specialization_constants;
+
+        vkreflection();
+
+        // code_size is in bytes
+        vkreflection(const uint32_t* code, size_t code_size, VkShaderStageFlagBits);
+    };
+}
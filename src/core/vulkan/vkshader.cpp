@@ -10,12 +10,25 @@ vkshader::vkshader()
 vkshader::vkshader(
     VkDevice device,
     std::vector<char> source,
-    VkShaderStageFlagBits shader_flags) : stage_flags(shader_flags)
+    VkShaderStageFlagBits shader_flags)
+    : vkshader(
+        device,
+        reinterpret_cast<const uint32_t *>(source.data()),
+        source.size(),
+        shader_flags)
+{}
+
+vkshader::vkshader(
+    VkDevice device,
+    const uint32_t* code,
+    size_t code_size,
+    VkShaderStageFlagBits shader_flags)
+    : stage_flags(shader_flags), reflection(code, code_size, shader_flags)
 {
     VkShaderModuleCreateInfo shader_create_info{};
     shader_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shader_create_info.pCode = reinterpret_cast<const uint32_t *>(source.data());
-    shader_create_info.codeSize = source.size();
+    shader_create_info.pCode = code;
+    shader_create_info.codeSize = code_size;
 
     VK_ASSERT(
         vkCreateShaderModule(
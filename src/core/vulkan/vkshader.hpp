@@ -4,6 +4,9 @@
 #include "GLFW/glfw3.h"
 
 #include "utils/assert.hpp"
+#include "core/vulkan/vkreflection.hpp"
+#include "core/vulkan/vkspecialization.hpp"
+
 #include <vector>
 
 namespace core
@@ -14,6 +17,10 @@ namespace core
 
         VkShaderModule handle;
         VkShaderStageFlagBits stage_flags;
+        vkreflection reflection;
+        // constants baked into pipelines made from it, copies of a shader
+        // can share the module with different values
+        vkspecialization specialization;
 
         vkshader();
 
@@ -22,6 +29,13 @@ namespace core
             std::vector<char> source,
             VkShaderStageFlagBits);
 
+        // code_size is in bytes
+        vkshader(
+            VkDevice device,
+            const uint32_t* code,
+            size_t code_size,
+            VkShaderStageFlagBits);
+
         void destroy(VkDevice);
     };
 }
\ No newline at end of file
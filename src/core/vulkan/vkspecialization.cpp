@@ -0,0 +1,67 @@
+#include "./vkspecialization.hpp"
+
+#include <cstring>
+
+using namespace core;
+
+void vkspecialization::set_bits(uint32_t id, uint32_t bits) {
+    for(size_t i = 0; i < _entries.size(); i++) {
+        if(_entries[i].constantID == id) {
+            _data[i] = bits;
+            return;
+        }
+    }
+
+    VkSpecializationMapEntry entry{};
+    entry.constantID = id;
+    entry.offset = uint32_t(_data.size() * sizeof(uint32_t));
+    entry.size = sizeof(uint32_t);
+
+    _entries.push_back(entry);
+    _data.push_back(bits);
+}
+
+void vkspecialization::set(uint32_t id, uint32_t value) {
+    set_bits(id, value);
+}
+
+void vkspecialization::set(uint32_t id, int32_t value) {
+    set_bits(id, uint32_t(value));
+}
+
+void vkspecialization::set(uint32_t id, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    set_bits(id, bits);
+}
+
+void vkspecialization::set(uint32_t id, bool value) {
+    set_bits(id, value ? VK_TRUE : VK_FALSE);
+}
+
+bool vkspecialization::empty() const {
+    return _entries.empty();
+}
+
+VkSpecializationInfo vkspecialization::info() const {
+    VkSpecializationInfo info{};
+    info.mapEntryCount = uint32_t(_entries.size());
+    info.pMapEntries = _entries.data();
+    info.dataSize = _data.size() * sizeof(uint32_t);
+    info.pData = _data.data();
+    return info;
+}
+
+bool vkspecialization::matches(const vkreflection& reflection) const {
+    for(auto& entry : _entries) {
+        bool found = false;
+        for(auto& constant : reflection.specialization_constants) {
+            if(constant.id == entry.constantID && constant.size == entry.size) {
+                found = true;
+                break;
+            }
+        }
+        if(!found) return false;
+    }
+    return true;
+}
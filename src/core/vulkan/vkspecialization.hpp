@@ -0,0 +1,37 @@
+#pragma once
+
+#include "./vkreflection.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace core {
+    // values for a shader's layout(constant_id = N) constants, baked in
+    // when a pipeline is created so the driver can fold the branches on
+    // them. every value is 32 bits, bools are VkBool32
+    class vkspecialization {
+    private:
+        std::vector<VkSpecializationMapEntry> _entries;
+        std::vector<uint32_t> _data;
+
+        void set_bits(uint32_t id, uint32_t bits);
+
+    public:
+        // replaces the value if id was already set
+        void set(uint32_t id, uint32_t value);
+        void set(uint32_t id, int32_t value);
+        void set(uint32_t id, float value);
+        void set(uint32_t id, bool value);
+
+        bool empty() const;
+
+        // points into this object, only valid while it's alive and unchanged
+        VkSpecializationInfo info() const;
+
+        // every id is a 32 bit constant the shader declares
+        bool matches(const vkreflection&) const;
+    };
+}
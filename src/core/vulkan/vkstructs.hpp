@@ -5,6 +5,7 @@
 
 #include <optional>
 #include <cstdint>
+#include <vector>
 
 namespace structs {
     struct queue_family_indices
@@ -33,4 +34,30 @@ namespace structs {
                    present_mode.has_value();
         }
     };
+
+    // vertex buffer layout decided by the data (eg. a mesh format),
+    // instead of being guessed from the shader's inputs
+    struct vertex_layout
+    {
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+    };
+
+    // what a pipeline draws into. with dynamic rendering only the formats
+    // matter, otherwise it needs a compatible render pass too
+    struct render_target_info
+    {
+        std::vector<VkFormat> color_formats;
+        VkFormat depth_format = VK_FORMAT_UNDEFINED;
+        VkRenderPass render_pass = VK_NULL_HANDLE;
+    };
+
+    // everything one frame in flight records and waits with
+    struct frame_resources
+    {
+        VkCommandPool command_pool;
+        VkCommandBuffer command_buffer;
+        VkSemaphore image_available;
+        VkFence in_flight;
+    };
 }
\ No newline at end of file
@@ -21,7 +21,8 @@ vkswapchain::vkswapchain(
     VkInstance instance, 
     VkPhysicalDevice physical_device, 
     VkDevice device,
-    VkSurfaceKHR surface
+    VkSurfaceKHR surface,
+    VkSwapchainKHR old_swapchain
 ) : instance(instance) {
     using std::vector;
 
@@ -70,7 +71,7 @@ vkswapchain::vkswapchain(
     swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchain_create_info.clipped = true;
 
-    swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
+    swapchain_create_info.oldSwapchain = old_swapchain;
 
     VK_ASSERT(
         vkCreateSwapchainKHR(
@@ -229,51 +230,20 @@ VkExtent2D vkswapchain::pick_extent(
     return extent;   
 }
 
-void vkswapchain::create_framebuffers(
-    VkRenderPass render_pass,
-    VkDevice device
-) {
-    framebuffers.resize(image_views.size());
-
-    for(int i = 0; i < image_views.size(); i++) {
-        VkImageView attachments[] = {
-            image_views[i]
-        };
-
-        VkFramebufferCreateInfo framebuffer_info{};
-        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebuffer_info.renderPass = render_pass;
-        framebuffer_info.attachmentCount = 1;
-        framebuffer_info.pAttachments = attachments;
-        framebuffer_info.width = extent.width;
-        framebuffer_info.height = extent.height;
-        framebuffer_info.layers = 1;
-
-        VK_ASSERT(
-            vkCreateFramebuffer(
-                device, 
-                &framebuffer_info, 
-                nullptr, 
-                &framebuffers[i]
-            )
-        );
-    }
-}
-
-std::vector<VkFramebuffer> vkswapchain::get_framebuffers() {
-    return framebuffers;
-}
-
 void vkswapchain::destroy(VkDevice device) {
     if(handle == VK_NULL_HANDLE) return;
 
-    for(auto& framebuffer : framebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-
     for (auto &image_view : image_views)
     {
         vkDestroyImageView(device, image_view, nullptr);
     }
     vkDestroySwapchainKHR(device, handle, nullptr);
+}
+
+void vkswapchain::destroy(vkdeletion_queue& deletions) {
+    if(handle == VK_NULL_HANDLE) return;
+
+    for(auto image_view : image_views) deletions.retire(image_view);
+    deletions.retire(handle);
+    handle = VK_NULL_HANDLE;
 }
\ No newline at end of file
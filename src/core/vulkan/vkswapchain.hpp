@@ -3,15 +3,14 @@
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
 
+#include "./vkdeletion_queue.hpp"
+
 #include <vector>
 #include <optional>
 
 namespace core {
     class vkswapchain
     {
-    private:
-        std::vector<VkFramebuffer> framebuffers;
-
     public:
         VkInstance instance;
 
@@ -26,16 +25,17 @@ namespace core {
             VkInstance, 
             VkPhysicalDevice,
             VkDevice, 
-            VkSurfaceKHR
+            VkSurfaceKHR,
+            // being replaced, lets the driver hand its resources over
+            VkSwapchainKHR old_swapchain = VK_NULL_HANDLE
         );
 
         void destroy(VkDevice);
+        // the images may still be drawn into or presented
+        void destroy(vkdeletion_queue&);
     
         std::vector<VkImage> images;
         std::vector<VkImageView> image_views;
-        std::vector<VkFramebuffer> get_framebuffers();
-
-        void create_framebuffers(VkRenderPass, VkDevice);
 
     private:
         VkExtent2D pick_extent(GLFWwindow*, VkSurfaceCapabilitiesKHR&);
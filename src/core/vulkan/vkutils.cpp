@@ -3,43 +3,43 @@
 
 #include "utils/list.hpp"
 #include "utils/assert.hpp"
+#include "core/memory/arena.hpp"
 #include "core/vulkan/vkstructs.hpp"
 
 #include <vector>
-#include <string>
-#include <unordered_set>
 #include <string.h>
 
 bool vkutils::check_validation_layers_support(
-    std::vector<const char *> validation_layers)
+    const std::vector<const char *>& validation_layers)
 {
-    using std::vector, std::string, std::unordered_set;
-
     uint32_t layer_count = 0;
     vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
 
-    vector<VkLayerProperties> available_layers(layer_count);
+    auto available_layers = core::memory::make_frame_vector<VkLayerProperties>();
+    available_layers.resize(layer_count);
     vkEnumerateInstanceLayerProperties(&layer_count, available_layers.data());
 
-    unordered_set<string> required_layer_names(
-        validation_layers.begin(),
-        validation_layers.end());
-
-    for (auto &available_layer : available_layers)
+    // a handful of names, a linear scan beats hashing strings into a set
+    for (auto required_layer : validation_layers)
     {
-        required_layer_names.erase(available_layer.layerName);
+        bool found = false;
+        for (auto &available_layer : available_layers)
+        {
+            found |= strcmp(available_layer.layerName, required_layer) == 0;
+        }
+
+        if (!found)
+            return false;
     }
 
-    return required_layer_names.empty();
+    return true;
 }
 
 bool vkutils::check_device_extension_support(
-    VkPhysicalDevice device, std::vector<const char *> extension_names)
+    VkPhysicalDevice device, const std::vector<const char *>& extension_names)
 {
-    using std::vector, std::string, std::unordered_set;
-
     uint32_t available_extension_count;
-    std::vector<VkExtensionProperties> extension_properties;
+    auto extension_properties = core::memory::make_frame_vector<VkExtensionProperties>();
 
     vkEnumerateDeviceExtensionProperties(
         device,
@@ -55,20 +55,23 @@ bool vkutils::check_device_extension_support(
         &available_extension_count,
         extension_properties.data());
 
-    unordered_set<string> required_extensions(extension_names.begin(), extension_names.end());
-
-    for (auto &property : extension_properties)
+    for (auto required_extension : extension_names)
     {
-        required_extensions.erase(property.extensionName);
+        bool found = false;
+        for (auto &property : extension_properties)
+        {
+            found |= strcmp(property.extensionName, required_extension) == 0;
+        }
+
+        if (!found)
+            return false;
     }
 
-    return required_extensions.empty();
+    return true;
 }
 
 structs::queue_family_indices vkutils::get_queue_family_indices(VkPhysicalDevice physical_device, VkSurfaceKHR surface)
 {
-    using std::vector;
-
     static structs::queue_family_indices indices{};
 
     if (indices.is_complete())
@@ -82,8 +85,9 @@ structs::queue_family_indices vkutils::get_queue_family_indices(VkPhysicalDevice
 
     ASSERT(queue_family_count > 0, "No queue family available");
 
-    vector<VkQueueFamilyProperties>
-        queue_family_properties(queue_family_count);
+    auto queue_family_properties =
+        core::memory::make_frame_vector<VkQueueFamilyProperties>();
+    queue_family_properties.resize(queue_family_count);
 
     vkGetPhysicalDeviceQueueFamilyProperties(
         physical_device,
@@ -114,4 +118,57 @@ structs::queue_family_indices vkutils::get_queue_family_indices(VkPhysicalDevice
         "Required family indices not provided entirely");
 
     return indices;
+}
+
+uint32_t vkutils::find_memory_type(
+    VkPhysicalDevice physical_device, uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+    {
+        if ((type_bits & (1u << i)) &&
+            (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+
+    ASSERT(false, "No suitable memory type");
+    return 0;
+}
+
+VkCommandBuffer vkutils::begin_one_time_commands(VkDevice device, VkCommandPool command_pool)
+{
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    VK_ASSERT(vkAllocateCommandBuffers(device, &allocate_info, &command_buffer));
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_ASSERT(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    return command_buffer;
+}
+
+void vkutils::submit_one_time_commands(
+    VkDevice device, VkCommandPool command_pool, VkQueue queue, VkCommandBuffer command_buffer)
+{
+    VK_ASSERT(vkEndCommandBuffer(command_buffer));
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    VK_ASSERT(vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE));
+    vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
 }
\ No newline at end of file
@@ -9,7 +9,14 @@
 
 namespace vkutils
 {
-    bool check_validation_layers_support(std::vector<const char *> validation_layers);
-    bool check_device_extension_support(VkPhysicalDevice device, std::vector<const char *> extension_names);
+    bool check_validation_layers_support(const std::vector<const char *>& validation_layers);
+    bool check_device_extension_support(VkPhysicalDevice device, const std::vector<const char *>& extension_names);
     structs::queue_family_indices get_queue_family_indices(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
+
+    // index of a memory type allowed by type_bits that has every property asked for
+    uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_bits, VkMemoryPropertyFlags properties);
+
+    // for uploads and other setup work, submit blocks until the GPU is done
+    VkCommandBuffer begin_one_time_commands(VkDevice device, VkCommandPool command_pool);
+    void submit_one_time_commands(VkDevice device, VkCommandPool command_pool, VkQueue queue, VkCommandBuffer command_buffer);
 }
\ No newline at end of file
@@ -1,8 +1,7 @@
 #include "player.hpp"
 #include "components/components.hpp"
 #include "components/structs.hpp"
-
-#include <iostream>
+#include "core/debug/debug_draw.hpp"
 
 using core::world;
 
@@ -30,13 +29,21 @@ void setup_player(world& w) {
     );
 }
 
-void update_player(world& w) {
+void update_player([[maybe_unused]] world& w) {
+    // only debug drawing for now, gone with it
+#if GAME_DEBUG_DRAW
     auto& registry = w.get_registry();
     auto view = registry.view<const components::transform>();
 
     for (auto [entity, transform] : view.each()) {
-        // std::cout << "player at X : " << transform.position.x << "\n";
+        DEBUG_BOX(
+            structs::vector3{ transform.position.x - 0.5f, transform.position.y - 0.5f, transform.position.z - 0.5f },
+            structs::vector3{ transform.position.x + 0.5f, transform.position.y + 0.5f, transform.position.z + 0.5f },
+            structs::color{ 0, 255, 0, 255 });
+        DEBUG_TEXT(8, 8, structs::color{ 255, 255, 255, 255 },
+            "player %.1f %.1f %.1f", transform.position.x, transform.position.y, transform.position.z);
     }
+#endif
 }
 
 void dispose_player(world& w) {
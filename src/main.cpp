@@ -8,19 +8,55 @@
 #include "core/ecs/world.hpp"
 #include "core/graphics/renderer.hpp"
 #include "core/vulkan/vkapp.hpp"
+#include "core/memory/arena.hpp"
+#include "core/memory/alloc_stats.hpp"
 #include "entities/player.hpp"
+#include "core/physics/simulation.hpp"
+#include "core/physics/system.hpp"
+#include "core/input/input.hpp"
+#include "core/debug/memory_telemetry.hpp"
+#include "core/debug/timeline.hpp"
+#include "bench/recording.hpp"
 #include "utils/assert.hpp"
+#include "utils/log.hpp"
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <exception>
 
-int main() {
-    
+// time to first frame, --startup-check fails past it
+#ifndef GAME_STARTUP_BUDGET_MS
+    #define GAME_STARTUP_BUDGET_MS 1500
+#endif
+
+int main(int argc, char** argv) {
+    // everything up to the first present, on one clock
+    core::timeline startup;
+
+    // --startup-trace <path> writes the startup as a chrome trace,
+    // --startup-check exits after the first frame, failing if it took
+    // longer than GAME_STARTUP_BUDGET_MS
+    const char* startup_trace = nullptr;
+    bool startup_check = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--startup-trace") == 0 && i + 1 < argc) startup_trace = argv[i + 1];
+        if(strcmp(argv[i], "--startup-check") == 0) startup_check = true;
+    }
+
     core::world world;
+
+    // ENTITIES & COMPONENTS
+    // registered before the vkapp, their startup systems run while it
+    // starts up. anything registered after gets a second tick_startup()
+
+    // player::register_player(world);
+    // renderer::register_renderer(world);
     
     // WINDOWING
     // GLFW windowing
 
+    double window_start = startup.now_ms();
     ASSERT(glfwInit() == GLFW_TRUE, "Error initializing GLFW");
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -30,33 +66,165 @@ int main() {
     int height = 500;
     std::string title = "Hello, World!";
     GLFWwindow* window = glfwCreateWindow(width, height, title.c_str(), 0, 0);
+    startup.record("window", 0, window_start, startup.now_ms());
 
     // world.insert_resource<components::window_details>(width, height, title);
 
     // VULKAN context
 
-    core::vkapp vulkan_app(window);
+    core::vkapp vulkan_app(window, &startup, [&world] { world.tick_startup(); });
+
+    // recording time vs. thread count, then exit
+    if(argc > 1 && strcmp(argv[1], "--bench-recording") == 0) {
+        bench::recording(vulkan_app);
+        return 0;
+    }
     // world.insert_resource<components::vulkan_details>(vulkan_app.get_details());
     
-    // ENTITIES & COMPONENTS
+    double systems_start = startup.now_ms();
 
-    // player::register_player(world);
-    // renderer::register_renderer(world);
+    // INPUT
+    // polled from the world's update, before anything reads it
+
+    core::input::input_system input(window);
+    core::input::register_input(world, input);
+
+    // PHYSICS
+
+    core::physics::simulation physics({}, vulkan_app.jobs.get());
+    core::physics::register_physics(world, physics);
+
+    // LIGHTING
+    // entities with a point_light, binned on the GPU every frame
+
+    if(vulkan_app.lighting) {
+        core::register_lighting(world, *vulkan_app.lighting);
+    }
+
+    // PARTICLES
+    // entities with a particle_emitter spawn into the GPU simulation
+
+    if(vulkan_app.particles) {
+        core::register_particles(world, *vulkan_app.particles);
+    }
+
+    // MEMORY
+    // heaps, our allocations, RSS and ECS pools. F3 shows them,
+    // --memory-log <path> appends every sample to a file for soak runs
+
+    core::memory_telemetry telemetry(vulkan_app.physical_device, vulkan_app.memory_budget);
+    telemetry.track_component<components::transform>("transform");
+    telemetry.track_component<components::rigid_body>("rigid_body");
+    telemetry.track_component<components::point_light>("point_light");
+    telemetry.track_component<components::particle_emitter>("particle_emitter");
+
+    for(int i = 1; i + 1 < argc; i++) {
+        if(strcmp(argv[i], "--memory-log") == 0) telemetry.stream_to(argv[i + 1]);
+    }
+
+    core::register_memory_telemetry(world, telemetry, vulkan_app.sprites.get());
+
+    // startup systems of everything registered since the vkapp, which
+    // needed its objects. the ones before it already ran
+    world.tick_startup();
 
     // Main loop
 
-    const float TARGET_FPS = 60;
-    // world.tick_startup();
+    // frames it takes for arenas and pools to reach their steady size
+    const uint64_t WARMUP_FRAMES = 3;
+
+    // startup temporaries live in the frame arena too
+    core::memory::end_frame();
+
+    // what main did between the vkapp and the loop
+    startup.record("systems", 0, systems_start, startup.now_ms());
+
+    int status = 0;
+    uint64_t frame = 0;
+    double last_time = glfwGetTime();
     while(glfwWindowShouldClose(window) != GLFW_TRUE) {
-        // world.tick_update(1/TARGET_FPS);
-        glfwPollEvents();
-        glfwSwapBuffers(window);
+        double frame_start = startup.now_ms();
+
+        // frame boundary, nothing is being recorded right now
+        vulkan_app.reload_shaders();
+
+        core::memory::allocation_probe frame_allocations;
+
+        // the GPU wait goes before input is read, not between input and
+        // the frame that uses it
+        vulkan_app.wait_frame();
+
+        // physics catches up in fixed steps, whatever the frame took
+        double now = glfwGetTime();
+        world.tick_update(float(now - last_time));
+        last_time = now;
+
+        // requests made during the frame turn into loads/evictions here
+        vulkan_app.textures->update();
+
+        vulkan_app.draw_frame();
+        input.frame_presented();
+
+        if(frame == 0) {
+            double first_frame = startup.now_ms();
+            startup.record("first frame", 0, frame_start, first_frame);
+            LOG("[STARTUP] first frame after %.1f ms, budget %d ms", first_frame, GAME_STARTUP_BUDGET_MS);
+
+            if(startup_trace != nullptr) startup.write(startup_trace);
+
+            if(startup_check) {
+                bool ok = first_frame <= GAME_STARTUP_BUDGET_MS;
+                printf("startup: first frame after %.1f ms, budget %d ms, %s\n",
+                    first_frame, GAME_STARTUP_BUDGET_MS, ok ? "ok" : "over budget");
+                status = ok ? 0 : 1;
+                break;
+            }
+        }
+
+        // past warm-up, a frame should never need to touch the heap
+        if(core::memory::allocation_tracking_enabled() && frame > WARMUP_FRAMES) {
+            auto allocations = frame_allocations.delta();
+            if(allocations.count > 0) {
+                LOG("[ALLOC] frame %lu did %lu allocations (%lu bytes)",
+                    frame, allocations.count, allocations.bytes);
+            }
+        }
+
+        // residency numbers, to tune GAME_TEXTURE_BUDGET_MB
+        auto& texture_stats = vulkan_app.textures->get_stats();
+        if(texture_stats.texture_count > 0 && frame % 600 == 0) {
+            [[maybe_unused]] const float MiB = 1024.0f * 1024.0f;
+            LOG("[TEXTURE] %u textures, %u satisfied, %.1f/%.1f MiB resident, %.1f MiB wanted, %u loading",
+                texture_stats.texture_count, texture_stats.satisfied,
+                texture_stats.resident_bytes / MiB, texture_stats.budget_bytes / MiB,
+                texture_stats.wanted_bytes / MiB, texture_stats.pending_loads);
+        }
+
+        // how well sorting kept state changes down
+        if(frame % 600 == 0) {
+            [[maybe_unused]] auto& draw_stats = vulkan_app.draw_stats;
+            LOG("[DRAW] %u draws, %u pipeline/%u descriptor/%u buffer binds, %u skipped",
+                draw_stats.draws, draw_stats.pipeline_binds, draw_stats.descriptor_binds,
+                draw_stats.buffer_binds, draw_stats.skipped_binds);
+        }
+
+        // oldest event of a frame to that frame's present
+        auto latency = input.get_latency();
+        if(latency.samples > 0 && frame % 600 == 0) {
+            LOG("[INPUT] latency %.2f ms last, %.2f ms average, %.2f ms worst over %u frames, %u events dropped",
+                latency.last_ms, latency.average_ms, latency.max_ms, latency.samples, input.dropped());
+        }
+
+        core::memory::end_frame();
+        frame++;
     }
 
     // Cleanup
 
-    // world.tick_dispose();
+    // while the window and vkapp are still there, the destructor won't
+    // run it again
+    world.tick_dispose();
     glfwDestroyWindow(window);
     
-    return 0;
+    return status;
 }
\ No newline at end of file
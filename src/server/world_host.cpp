@@ -0,0 +1,269 @@
+#include "./world_host.hpp"
+
+#include "core/jobs/thread_pool.hpp"
+#include "utils/assert.hpp"
+
+#include <new>
+#include <algorithm>
+
+using namespace server;
+
+// counting_resource
+
+world_host::counting_resource::counting_resource() : _bytes(0), _peak(0) {}
+
+uint64_t world_host::counting_resource::bytes() const {
+    return _bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t world_host::counting_resource::peak() const {
+    return _peak.load(std::memory_order_relaxed);
+}
+
+void* world_host::counting_resource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = ::operator new(bytes, std::align_val_t(alignment));
+
+    // only the world's shard allocates, but stats() reads from elsewhere
+    uint64_t now = _bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if(now > _peak.load(std::memory_order_relaxed)) _peak.store(now, std::memory_order_relaxed);
+    return p;
+}
+
+void world_host::counting_resource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    _bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    ::operator delete(p, bytes, std::align_val_t(alignment));
+}
+
+bool world_host::counting_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// world_host
+
+world_host::world_host() : world_host(settings{}) {}
+
+world_host::world_host(const settings& s) : _settings(s), _running(true), _next_id(0) {
+    uint32_t threads = s.threads;
+    if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    _shards.reserve(threads);
+    for(uint32_t i = 0; i < threads; i++) {
+        auto sh = std::make_unique<shard>();
+        sh->index = i;
+        _shards.push_back(std::move(sh));
+    }
+    // after every shard exists, add() may pick any of them right away
+    for(auto& sh : _shards) {
+        sh->thread = std::thread(&world_host::shard_loop, this, std::ref(*sh));
+    }
+}
+
+world_host::~world_host() {
+    _running.store(false);
+    for(auto& sh : _shards) {
+        // the lock makes sure a shard isn't between its check and its wait
+        std::lock_guard<std::mutex> lock(sh->mutex);
+        sh->wake.notify_one();
+    }
+    for(auto& sh : _shards) sh->thread.join();
+}
+
+world_host::world_id world_host::add(float tick_rate, setup_fn setup) {
+    ASSERT(tick_rate > 0.0f, "A world needs a positive tick rate");
+
+    auto h = std::make_unique<hosted>();
+    h->tick_rate = tick_rate;
+    h->setup = std::move(setup);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    h->id = _next_id++;
+
+    // least loaded by what the worlds measured so far. ones that haven't
+    // ticked yet are guessed from their rate, so a burst of add()s still
+    // spreads out
+    auto guess = [](float rate) { return rate * 1e-5; };
+
+    uint32_t best = 0;
+    double best_load = 0.0;
+    for(uint32_t i = 0; i < _shards.size(); i++) {
+        auto& sh = *_shards[i];
+        std::lock_guard<std::mutex> shard_lock(sh.mutex);
+
+        double load = 0.0;
+        for(auto& w : sh.worlds) load += w->stats.ticks > 0 ? w->stats.load : guess(w->tick_rate);
+        for(auto& w : sh.incoming) load += guess(w->tick_rate);
+
+        if(i == 0 || load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+
+    h->stats.id = h->id;
+    h->stats.shard = best;
+    h->stats.tick_rate = tick_rate;
+    world_id id = h->id;
+    _shard_of.push_back(best);
+
+    auto& sh = *_shards[best];
+    {
+        std::lock_guard<std::mutex> shard_lock(sh.mutex);
+        sh.incoming.push_back(std::move(h));
+    }
+    sh.wake.notify_one();
+
+    return id;
+}
+
+void world_host::remove(world_id id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ASSERT(id < _shard_of.size(), "Unknown world");
+    if(_shard_of[id] == UINT32_MAX) return;
+
+    auto& sh = *_shards[_shard_of[id]];
+    _shard_of[id] = UINT32_MAX;
+
+    {
+        std::lock_guard<std::mutex> shard_lock(sh.mutex);
+        sh.removals.push_back(id);
+    }
+    sh.wake.notify_one();
+}
+
+uint32_t world_host::shard_count() const {
+    return _shards.size();
+}
+
+std::vector<world_host::world_stats> world_host::stats() {
+    std::vector<world_stats> out;
+    for(auto& sh : _shards) {
+        std::lock_guard<std::mutex> lock(sh->mutex);
+        for(auto& w : sh->worlds) out.push_back(w->stats);
+    }
+    return out;
+}
+
+void world_host::start_world(hosted& h) {
+    h.pool = std::make_unique<std::pmr::unsynchronized_pool_resource>(&h.heap);
+    h.arena = std::make_unique<core::memory::linear_arena>(_settings.arena_size);
+    h.world = std::make_unique<core::world>(h.pool.get());
+
+    {
+        core::memory::frame_arena_scope scope(*h.arena);
+        if(h.setup) h.setup(*h.world);
+        h.world->tick_startup();
+    }
+    h.arena->reset();
+
+    h.next_tick = clock::now();
+}
+
+void world_host::dispose_world(hosted& h) {
+    {
+        core::memory::frame_arena_scope scope(*h.arena);
+        h.world->tick_dispose();
+    }
+    h.arena->reset();
+}
+
+void world_host::tick(shard& sh, hosted& h, clock::time_point now) {
+    auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / h.tick_rate));
+    bool late = now - h.next_tick > period;
+
+    core::memory::allocation_probe allocations;
+    auto start = clock::now();
+    {
+        core::memory::frame_arena_scope scope(*h.arena);
+        h.world->tick_update(1.0f / h.tick_rate);
+    }
+    double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    auto allocated = allocations.delta();
+
+    uint64_t arena_used = h.arena->used();
+    h.arena->reset();
+
+    // a late world starts over from now, the backlog would only make
+    // the shard later still
+    h.next_tick = late ? now + period : h.next_tick + period;
+    h.total_ms += ms;
+
+    std::lock_guard<std::mutex> lock(sh.mutex);
+    auto& s = h.stats;
+    s.ticks++;
+    if(late) s.late_ticks++;
+    s.last_ms = ms;
+    s.mean_ms = h.total_ms / s.ticks;
+    s.max_ms = std::max(s.max_ms, ms);
+    s.load = s.mean_ms * h.tick_rate / 1000.0;
+    s.memory_bytes = h.heap.bytes();
+    s.peak_memory_bytes = h.heap.peak();
+    s.arena_peak_bytes = std::max<uint64_t>(s.arena_peak_bytes, arena_used);
+    s.allocations += allocated.count;
+    s.allocated_bytes += allocated.bytes;
+}
+
+void world_host::shard_loop(shard& sh) {
+    if(_settings.pin) core::jobs::pin_current_thread(sh.index);
+
+    // swapped with the shard's, so they're worked on outside the lock
+    std::vector<std::unique_ptr<hosted>> incoming;
+    std::vector<world_id> removals;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(sh.mutex);
+            auto woken = [&] {
+                return !_running.load() || !sh.incoming.empty() || !sh.removals.empty();
+            };
+
+            if(sh.worlds.empty()) {
+                sh.wake.wait(lock, woken);
+            } else {
+                auto next = sh.worlds[0]->next_tick;
+                for(auto& w : sh.worlds) next = std::min(next, w->next_tick);
+                sh.wake.wait_until(lock, next, woken);
+            }
+
+            if(!_running.load()) break;
+            incoming.swap(sh.incoming);
+            removals.swap(sh.removals);
+        }
+
+        for(auto& h : incoming) {
+            this->start_world(*h);
+            std::lock_guard<std::mutex> lock(sh.mutex);
+            sh.worlds.push_back(std::move(h));
+        }
+        incoming.clear();
+
+        for(world_id id : removals) {
+            auto found = std::find_if(sh.worlds.begin(), sh.worlds.end(), [id](auto& w) { return w->id == id; });
+            // removed before it even started
+            if(found == sh.worlds.end()) continue;
+
+            this->dispose_world(**found);
+
+            std::unique_ptr<hosted> done;
+            {
+                std::lock_guard<std::mutex> lock(sh.mutex);
+                done = std::move(*found);
+                sh.worlds.erase(found);
+            }
+            // freed outside the lock, with everything its pool held
+        }
+        removals.clear();
+
+        // everything that's due, the vector only changes on this thread
+        auto now = clock::now();
+        for(auto& h : sh.worlds) {
+            if(h->next_tick <= now) this->tick(sh, *h, now);
+        }
+    }
+
+    // shutting down, every world is disposed and freed where it ran
+    for(auto& h : sh.worlds) this->dispose_world(*h);
+
+    std::lock_guard<std::mutex> lock(sh.mutex);
+    sh.worlds.clear();
+    sh.incoming.clear();
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "core/ecs/world.hpp"
+#include "core/memory/arena.hpp"
+#include "core/memory/alloc_stats.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <condition_variable>
+
+namespace server {
+    // runs many independent core::worlds (eg. one per match) without a
+    // window or GPU. each world is owned by one shard, a thread pinned to
+    // its own core, which ticks it at the world's own rate with a fixed
+    // delta. a world is only ever touched by its shard, from setup to
+    // destruction, so its systems need no locking.
+    //
+    // every world gets its own memory: a pool resource (world::memory()),
+    // which holds its registry and systems, and a frame arena that is the
+    // shard's core::memory::frame_arena() during setup, ticks and dispose
+    // and is reset after each. what a tick costs is measured per world,
+    // to see how densely worlds can be packed on a machine
+    class world_host {
+    public:
+        using world_id = uint32_t;
+        // registers the world's systems and makes its entities, on the
+        // shard thread. tick_startup() runs right after
+        using setup_fn = std::function<void(core::world&)>;
+
+        struct settings {
+            // 0 for one per hardware thread
+            uint32_t threads = 0;
+            bool pin = true;
+            // each world's first arena block, it grows if a tick needs more
+            size_t arena_size = 16 * 1024;
+        };
+
+        struct world_stats {
+            world_id id;
+            uint32_t shard;
+            float tick_rate;
+
+            uint64_t ticks;
+            // ticks that started more than a period late, the shard is
+            // overloaded. the backlog is dropped, not caught up on
+            uint64_t late_ticks;
+
+            // tick cost, milliseconds
+            double last_ms, mean_ms, max_ms;
+            // share of one core the world takes, mean cost times rate
+            double load;
+
+            // what the world's pool took from the heap, now and at most:
+            // the registry, the system lists and anything setup put in
+            // world::memory(), eg. a physics::simulation
+            uint64_t memory_bytes, peak_memory_bytes;
+            // the most a tick used of its frame arena
+            uint64_t arena_peak_bytes;
+            // heap allocations made while ticking, in
+            // GAME_TRACK_ALLOCATIONS builds. the pool growing counts too,
+            // anything else is memory that got past the world's pool
+            uint64_t allocations, allocated_bytes;
+        };
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        // between a world's pool and the heap, counts what the pool holds
+        class counting_resource : public std::pmr::memory_resource {
+        private:
+            std::atomic<uint64_t> _bytes, _peak;
+
+        public:
+            counting_resource();
+
+            uint64_t bytes() const;
+            uint64_t peak() const;
+
+        protected:
+            void* do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void*, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        struct hosted {
+            world_id id;
+            float tick_rate;
+            setup_fn setup;
+
+            // destroyed bottom up, the world before the memory it uses
+            counting_resource heap;
+            std::unique_ptr<std::pmr::unsynchronized_pool_resource> pool;
+            std::unique_ptr<core::memory::linear_arena> arena;
+            std::unique_ptr<core::world> world;
+
+            clock::time_point next_tick;
+            double total_ms = 0.0;
+            // written by the shard under its mutex
+            world_stats stats = {};
+        };
+
+        struct shard {
+            uint32_t index;
+            std::thread thread;
+
+            std::mutex mutex;
+            std::condition_variable wake;
+            // handed over by add() and remove(), taken by the shard
+            std::vector<std::unique_ptr<hosted>> incoming;
+            std::vector<world_id> removals;
+            // only changed by the shard, under the mutex
+            std::vector<std::unique_ptr<hosted>> worlds;
+        };
+
+        settings _settings;
+        std::atomic<bool> _running;
+        std::vector<std::unique_ptr<shard>> _shards;
+
+        std::mutex _mutex;
+        world_id _next_id;
+        // per world id, UINT32_MAX once removed
+        std::vector<uint32_t> _shard_of;
+
+        void shard_loop(shard&);
+        void start_world(hosted&);
+        void dispose_world(hosted&);
+        void tick(shard&, hosted&, clock::time_point now);
+
+    public:
+        world_host();
+        world_host(const settings&);
+        // disposes every world, each on its shard
+        ~world_host();
+
+        world_host(const world_host&) = delete;
+        world_host& operator=(const world_host&) = delete;
+
+        // goes to the least loaded shard, which makes and starts it
+        world_id add(float tick_rate, setup_fn);
+        // disposed and freed on its shard, eg. once its match is over
+        void remove(world_id);
+
+        uint32_t shard_count() const;
+        // every world's numbers as of its last tick
+        std::vector<world_stats> stats();
+    };
+}
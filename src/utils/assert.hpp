@@ -6,8 +6,6 @@
 
 #ifndef NDEBUG 
 
-  #include <vulkan/vulkan.h>
-
   #include <stdio.h>
   #include <error.h>
   #include <exception>
@@ -27,6 +25,7 @@
 #else
 
   #define VK_ASSERT(x) x
-  #define ASSERT(x) x
+  // same shape as the debug form, call sites may leave the ; out
+  #define ASSERT(x,y) if(!(x)) {}
 
 #endif
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include <fstream>
 
+#include <unistd.h>
+#include <limits.h>
+
 namespace utils::file {
-    std::string read_contents(std::string path) {
+    inline std::string read_contents(std::string path) {
         using std::ifstream, std::stringstream;
 
         ifstream f(path);
@@ -15,7 +19,7 @@ namespace utils::file {
         return buff.str();
     }
 
-    std::vector<char> read_binary(std::string path) {
+    inline std::vector<char> read_binary(std::string path) {
         using namespace std;
         // ios::ate -> start At The End (so we can get the size later)
         ifstream file(path, ios::ate | ios::binary);
@@ -35,4 +39,16 @@ namespace utils::file {
 
         return buffer;
     }
+
+    // directory holding the running executable, with a trailing slash
+    inline std::string executable_dir() {
+        char path[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+
+        if (length <= 0)
+            return "./";
+
+        std::string exe(path, length);
+        return exe.substr(0, exe.find_last_of('/') + 1);
+    }
 }
\ No newline at end of file
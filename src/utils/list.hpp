@@ -17,7 +17,7 @@ namespace utils::list {
     }
 
     template<typename T>
-    bool contains_all(vector<T> hay, vector<T> needles) {
+    bool contains_all(const vector<T>& hay, const vector<T>& needles) {
         for(auto& needle : needles) {
             bool has_found = false;
 
@@ -11,6 +11,6 @@
     printf(x, ##args); printf("\n\t- at %s:%s\n", __FILE__, __LINE__);
 
 #else
-  #define LOG(x)
-  #define LOG_AT(x)
+  #define LOG(...)
+  #define LOG_AT(...)
 #endif
\ No newline at end of file
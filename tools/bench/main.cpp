@@ -0,0 +1,212 @@
+// headless benchmarks: builds a core::world, runs its update for a number
+// of frames and reports frame time percentiles, allocations and hardware
+// counters, no window or GPU involved
+//
+//   bench [--systems movement,physics,snapshot,occlusion,lighting] [--entities N] [--frames K]
+//         [--warmup W] [--threads T] [--name NAME] [--suite standard|physics|snapshot]
+//         [--json out.json]
+//
+// without --systems it runs a suite, the standard one unless --suite says
+// otherwise. --json writes the results in a form that can be diffed
+// against an older run
+
+#include "bench/scenario.hpp"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = list.find(',', start);
+        if(end == std::string::npos) end = list.size();
+        if(end > start) out.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return out;
+}
+
+static std::vector<bench::scenario> standard_suite() {
+    auto make = [](const char* name, uint32_t entities, std::vector<std::string> systems) {
+        bench::scenario s;
+        s.name = name;
+        s.entities = entities;
+        s.systems = std::move(systems);
+        return s;
+    };
+
+    return {
+        make("movement-10k", 10000, { "movement" }),
+        make("movement-100k", 100000, { "movement" }),
+        make("physics-1k", 1000, { "physics" }),
+        make("physics-10k", 10000, { "physics" }),
+        make("snapshot-100k", 100000, { "movement", "snapshot" }),
+        make("occlusion-100k", 100000, { "movement", "occlusion" }),
+        // light count sweep, one light per entity
+        make("lights-256", 256, { "lighting" }),
+        make("lights-1k", 1000, { "lighting" }),
+        make("lights-4k", 4000, { "lighting" }),
+        make("lights-16k", 16000, { "lighting" }),
+    };
+}
+
+// the same pile with 1..N threads, every thread count has to end up in
+// the exact same state
+static std::vector<bench::scenario> physics_suite() {
+    uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> thread_counts;
+    for(uint32_t t = 1; t < hardware; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(hardware);
+
+    std::vector<bench::scenario> out;
+    for(uint32_t entities : { 1000u, 10000u, 50000u }) {
+        for(auto t : thread_counts) {
+            bench::scenario s;
+            s.name = "physics-" + std::to_string(entities / 1000) + "k-t" + std::to_string(t);
+            s.entities = entities;
+            s.frames = 120;
+            s.threads = t;
+            s.systems = { "physics" };
+            out.push_back(s);
+        }
+    }
+    return out;
+}
+
+// a million entities, a world that stands still and one where everything
+// moves every frame
+static std::vector<bench::scenario> snapshot_suite() {
+    auto make = [](const char* name, std::vector<std::string> systems) {
+        bench::scenario s;
+        s.name = name;
+        s.entities = 1000000;
+        s.frames = 30;
+        s.warmup = 5;
+        s.systems = std::move(systems);
+        return s;
+    };
+
+    return {
+        make("snapshot-still-1m", { "snapshot" }),
+        make("snapshot-moving-1m", { "movement", "snapshot" }),
+    };
+}
+
+// physics results with the same entity count should all match the first
+// one, which has the fewest threads
+static bool check_determinism(const std::vector<bench::scenario_result>& results) {
+    bool ok = true;
+    for(size_t i = 0; i < results.size(); i++) {
+        auto& r = results[i];
+        if(!r.valid || r.state_hash == 0) continue;
+
+        for(size_t j = 0; j < i; j++) {
+            auto& first = results[j];
+            if(!first.valid || first.state_hash == 0 || first.config.entities != r.config.entities) continue;
+
+            if(first.state_hash != r.state_hash) {
+                printf("%s DIVERGED from %s\n", r.config.name.c_str(), first.config.name.c_str());
+                ok = false;
+            }
+            break;
+        }
+    }
+    return ok;
+}
+
+// the culler may keep hidden boxes, but never hide one that can be seen
+static bool check_occlusion(const std::vector<bench::scenario_result>& results) {
+    bool ok = true;
+    for(auto& r : results) {
+        for(auto& m : r.metrics) {
+            if(m.name != "wrongly_culled" || m.value == 0.0) continue;
+
+            printf("%s CULLED %.0f visible boxes\n", r.config.name.c_str(), m.value);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    bench::scenario custom;
+    bool has_custom = false;
+    std::string json_path;
+    std::string suite = "standard";
+
+    // applied on top of every scenario when given
+    long entities = -1, frames = -1, warmup = -1, threads = -1;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 >= argc) {
+            printf("%s needs a value\n", arg.c_str());
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if(arg == "--systems") {
+            custom.systems = split(value);
+            has_custom = true;
+        } else if(arg == "--name") {
+            custom.name = value;
+        } else if(arg == "--entities") {
+            entities = strtol(value, nullptr, 10);
+        } else if(arg == "--frames") {
+            frames = strtol(value, nullptr, 10);
+        } else if(arg == "--warmup") {
+            warmup = strtol(value, nullptr, 10);
+        } else if(arg == "--threads") {
+            threads = strtol(value, nullptr, 10);
+        } else if(arg == "--suite") {
+            suite = value;
+        } else if(arg == "--json") {
+            json_path = value;
+        } else {
+            printf("unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<bench::scenario> scenarios;
+    if(has_custom) scenarios.push_back(custom);
+    else if(suite == "standard") scenarios = standard_suite();
+    else if(suite == "physics") scenarios = physics_suite();
+    else if(suite == "snapshot") scenarios = snapshot_suite();
+    else {
+        printf("unknown suite %s\n", suite.c_str());
+        return 1;
+    }
+
+    for(auto& s : scenarios) {
+        if(entities >= 0) s.entities = uint32_t(entities);
+        if(frames >= 0) s.frames = uint32_t(frames);
+        if(warmup >= 0) s.warmup = uint32_t(warmup);
+        if(threads >= 0) s.threads = uint32_t(threads);
+    }
+
+    std::vector<bench::scenario_result> results;
+    bool ok = true;
+
+    bench::print_header();
+    for(auto& s : scenarios) {
+        results.push_back(bench::run(s));
+        bench::print(results.back());
+        ok &= results.back().valid;
+    }
+
+    ok &= check_determinism(results);
+    ok &= check_occlusion(results);
+
+    if(!json_path.empty()) {
+        ok &= bench::write_json(json_path, results);
+    }
+
+    return ok ? 0 : 1;
+}
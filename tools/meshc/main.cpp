@@ -0,0 +1,227 @@
+// compiles .obj models into .mesh files (see core/graphics/mesh_format.hpp)
+//
+//   meshc <in.obj> <out.mesh> [--lods N]
+//
+// prints the vertex cache and size numbers before and after processing
+
+#include "core/graphics/mesh_processing.hpp"
+#include "core/graphics/mesh_format.hpp"
+
+#include <map>
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using core::mesh_processing::vertex;
+
+struct obj_mesh {
+    std::vector<vertex> vertices;
+    std::vector<uint32_t> indices;
+    bool has_normals = false;
+};
+
+// obj indices are 1-based, negative ones count from the end
+static int resolve(int index, size_t count) {
+    return index < 0 ? int(count) + index : index - 1;
+}
+
+static bool load_obj(const std::string& path, obj_mesh& out) {
+    std::ifstream file(path);
+    if(!file.is_open()) {
+        printf("could not open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<std::array<float, 3>> positions, normals;
+    std::vector<std::array<float, 2>> uvs;
+
+    // same position/uv/normal triple -> same vertex
+    std::map<std::array<int, 3>, uint32_t> unique;
+
+    std::string line;
+    std::vector<uint32_t> face;
+
+    while(std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string type;
+        in >> type;
+
+        if(type == "v") {
+            std::array<float, 3> p{};
+            in >> p[0] >> p[1] >> p[2];
+            positions.push_back(p);
+        } else if(type == "vn") {
+            std::array<float, 3> n{};
+            in >> n[0] >> n[1] >> n[2];
+            normals.push_back(n);
+        } else if(type == "vt") {
+            std::array<float, 2> t{};
+            in >> t[0] >> t[1];
+            uvs.push_back(t);
+        } else if(type == "f") {
+            face.clear();
+
+            std::string corner;
+            while(in >> corner) {
+                // v, v/t, v//n or v/t/n
+                std::array<int, 3> key{ -1, -1, -1 };
+                int slot = 0;
+                const char* c = corner.c_str();
+
+                while(*c && slot < 3) {
+                    if(*c != '/') {
+                        char* end;
+                        long value = strtol(c, &end, 10);
+                        size_t count = slot == 0 ? positions.size() : slot == 1 ? uvs.size() : normals.size();
+                        key[slot] = resolve(value, count);
+                        c = end;
+                    }
+                    if(*c == '/') c++;
+                    slot++;
+                }
+
+                auto found = unique.find(key);
+                if(found != unique.end()) {
+                    face.push_back(found->second);
+                    continue;
+                }
+
+                vertex v{};
+                auto& p = positions.at(key[0]);
+                std::copy(p.begin(), p.end(), v.position);
+
+                if(key[1] >= 0) {
+                    v.uv[0] = uvs.at(key[1])[0];
+                    // obj puts the origin at the bottom left, vulkan at the top
+                    v.uv[1] = 1.0f - uvs.at(key[1])[1];
+                }
+
+                if(key[2] >= 0) {
+                    auto& n = normals.at(key[2]);
+                    std::copy(n.begin(), n.end(), v.normal);
+                    out.has_normals = true;
+                }
+
+                uint32_t index = out.vertices.size();
+                out.vertices.push_back(v);
+                unique.emplace(key, index);
+                face.push_back(index);
+            }
+
+            // polygons become fans
+            for(size_t i = 2; i < face.size(); i++) {
+                out.indices.insert(out.indices.end(), { face[0], face[i - 1], face[i] });
+            }
+        }
+    }
+
+    return !out.indices.empty();
+}
+
+// area weighted face normals, for files that don't come with any
+static void generate_normals(obj_mesh& mesh) {
+    for(auto& v : mesh.vertices) {
+        v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+    }
+
+    for(size_t t = 0; t < mesh.indices.size(); t += 3) {
+        vertex* tri[3] = {
+            &mesh.vertices[mesh.indices[t]],
+            &mesh.vertices[mesh.indices[t + 1]],
+            &mesh.vertices[mesh.indices[t + 2]]
+        };
+
+        float ab[3], ac[3];
+        for(int i = 0; i < 3; i++) {
+            ab[i] = tri[1]->position[i] - tri[0]->position[i];
+            ac[i] = tri[2]->position[i] - tri[0]->position[i];
+        }
+
+        float n[3] = {
+            ab[1] * ac[2] - ab[2] * ac[1],
+            ab[2] * ac[0] - ab[0] * ac[2],
+            ab[0] * ac[1] - ab[1] * ac[0]
+        };
+
+        for(auto v : tri) {
+            for(int i = 0; i < 3; i++) v->normal[i] += n[i];
+        }
+    }
+}
+
+// worst angle between the original normals and the decoded ones
+static float max_normal_error(const std::vector<vertex>& vertices) {
+    float worst = 0.0f;
+
+    for(auto& v : vertices) {
+        float n[3] = { v.normal[0], v.normal[1], v.normal[2] };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if(length <= 0.0f) continue;
+        for(auto& c : n) c /= length;
+
+        int16_t encoded[2];
+        float decoded[3];
+        core::mesh_format::encode_octahedral(n, encoded);
+        core::mesh_format::decode_octahedral(encoded, decoded);
+
+        float dot = n[0] * decoded[0] + n[1] * decoded[1] + n[2] * decoded[2];
+        worst = std::max(worst, std::acos(std::min(dot, 1.0f)));
+    }
+
+    return worst * 180.0f / 3.14159265f;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printf("usage: %s <in.obj> <out.mesh> [--lods N]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t max_lods = 4;
+    if(argc >= 5 && strcmp(argv[3], "--lods") == 0) max_lods = std::max(1, atoi(argv[4]));
+
+    obj_mesh mesh;
+    if(!load_obj(argv[1], mesh)) return 1;
+    if(!mesh.has_normals) generate_normals(mesh);
+
+    using namespace core::mesh_processing;
+
+    auto before_16 = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 16);
+    auto before_32 = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 32);
+
+    auto chain = build_lods(mesh.vertices, mesh.indices, max_lods);
+    auto bytes = write_mesh(mesh.vertices, chain);
+
+    auto after_16 = analyze_vertex_cache(chain.lods[0], mesh.vertices.size(), 16);
+    auto after_32 = analyze_vertex_cache(chain.lods[0], mesh.vertices.size(), 32);
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    if(!out.good()) {
+        printf("could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    size_t float_vertex = sizeof(vertex);
+    size_t packed_vertex = sizeof(core::mesh_format::packed_vertex);
+
+    printf("%s: %zu vertices, %zu triangles\n", argv[1], mesh.vertices.size(), chain.lods[0].size() / 3);
+    printf("%-10s %8s %8s %8s\n", "", "acmr16", "acmr32", "atvr16");
+    printf("%-10s %8.3f %8.3f %8.3f\n", "input", before_16.acmr, before_32.acmr, before_16.atvr);
+    printf("%-10s %8.3f %8.3f %8.3f\n", "optimized", after_16.acmr, after_32.acmr, after_16.atvr);
+    printf("bytes/vertex: %zu -> %zu, normals off by at most %.3f deg\n",
+        float_vertex, packed_vertex, max_normal_error(mesh.vertices));
+
+    for(size_t i = 0; i < chain.lods.size(); i++) {
+        printf("lod %zu: %8zu triangles, error %.4f\n", i, chain.lods[i].size() / 3, chain.errors[i]);
+    }
+
+    printf("wrote %s, %zu bytes\n", argv[2], bytes.size());
+    return 0;
+}
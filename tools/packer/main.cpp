@@ -0,0 +1,159 @@
+// packs an asset directory into a single .pak archive
+//
+//   packer pack <assets dir> <out.pak> [--lz4 | --zstd]
+//   packer list <archive.pak>
+//   packer bench <archive.pak> <assets dir> [iterations]
+
+#include "core/assets/archive.hpp"
+#include "core/assets/archive_writer.hpp"
+#include "utils/file.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using core::archive_format::compression;
+
+static std::vector<std::string> collect(const std::string& root) {
+    std::vector<std::string> names;
+
+    for(auto& entry : fs::recursive_directory_iterator(root)) {
+        if(!entry.is_regular_file()) continue;
+
+        // names always use forward slashes, relative to the assets root
+        auto name = fs::relative(entry.path(), root).generic_string();
+
+        // skips caches and editor files
+        if(name[0] == '.' || name.find("/.") != std::string::npos) continue;
+
+        names.push_back(name);
+    }
+
+    return names;
+}
+
+static int pack(const std::string& root, const std::string& out, compression method) {
+    core::archive_writer writer;
+
+    if(!core::archive_writer::supports(method)) {
+        printf("[WARN] compression not available in this build, storing entries as is\n");
+    }
+
+    auto names = collect(root);
+    for(auto& name : names) {
+        writer.add(name, utils::file::read_binary(root + "/" + name), method);
+    }
+
+    if(!writer.write(out)) return 1;
+
+    printf("packed %zu assets into %s\n", names.size(), out.c_str());
+    return 0;
+}
+
+static int list(const std::string& path) {
+    core::archive pak(path);
+    if(!pak.is_open()) return 1;
+
+    const char* methods[] = { "none", "lz4", "zstd" };
+
+    for(size_t i = 0; i < pak.entry_count(); i++) {
+        auto& e = pak.entry_at(i);
+        auto name = pak.name_of(e);
+
+        printf("%016lx %10lu -> %10lu %-4s %.*s\n",
+            e.hash, e.original_size, e.stored_size,
+            methods[static_cast<uint32_t>(e.method)],
+            int(name.size()), name.data());
+    }
+    return 0;
+}
+
+template<typename F>
+static double time_ms(int iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+// compares against loose files with the page cache warm for both, so
+// this measures lookup and syscall overhead rather than the disk
+static int bench(const std::string& path, const std::string& root, int iterations) {
+    auto names = collect(root);
+
+    size_t total_bytes = 0;
+    for(auto& name : names) total_bytes += fs::file_size(root + "/" + name);
+
+    // startup: get to the point where every asset can be located
+    double loose_startup = time_ms(iterations, [&] {
+        for(auto& name : names) {
+            std::ifstream f(root + "/" + name, std::ios::binary);
+        }
+    });
+
+    double pak_startup = time_ms(iterations, [&] {
+        core::archive pak(path);
+        for(auto& name : names) pak.find(name);
+    });
+
+    // throughput: read every asset fully
+    size_t sink = 0;
+
+    double loose_read = time_ms(iterations, [&] {
+        for(auto& name : names) sink += utils::file::read_binary(root + "/" + name).size();
+    });
+
+    // every chunk gets copied out, like an upload into a staging buffer
+    // would, otherwise mmap'd entries would never even be touched
+    core::archive pak(path);
+    std::vector<char> staging(1 << 20);
+    double pak_read = time_ms(iterations, [&] {
+        for(auto& name : names) {
+            auto e = pak.find(name);
+            pak.stream(*e, staging.size(), [&](const char* data, size_t size) {
+                memcpy(staging.data(), data, size);
+                sink += size;
+            });
+        }
+    });
+
+    double mb = total_bytes / (1024.0 * 1024.0);
+
+    printf("%zu assets, %.2f MiB, %d iterations\n", names.size(), mb, iterations);
+    printf("%-8s %12s %14s\n", "", "startup ms", "read MiB/s");
+    printf("%-8s %12.3f %14.1f\n", "loose", loose_startup, mb / (loose_read / 1000.0));
+    printf("%-8s %12.3f %14.1f\n", "archive", pak_startup, mb / (pak_read / 1000.0));
+
+    return sink == 0 && total_bytes != 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc >= 4 && strcmp(argv[1], "pack") == 0) {
+        compression method = compression::none;
+        if(argc >= 5 && strcmp(argv[4], "--lz4") == 0) method = compression::lz4;
+        if(argc >= 5 && strcmp(argv[4], "--zstd") == 0) method = compression::zstd;
+
+        return pack(argv[2], argv[3], method);
+    }
+
+    if(argc >= 3 && strcmp(argv[1], "list") == 0) {
+        return list(argv[2]);
+    }
+
+    if(argc >= 4 && strcmp(argv[1], "bench") == 0) {
+        return bench(argv[2], argv[3], argc >= 5 ? atoi(argv[4]) : 100);
+    }
+
+    printf(
+        "usage:\n"
+        "  %s pack <assets dir> <out.pak> [--lz4 | --zstd]\n"
+        "  %s list <archive.pak>\n"
+        "  %s bench <archive.pak> <assets dir> [iterations]\n",
+        argv[0], argv[0], argv[0]);
+    return 1;
+}
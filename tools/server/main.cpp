@@ -0,0 +1,271 @@
+// headless match server: hosts many small core::worlds on threads
+// pinned to cores, no window or GPU. each world is a match that ticks at
+// its own rate, and what every tick costs is reported, to find how many
+// matches a machine holds
+//
+//   server [--worlds N] [--rates 20,30,60] [--entities N] [--physics]
+//          [--threads T] [--no-pin] [--seconds S] [--report S] [--match-seconds S]
+//
+// rates are handed out to the worlds in turn. --match-seconds ends every
+// match after that long and starts a new one in its place
+
+#include "server/world_host.hpp"
+#include "core/ecs/world.hpp"
+#include "core/physics/simulation.hpp"
+#include "core/physics/system.hpp"
+#include "components/components.hpp"
+
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace core;
+
+namespace {
+    // only the matches use it, so it lives here
+    struct velocity {
+        float x, y, z;
+    };
+
+    struct match_settings {
+        uint32_t entities = 64;
+        bool physics = false;
+    };
+
+    const float match_size = 50.0f;
+
+    uint32_t next_random(uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u;
+        return seed;
+    }
+
+    float random_float(uint32_t& seed) {
+        return float(next_random(seed) >> 8) / float(1 << 24);
+    }
+
+    // entities bouncing around a box, or a pile of bodies with --physics
+    void setup_match(world& w, const match_settings& settings, uint32_t seed) {
+        auto& registry = w.get_registry();
+
+        std::vector<entt::entity> entities(settings.entities);
+        for(auto& e : entities) {
+            e = registry.create();
+            registry.emplace<components::transform>(e,
+                structs::vector3{ random_float(seed) * match_size, random_float(seed) * match_size, 0.0f },
+                structs::vector3{ 1.0f, 1.0f, 1.0f },
+                structs::vector3{ 0.0f, 0.0f, 0.0f });
+        }
+
+        if(settings.physics) {
+            physics::settings physics_settings;
+            physics_settings.planar = true;
+
+            // the simulation and every body in it live in the world's pool
+            std::pmr::polymorphic_allocator<physics::simulation> allocator(w.memory());
+            physics::simulation* sim = allocator.allocate(1);
+            allocator.construct(sim, physics_settings, nullptr, w.memory());
+
+            physics::body_desc floor;
+            floor.type = physics::shape::box;
+            floor.mass = 0.0f;
+            floor.position[0] = match_size * 0.5f;
+            floor.position[1] = -1.0f;
+            floor.extents[0] = match_size;
+            floor.extents[1] = 1.0f;
+            floor.extents[2] = match_size;
+            sim->add_body(floor);
+
+            for(auto e : entities) {
+                physics::body_desc body;
+                body.extents[0] = body.extents[1] = body.extents[2] = 0.5f;
+                body.restitution = 0.2f;
+                physics::attach_body(w, *sim, e, body);
+            }
+
+            physics::register_physics(w, *sim);
+            // the simulation goes with the match. a bare pointer fits in
+            // std::function, so the capture stays off the global heap
+            w.add_dispose_system([sim](world& w) {
+                std::pmr::polymorphic_allocator<physics::simulation> allocator(w.memory());
+                allocator.destroy(sim);
+                allocator.deallocate(sim, 1);
+            });
+            return;
+        }
+
+        for(auto e : entities) {
+            registry.emplace<velocity>(e,
+                (random_float(seed) - 0.5f) * 10.0f, (random_float(seed) - 0.5f) * 10.0f, 0.0f);
+        }
+
+        w.add_update_system([](world& w) {
+            float delta = w.get_resource<world::delta_time>();
+            auto view = w.get_registry().view<components::transform, velocity>();
+
+            for(auto [entity, transform, v] : view.each()) {
+                transform.position.x += v.x * delta;
+                transform.position.y += v.y * delta;
+                if(transform.position.x < 0.0f || transform.position.x > match_size) v.x = -v.x;
+                if(transform.position.y < 0.0f || transform.position.y > match_size) v.y = -v.y;
+            }
+        });
+    }
+
+    std::vector<float> split_rates(const std::string& list) {
+        std::vector<float> out;
+        size_t start = 0;
+        while(start <= list.size()) {
+            size_t end = list.find(',', start);
+            if(end == std::string::npos) end = list.size();
+            if(end > start) out.push_back(strtof(list.substr(start, end - start).c_str(), nullptr));
+            start = end + 1;
+        }
+        return out;
+    }
+
+    // per shard totals, then the most expensive worlds
+    void report(server::world_host& host, double seconds) {
+        auto stats = host.stats();
+
+        std::vector<double> shard_load(host.shard_count(), 0.0);
+        std::vector<uint32_t> shard_worlds(host.shard_count(), 0);
+        double total_load = 0.0;
+        uint64_t late = 0, memory = 0;
+        for(auto& s : stats) {
+            shard_load[s.shard] += s.load;
+            shard_worlds[s.shard]++;
+            total_load += s.load;
+            late += s.late_ticks;
+            memory += s.memory_bytes;
+        }
+
+        printf("[%6.1fs] %zu worlds, %.2f cores busy, %llu late ticks, %.1f MiB in world pools\n",
+            seconds, stats.size(), total_load, (unsigned long long)late, memory / (1024.0 * 1024.0));
+
+        for(uint32_t i = 0; i < host.shard_count(); i++) {
+            printf("  shard %2u  %4u worlds  %5.1f%% busy\n", i, shard_worlds[i], shard_load[i] * 100.0);
+        }
+
+        std::sort(stats.begin(), stats.end(), [](auto& a, auto& b) { return a.load > b.load; });
+        printf("  %6s %5s %5s %9s %9s %9s %7s %10s %10s %8s\n",
+            "world", "shard", "hz", "mean ms", "max ms", "load %", "late", "pool KiB", "arena KiB", "allocs");
+        for(size_t i = 0; i < std::min<size_t>(stats.size(), 5); i++) {
+            auto& s = stats[i];
+            printf("  %6u %5u %5.0f %9.3f %9.3f %9.2f %7llu %10.1f %10.1f %8llu\n",
+                s.id, s.shard, s.tick_rate, s.mean_ms, s.max_ms, s.load * 100.0,
+                (unsigned long long)s.late_ticks, s.memory_bytes / 1024.0, s.arena_peak_bytes / 1024.0,
+                (unsigned long long)s.allocations);
+        }
+
+        // what one core holds at the load measured so far
+        if(total_load > 0.0) {
+            printf("  ~%.0f worlds per core\n", stats.size() / total_load);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t worlds = 256;
+    std::vector<float> rates = { 30.0f };
+    match_settings match;
+    server::world_host::settings host_settings;
+    double seconds = 30.0, report_every = 5.0, match_seconds = 0.0;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if(arg == "--physics") {
+            match.physics = true;
+            continue;
+        }
+        if(arg == "--no-pin") {
+            host_settings.pin = false;
+            continue;
+        }
+
+        if(i + 1 >= argc) {
+            printf("%s needs a value\n", arg.c_str());
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if(arg == "--worlds") {
+            worlds = strtoul(value, nullptr, 10);
+        } else if(arg == "--rates") {
+            rates = split_rates(value);
+        } else if(arg == "--entities") {
+            match.entities = strtoul(value, nullptr, 10);
+        } else if(arg == "--threads") {
+            host_settings.threads = strtoul(value, nullptr, 10);
+        } else if(arg == "--seconds") {
+            seconds = strtod(value, nullptr);
+        } else if(arg == "--report") {
+            report_every = strtod(value, nullptr);
+        } else if(arg == "--match-seconds") {
+            match_seconds = strtod(value, nullptr);
+        } else {
+            printf("unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    if(rates.empty() || std::any_of(rates.begin(), rates.end(), [](float r) { return r <= 0.0f; })) {
+        printf("--rates needs positive tick rates\n");
+        return 1;
+    }
+
+    server::world_host host(host_settings);
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+    struct hosted_match {
+        server::world_host::world_id id;
+        float rate;
+        double started;
+    };
+    std::vector<hosted_match> matches;
+    uint32_t seed = 1;
+
+    auto start_match = [&](float rate) {
+        uint32_t match_seed = next_random(seed);
+        auto id = host.add(rate, [match, match_seed](world& w) { setup_match(w, match, match_seed); });
+        return hosted_match{ id, rate, elapsed() };
+    };
+
+    for(uint32_t i = 0; i < worlds; i++) {
+        matches.push_back(start_match(rates[i % rates.size()]));
+    }
+
+    printf("hosting %u worlds on %u shards%s\n", worlds, host.shard_count(), host_settings.pin ? ", pinned" : "");
+
+    double next_report = report_every;
+    while(elapsed() < seconds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        double now = elapsed();
+
+        if(match_seconds > 0.0) {
+            for(auto& m : matches) {
+                if(now - m.started < match_seconds) continue;
+                host.remove(m.id);
+                m = start_match(m.rate);
+            }
+        }
+
+        if(now >= next_report) {
+            report(host, now);
+            next_report += report_every;
+        }
+    }
+
+    report(host, elapsed());
+    return 0;
+}